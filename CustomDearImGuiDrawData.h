@@ -0,0 +1,1105 @@
+#pragma once
+#include "imgui.h"
+#include "imgui_internal.h"
+#include <cstdint>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Draw data utilities. Everything here works on the ImDrawData returned by ImGui::GetDrawData() after ImGui::Render()
+// and doesn't rely on any rendering backend.
+namespace DearImGuiExt
+{
+    // ImDrawData::CmdLists became an owned ImVector in 1.89.8. Hide the difference from the rest of the code.
+    inline void SetDrawDataCmdLists(
+        ImDrawData*            pDrawData,
+        ImVector<ImDrawList*>& lists)
+    {
+#if IMGUI_VERSION_NUM >= 18980
+        pDrawData->CmdLists.resize(lists.Size);
+        if (lists.Size > 0)
+        {
+            memcpy(pDrawData->CmdLists.Data, lists.Data, lists.size_in_bytes());
+        }
+#else
+        pDrawData->CmdLists = lists.Data;
+#endif
+        pDrawData->CmdListsCount = lists.Size;
+    }
+
+    // Per capture counters of a DrawDataSnapshot.
+    struct DrawDataSnapshotStats
+    {
+        size_t bytesCopied;    // Vertex, index and command bytes copied by the last capture.
+        int    listsCopied;    // Draw lists in the last capture.
+        int    listsCreated;   // Draw lists the last capture had to create because no retired one was available.
+        int    buffersGrown;   // Vertex/index/command buffers that had to grow. 0 in steady state.
+    };
+
+    // A deep copy of a frame's ImDrawData. It owns its draw lists, so the Dear ImGui context can start building the next
+    // frame while the copy is consumed somewhere else.
+    // The owned lists are kept between captures and matched to their source list, so a snapshot reused every frame
+    // stops allocating once every buffer has reached its peak size.
+    class DrawDataSnapshot
+    {
+    public:
+        DrawDataSnapshot()
+            : m_stats()
+        {}
+
+        ~DrawDataSnapshot()
+        {
+            Clear();
+            for (int i = 0; i < m_spareLists.Size; i++)
+            {
+                IM_DELETE(m_spareLists[i]);
+            }
+        }
+
+        // Must be called on the thread that owns the Dear ImGui context, because the copies are allocated by its allocator.
+        void Capture(const ImDrawData* pSrc)
+        {
+            assert((void("ERROR: The source draw data cannot be NULL."), pSrc != nullptr));
+            m_stats = DrawDataSnapshotStats();
+
+            // Retire all lists of the previous capture. The ones whose source list is still alive are picked back up
+            // below, so each window keeps the capacity it needed last frame.
+            m_previousLists.swap(m_lists);
+            m_previousSources.swap(m_sources);
+            m_lists.resize(0);
+            m_sources.resize(0);
+
+            int searchStart = 0;
+            for (int i = 0; i < pSrc->CmdListsCount; i++)
+            {
+                const ImDrawList* pSrcList = pSrc->CmdLists[i];
+                ImDrawList* pDstList = TakePreviousList(pSrcList, searchStart);
+                if (pDstList == nullptr)
+                {
+                    pDstList = AcquireSpareList(pSrcList);
+                }
+
+                CopyBuffer(pDstList->CmdBuffer, pSrcList->CmdBuffer);
+                CopyBuffer(pDstList->IdxBuffer, pSrcList->IdxBuffer);
+                CopyBuffer(pDstList->VtxBuffer, pSrcList->VtxBuffer);
+                pDstList->Flags = pSrcList->Flags;
+                pDstList->_OwnerName = pSrcList->_OwnerName;
+
+                m_lists.push_back(pDstList);
+                m_sources.push_back(pSrcList);
+                m_stats.listsCopied++;
+            }
+
+            // Lists of windows that disappeared become spares for windows that may appear later.
+            for (int i = 0; i < m_previousLists.Size; i++)
+            {
+                if (m_previousSources[i])
+                {
+                    m_spareLists.push_back(m_previousLists[i]);
+                }
+            }
+            m_previousLists.resize(0);
+            m_previousSources.resize(0);
+
+            m_drawData.Valid            = pSrc->Valid;
+            m_drawData.TotalIdxCount    = pSrc->TotalIdxCount;
+            m_drawData.TotalVtxCount    = pSrc->TotalVtxCount;
+            m_drawData.DisplayPos       = pSrc->DisplayPos;
+            m_drawData.DisplaySize      = pSrc->DisplaySize;
+            m_drawData.FramebufferScale = pSrc->FramebufferScale;
+            m_drawData.OwnerViewport    = pSrc->OwnerViewport;
+            SetDrawDataCmdLists(&m_drawData, m_lists);
+        }
+
+        // Releases every owned list. The next capture starts from scratch.
+        void Clear()
+        {
+            for (int i = 0; i < m_lists.Size; i++)
+            {
+                IM_DELETE(m_lists[i]);
+            }
+            m_lists.resize(0);
+            m_sources.resize(0);
+            SetDrawDataCmdLists(&m_drawData, m_lists);
+            m_drawData.Valid = false;
+        }
+
+        ImDrawData* GetDrawData() { return &m_drawData; }
+        const DrawDataSnapshotStats& GetStats() const { return m_stats; }
+
+        // Source list of each list of GetDrawData(), in the same order. The owned lists change from one capture to the
+        // next, the source lists don't, so these identify a window across frames. Only valid as keys.
+        const ImDrawList* const* GetSourceLists() const { return m_sources.Data; }
+
+    private:
+        DrawDataSnapshot(const DrawDataSnapshot&) = delete;
+        DrawDataSnapshot& operator=(const DrawDataSnapshot&) = delete;
+
+        // Matched by the address of the source list. Windows are rendered in about the same order every frame, so the
+        // search starts after the last match. A taken list has its source cleared.
+        ImDrawList* TakePreviousList(
+            const ImDrawList* pSrcList,
+            int&              searchStart)
+        {
+            for (int n = 0; n < m_previousSources.Size; n++)
+            {
+                int i = (searchStart + n) % m_previousSources.Size;
+                if (m_previousSources[i] == pSrcList)
+                {
+                    m_previousSources[i] = nullptr;
+                    searchStart = i + 1;
+                    return m_previousLists[i];
+                }
+            }
+            return nullptr;
+        }
+
+        ImDrawList* AcquireSpareList(const ImDrawList* pSrcList)
+        {
+            if (m_spareLists.Size > 0)
+            {
+                ImDrawList* pList = m_spareLists.back();
+                m_spareLists.pop_back();
+                return pList;
+            }
+
+            m_stats.listsCreated++;
+            return IM_NEW(ImDrawList)(pSrcList->_Data);
+        }
+
+        template<typename T>
+        void CopyBuffer(ImVector<T>& dst, const ImVector<T>& src)
+        {
+            if (src.Size > dst.Capacity)
+            {
+                m_stats.buffersGrown++;
+            }
+            dst.resize(src.Size);
+            if (src.Size > 0)
+            {
+                memcpy(dst.Data, src.Data, (size_t)src.size_in_bytes());
+            }
+            m_stats.bytesCopied += (size_t)src.size_in_bytes();
+        }
+
+        ImVector<ImDrawList*>       m_lists;
+        ImVector<const ImDrawList*> m_sources;         // Source list of each entry in m_lists. Only used as a key.
+        ImVector<ImDrawList*>       m_spareLists;      // Retired lists kept for their capacity.
+        ImVector<ImDrawList*>       m_previousLists;   // Lists of the previous capture, during a capture.
+        ImVector<const ImDrawList*> m_previousSources; // Their source lists. Cleared once a list is taken.
+        ImDrawData                  m_drawData;
+        DrawDataSnapshotStats       m_stats;
+    };
+
+    // A set of reusable snapshots for consumers that hold on to frames for a while, e.g. recorders or network streamers.
+    // Release() can be called from any thread. Capture() has to run on the thread that owns the Dear ImGui context.
+    class DrawDataSnapshotPool
+    {
+    public:
+        DrawDataSnapshotPool() {}
+
+        ~DrawDataSnapshotPool()
+        {
+            assert((void("ERROR: All snapshots must be released before destroying the pool."),
+                    m_freeSnapshots.Size == m_allSnapshots.Size));
+            for (int i = 0; i < m_allSnapshots.Size; i++)
+            {
+                delete m_allSnapshots[i];
+            }
+        }
+
+        // Takes a free snapshot and captures the draw data into it. A snapshot is only created when all of them are
+        // in use.
+        DrawDataSnapshot* Capture(const ImDrawData* pSrc)
+        {
+            DrawDataSnapshot* pSnapshot = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_freeSnapshots.Size > 0)
+                {
+                    pSnapshot = m_freeSnapshots.back();
+                    m_freeSnapshots.pop_back();
+                }
+                else
+                {
+                    pSnapshot = new DrawDataSnapshot();
+                    m_allSnapshots.push_back(pSnapshot);
+                }
+            }
+
+            pSnapshot->Capture(pSrc);
+            m_lastBytesCopied = pSnapshot->GetStats().bytesCopied;
+            return pSnapshot;
+        }
+
+        void Release(DrawDataSnapshot* pSnapshot)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_freeSnapshots.push_back(pSnapshot);
+        }
+
+        // Bytes copied by the latest Capture().
+        size_t GetLastBytesCopied() const { return m_lastBytesCopied; }
+
+        int GetSnapshotCount()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_allSnapshots.Size;
+        }
+
+    private:
+        DrawDataSnapshotPool(const DrawDataSnapshotPool&) = delete;
+        DrawDataSnapshotPool& operator=(const DrawDataSnapshotPool&) = delete;
+
+        std::mutex                  m_mutex;
+        ImVector<DrawDataSnapshot*> m_allSnapshots;
+        ImVector<DrawDataSnapshot*> m_freeSnapshots;
+        size_t                      m_lastBytesCopied = 0;
+    };
+
+    // Per frame counters of a DrawDataDamageTracker.
+    struct DrawDataDamageStats
+    {
+        int   changedLists;    // Lists that changed, moved in the draw order, appeared or disappeared.
+        int   damageRects;     // After merging.
+        float damagedFraction; // Share of the display covered by the damage rects.
+    };
+
+    // Finds the parts of the display whose pixels can differ from the previous frame. Every draw list is compared with its
+    // copy from the previous frame, so a leaf window that draws the same thing again causes no damage, and one that changed
+    // or moved damages its old and new clip rects. Drawing the whole draw data clipped to the damage rects, over the
+    // previous frame's pixels, gives the same image as a full redraw.
+    // Rects are (min x, min y, max x, max y) in draw data coordinates, cover whole framebuffer pixels and don't overlap.
+    class DrawDataDamageTracker
+    {
+    public:
+        static constexpr int MaxRects = 8;      // More damage rects are merged, wasting as little area as possible.
+        static constexpr int HistoryFrames = 4; // Damage kept for swapchain images that were rendered a few frames ago.
+
+        DrawDataDamageTracker()
+            : m_displayPos(0.f, 0.f),
+              m_displaySize(0.f, 0.f),
+              m_framebufferScale(0.f, 0.f),
+              m_historyHead(0),
+              m_historyCount(0),
+              m_stats()
+        {}
+
+        ~DrawDataDamageTracker()
+        {
+            Reset();
+        }
+
+        // ppListKeys identifies each list of the draw data from one frame to the next. It defaults to the lists
+        // themselves. Pass DrawDataSnapshot::GetSourceLists() when the draw data is a snapshot.
+        void Update(
+            const ImDrawData*        pDrawData,
+            const ImDrawList* const* ppListKeys = nullptr)
+        {
+            assert((void("ERROR: The draw data cannot be NULL."), pDrawData != nullptr));
+            m_stats = DrawDataDamageStats();
+            m_damage.resize(0);
+
+            ImVec4 display(pDrawData->DisplayPos.x,
+                           pDrawData->DisplayPos.y,
+                           pDrawData->DisplayPos.x + pDrawData->DisplaySize.x,
+                           pDrawData->DisplayPos.y + pDrawData->DisplaySize.y);
+            bool isFullDamage = (pDrawData->DisplayPos.x != m_displayPos.x) || (pDrawData->DisplayPos.y != m_displayPos.y) ||
+                                (pDrawData->DisplaySize.x != m_displaySize.x) || (pDrawData->DisplaySize.y != m_displaySize.y) ||
+                                (pDrawData->FramebufferScale.x != m_framebufferScale.x) ||
+                                (pDrawData->FramebufferScale.y != m_framebufferScale.y);
+            m_displayPos = pDrawData->DisplayPos;
+            m_displaySize = pDrawData->DisplaySize;
+            m_framebufferScale = pDrawData->FramebufferScale;
+
+            for (int i = 0; i < m_lists.Size; i++)
+            {
+                m_lists[i]->isSeen = false;
+            }
+
+            int searchStart = 0;
+            for (int i = 0; i < pDrawData->CmdListsCount; i++)
+            {
+                const ImDrawList* pSrcList = pDrawData->CmdLists[i];
+                const ImDrawList* pKey = ppListKeys ? ppListKeys[i] : pSrcList;
+                ListState* pState = FindListState(pKey, searchStart);
+                if (pState == nullptr)
+                {
+                    pState = IM_NEW(ListState)();
+                    pState->pKey = pKey;
+                    pState->order = -1;
+                    m_lists.push_back(pState);
+                }
+                pState->isSeen = true;
+
+                ImVec4 bounds = ListBounds(pSrcList, display);
+                if ((pState->order != i) || (IsSameList(pState, pSrcList) == false))
+                {
+                    // A list that didn't exist has empty bounds.
+                    if (pState->order >= 0)
+                    {
+                        m_damage.push_back(pState->bounds);
+                    }
+                    m_damage.push_back(bounds);
+                    CopyBuffer(pState->vtx, pSrcList->VtxBuffer);
+                    CopyBuffer(pState->idx, pSrcList->IdxBuffer);
+                    CopyBuffer(pState->cmd, pSrcList->CmdBuffer);
+                    m_stats.changedLists++;
+                }
+                pState->bounds = bounds;
+                pState->order = i;
+            }
+
+            // The windows that disappeared leave their last bounds damaged.
+            for (int i = 0; i < m_lists.Size;)
+            {
+                ListState* pState = m_lists[i];
+                if (pState->isSeen)
+                {
+                    i++;
+                    continue;
+                }
+                m_damage.push_back(pState->bounds);
+                m_stats.changedLists++;
+                IM_DELETE(pState);
+                m_lists.erase(m_lists.begin() + i);
+            }
+
+            if (isFullDamage)
+            {
+                m_damage.resize(0);
+                m_damage.push_back(display);
+            }
+            MergeRects(m_damage, display);
+
+            m_historyHead = (m_historyHead + 1) % HistoryFrames;
+            CopyBuffer(m_history[m_historyHead], m_damage);
+            m_historyCount = ImMin(m_historyCount + 1, HistoryFrames);
+
+            float damagedArea = 0.f;
+            for (int i = 0; i < m_damage.Size; i++)
+            {
+                damagedArea += RectArea(m_damage[i]);
+            }
+            float displayArea = RectArea(display);
+            m_stats.damageRects = m_damage.Size;
+            m_stats.damagedFraction = (displayArea > 0.f) ? damagedArea / displayArea : 0.f;
+        }
+
+        // Damage of the last update.
+        const ImVector<ImVec4>& GetDamageRects() const { return m_damage; }
+
+        // Damage of the last frameCount updates together, for an image that was last rendered frameCount frames ago.
+        // Returns false when the damage of that many frames isn't known anymore: the image has to be drawn whole.
+        bool CollectDamage(
+            int               frameCount,
+            ImVector<ImVec4>& rects) const
+        {
+            rects.resize(0);
+            if ((frameCount <= 0) || (frameCount > m_historyCount))
+            {
+                return false;
+            }
+
+            for (int i = 0; i < frameCount; i++)
+            {
+                const ImVector<ImVec4>& frameRects = m_history[(m_historyHead + HistoryFrames - i) % HistoryFrames];
+                for (int n = 0; n < frameRects.Size; n++)
+                {
+                    rects.push_back(frameRects[n]);
+                }
+            }
+            MergeRects(rects, ImVec4(m_displayPos.x, m_displayPos.y, m_displayPos.x + m_displaySize.x, m_displayPos.y + m_displaySize.y));
+            return true;
+        }
+
+        // Forgets every list. The next update damages the whole display, e.g. after the swapchain was recreated.
+        void Reset()
+        {
+            for (int i = 0; i < m_lists.Size; i++)
+            {
+                IM_DELETE(m_lists[i]);
+            }
+            m_lists.resize(0);
+            m_displaySize = ImVec2(0.f, 0.f);
+            m_historyCount = 0;
+        }
+
+        const DrawDataDamageStats& GetStats() const { return m_stats; }
+
+    private:
+        DrawDataDamageTracker(const DrawDataDamageTracker&) = delete;
+        DrawDataDamageTracker& operator=(const DrawDataDamageTracker&) = delete;
+
+        // The previous frame's copy of a list.
+        struct ListState
+        {
+            ImVector<ImDrawVert> vtx;
+            ImVector<ImDrawIdx>  idx;
+            ImVector<ImDrawCmd>  cmd;
+            ImVec4               bounds;
+            const ImDrawList*    pKey;    // Source list of the draw data, or the key given to Update().
+            int                  order;   // Index in the draw data. -1 before the first frame of the list.
+            bool                 isSeen;  // In the current frame.
+        };
+
+        static float RectArea(const ImVec4& rect)
+        {
+            return (rect.z - rect.x) * (rect.w - rect.y);
+        }
+
+        static bool IsRectEmpty(const ImVec4& rect)
+        {
+            return (rect.z <= rect.x) || (rect.w <= rect.y);
+        }
+
+        static ImVec4 UnionRect(
+            const ImVec4& a,
+            const ImVec4& b)
+        {
+            return ImVec4(ImMin(a.x, b.x), ImMin(a.y, b.y), ImMax(a.z, b.z), ImMax(a.w, b.w));
+        }
+
+        // Everything a list draws is within the clip rects of its commands.
+        static ImVec4 ListBounds(
+            const ImDrawList* pList,
+            const ImVec4&     display)
+        {
+            ImVec4 bounds(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+            for (int i = 0; i < pList->CmdBuffer.Size; i++)
+            {
+                const ImDrawCmd& cmd = pList->CmdBuffer[i];
+                if ((cmd.ElemCount > 0) || cmd.UserCallback)
+                {
+                    bounds = UnionRect(bounds, cmd.ClipRect);
+                }
+            }
+            bounds = ImVec4(ImMax(bounds.x, display.x), ImMax(bounds.y, display.y), ImMin(bounds.z, display.z), ImMin(bounds.w, display.w));
+            return IsRectEmpty(bounds) ? ImVec4(0.f, 0.f, 0.f, 0.f) : bounds;
+        }
+
+        static bool IsSameList(
+            const ListState*  pState,
+            const ImDrawList* pList)
+        {
+            if ((pState->vtx.Size != pList->VtxBuffer.Size) || (pState->idx.Size != pList->IdxBuffer.Size) ||
+                (pState->cmd.Size != pList->CmdBuffer.Size))
+            {
+                return false;
+            }
+
+            for (int i = 0; i < pState->cmd.Size; i++)
+            {
+                const ImDrawCmd& a = pState->cmd[i];
+                const ImDrawCmd& b = pList->CmdBuffer[i];
+                if ((a.ClipRect.x != b.ClipRect.x) || (a.ClipRect.y != b.ClipRect.y) || (a.ClipRect.z != b.ClipRect.z) ||
+                    (a.ClipRect.w != b.ClipRect.w) || (a.TextureId != b.TextureId) || (a.VtxOffset != b.VtxOffset) ||
+                    (a.IdxOffset != b.IdxOffset) || (a.ElemCount != b.ElemCount) || (a.UserCallback != b.UserCallback) ||
+                    (a.UserCallbackData != b.UserCallbackData))
+                {
+                    return false;
+                }
+            }
+            return ((pState->vtx.Size == 0) || (memcmp(pState->vtx.Data, pList->VtxBuffer.Data, (size_t)pState->vtx.size_in_bytes()) == 0)) &&
+                   ((pState->idx.Size == 0) || (memcmp(pState->idx.Data, pList->IdxBuffer.Data, (size_t)pState->idx.size_in_bytes()) == 0));
+        }
+
+        template<typename T>
+        static void CopyBuffer(ImVector<T>& dst, const ImVector<T>& src)
+        {
+            dst.resize(src.Size);
+            if (src.Size > 0)
+            {
+                memcpy(dst.Data, src.Data, (size_t)src.size_in_bytes());
+            }
+        }
+
+        // Grows the rect to whole framebuffer pixels, so a scissor covers exactly the same pixels as a clear.
+        ImVec4 SnapRectToPixels(const ImVec4& rect) const
+        {
+            ImVec2 scale(ImMax(m_framebufferScale.x, 1e-6f), ImMax(m_framebufferScale.y, 1e-6f));
+            return ImVec4(m_displayPos.x + floorf((rect.x - m_displayPos.x) * scale.x) / scale.x,
+                          m_displayPos.y + floorf((rect.y - m_displayPos.y) * scale.y) / scale.y,
+                          m_displayPos.x + ceilf((rect.z - m_displayPos.x) * scale.x) / scale.x,
+                          m_displayPos.y + ceilf((rect.w - m_displayPos.y) * scale.y) / scale.y);
+        }
+
+        // Overlapping rects are replaced by their bounding box until none overlap. Past MaxRects, the two rects whose
+        // bounding box adds the least area are merged.
+        void MergeRects(
+            ImVector<ImVec4>& rects,
+            const ImVec4&     display) const
+        {
+            for (int i = 0; i < rects.Size;)
+            {
+                ImVec4& rect = rects[i];
+                rect = SnapRectToPixels(ImVec4(ImMax(rect.x, display.x), ImMax(rect.y, display.y), ImMin(rect.z, display.z), ImMin(rect.w, display.w)));
+                if (IsRectEmpty(rect))
+                {
+                    rects.erase(rects.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            while (true)
+            {
+                bool isMerged = false;
+                for (int i = 0; (i < rects.Size) && (isMerged == false); i++)
+                {
+                    for (int j = i + 1; j < rects.Size; j++)
+                    {
+                        const ImVec4& a = rects[i];
+                        const ImVec4& b = rects[j];
+                        if ((a.x < b.z) && (b.x < a.z) && (a.y < b.w) && (b.y < a.w))
+                        {
+                            rects[i] = UnionRect(a, b);
+                            rects.erase(rects.begin() + j);
+                            isMerged = true;
+                            break;
+                        }
+                    }
+                }
+
+                if (isMerged)
+                {
+                    continue;
+                }
+                if (rects.Size <= MaxRects)
+                {
+                    break;
+                }
+
+                int bestI = 0;
+                int bestJ = 1;
+                float bestWaste = FLT_MAX;
+                for (int i = 0; i < rects.Size; i++)
+                {
+                    for (int j = i + 1; j < rects.Size; j++)
+                    {
+                        float waste = RectArea(UnionRect(rects[i], rects[j])) - RectArea(rects[i]) - RectArea(rects[j]);
+                        if (waste < bestWaste)
+                        {
+                            bestWaste = waste;
+                            bestI = i;
+                            bestJ = j;
+                        }
+                    }
+                }
+                rects[bestI] = UnionRect(rects[bestI], rects[bestJ]);
+                rects.erase(rects.begin() + bestJ);
+            }
+        }
+
+        // Matched by the list's key. New lists are appended to m_lists, so it stays close to the draw order and the
+        // search starts after the last match.
+        ListState* FindListState(
+            const ImDrawList* pKey,
+            int&              searchStart) const
+        {
+            for (int n = 0; n < m_lists.Size; n++)
+            {
+                int i = (searchStart + n) % m_lists.Size;
+                if (m_lists[i]->pKey == pKey)
+                {
+                    searchStart = i + 1;
+                    return m_lists[i];
+                }
+            }
+            return nullptr;
+        }
+
+        ImVector<ListState*> m_lists;
+        ImVec2               m_displayPos;
+        ImVec2               m_displaySize;
+        ImVec2               m_framebufferScale;
+
+        ImVector<ImVec4> m_damage;
+        ImVector<ImVec4> m_history[HistoryFrames]; // Damage of the last frames. m_historyHead is the newest.
+        int              m_historyHead;
+        int              m_historyCount;
+
+        DrawDataDamageStats m_stats;
+    };
+
+    // Restricts draw data to a set of rects that don't overlap, e.g. the damage of a DrawDataDamageTracker. Every command is
+    // repeated once per rect it touches, with its clip rect cut down to that rect, so a renderer that scissors by clip rect
+    // draws nothing outside the rects and no pixel twice. The vertices and indices are shared with the original commands.
+    // The command buffers are kept between frames.
+    class DrawDataClipper
+    {
+    public:
+        DrawDataClipper()
+            : m_pDrawData(nullptr)
+        {}
+
+        ~DrawDataClipper()
+        {
+            Restore();
+            for (int i = 0; i < m_cmdBuffers.Size; i++)
+            {
+                IM_DELETE(m_cmdBuffers[i]);
+            }
+        }
+
+        // The draw data uses the clipped commands until Restore().
+        void Clip(
+            ImDrawData*             pDrawData,
+            const ImVector<ImVec4>& rects)
+        {
+            assert((void("ERROR: The draw data cannot be NULL."), pDrawData != nullptr));
+            assert((void("ERROR: The previous draw data wasn't restored."), m_pDrawData == nullptr));
+            m_pDrawData = pDrawData;
+
+            while (m_cmdBuffers.Size < pDrawData->CmdListsCount)
+            {
+                m_cmdBuffers.push_back(IM_NEW(ImVector<ImDrawCmd>)());
+            }
+
+            for (int i = 0; i < pDrawData->CmdListsCount; i++)
+            {
+                ImDrawList* pList = pDrawData->CmdLists[i];
+                ImVector<ImDrawCmd>& clipped = *m_cmdBuffers[i];
+                clipped.resize(0);
+                for (int c = 0; c < pList->CmdBuffer.Size; c++)
+                {
+                    const ImDrawCmd& cmd = pList->CmdBuffer[c];
+                    if (cmd.UserCallback)
+                    {
+                        clipped.push_back(cmd);
+                        continue;
+                    }
+
+                    for (int r = 0; r < rects.Size; r++)
+                    {
+                        ImVec4 clip(ImMax(cmd.ClipRect.x, rects[r].x),
+                                    ImMax(cmd.ClipRect.y, rects[r].y),
+                                    ImMin(cmd.ClipRect.z, rects[r].z),
+                                    ImMin(cmd.ClipRect.w, rects[r].w));
+                        if ((clip.x < clip.z) && (clip.y < clip.w) && (cmd.ElemCount > 0))
+                        {
+                            clipped.push_back(cmd);
+                            clipped.back().ClipRect = clip;
+                        }
+                    }
+                }
+                pList->CmdBuffer.swap(clipped);
+            }
+        }
+
+        // Puts the original commands back. Does nothing when nothing is clipped.
+        void Restore()
+        {
+            if (m_pDrawData == nullptr)
+            {
+                return;
+            }
+
+            for (int i = 0; i < m_pDrawData->CmdListsCount; i++)
+            {
+                m_pDrawData->CmdLists[i]->CmdBuffer.swap(*m_cmdBuffers[i]);
+            }
+            m_pDrawData = nullptr;
+        }
+
+    private:
+        DrawDataClipper(const DrawDataClipper&) = delete;
+        DrawDataClipper& operator=(const DrawDataClipper&) = delete;
+
+        ImDrawData*                    m_pDrawData;  // Clipped draw data, until Restore().
+        ImVector<ImVector<ImDrawCmd>*> m_cmdBuffers; // One per list. Holds the original commands while clipped.
+    };
+
+    // Per frame counters of a DrawDataBatcher.
+    struct DrawDataBatchStats
+    {
+        int listsBefore; // Draw lists of the source draw data.
+        int cmdsBefore;  // Draw calls and callbacks of the source draw data.
+        int cmdsAfter;   // Draw calls and callbacks of the batched draw data.
+    };
+
+    // Copies every draw list of a frame into one list and joins consecutive commands that use the same texture, so the
+    // windows of a layout cost a few draw calls instead of a few per window. Two commands are joined when they have the
+    // same clip rect, or when the geometry of both lies within its own clip rect: the joined command then uses the union
+    // of the clip rects, which hides nothing either of them drew. Only consecutive commands are joined, so the draw order
+    // doesn't change. Callbacks are copied as they are and nothing is joined across them.
+    // The renderer has to support ImDrawCmd::VtxOffset (ImGuiBackendFlags_RendererHasVtxOffset), as the Vulkan backend
+    // does, because the batched list can have more vertices than a 16-bit index reaches. Callbacks get the batched list.
+    // The buffers are kept between frames.
+    class DrawDataBatcher
+    {
+    public:
+        DrawDataBatcher()
+            : m_pList(nullptr),
+              m_stats()
+        {}
+
+        ~DrawDataBatcher()
+        {
+            IM_DELETE(m_pList);
+        }
+
+        // The returned draw data stays valid until the next call. The source draw data isn't modified.
+        ImDrawData* Batch(const ImDrawData* pSrc)
+        {
+            assert((void("ERROR: The source draw data cannot be NULL."), pSrc != nullptr));
+            m_stats = DrawDataBatchStats();
+            m_stats.listsBefore = pSrc->CmdListsCount;
+
+            if ((m_pList == nullptr) && (pSrc->CmdListsCount > 0))
+            {
+                m_pList = IM_NEW(ImDrawList)(pSrc->CmdLists[0]->_Data);
+            }
+
+            m_lists.resize(0);
+            if (m_pList)
+            {
+                m_pList->CmdBuffer.resize(0);
+                m_pList->IdxBuffer.resize(0);
+                m_pList->VtxBuffer.resize(0);
+                m_lists.push_back(m_pList);
+            }
+
+            // Whether the geometry of the last batched command lies within its clip rect.
+            bool isLastContained = false;
+            for (int i = 0; i < pSrc->CmdListsCount; i++)
+            {
+                const ImDrawList* pSrcList = pSrc->CmdLists[i];
+                unsigned int vtxBase = (unsigned int)m_pList->VtxBuffer.Size;
+                AppendBuffer(m_pList->VtxBuffer, pSrcList->VtxBuffer);
+
+                for (int c = 0; c < pSrcList->CmdBuffer.Size; c++)
+                {
+                    const ImDrawCmd& cmd = pSrcList->CmdBuffer[c];
+                    if ((cmd.ElemCount == 0) && (cmd.UserCallback == nullptr))
+                    {
+                        continue;
+                    }
+                    m_stats.cmdsBefore++;
+
+                    if (cmd.UserCallback)
+                    {
+                        m_pList->CmdBuffer.push_back(cmd);
+                        m_pList->CmdBuffer.back().VtxOffset += vtxBase;
+                        m_pList->CmdBuffer.back().IdxOffset = (unsigned int)m_pList->IdxBuffer.Size;
+                        continue;
+                    }
+
+                    // Bounds of the geometry and highest index.
+                    const ImDrawIdx* pIdx = pSrcList->IdxBuffer.Data + cmd.IdxOffset;
+                    const ImDrawVert* pVtx = pSrcList->VtxBuffer.Data + cmd.VtxOffset;
+                    ImVec4 bounds(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+                    unsigned int maxIdx = 0;
+                    for (unsigned int n = 0; n < cmd.ElemCount; n++)
+                    {
+                        const ImVec2& pos = pVtx[pIdx[n]].pos;
+                        bounds = ImVec4(ImMin(bounds.x, pos.x), ImMin(bounds.y, pos.y), ImMax(bounds.z, pos.x), ImMax(bounds.w, pos.y));
+                        maxIdx = ImMax(maxIdx, (unsigned int)pIdx[n]);
+                    }
+                    bool isContained = (bounds.x >= cmd.ClipRect.x) && (bounds.y >= cmd.ClipRect.y) &&
+                                       (bounds.z <= cmd.ClipRect.z) && (bounds.w <= cmd.ClipRect.w);
+
+                    unsigned int vtxOffset = vtxBase + cmd.VtxOffset;
+                    ImDrawCmd* pLast = (m_pList->CmdBuffer.Size > 0) ? &m_pList->CmdBuffer.back() : nullptr;
+                    bool isJoined = false;
+                    if (pLast && (pLast->UserCallback == nullptr) && (pLast->TextureId == cmd.TextureId) &&
+                        (vtxOffset >= pLast->VtxOffset) && ((uint64_t)maxIdx + (vtxOffset - pLast->VtxOffset) <= MaxIndex()))
+                    {
+                        bool isSameClip = (pLast->ClipRect.x == cmd.ClipRect.x) && (pLast->ClipRect.y == cmd.ClipRect.y) &&
+                                          (pLast->ClipRect.z == cmd.ClipRect.z) && (pLast->ClipRect.w == cmd.ClipRect.w);
+                        if (isSameClip || (isLastContained && isContained))
+                        {
+                            pLast->ClipRect = ImVec4(ImMin(pLast->ClipRect.x, cmd.ClipRect.x),
+                                                     ImMin(pLast->ClipRect.y, cmd.ClipRect.y),
+                                                     ImMax(pLast->ClipRect.z, cmd.ClipRect.z),
+                                                     ImMax(pLast->ClipRect.w, cmd.ClipRect.w));
+                            AppendIndices(pIdx, cmd.ElemCount, vtxOffset - pLast->VtxOffset);
+                            pLast->ElemCount += cmd.ElemCount;
+                            isLastContained = isLastContained && isContained;
+                            isJoined = true;
+                        }
+                    }
+
+                    if (isJoined == false)
+                    {
+                        ImDrawCmd batched = cmd;
+                        batched.VtxOffset = vtxOffset;
+                        batched.IdxOffset = (unsigned int)m_pList->IdxBuffer.Size;
+                        m_pList->CmdBuffer.push_back(batched);
+                        AppendIndices(pIdx, cmd.ElemCount, 0);
+                        isLastContained = isContained;
+                    }
+                }
+            }
+            m_stats.cmdsAfter = m_pList ? m_pList->CmdBuffer.Size : 0;
+
+            m_drawData.Valid            = pSrc->Valid;
+            m_drawData.TotalIdxCount    = m_pList ? m_pList->IdxBuffer.Size : 0;
+            m_drawData.TotalVtxCount    = m_pList ? m_pList->VtxBuffer.Size : 0;
+            m_drawData.DisplayPos       = pSrc->DisplayPos;
+            m_drawData.DisplaySize      = pSrc->DisplaySize;
+            m_drawData.FramebufferScale = pSrc->FramebufferScale;
+            m_drawData.OwnerViewport    = pSrc->OwnerViewport;
+            SetDrawDataCmdLists(&m_drawData, m_lists);
+            return &m_drawData;
+        }
+
+        const DrawDataBatchStats& GetStats() const { return m_stats; }
+
+    private:
+        DrawDataBatcher(const DrawDataBatcher&) = delete;
+        DrawDataBatcher& operator=(const DrawDataBatcher&) = delete;
+
+        static constexpr uint64_t MaxIndex() { return ((uint64_t)1 << (8 * sizeof(ImDrawIdx))) - 1; }
+
+        template<typename T>
+        static void AppendBuffer(ImVector<T>& dst, const ImVector<T>& src)
+        {
+            int size = dst.Size;
+            dst.resize(size + src.Size);
+            if (src.Size > 0)
+            {
+                memcpy(dst.Data + size, src.Data, (size_t)src.size_in_bytes());
+            }
+        }
+
+        // Indices of a joined command are rebased on the vertex offset of the command they join.
+        void AppendIndices(
+            const ImDrawIdx* pIdx,
+            unsigned int     count,
+            unsigned int     rebase)
+        {
+            int size = m_pList->IdxBuffer.Size;
+            m_pList->IdxBuffer.resize(size + (int)count);
+            ImDrawIdx* pDst = m_pList->IdxBuffer.Data + size;
+            if (rebase == 0)
+            {
+                memcpy(pDst, pIdx, count * sizeof(ImDrawIdx));
+                return;
+            }
+
+            for (unsigned int n = 0; n < count; n++)
+            {
+                pDst[n] = (ImDrawIdx)(pIdx[n] + rebase);
+            }
+        }
+
+        ImDrawList*           m_pList;  // Every command of the frame. Created with the first source list's shared data.
+        ImVector<ImDrawList*> m_lists;  // m_pList, once it exists.
+        ImDrawData            m_drawData;
+        DrawDataBatchStats    m_stats;
+    };
+
+    // Records and submits a frame on the render thread. E.g. FrameRender() + FramePresent() in the examples.
+    typedef void (*DrawDataSubmitFunc)(ImDrawData* pDrawData, void* pUserData);
+
+    // A submitter that does nothing. Used to measure the pipelining and snapshot cost without a GPU.
+    inline void NullDrawDataSubmit(ImDrawData* pDrawData, void* pUserData)
+    {
+        (void)pDrawData;
+        (void)pUserData;
+    }
+
+    struct RenderThreadStats
+    {
+        uint64_t framesSubmitted; // Frames handed over by the main thread.
+        uint64_t framesRendered;  // Frames the submit function has finished.
+        double   lastCaptureMs;   // Time the main thread spent copying the draw data.
+        double   lastWaitMs;      // Time the main thread waited for a free snapshot slot.
+        double   lastSubmitMs;    // Time the render thread spent in the submit function.
+        size_t   lastBytesCopied; // Draw data bytes copied into the snapshot.
+    };
+
+    // Double-buffered render thread. The main thread builds frame N+1 while the render thread records frame N.
+    // The main thread only blocks when both snapshots are still in flight.
+    class RenderThread
+    {
+    public:
+        // When the user config makes GImGui thread local (#define GImGui, see CustomDearImGuiLayout.h), the context is made
+        // current on the render thread, so backends can find their data. The shared global GImGui is never written by
+        // the render thread. Pass nullptr to use the calling thread's current context.
+        RenderThread(
+            DrawDataSubmitFunc submitFunc,
+            void*              pUserData,
+            ImGuiContext*      pContext = nullptr)
+            : m_pfnSubmitFunc(submitFunc),
+              m_pUserData(pUserData),
+              m_pContext(pContext ? pContext : ImGui::GetCurrentContext()),
+              m_nextSequence(0),
+              m_renderingSlot(0),
+              m_stop(false),
+              m_stats()
+        {
+            assert((void("ERROR: The submit function cannot be NULL."), submitFunc != nullptr));
+            for (int i = 0; i < SlotCount; i++)
+            {
+                m_slotStates[i] = SlotState::Free;
+                m_slotSequences[i] = 0;
+            }
+            m_thread = std::thread(&RenderThread::ThreadMain, this);
+        }
+
+        ~RenderThread()
+        {
+            Stop();
+        }
+
+        // Copies the draw data into a free slot and hands it over to the render thread.
+        void Submit(const ImDrawData* pDrawData)
+        {
+            using Clock = std::chrono::steady_clock;
+            Clock::time_point waitStart = Clock::now();
+
+            int slot = -1;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cond.wait(lock, [&]() { return FindSlot(SlotState::Free) != -1; });
+                slot = FindSlot(SlotState::Free);
+                m_slotStates[slot] = SlotState::Filling;
+            }
+
+            Clock::time_point captureStart = Clock::now();
+            m_snapshots[slot].Capture(pDrawData);
+            Clock::time_point captureEnd = Clock::now();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_slotStates[slot] = SlotState::Pending;
+                m_slotSequences[slot] = m_nextSequence++;
+                m_stats.framesSubmitted++;
+                m_stats.lastWaitMs = std::chrono::duration<double, std::milli>(captureStart - waitStart).count();
+                m_stats.lastCaptureMs = std::chrono::duration<double, std::milli>(captureEnd - captureStart).count();
+                m_stats.lastBytesCopied = m_snapshots[slot].GetStats().bytesCopied;
+            }
+            m_cond.notify_all();
+        }
+
+        // Blocks until every submitted frame has been consumed. E.g. before rebuilding the swapchain.
+        void WaitIdle()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [&]() { return m_stats.framesRendered == m_stats.framesSubmitted; });
+        }
+
+        // Finishes the pending frames and joins the render thread.
+        void Stop()
+        {
+            if (m_thread.joinable())
+            {
+                WaitIdle();
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_cond.notify_all();
+                m_thread.join();
+            }
+        }
+
+        RenderThreadStats GetStats()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_stats;
+        }
+
+        // The snapshot whose draw data the submit function got. Only valid while the submit function runs, on the
+        // render thread. E.g. for DrawDataSnapshot::GetSourceLists().
+        const DrawDataSnapshot* GetRenderingSnapshot() const
+        {
+            assert((void("ERROR: Only the submit function can get the snapshot it renders."),
+                    std::this_thread::get_id() == m_thread.get_id()));
+            return &m_snapshots[m_renderingSlot];
+        }
+
+    private:
+        RenderThread(const RenderThread&) = delete;
+        RenderThread& operator=(const RenderThread&) = delete;
+
+        enum class SlotState
+        {
+            Free,
+            Filling,
+            Pending,
+            Rendering
+        };
+
+        static constexpr int SlotCount = 2;
+
+        // Returns the slot in the given state. Pending slots are returned in submission order. Requires m_mutex.
+        int FindSlot(SlotState state) const
+        {
+            int found = -1;
+            for (int i = 0; i < SlotCount; i++)
+            {
+                if (m_slotStates[i] == state)
+                {
+                    if ((found == -1) || (m_slotSequences[i] < m_slotSequences[found]))
+                    {
+                        found = i;
+                    }
+                }
+            }
+            return found;
+        }
+
+        void ThreadMain()
+        {
+#ifdef GImGui
+            ImGui::SetCurrentContext(m_pContext);
+#else
+            (void)m_pContext;
+#endif
+
+            while (true)
+            {
+                int slot = -1;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_cond.wait(lock, [&]() { return m_stop || (FindSlot(SlotState::Pending) != -1); });
+                    if (m_stop)
+                    {
+                        break;
+                    }
+                    slot = FindSlot(SlotState::Pending);
+                    m_slotStates[slot] = SlotState::Rendering;
+                }
+                m_renderingSlot = slot;
+
+                std::chrono::steady_clock::time_point submitStart = std::chrono::steady_clock::now();
+                m_pfnSubmitFunc(m_snapshots[slot].GetDrawData(), m_pUserData);
+                std::chrono::steady_clock::time_point submitEnd = std::chrono::steady_clock::now();
+
+                {
+                    // The snapshot keeps its lists. They are released by the main thread on the next capture, so all
+                    // Dear ImGui allocations stay on one thread.
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_slotStates[slot] = SlotState::Free;
+                    m_stats.framesRendered++;
+                    m_stats.lastSubmitMs = std::chrono::duration<double, std::milli>(submitEnd - submitStart).count();
+                }
+                m_cond.notify_all();
+            }
+        }
+
+        DrawDataSubmitFunc m_pfnSubmitFunc;
+        void*              m_pUserData;
+        ImGuiContext*      m_pContext;
+
+        DrawDataSnapshot m_snapshots[SlotCount];
+        SlotState        m_slotStates[SlotCount];
+        uint64_t         m_slotSequences[SlotCount];
+        uint64_t         m_nextSequence;
+        int              m_renderingSlot; // Only used by the render thread.
+
+        std::mutex              m_mutex;
+        std::condition_variable m_cond;
+        std::thread             m_thread;
+        bool                    m_stop;
+
+        RenderThreadStats m_stats;
+    };
+}
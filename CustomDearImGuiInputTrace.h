@@ -0,0 +1,639 @@
+#pragma once
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "CustomDearImGuiLayout.h"
+#include "CustomDearImGuiRemote.h"
+#include <chrono>
+#include <cstdint>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+// Input traces for deterministic performance regression runs. An InputTraceRecorder captures the input events, delta time
+// and display size of every frame of a live session, and an InputTracePlayer feeds them back to another context one
+// frame per ImGui::NewFrame(), e.g. in the headless benchmark. With a CustomLayout, the trace also holds the layout state
+// at the start and the layout hash after every frame, so the replay checks that it lays out exactly like the recording.
+// Both hook into the context, so the application loop doesn't change. The values are little endian.
+namespace DearImGuiExt
+{
+    // Flags in front of every frame of a trace.
+    enum InputTraceFrameFlags : uint8_t
+    {
+        InputTraceFrame_DisplaySize      = 1 << 0, // The display size changed. Always set on the first frame.
+        InputTraceFrame_FramebufferScale = 1 << 1, // The framebuffer scale changed. Always set on the first frame.
+        InputTraceFrame_LayoutHash       = 1 << 2, // CustomLayout::GetStateHash() at the end of the frame.
+    };
+
+    // File header, followed by the layout state text and the frames.
+    static const char    InputTraceMagic[4] = { 'I', 'M', 'T', 'R' };
+    static const uint8_t InputTraceVersion  = 1;
+
+    // Records the input of the current context from Start() to Stop(). A frame is kept once it reaches ImGui::EndFrame().
+    class InputTraceRecorder
+    {
+    public:
+        InputTraceRecorder()
+            : m_pContext(nullptr),
+              m_pLayout(nullptr),
+              m_queuedEventCount(0),
+              m_frameCount(0),
+              m_displaySize(-1.f, -1.f),
+              m_framebufferScale(-1.f, -1.f)
+        {
+            memset(m_hookIds, 0, sizeof(m_hookIds));
+        }
+
+        ~InputTraceRecorder()
+        {
+            Stop();
+        }
+
+        // Starts a new trace of the layout's context or the current one, best before the first frame so the replay starts
+        // from the same state. The layout is optional and must outlive the recording.
+        void Start(CustomLayout* pLayout = nullptr)
+        {
+            assert((void("ERROR: Start() needs the layout's context or a current one."),
+                    (pLayout && pLayout->GetContext()) || (ImGui::GetCurrentContext() != nullptr)));
+            Stop();
+
+            m_pContext = (pLayout && pLayout->GetContext()) ? pLayout->GetContext() : ImGui::GetCurrentContext();
+            m_pLayout = pLayout;
+            m_queuedEventCount = 0;
+            m_frameCount = 0;
+            m_displaySize = ImVec2(-1.f, -1.f);
+            m_framebufferScale = ImVec2(-1.f, -1.f);
+
+            ImGuiTextBuffer state;
+            if (pLayout)
+            {
+                pLayout->SaveState(state);
+            }
+            m_trace.resize(0);
+            RemoteWriter writer(m_trace);
+            writer.WriteBytes(InputTraceMagic, sizeof(InputTraceMagic));
+            writer.WriteU8(InputTraceVersion);
+            writer.WriteVarU32((uint32_t)state.size());
+            writer.WriteBytes(state.begin(), (size_t)state.size());
+
+            const ImGuiContextHookType types[HookCount] = { ImGuiContextHookType_NewFramePre,
+                                                            ImGuiContextHookType_NewFramePost,
+                                                            ImGuiContextHookType_EndFramePre,
+                                                            ImGuiContextHookType_Shutdown };
+            for (int i = 0; i < HookCount; i++)
+            {
+                ImGuiContextHook hook;
+                hook.Type = types[i];
+                hook.Callback = &OnHook;
+                hook.UserData = this;
+                m_hookIds[i] = ImGui::AddContextHook(m_pContext, &hook);
+            }
+        }
+
+        // The trace stays available until the next Start().
+        void Stop()
+        {
+            if (m_pContext)
+            {
+                for (int i = 0; i < HookCount; i++)
+                {
+                    ImGui::RemoveContextHook(m_pContext, m_hookIds[i]);
+                }
+                m_pContext = nullptr;
+            }
+            m_pLayout = nullptr;
+        }
+
+        bool IsRecording() const { return m_pContext != nullptr; }
+        int  GetFrameCount() const { return m_frameCount; }
+
+        const ImVector<unsigned char>& GetData() const { return m_trace; }
+
+        bool SaveFile(const char* pPath) const
+        {
+            FILE* pFile = fopen(pPath, "wb");
+            if (pFile == nullptr)
+            {
+                return false;
+            }
+            bool isWritten = fwrite(m_trace.Data, 1, (size_t)m_trace.Size, pFile) == (size_t)m_trace.Size;
+            return (fclose(pFile) == 0) && isWritten;
+        }
+
+    private:
+        static constexpr int HookCount = 4;
+
+        static void OnHook(
+            ImGuiContext*     pContext,
+            ImGuiContextHook* pHook)
+        {
+            InputTraceRecorder* pRecorder = (InputTraceRecorder*)pHook->UserData;
+            ImGuiContext& g = *pContext;
+            switch (pHook->Type)
+            {
+            case ImGuiContextHookType_NewFramePre:
+                pRecorder->BeginFrame(g);
+                break;
+            case ImGuiContextHookType_NewFramePost:
+                // Events left in the queue, e.g. a trickled mouse release, were recorded in this frame already.
+                pRecorder->m_queuedEventCount = g.InputEventsQueue.Size;
+                break;
+            case ImGuiContextHookType_EndFramePre:
+                pRecorder->EndFrame();
+                break;
+            case ImGuiContextHookType_Shutdown:
+                // The context frees its hooks.
+                pRecorder->m_pContext = nullptr;
+                pRecorder->m_pLayout = nullptr;
+                break;
+            default:
+                break;
+            }
+        }
+
+        void BeginFrame(ImGuiContext& g)
+        {
+            const ImGuiIO& io = g.IO;
+            uint8_t flags = m_pLayout ? InputTraceFrame_LayoutHash : 0;
+            if ((io.DisplaySize.x != m_displaySize.x) || (io.DisplaySize.y != m_displaySize.y))
+            {
+                flags |= InputTraceFrame_DisplaySize;
+                m_displaySize = io.DisplaySize;
+            }
+            if ((io.DisplayFramebufferScale.x != m_framebufferScale.x) || (io.DisplayFramebufferScale.y != m_framebufferScale.y))
+            {
+                flags |= InputTraceFrame_FramebufferScale;
+                m_framebufferScale = io.DisplayFramebufferScale;
+            }
+
+            m_frame.resize(0);
+            RemoteWriter writer(m_frame);
+            writer.WriteU8(flags);
+            writer.WriteFloat(io.DeltaTime);
+            if (flags & InputTraceFrame_DisplaySize)
+            {
+                writer.WriteFloat(m_displaySize.x);
+                writer.WriteFloat(m_displaySize.y);
+            }
+            if (flags & InputTraceFrame_FramebufferScale)
+            {
+                writer.WriteFloat(m_framebufferScale.x);
+                writer.WriteFloat(m_framebufferScale.y);
+            }
+
+            const int firstEvent = ImMin(m_queuedEventCount, g.InputEventsQueue.Size);
+            writer.WriteVarU32((uint32_t)(g.InputEventsQueue.Size - firstEvent));
+            for (int i = firstEvent; i < g.InputEventsQueue.Size; i++)
+            {
+                WriteEvent(writer, g.InputEventsQueue[i]);
+            }
+        }
+
+        void EndFrame()
+        {
+            if (m_frame.Size == 0)
+            {
+                // Started between NewFrame() and EndFrame().
+                return;
+            }
+            RemoteWriter writer(m_trace);
+            writer.WriteBytes(m_frame.Data, (size_t)m_frame.Size);
+            if (m_pLayout)
+            {
+                writer.WriteU32(m_pLayout->GetStateHash());
+            }
+            m_frame.resize(0);
+            m_frameCount++;
+        }
+
+        static void WriteEvent(
+            RemoteWriter&          writer,
+            const ImGuiInputEvent& event)
+        {
+            switch (event.Type)
+            {
+            case ImGuiInputEventType_MousePos:
+                writer.WriteU8(RemoteInputEvent_MousePos);
+                writer.WriteFloat(event.MousePos.PosX);
+                writer.WriteFloat(event.MousePos.PosY);
+                break;
+            case ImGuiInputEventType_MouseButton:
+                writer.WriteU8(RemoteInputEvent_MouseButton);
+                writer.WriteU8((uint8_t)event.MouseButton.Button);
+                writer.WriteU8(event.MouseButton.Down ? 1 : 0);
+                break;
+            case ImGuiInputEventType_MouseWheel:
+                writer.WriteU8(RemoteInputEvent_MouseWheel);
+                writer.WriteFloat(event.MouseWheel.WheelX);
+                writer.WriteFloat(event.MouseWheel.WheelY);
+                break;
+            case ImGuiInputEventType_Key:
+                writer.WriteU8(RemoteInputEvent_Key);
+                writer.WriteVarU32((uint32_t)event.Key.Key);
+                writer.WriteU8(event.Key.Down ? 1 : 0);
+                writer.WriteFloat(event.Key.AnalogValue);
+                break;
+            case ImGuiInputEventType_Text:
+                writer.WriteU8(RemoteInputEvent_Char);
+                writer.WriteVarU32(event.Text.Char);
+                break;
+            case ImGuiInputEventType_Focus:
+                writer.WriteU8(RemoteInputEvent_Focus);
+                writer.WriteU8(event.AppFocused.Focused ? 1 : 0);
+                break;
+            default:
+                assert((void("ERROR: Unknown input event type."), false));
+                break;
+            }
+        }
+
+        ImGuiContext* m_pContext;
+        CustomLayout* m_pLayout;
+        ImGuiID       m_hookIds[HookCount];
+
+        ImVector<unsigned char> m_trace;
+        ImVector<unsigned char> m_frame; // Frame between NewFrame() and EndFrame().
+        int                     m_queuedEventCount; // Events left in the queue by the last NewFrame().
+        int                     m_frameCount;
+        ImVec2                  m_displaySize;
+        ImVec2                  m_framebufferScale;
+    };
+
+    // Plays a trace of InputTraceRecorder back into the current context, one recorded frame per ImGui::NewFrame(). The
+    // delta time, display size and events of the recording replace the ones of the IO, so the application must not
+    // queue events of its own while playing. Load GetInitialLayoutState() into the layout before the first frame.
+    class InputTracePlayer
+    {
+    public:
+        InputTracePlayer()
+            : m_pContext(nullptr),
+              m_pLayout(nullptr),
+              m_stateSize(0),
+              m_frameCount(0),
+              m_readOffset(0),
+              m_frameIndex(0),
+              m_frameHash(0),
+              m_hasFrameHash(false),
+              m_mismatchCount(0),
+              m_firstMismatchFrame(-1),
+              m_displaySize(0.f, 0.f),
+              m_framebufferScale(1.f, 1.f)
+        {
+            memset(m_hookIds, 0, sizeof(m_hookIds));
+        }
+
+        ~InputTracePlayer()
+        {
+            Stop();
+        }
+
+        // Copies and checks a whole trace. Returns false if it is malformed.
+        bool Load(
+            const unsigned char* pData,
+            size_t               size)
+        {
+            Stop();
+            m_trace.resize(0);
+            m_state.resize(0);
+            m_frameCount = 0;
+
+            RemoteReader reader(pData, size);
+            char magic[sizeof(InputTraceMagic)] = {};
+            reader.ReadBytes(magic, sizeof(magic));
+            if ((memcmp(magic, InputTraceMagic, sizeof(magic)) != 0) || (reader.ReadU8() != InputTraceVersion))
+            {
+                return false;
+            }
+            uint32_t stateSize = reader.ReadVarU32();
+            if ((reader.IsValid() == false) || (stateSize > size))
+            {
+                return false;
+            }
+            m_state.resize((int)stateSize + 1);
+            reader.ReadBytes(m_state.Data, stateSize);
+            m_state[(int)stateSize] = '\0';
+            size_t stateEnd = size - reader.GetRemainingSize();
+
+            int frameCount = 0;
+            Frame frame;
+            while (reader.IsValid() && (reader.IsAtEnd() == false))
+            {
+                if (ReadFrame(reader, frame, nullptr))
+                {
+                    frameCount++;
+                }
+            }
+            if (reader.IsValid() == false)
+            {
+                m_state.resize(0);
+                return false;
+            }
+
+            m_trace.resize((int)size);
+            memcpy(m_trace.Data, pData, size);
+            m_stateSize = stateEnd;
+            m_frameCount = frameCount;
+            return true;
+        }
+
+        bool LoadFile(const char* pPath)
+        {
+            FILE* pFile = fopen(pPath, "rb");
+            if (pFile == nullptr)
+            {
+                return false;
+            }
+            ImVector<unsigned char> data;
+            unsigned char chunk[4096];
+            for (size_t readSize; (readSize = fread(chunk, 1, sizeof(chunk), pFile)) > 0;)
+            {
+                int offset = data.Size;
+                data.resize(offset + (int)readSize);
+                memcpy(data.Data + offset, chunk, readSize);
+            }
+            bool isRead = ferror(pFile) == 0;
+            fclose(pFile);
+            return isRead && Load(data.Data, (size_t)data.Size);
+        }
+
+        // The CustomLayout::SaveState() text at the start of the recording, empty without a layout.
+        const char* GetInitialLayoutState() const { return m_state.Size ? m_state.Data : ""; }
+        int         GetFrameCount() const { return m_frameCount; }
+
+        // Starts from the first frame in the layout's context or the current one. Compares the layout hashes of the
+        // recording when a layout is given.
+        void Start(CustomLayout* pLayout = nullptr)
+        {
+            assert((void("ERROR: Start() needs the layout's context or a current one."),
+                    (pLayout && pLayout->GetContext()) || (ImGui::GetCurrentContext() != nullptr)));
+            Stop();
+
+            m_pContext = (pLayout && pLayout->GetContext()) ? pLayout->GetContext() : ImGui::GetCurrentContext();
+            m_pLayout = pLayout;
+            m_readOffset = m_stateSize;
+            m_frameIndex = 0;
+            m_hasFrameHash = false;
+            m_mismatchCount = 0;
+            m_firstMismatchFrame = -1;
+            m_frameMs.resize(0);
+            m_frameMs.reserve(m_frameCount);
+
+            const ImGuiContextHookType types[HookCount] = { ImGuiContextHookType_NewFramePre,
+                                                            ImGuiContextHookType_EndFramePre,
+                                                            ImGuiContextHookType_RenderPost,
+                                                            ImGuiContextHookType_Shutdown };
+            for (int i = 0; i < HookCount; i++)
+            {
+                ImGuiContextHook hook;
+                hook.Type = types[i];
+                hook.Callback = &OnHook;
+                hook.UserData = this;
+                m_hookIds[i] = ImGui::AddContextHook(m_pContext, &hook);
+            }
+        }
+
+        void Stop()
+        {
+            if (m_pContext)
+            {
+                for (int i = 0; i < HookCount; i++)
+                {
+                    ImGui::RemoveContextHook(m_pContext, m_hookIds[i]);
+                }
+                m_pContext = nullptr;
+            }
+            m_pLayout = nullptr;
+        }
+
+        bool IsPlaying() const { return m_pContext != nullptr; }
+        bool IsDone() const { return m_frameIndex >= m_frameCount; }
+        int  GetPlayedFrameCount() const { return m_frameIndex; }
+
+        // Frames whose layout hash differs from the recording, and the first of them or -1.
+        int GetMismatchCount() const { return m_mismatchCount; }
+        int GetFirstMismatchFrame() const { return m_firstMismatchFrame; }
+
+        // Milliseconds from ImGui::NewFrame() to the end of ImGui::Render() of every played frame.
+        const ImVector<float>& GetFrameTimes() const { return m_frameMs; }
+
+    private:
+        static constexpr int HookCount = 4;
+
+        using Clock = std::chrono::steady_clock;
+
+        struct Frame
+        {
+            uint8_t  flags;
+            float    deltaTime;
+            ImVec2   displaySize;
+            ImVec2   framebufferScale;
+            uint32_t layoutHash;
+        };
+
+        static void OnHook(
+            ImGuiContext*     pContext,
+            ImGuiContextHook* pHook)
+        {
+            InputTracePlayer* pPlayer = (InputTracePlayer*)pHook->UserData;
+            switch (pHook->Type)
+            {
+            case ImGuiContextHookType_NewFramePre:
+                pPlayer->BeginFrame(pContext->IO);
+                break;
+            case ImGuiContextHookType_EndFramePre:
+                pPlayer->EndFrame();
+                break;
+            case ImGuiContextHookType_RenderPost:
+                if (pPlayer->m_frameMs.Size < pPlayer->m_frameIndex)
+                {
+                    pPlayer->m_frameMs.push_back(std::chrono::duration<float, std::milli>(Clock::now() - pPlayer->m_frameStart).count());
+                }
+                break;
+            case ImGuiContextHookType_Shutdown:
+                pPlayer->m_pContext = nullptr;
+                pPlayer->m_pLayout = nullptr;
+                break;
+            default:
+                break;
+            }
+        }
+
+        void BeginFrame(ImGuiIO& io)
+        {
+            m_hasFrameHash = false;
+            if (IsDone())
+            {
+                return;
+            }
+
+            m_frameStart = Clock::now();
+            RemoteReader reader(m_trace.Data + m_readOffset, (size_t)m_trace.Size - m_readOffset);
+            Frame frame;
+            ReadFrame(reader, frame, &io);
+            assert((void("ERROR: The trace was checked by Load()."), reader.IsValid()));
+            m_readOffset = (size_t)m_trace.Size - reader.GetRemainingSize();
+
+            if (frame.flags & InputTraceFrame_DisplaySize)
+            {
+                m_displaySize = frame.displaySize;
+            }
+            if (frame.flags & InputTraceFrame_FramebufferScale)
+            {
+                m_framebufferScale = frame.framebufferScale;
+            }
+            io.DeltaTime = frame.deltaTime;
+            io.DisplaySize = m_displaySize;
+            io.DisplayFramebufferScale = m_framebufferScale;
+
+            m_hasFrameHash = (frame.flags & InputTraceFrame_LayoutHash) != 0;
+            m_frameHash = frame.layoutHash;
+            m_frameIndex++;
+        }
+
+        void EndFrame()
+        {
+            if (m_hasFrameHash && m_pLayout && (m_pLayout->GetStateHash() != m_frameHash))
+            {
+                if (m_firstMismatchFrame < 0)
+                {
+                    m_firstMismatchFrame = m_frameIndex - 1;
+                }
+                m_mismatchCount++;
+            }
+            m_hasFrameHash = false;
+        }
+
+        // Reads a frame and queues its events in the IO, if any. Returns false and makes the reader invalid on a
+        // malformed frame.
+        static bool ReadFrame(
+            RemoteReader& reader,
+            Frame&        frame,
+            ImGuiIO*      pIO)
+        {
+            frame.flags = reader.ReadU8();
+            frame.deltaTime = reader.ReadFloat();
+            frame.displaySize = ImVec2(0.f, 0.f);
+            frame.framebufferScale = ImVec2(1.f, 1.f);
+            frame.layoutHash = 0;
+            if (frame.flags & InputTraceFrame_DisplaySize)
+            {
+                frame.displaySize.x = reader.ReadFloat();
+                frame.displaySize.y = reader.ReadFloat();
+            }
+            if (frame.flags & InputTraceFrame_FramebufferScale)
+            {
+                frame.framebufferScale.x = reader.ReadFloat();
+                frame.framebufferScale.y = reader.ReadFloat();
+            }
+
+            uint32_t eventCount = reader.ReadVarU32();
+            for (uint32_t i = 0; (i < eventCount) && reader.IsValid(); i++)
+            {
+                ReadEvent(reader, pIO);
+            }
+            if (frame.flags & InputTraceFrame_LayoutHash)
+            {
+                frame.layoutHash = reader.ReadU32();
+            }
+            return reader.IsValid();
+        }
+
+        static void ReadEvent(
+            RemoteReader& reader,
+            ImGuiIO*      pIO)
+        {
+            switch (reader.ReadU8())
+            {
+            case RemoteInputEvent_MousePos:
+            {
+                float x = reader.ReadFloat();
+                float y = reader.ReadFloat();
+                if (pIO && reader.IsValid())
+                {
+                    pIO->AddMousePosEvent(x, y);
+                }
+                break;
+            }
+            case RemoteInputEvent_MouseButton:
+            {
+                int button = reader.ReadU8();
+                bool down = reader.ReadU8() != 0;
+                if (button >= ImGuiMouseButton_COUNT)
+                {
+                    reader.Invalidate();
+                }
+                else if (pIO && reader.IsValid())
+                {
+                    pIO->AddMouseButtonEvent(button, down);
+                }
+                break;
+            }
+            case RemoteInputEvent_MouseWheel:
+            {
+                float x = reader.ReadFloat();
+                float y = reader.ReadFloat();
+                if (pIO && reader.IsValid())
+                {
+                    pIO->AddMouseWheelEvent(x, y);
+                }
+                break;
+            }
+            case RemoteInputEvent_Key:
+            {
+                ImGuiKey key = (ImGuiKey)reader.ReadVarU32();
+                bool down = reader.ReadU8() != 0;
+                float analogValue = reader.ReadFloat();
+                if (IsRemoteInputKey(key) == false)
+                {
+                    reader.Invalidate();
+                }
+                else if (pIO && reader.IsValid())
+                {
+                    pIO->AddKeyAnalogEvent(key, down, analogValue);
+                }
+                break;
+            }
+            case RemoteInputEvent_Char:
+            {
+                unsigned int c = reader.ReadVarU32();
+                if (pIO && reader.IsValid())
+                {
+                    pIO->AddInputCharacter(c);
+                }
+                break;
+            }
+            case RemoteInputEvent_Focus:
+            {
+                bool focused = reader.ReadU8() != 0;
+                if (pIO && reader.IsValid())
+                {
+                    pIO->AddFocusEvent(focused);
+                }
+                break;
+            }
+            default:
+                reader.Invalidate();
+                break;
+            }
+        }
+
+        ImGuiContext* m_pContext;
+        CustomLayout* m_pLayout;
+        ImGuiID       m_hookIds[HookCount];
+
+        ImVector<unsigned char> m_trace;
+        ImVector<char>          m_state;
+        size_t                  m_stateSize; // Bytes in front of the first frame.
+        int                     m_frameCount;
+
+        size_t            m_readOffset;
+        int               m_frameIndex; // Frames started so far.
+        uint32_t          m_frameHash;
+        bool              m_hasFrameHash;
+        int               m_mismatchCount;
+        int               m_firstMismatchFrame;
+        ImVec2            m_displaySize;
+        ImVec2            m_framebufferScale;
+        Clock::time_point m_frameStart;
+        ImVector<float>   m_frameMs;
+    };
+}
@@ -0,0 +1,245 @@
+#pragma once
+#include <cstdint>
+#include <cassert>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small work-stealing job system used by the layout to run leaf work off the main thread.
+// Nothing in here touches Dear ImGui.
+namespace DearImGuiExt
+{
+    typedef void (*JobFunc)(void* pUserData);
+
+    // Counts the unfinished jobs of a batch. Wait on it with JobSystem::Wait().
+    class JobCounter
+    {
+    public:
+        JobCounter() : m_pending(0) {}
+
+        bool IsDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+        std::atomic<int> m_pending;
+    };
+
+    class JobSystem
+    {
+    public:
+        // The thread calling Wait() also runs jobs, so N worker threads give N + 1 threads of parallelism.
+        // 0 workers is valid: every job then runs inside Wait().
+        explicit JobSystem(uint32_t workerCount)
+            : m_nextQueue(0),
+              m_queuedJobs(0),
+              m_stop(false)
+        {
+            // The extra queue receives jobs from threads that aren't workers when there are no workers.
+            for (uint32_t i = 0; i < workerCount + 1; i++)
+            {
+                m_queues.emplace_back(new WorkerQueue());
+            }
+
+            for (uint32_t i = 0; i < workerCount; i++)
+            {
+                m_workers.emplace_back(&JobSystem::WorkerMain, this, i);
+            }
+        }
+
+        // Jobs still queued run before the workers exit. The remaining ones, e.g. all of them without workers, run here.
+        ~JobSystem()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_stop = true;
+            }
+            m_sleepCond.notify_all();
+
+            for (std::thread& worker : m_workers)
+            {
+                worker.join();
+            }
+
+            while (TryRunJob(NotAWorker))
+            {
+            }
+            assert((void("ERROR: Jobs were submitted from another thread while the job system was destroyed."), m_queuedJobs == 0));
+        }
+
+        // Default worker count: one thread per core, counting the caller of Wait().
+        static uint32_t DefaultWorkerCount()
+        {
+            uint32_t cores = std::thread::hardware_concurrency();
+            return (cores > 1) ? cores - 1 : 0;
+        }
+
+        uint32_t GetWorkerCount() const { return (uint32_t)m_workers.size(); }
+
+        // Can be called from any thread, including from inside a job.
+        void Submit(
+            JobFunc     func,
+            void*       pUserData,
+            JobCounter* pCounter = nullptr)
+        {
+            assert((void("ERROR: The job function cannot be NULL."), func != nullptr));
+            if (pCounter)
+            {
+                pCounter->m_pending.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Workers push to their own queue and pop from its back. Other threads spread jobs across the workers.
+            uint32_t queue = CurrentWorkerIndex();
+            if (queue == NotAWorker)
+            {
+                queue = m_workers.empty() ? (uint32_t)m_workers.size() :
+                                            m_nextQueue.fetch_add(1, std::memory_order_relaxed) % (uint32_t)m_workers.size();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+                m_queues[queue]->jobs.push_back(Job{ func, pUserData, pCounter });
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_queuedJobs++;
+            }
+            m_sleepCond.notify_one();
+        }
+
+        // Runs jobs on the calling thread until every job of the counter has finished.
+        void Wait(JobCounter* pCounter)
+        {
+            while (pCounter->IsDone() == false)
+            {
+                if (TryRunJob(CurrentWorkerIndex()) == false)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    private:
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        static constexpr uint32_t NotAWorker = 0xFFFFFFFF;
+
+        struct Job
+        {
+            JobFunc     pfnFunc;
+            void*       pUserData;
+            JobCounter* pCounter;
+        };
+
+        struct WorkerQueue
+        {
+            std::mutex      mutex;
+            std::deque<Job> jobs;
+        };
+
+        // The thread local is shared by every job system, so it remembers which one the thread works for.
+        struct WorkerThread
+        {
+            const JobSystem* pOwner;
+            uint32_t         index;
+        };
+
+        static WorkerThread& WorkerThreadStorage()
+        {
+            static thread_local WorkerThread workerThread = { nullptr, NotAWorker };
+            return workerThread;
+        }
+
+        // Workers of another job system count as any other thread.
+        uint32_t CurrentWorkerIndex() const
+        {
+            const WorkerThread& workerThread = WorkerThreadStorage();
+            return (workerThread.pOwner == this) ? workerThread.index : NotAWorker;
+        }
+
+        // Pops from the back of the own queue first, then steals from the front of the others.
+        bool TryRunJob(uint32_t ownQueue)
+        {
+            Job job = {};
+            bool found = false;
+            uint32_t queueCount = (uint32_t)m_queues.size();
+
+            if (ownQueue != NotAWorker)
+            {
+                WorkerQueue& queue = *m_queues[ownQueue];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.jobs.empty() == false)
+                {
+                    job = queue.jobs.back();
+                    queue.jobs.pop_back();
+                    found = true;
+                }
+            }
+
+            uint32_t start = (ownQueue == NotAWorker) ? 0 : ownQueue + 1;
+            for (uint32_t i = 0; (i < queueCount) && (found == false); i++)
+            {
+                WorkerQueue& queue = *m_queues[(start + i) % queueCount];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.jobs.empty() == false)
+                {
+                    job = queue.jobs.front();
+                    queue.jobs.pop_front();
+                    found = true;
+                }
+            }
+
+            if (found == false)
+            {
+                return false;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_queuedJobs--;
+            }
+
+            job.pfnFunc(job.pUserData);
+            if (job.pCounter)
+            {
+                job.pCounter->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+            return true;
+        }
+
+        void WorkerMain(uint32_t index)
+        {
+            WorkerThreadStorage() = WorkerThread{ this, index };
+
+            while (true)
+            {
+                if (TryRunJob(index))
+                {
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(m_sleepMutex);
+                m_sleepCond.wait(lock, [&]() { return m_stop || (m_queuedJobs > 0); });
+                if (m_stop && (m_queuedJobs == 0))
+                {
+                    break;
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+        std::vector<std::thread>                  m_workers;
+        std::atomic<uint32_t>                     m_nextQueue;
+
+        // Guards the sleep state only. The queues have their own locks.
+        std::mutex              m_sleepMutex;
+        std::condition_variable m_sleepCond;
+        int                     m_queuedJobs;
+        bool                    m_stop;
+    };
+}
@@ -1,16 +1,474 @@
 #pragma once
 #include "imgui.h"
 #include "imgui_internal.h"
+#include "CustomDearImGuiJobSystem.h"
+#include "CustomDearImGuiMpscQueue.h"
 #include <cstdint>
 #include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// Parallel leaves (optional): define CUSTOM_LAYOUT_PARALLEL_LEAVES to build the leaf windows on a job system, each leaf in
+// its own Dear ImGui context. Dear ImGui keeps the current context in the GImGui global, so it has to be made thread
+// local in your imconfig.h first:
+//     struct ImGuiContext;
+//     extern thread_local ImGuiContext* MyImGuiTLS;
+//     #define GImGui MyImGuiTLS
+// and define `thread_local ImGuiContext* MyImGuiTLS = nullptr;` in one of your .cpp files.
+//
+// Threading model: a CustomLayout belongs to the Dear ImGui context given to its constructor, or to the context that is
+// current when it is used. BeginEndLayout() and WarmUp() make that context current on the calling thread for their
+// duration, so one thread can drive the layouts of several contexts, e.g. one per OS window. With the thread local
+// GImGui above, several threads can build frames at the same time, each in its own context: a context and everything
+// drawn into it (layouts, menu bars, its IO) must only be used by one thread at a time, and contexts share nothing but
+// an optional font atlas, which must be built before the threads start and never changed afterwards. A JobSystem can be
+// shared by the layouts of all the threads.
+#ifdef CUSTOM_LAYOUT_PARALLEL_LEAVES
+#include "CustomDearImGuiDrawData.h"
+#include <memory>
+#include <vector>
+#endif
+
+// Coroutine leaves: available when the header is compiled as C++20 with coroutine support.
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine)
+#define CUSTOM_LAYOUT_COROUTINES
+#include <coroutine>
+#include <exception>
+#include <utility>
+#endif
+#endif
 
 // Set custom windows properties. Names, styles...
 // Positions and sizes are handled by the layout.
 typedef void (*CustomWindowFunc)();
 
+// Optional two-phase leaves. Prepare runs on the layout's job system at the start of a frame and must not call Dear ImGui.
+// Emit runs on the UI thread in place of the window function and draws the prepared data. Both get the index (0 or 1) of
+// the user's result buffer to use. Prepare fills one while Emit reads the other.
+typedef void (*CustomPrepareFunc)(void* pUserData, uint32_t bufferIndex);
+typedef void (*CustomEmitFunc)(void* pUserData, uint32_t bufferIndex);
+
+// Optional background work of an inactive tab. Runs on the UI thread every few frames and must not call Dear ImGui.
+typedef void (*CustomTabTickFunc)(void* pUserData);
+
 // TODO: Constructor changes to RAII style. User shouldn't be responsible for creating new node.
 namespace DearImGuiExt 
 {
+    class CustomLayoutNode;
+    class CustomLayout;
+
+    // ImGuiStorage has no erase. Its pairs are kept sorted by key.
+    inline void EraseStorageKey(
+        ImGuiStorage& storage,
+        ImGuiID       key)
+    {
+        typedef decltype(storage.Data)::value_type Entry;
+        Entry* pEntry = std::lower_bound(storage.Data.begin(), storage.Data.end(), key,
+            [](const Entry& entry, ImGuiID id) { return entry.key < id; });
+        if ((pEntry != storage.Data.end()) && (pEntry->key == key))
+        {
+            storage.Data.erase(pEntry);
+        }
+    }
+
+    // Makes a context current until the end of the scope. Does nothing for a null context.
+    class CustomContextScope
+    {
+    public:
+        explicit CustomContextScope(ImGuiContext* pContext)
+            : m_pPrevContext(ImGui::GetCurrentContext()),
+              m_isSwitched((pContext != nullptr) && (pContext != m_pPrevContext))
+        {
+            if (m_isSwitched)
+            {
+                ImGui::SetCurrentContext(pContext);
+            }
+        }
+
+        ~CustomContextScope()
+        {
+            if (m_isSwitched)
+            {
+                ImGui::SetCurrentContext(m_pPrevContext);
+            }
+        }
+
+    private:
+        CustomContextScope(const CustomContextScope&) = delete;
+        CustomContextScope& operator=(const CustomContextScope&) = delete;
+
+        ImGuiContext* m_pPrevContext;
+        bool          m_isSwitched;
+    };
+
+    // Round half up. ImFloor() truncates towards zero, which is wrong for negative coordinates.
+    inline float SnapToPixel(float v)
+    {
+        return floorf(v + 0.5f);
+    }
+
+    struct CustomLeafPrepareStats
+    {
+        const CustomLayoutNode* pNode;
+        uint64_t                prepareCount;   // Finished Prepare calls.
+        uint64_t                lateFrames;     // Frames emitted with an older result because Prepare was still running.
+        double                  lastLatencyMs;  // From scheduling to the end of Prepare.
+        double                  maxLatencyMs;
+        double                  totalLatencyMs;
+    };
+
+    // Draw list sizes of a leaf's window. Used for the capacity its window reserves when it is first built and for the
+    // peak sizes it reached.
+    struct CustomLeafCapacity
+    {
+        int vtxCount;
+        int idxCount;
+        int cmdCount;
+    };
+
+    struct CustomLayoutStats
+    {
+        uint64_t                         frameCount;
+        ImVector<CustomLeafPrepareStats> leafPrepares; // Two-phase leaves in layout order.
+
+        // Coroutine leaves. The budget is overrun when a coroutine runs much longer than its last chunk of work between two
+        // budget checks. Frames within 5% of the budget aren't counted, the last chunk usually ends a little late.
+        double   lastCoroutineMs;   // Time spent resuming coroutines in the last frame.
+        double   maxOverrunMs;
+        uint64_t budgetOverruns;    // Frames that exceeded the coroutine budget.
+
+        // Structural edits.
+        uint64_t appliedCommands;
+        uint64_t droppedCommands;   // Their node wasn't in the layout anymore or had the wrong kind.
+        uint64_t nodesCreated;      // Heap allocations. Nodes of the initial tree aren't counted.
+        uint64_t nodesRecycled;     // Taken from the free list.
+
+        uint64_t viewportLayouts;   // Layouts of the whole tree for a new viewport, or host rect for a sub-layout.
+    };
+
+    // Schedules the two phases of a leaf and swaps its result buffers. Owned by the leaf node.
+    // Emit always gets the newest finished result. If Prepare is still running, the frame uses the previous result
+    // instead of waiting, which is counted as a late frame.
+    class CustomLeafPrepareStage
+    {
+    public:
+        CustomLeafPrepareStage(
+            CustomPrepareFunc prepareFunc,
+            CustomEmitFunc    emitFunc,
+            void*             pUserData)
+            : m_pfnPrepareFunc(prepareFunc),
+              m_pfnEmitFunc(emitFunc),
+              m_pUserData(pUserData),
+              m_state(State_Idle),
+              m_frontBuffer(0),
+              m_lastLatencyMs(0.0),
+              m_stats()
+        {
+            assert((void("ERROR: Two-phase leaves need both a prepare and an emit function."),
+                    (prepareFunc != nullptr) && (emitFunc != nullptr)));
+        }
+
+        // UI thread, at the start of a frame. Starts the next Prepare unless the previous one is still running.
+        // Without a job system, Prepare runs right away on the calling thread.
+        void Schedule(
+            JobSystem*  pJobSystem,
+            JobCounter* pCounter)
+        {
+            ConsumeResult();
+            if (m_state.load(std::memory_order_acquire) != State_Idle)
+            {
+                return;
+            }
+
+            m_state.store(State_Running, std::memory_order_relaxed);
+            m_scheduleTime = std::chrono::steady_clock::now();
+            if (pJobSystem)
+            {
+                pJobSystem->Submit(PrepareJob, this, pCounter);
+            }
+            else
+            {
+                PrepareJob(this);
+            }
+        }
+
+        // UI thread, in place of the window function.
+        void Emit()
+        {
+            ConsumeResult();
+            if (m_state.load(std::memory_order_acquire) == State_Running)
+            {
+                m_stats.lateFrames++;
+            }
+            m_pfnEmitFunc(m_pUserData, m_frontBuffer);
+        }
+
+        const CustomLeafPrepareStats& GetStats() const { return m_stats; }
+
+    private:
+        enum State
+        {
+            State_Idle,
+            State_Running,
+            State_Ready
+        };
+
+        // Makes a finished result visible to Emit.
+        void ConsumeResult()
+        {
+            if (m_state.load(std::memory_order_acquire) == State_Ready)
+            {
+                m_frontBuffer ^= 1;
+                m_stats.prepareCount++;
+                m_stats.lastLatencyMs = m_lastLatencyMs;
+                m_stats.maxLatencyMs = ImMax(m_stats.maxLatencyMs, m_lastLatencyMs);
+                m_stats.totalLatencyMs += m_lastLatencyMs;
+                m_state.store(State_Idle, std::memory_order_relaxed);
+            }
+        }
+
+        static void PrepareJob(void* pUserData)
+        {
+            CustomLeafPrepareStage* pStage = (CustomLeafPrepareStage*)pUserData;
+            pStage->m_pfnPrepareFunc(pStage->m_pUserData, pStage->m_frontBuffer ^ 1);
+            pStage->m_lastLatencyMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - pStage->m_scheduleTime).count();
+            pStage->m_state.store(State_Ready, std::memory_order_release);
+        }
+
+        CustomPrepareFunc m_pfnPrepareFunc;
+        CustomEmitFunc    m_pfnEmitFunc;
+        void*             m_pUserData;
+
+        std::atomic<int>                      m_state;
+        uint32_t                              m_frontBuffer;   // Buffer read by Emit. Prepare writes the other one.
+        std::chrono::steady_clock::time_point m_scheduleTime;
+        double                                m_lastLatencyMs; // Written by Prepare, published by m_state.
+
+        CustomLeafPrepareStats m_stats;
+    };
+
+    // Tabs of a leaf. The leaf draws a tab strip at the top of its domain and only runs the active tab's window function
+    // below it, the other tabs are suspended. An inactive tab with a tick function gets a tick every few frames instead,
+    // e.g. to keep polling a data source. Owned by the leaf node.
+    class CustomLeafTabs
+    {
+    public:
+        CustomLeafTabs()
+            : m_activeTab(0),
+              m_selectRequest(-1),
+              m_tickInterval(0),
+              m_frameIndex(0),
+              m_tickCount(0),
+              m_pStripWindow(nullptr)
+        {}
+
+        ~CustomLeafTabs()
+        {
+            for (int i = 0; i < m_tabs.Size; i++)
+            {
+                IM_FREE(m_tabs[i].pLabel);
+            }
+        }
+
+        // Labels must be unique within the leaf. Returns the index of the tab.
+        int AddTab(
+            const char*       pLabel,
+            CustomWindowFunc  windowFunc,
+            CustomTabTickFunc tickFunc,
+            void*             pUserData)
+        {
+            assert((void("ERROR: A tab needs a label and a window function."), (pLabel != nullptr) && (windowFunc != nullptr)));
+            m_tabs.push_back(Tab{ ImStrdup(pLabel), windowFunc, tickFunc, pUserData });
+            return m_tabs.Size - 1;
+        }
+
+        int GetTabCount() const { return m_tabs.Size; }
+        int GetActiveTab() const { return m_activeTab; }
+
+        // Also selects the tab in the tab strip from the next frame.
+        void SetActiveTab(int tab)
+        {
+            assert((void("ERROR: The tab index is out of range."), (tab >= 0) && (tab < m_tabs.Size)));
+            m_activeTab = tab;
+            m_selectRequest = tab;
+        }
+
+        // Inactive tabs with a tick function get a tick every that many frames, spread over the frames. 0 turns the ticks off.
+        void SetBackgroundTickInterval(uint32_t frames) { m_tickInterval = frames; }
+
+        uint64_t GetBackgroundTickCount() const { return m_tickCount; }
+
+        // Window of the tab strip, once it has been drawn.
+        ImGuiWindow* GetStripWindow() const { return m_pStripWindow; }
+
+        // UI thread, once per frame while the leaf is shown.
+        void TickBackground()
+        {
+            m_frameIndex++;
+            if (m_tickInterval == 0)
+            {
+                return;
+            }
+
+            for (int i = 0; i < m_tabs.Size; i++)
+            {
+                if ((i != m_activeTab) && m_tabs[i].pfnTickFunc && ((m_frameIndex + (uint32_t)i) % m_tickInterval == 0))
+                {
+                    m_tabs[i].pfnTickFunc(m_tabs[i].pUserData);
+                    m_tickCount++;
+                }
+            }
+        }
+
+        // Draws the tab strip in its own window at the top of the rect and gives the rest to the active tab. Returns the begin
+        // order of the active tab's window.
+        int BeginEnd(
+            uint32_t nodeId,
+            ImVec2   pos,
+            ImVec2   size)
+        {
+            constexpr ImGuiWindowFlags StripFlags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove |
+                                                    ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoScrollWithMouse;
+            float stripHeight = ImMin(ImGui::GetFrameHeight() + 2.f * ImGui::GetStyle().WindowPadding.y, size.y);
+
+            char stripName[32];
+            ImFormatString(stripName, IM_ARRAYSIZE(stripName), "##LeafTabs%u", nodeId);
+            ImGui::SetNextWindowPos(pos);
+            ImGui::SetNextWindowSize(ImVec2(size.x, stripHeight));
+            ImGui::Begin(stripName, nullptr, StripFlags);
+            if (ImGui::BeginTabBar("##Tabs", ImGuiTabBarFlags_FittingPolicyScroll))
+            {
+                for (int i = 0; i < m_tabs.Size; i++)
+                {
+                    ImGuiTabItemFlags flags = (i == m_selectRequest) ? ImGuiTabItemFlags_SetSelected : ImGuiTabItemFlags_None;
+                    if (ImGui::BeginTabItem(m_tabs[i].pLabel, nullptr, flags))
+                    {
+                        m_activeTab = i;
+                        ImGui::EndTabItem();
+                    }
+                }
+                ImGui::EndTabBar();
+            }
+            m_selectRequest = -1;
+            m_pStripWindow = ImGui::GetCurrentWindow();
+            ImGui::End();
+
+            ImGui::SetNextWindowPos(ImVec2(pos.x, pos.y + stripHeight));
+            ImGui::SetNextWindowSize(ImVec2(size.x, size.y - stripHeight));
+            int beginOrder = GImGui->WindowsActiveCount;
+            if (m_activeTab < m_tabs.Size)
+            {
+                m_tabs[m_activeTab].pfnWindowFunc();
+            }
+            return beginOrder;
+        }
+
+    private:
+        CustomLeafTabs(const CustomLeafTabs&) = delete;
+        CustomLeafTabs& operator=(const CustomLeafTabs&) = delete;
+
+        struct Tab
+        {
+            char*             pLabel; // Owned.
+            CustomWindowFunc  pfnWindowFunc;
+            CustomTabTickFunc pfnTickFunc;
+            void*             pUserData;
+        };
+
+        ImVector<Tab> m_tabs;
+        int           m_activeTab;
+        int           m_selectRequest; // Tab to select in the tab strip on the next draw. -1 for none.
+        uint32_t      m_tickInterval;
+        uint32_t      m_frameIndex;
+        uint64_t      m_tickCount;
+        ImGuiWindow*  m_pStripWindow;
+    };
+
+#ifdef CUSTOM_LAYOUT_COROUTINES
+    // co_await it between chunks of work in a coroutine leaf. It suspends until the next frame when another chunk as long
+    // as the last one would not fit in the frame's coroutine budget, and continues right away otherwise.
+    struct CustomBudgetCheck {};
+
+    // co_await it to suspend until the next frame unconditionally.
+    struct CustomNextFrame {};
+
+    // Return type of a coroutine leaf. It starts suspended and runs only when the layout resumes it, so it does the work and
+    // the leaf's window function draws its progress. Hand it to CustomLayout::StartCoroutine(), which owns it from then on.
+    // Don't call Dear ImGui from the coroutine.
+    class CustomLeafTask
+    {
+    public:
+        struct promise_type
+        {
+            const std::chrono::steady_clock::time_point* pDeadline = nullptr; // Set by the layout.
+            std::chrono::steady_clock::time_point        lastCheck;           // Last resume or budget check.
+            std::chrono::steady_clock::duration          lastChunk{};         // Work between the last two checks.
+
+            CustomLeafTask get_return_object()
+            {
+                return CustomLeafTask(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+
+            auto await_transform(CustomBudgetCheck)
+            {
+                struct BudgetAwaiter
+                {
+                    promise_type* pPromise;
+
+                    bool await_ready() const noexcept
+                    {
+                        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                        pPromise->lastChunk = now - pPromise->lastCheck;
+                        pPromise->lastCheck = now;
+                        return (now + pPromise->lastChunk) < *pPromise->pDeadline;
+                    }
+
+                    void await_suspend(std::coroutine_handle<>) const noexcept {}
+                    void await_resume() const noexcept {}
+                };
+                return BudgetAwaiter{ this };
+            }
+
+            std::suspend_always await_transform(CustomNextFrame) { return {}; }
+        };
+
+        CustomLeafTask(CustomLeafTask&& other) noexcept
+            : m_handle(std::exchange(other.m_handle, nullptr))
+        {}
+
+        CustomLeafTask(const CustomLeafTask&) = delete;
+        CustomLeafTask& operator=(const CustomLeafTask&) = delete;
+        CustomLeafTask& operator=(CustomLeafTask&&) = delete;
+
+        ~CustomLeafTask()
+        {
+            if (m_handle)
+            {
+                m_handle.destroy();
+            }
+        }
+
+    private:
+        friend class CustomLayout;
+
+        explicit CustomLeafTask(std::coroutine_handle<promise_type> handle)
+            : m_handle(handle)
+        {}
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+#endif
+
     // Leaves are windows; All others are logical domain.
     // Odd level domain splitters are left-right; even level domain splitters are top-down. (Level number starting from 1)
     class CustomLayoutNode
@@ -26,13 +484,31 @@ namespace DearImGuiExt
             CustomWindowFunc customFunc = nullptr)
             : m_pLeft(nullptr),
               m_pRight(nullptr),
+              m_pParent(nullptr),
+              m_id(0),
               m_level(level),
               m_domainPos(domainPos),
               m_domainSize(domainSize),
               m_splitterRatio(splitterRatio),
               m_splitterWidth(2.f),
               m_pfnCustomWindowFunc(customFunc),
-              m_isLogicalDomain(isLogicalDomain)
+              m_isLogicalDomain(isLogicalDomain),
+              m_isDirty(true),
+              m_pPrepareStage(nullptr),
+              m_pTabs(nullptr),
+              m_pSubLayout(nullptr),
+              m_pWindow(nullptr),
+              m_capacityHint(),
+              m_capacityPeak(),
+              m_nameId(0),
+              m_isHidden(false),
+              m_needsLayout(false),
+              m_minSize(0.f, 0.f),
+              m_maxSize(FLT_MAX, FLT_MAX),
+              m_limitMin(0.f, 0.f),
+              m_limitMax(FLT_MAX, FLT_MAX),
+              m_splitterCoord(0.f),
+              m_isPixelSnapped(false)
         {}
 
         // For the logical domain nodes only.
@@ -44,9 +520,27 @@ namespace DearImGuiExt
               m_domainSize(ImVec2(0.f, 0.f)),
               m_pfnCustomWindowFunc(nullptr),
               m_isLogicalDomain(true),
+              m_isDirty(true),
               m_pLeft(nullptr),
               m_pRight(nullptr),
-              m_splitterRatio(splitterRatio)
+              m_pParent(nullptr),
+              m_id(0),
+              m_splitterRatio(splitterRatio),
+              m_pPrepareStage(nullptr),
+              m_pTabs(nullptr),
+              m_pSubLayout(nullptr),
+              m_pWindow(nullptr),
+              m_capacityHint(),
+              m_capacityPeak(),
+              m_nameId(0),
+              m_isHidden(false),
+              m_needsLayout(false),
+              m_minSize(0.f, 0.f),
+              m_maxSize(FLT_MAX, FLT_MAX),
+              m_limitMin(0.f, 0.f),
+              m_limitMax(FLT_MAX, FLT_MAX),
+              m_splitterCoord(0.f),
+              m_isPixelSnapped(false)
         {}
 
         // For the window nodes only
@@ -57,9 +551,27 @@ namespace DearImGuiExt
               m_domainSize(ImVec2(0.f, 0.f)),
               m_pfnCustomWindowFunc(customFunc),
               m_isLogicalDomain(false),
+              m_isDirty(true),
               m_pLeft(nullptr),
               m_pRight(nullptr),
-              m_splitterRatio(0)
+              m_pParent(nullptr),
+              m_id(0),
+              m_splitterRatio(0),
+              m_pPrepareStage(nullptr),
+              m_pTabs(nullptr),
+              m_pSubLayout(nullptr),
+              m_pWindow(nullptr),
+              m_capacityHint(),
+              m_capacityPeak(),
+              m_nameId(0),
+              m_isHidden(false),
+              m_needsLayout(false),
+              m_minSize(0.f, 0.f),
+              m_maxSize(FLT_MAX, FLT_MAX),
+              m_limitMin(0.f, 0.f),
+              m_limitMax(FLT_MAX, FLT_MAX),
+              m_splitterCoord(0.f),
+              m_isPixelSnapped(false)
         {}
 
         ~CustomLayoutNode()
@@ -73,49 +585,139 @@ namespace DearImGuiExt
             {
                 delete m_pRight;
             }
+
+            if (m_pPrepareStage)
+            {
+                delete m_pPrepareStage;
+            }
+
+            if (m_pTabs)
+            {
+                delete m_pTabs;
+            }
+
+            SetSubLayout(nullptr);
         }
 
         CustomLayoutNode* GetLeftChild() const { return m_pLeft; }
         CustomLayoutNode* GetRightChild() const { return m_pRight; }
+        CustomLayoutNode* GetParent() const { return m_pParent; }
+        uint32_t GetId() const { return m_id; } // Given by the layout. Never reused, even when the node is recycled.
+        ImGuiID GetNameId() const { return m_nameId; } // Hash of the node's name. 0 without a name.
+        bool IsHidden() const { return m_isHidden; }
         ImVec2 GetDomainPos() const { return m_domainPos; }
         ImVec2 GetDomainSize() const { return m_domainSize; }
         uint32_t GetLevel() const { return m_level; }
-        float GetSplitterStartCoord() const
+        float GetSplitterRatio() const { return m_splitterRatio; }
+        float GetSplitterStartCoord() const { return m_splitterCoord; }
+        float GetSplitterWidth() const { return m_splitterWidth; }
+        ImVec2 GetSplitterPos() const
         {
             if (m_level % 2 == 1)
             {
-                return m_domainPos.x + m_splitterRatio * m_domainSize.x;
+                return ImVec2(m_splitterCoord, m_domainPos.y);
             }
             else
             {
-                return m_domainPos.y + m_splitterRatio * m_domainSize.y;
+                return ImVec2(m_domainPos.x, m_splitterCoord);
             }
         }
-        float GetSplitterWidth() const { return m_splitterWidth; }
-        ImVec2 GetSplitterPos() const
+        bool IsLogicalDomain() const { return m_isLogicalDomain; }
+
+        void SetDomainPos(ImVec2 pos) { m_domainPos = pos; }
+        void SetDomainSize(ImVec2 size) { m_domainSize = size; }
+        void SetSplitterRatio(float ratio)
         {
-            if (m_level % 2 == 1)
+            m_splitterRatio = ratio;
+            MarkDirty();
+        }
+
+        // Changed since the layout history recorded it. A dirty node's ancestors are dirty as well.
+        bool IsDirty() const { return m_isDirty; }
+
+        void MarkDirty()
+        {
+            m_isDirty = true;
+            for (CustomLayoutNode* pNode = m_pParent; pNode && (pNode->m_isDirty == false); pNode = pNode->m_pParent)
             {
-                float x = m_domainPos.x + m_splitterRatio * m_domainSize.x;
-                return ImVec2(x, m_domainPos.y);
+                pNode->m_isDirty = true;
             }
-            else
+        }
+
+        // Turns a window node into a two-phase leaf. The emit function replaces the window function.
+        void SetPrepareStage(
+            CustomPrepareFunc prepareFunc,
+            CustomEmitFunc    emitFunc,
+            void*             pUserData)
+        {
+            assert((void("ERROR: Only window nodes can have a prepare stage."), m_isLogicalDomain == false));
+            assert((void("ERROR: A tabbed leaf can't have a prepare stage."), m_pTabs == nullptr));
+            if (m_pPrepareStage)
             {
-                float y = m_domainPos.y + m_splitterRatio * m_domainSize.y;
-                return ImVec2(m_domainPos.x, y);
+                delete m_pPrepareStage;
             }
+            m_pPrepareStage = new CustomLeafPrepareStage(prepareFunc, emitFunc, pUserData);
         }
-        bool IsLogicalDomain() const { return m_isLogicalDomain; }
 
-        void SetDomainPos(ImVec2 pos) { m_domainPos = pos; }
-        void SetDomainSize(ImVec2 size) { m_domainSize = size; }
-        void SetSplitterRatio(float ratio) { m_splitterRatio = ratio; }
+        CustomLeafPrepareStage* GetPrepareStage() const { return m_pPrepareStage; }
+
+        // Turns a window node into a tabbed leaf on its first tab. The tabs replace the window function. The tick function
+        // and its user data are optional, see CustomLeafTabs. Returns the index of the tab.
+        int AddTab(
+            const char*       pLabel,
+            CustomWindowFunc  windowFunc,
+            CustomTabTickFunc tickFunc = nullptr,
+            void*             pUserData = nullptr)
+        {
+            assert((void("ERROR: Only window nodes can have tabs."), m_isLogicalDomain == false));
+            assert((void("ERROR: A two-phase leaf can't have tabs."), m_pPrepareStage == nullptr));
+            if (m_pTabs == nullptr)
+            {
+                m_pTabs = new CustomLeafTabs();
+            }
+            return m_pTabs->AddTab(pLabel, windowFunc, tickFunc, pUserData);
+        }
+
+        CustomLeafTabs* GetTabs() const { return m_pTabs; }
+
+        // Hosts a layout in the leaf in place of the window function. The sub-layout covers the leaf's domain and is only
+        // laid out again when that changes. Nothing of it runs while the leaf is hidden or collapsed to nothing. The leaf
+        // doesn't own it: destroying either one detaches them. A layout has one host at most. NULL detaches the current one.
+        void SetSubLayout(CustomLayout* pLayout);
+
+        CustomLayout* GetSubLayout() const { return m_pSubLayout; }
+
+        // Names a node of a tree that isn't given to a layout yet. Use CustomLayout::SetNodeName() afterwards, it keeps the
+        // layout's name index up to date. NULL or an empty name removes the name.
+        void SetName(const char* pName)
+        {
+            m_nameId = (pName && pName[0]) ? ImHashStr(pName) : 0;
+        }
+
+        // The first window the leaf began in its last build. NULL before that.
+        ImGuiWindow* GetWindow() const { return m_pWindow; }
+
+        // Reserved by the leaf's window as soon as it exists, so it doesn't grow its draw list over the first frames.
+        void SetCapacityHint(const CustomLeafCapacity& capacity)
+        {
+            m_capacityHint = capacity;
+            if (m_pWindow)
+            {
+                ReserveCapacity();
+            }
+        }
+
+        const CustomLeafCapacity& GetCapacityHint() const { return m_capacityHint; }
+
+        // Largest draw list of the leaf's window since the node was created. CustomLayout::SaveState() stores it.
+        const CustomLeafCapacity& GetCapacityPeak() const { return m_capacityPeak; }
 
         void CreateLeftChild(float ratio)
         {
             assert((void("ERROR: Only logical domain can have children."), m_isLogicalDomain == true));
             m_pLeft = new CustomLayoutNode(ratio);
             m_pLeft->m_level = m_level + 1;
+            m_pLeft->m_pParent = this;
         }
 
         void CreateLeftChild(CustomWindowFunc windowFunc)
@@ -123,6 +725,7 @@ namespace DearImGuiExt
             assert((void("ERROR: Only logical domain can have children."), m_isLogicalDomain == true));
             m_pLeft = new CustomLayoutNode(windowFunc);
             m_pLeft->m_level = m_level + 1;
+            m_pLeft->m_pParent = this;
         }
 
         void CreateRightChild(float ratio)
@@ -130,6 +733,7 @@ namespace DearImGuiExt
             assert((void("ERROR: Only logical domain can have children."), m_isLogicalDomain == true));
             m_pRight = new CustomLayoutNode(ratio);
             m_pRight->m_level = m_level + 1;
+            m_pRight->m_pParent = this;
         }
 
         void CreateRightChild(CustomWindowFunc windowFunc)
@@ -137,10 +741,16 @@ namespace DearImGuiExt
             assert((void("ERROR: Only logical domain can have children."), m_isLogicalDomain == true));
             m_pRight = new CustomLayoutNode(windowFunc);
             m_pRight->m_level = m_level + 1;
+            m_pRight->m_pParent = this;
         }
 
         void BeginEndNodeAndChildren()
         {
+            if (m_isHidden)
+            {
+                return;
+            }
+
             if (m_isLogicalDomain)
             {
                 // It is a logical domain. Calling its children instead.
@@ -154,80 +764,162 @@ namespace DearImGuiExt
                     m_pRight->BeginEndNodeAndChildren();
                 }
             }
+            else if (m_pSubLayout)
+            {
+                BeginEndSubLayout();
+            }
             else
             {
                 // Begin the window itself. Calling the custom function pointer.
                 ImGui::SetNextWindowPos(m_domainPos);
                 ImGui::SetNextWindowSize(m_domainSize);
+                int beginOrder = GImGui->WindowsActiveCount;
 
                 // Set custom windows properties.
-                if (m_pfnCustomWindowFunc)
+                if (m_pTabs)
+                {
+                    // The leaf's window is the active tab's one, begun after the tab strip.
+                    beginOrder = m_pTabs->BeginEnd(m_id, m_domainPos, m_domainSize);
+                }
+                else if (m_pPrepareStage)
+                {
+                    m_pPrepareStage->Emit();
+                }
+                else if (m_pfnCustomWindowFunc)
                 {
                     m_pfnCustomWindowFunc();
                 }
+
+                CaptureWindow(beginOrder);
+                if (m_pWindow)
+                {
+                    ImDrawList* pDrawList = m_pWindow->DrawList;
+                    m_capacityPeak.vtxCount = ImMax(m_capacityPeak.vtxCount, pDrawList->VtxBuffer.Size);
+                    m_capacityPeak.idxCount = ImMax(m_capacityPeak.idxCount, pDrawList->IdxBuffer.Size);
+                    m_capacityPeak.cmdCount = ImMax(m_capacityPeak.cmdCount, pDrawList->CmdBuffer.Size);
+                }
             }
         }
 
-        // Feed in new position and size and keep the original ratio.
-        void ResizeNodeAndChildren(
-            ImVec2 newPos,
-            ImVec2 newSize)
+        bool ContainsNode(const CustomLayoutNode* pNode) const
         {
-            // Resize this node.
-            m_domainPos = newPos;
-            m_domainSize = newSize;
+            if (pNode == this)
+            {
+                return true;
+            }
+            return (m_pLeft && m_pLeft->ContainsNode(pNode)) || (m_pRight && m_pRight->ContainsNode(pNode));
+        }
+
+        // Appends the window nodes under this node in layout order. Left (top) children come first. Hidden nodes and the
+        // nodes under them are skipped.
+        void CollectLeaves(ImVector<CustomLayoutNode*>& leaves)
+        {
+            if (m_isHidden)
+            {
+                return;
+            }
 
-            // If this node is a logical domain, then we need to also calculate new pos and domains for its children and
-            // call their resize function.
             if (m_isLogicalDomain)
             {
-                float splitterStartCoordinate = GetSplitterStartCoord();
-                float splitterWidth = GetSplitterWidth();
-                if (m_level % 2 == 1)
+                if (m_pLeft)
                 {
-                    m_pLeft->ResizeNodeAndChildren(m_domainPos, ImVec2(splitterStartCoordinate - m_domainPos.x, m_domainSize.y));
-                    m_pRight->ResizeNodeAndChildren(ImVec2(splitterStartCoordinate + splitterWidth, m_domainPos.y),
-                        ImVec2(m_domainSize.x -
-                            (splitterStartCoordinate - m_domainPos.x + splitterWidth),
-                            m_domainSize.y));
+                    m_pLeft->CollectLeaves(leaves);
                 }
-                else
+
+                if (m_pRight)
                 {
-                    m_pLeft->ResizeNodeAndChildren(m_domainPos, ImVec2(m_domainSize.x,
-                        splitterStartCoordinate - m_domainPos.y));
-                    m_pRight->ResizeNodeAndChildren(ImVec2(m_domainPos.x, splitterStartCoordinate + splitterWidth),
-                        ImVec2(m_domainSize.x,
-                            m_domainSize.y -
-                            (splitterStartCoordinate - m_domainPos.y + splitterWidth)));
+                    m_pRight->CollectLeaves(leaves);
                 }
             }
-
+            else
+            {
+                leaves.push_back(this);
+            }
         }
 
-        CustomLayoutNode* GetHoverSplitter()
+        // Appends this node and the nodes under it in depth-first order, parents before their children.
+        void CollectNodes(ImVector<CustomLayoutNode*>& nodes)
         {
-            if (m_isLogicalDomain == false)
+            nodes.push_back(this);
+            if (m_pLeft)
             {
-                return nullptr;
+                m_pLeft->CollectNodes(nodes);
             }
-
-            // Get splitter pos
-            ImVec2 splitterMin;
-            ImVec2 splitterMax;
-
-            constexpr float SplitterWidthPadding = 2.f;
-
-            if (m_level % 2 == 1)
+            if (m_pRight)
             {
-                splitterMin.x = m_domainPos.x + m_splitterRatio * m_domainSize.x - SplitterWidthPadding;
-                splitterMin.y = m_domainPos.y;
+                m_pRight->CollectNodes(nodes);
+            }
+        }
+
+        // Feed in new position and size and keep the original ratio. The size limits of the subtree are worked out first,
+        // bottom-up, then the splitters are placed top-down: two passes over the subtree whatever the constraints.
+        void ResizeNodeAndChildren(
+            ImVec2 newPos,
+            ImVec2 newSize)
+        {
+            UpdateSubtreeSizeLimits();
+            LayoutNodeAndChildren(newPos, newSize);
+        }
+
+        // Limits of the node's size. A splitter ratio only places its splitter within the range the two children accept,
+        // so a fixed panel (the same size for both) keeps its size through every resize. Where the limits of the two children
+        // conflict the left or top one wins, unless only the other one has a fixed size. The root always covers the viewport.
+        // Set them before the tree goes to a layout, and with CustomLayout::SetNodeSizeConstraints() after.
+        void SetSizeConstraints(
+            ImVec2 minSize,
+            ImVec2 maxSize = ImVec2(FLT_MAX, FLT_MAX))
+        {
+            assert((void("ERROR: The max size cannot be less than the min size."), (minSize.x <= maxSize.x) && (minSize.y <= maxSize.y)));
+            m_minSize = minSize;
+            m_maxSize = maxSize;
+        }
+
+        // An axis of 0 or less stays free.
+        void SetFixedSize(ImVec2 size)
+        {
+            SetSizeConstraints(ImVec2(ImMax(size.x, 0.f), ImMax(size.y, 0.f)),
+                               ImVec2((size.x > 0.f) ? size.x : FLT_MAX, (size.y > 0.f) ? size.y : FLT_MAX));
+        }
+
+        ImVec2 GetMinSize() const { return m_minSize; }
+        ImVec2 GetMaxSize() const { return m_maxSize; }
+
+        // What the node and its subtree accept together, as of the last layout. The root's min is the smallest useful
+        // viewport.
+        ImVec2 GetSizeLimitMin() const { return m_limitMin; }
+        ImVec2 GetSizeLimitMax() const { return m_limitMax; }
+
+        CustomLayoutNode* GetHoverSplitter()
+        {
+            if (m_isLogicalDomain == false)
+            {
+                return nullptr;
+            }
+
+            // Without its splitter, a domain is covered by its shown child.
+            if (m_pLeft->m_isHidden || m_pRight->m_isHidden)
+            {
+                CustomLayoutNode* pShown = m_pLeft->m_isHidden ? m_pRight : m_pLeft;
+                return pShown->m_isHidden ? nullptr : pShown->GetHoverSplitter();
+            }
+
+            // Get splitter pos
+            ImVec2 splitterMin;
+            ImVec2 splitterMax;
+
+            constexpr float SplitterWidthPadding = 2.f;
+
+            if (m_level % 2 == 1)
+            {
+                splitterMin.x = m_splitterCoord - SplitterWidthPadding;
+                splitterMin.y = m_domainPos.y;
                 splitterMax.x = splitterMin.x + m_splitterWidth + SplitterWidthPadding;
                 splitterMax.y = m_domainPos.y + m_domainSize.y;
             }
             else
             {
                 splitterMin.x = m_domainPos.x;
-                splitterMin.y = m_domainPos.y + m_splitterRatio * m_domainSize.y - SplitterWidthPadding;
+                splitterMin.y = m_splitterCoord - SplitterWidthPadding;
                 splitterMax.x = m_domainPos.x + m_domainSize.x;
                 splitterMax.y = splitterMin.y + m_splitterWidth + SplitterWidthPadding;
             }
@@ -266,23 +958,316 @@ namespace DearImGuiExt
         }
 
     private:
+        friend class CustomLayout;
+        friend class CustomLayoutHistory;
+
+        void BeginEndSubLayout();
+
+        // The first window a leaf begins gets the next begin order of the frame. The windows are only searched when the
+        // leaf's window changed.
+        void CaptureWindow(int beginOrder)
+        {
+            ImGuiContext& g = *GImGui;
+            if (m_pWindow && (m_pWindow->LastFrameActive == g.FrameCount) && (m_pWindow->BeginOrderWithinContext == beginOrder))
+            {
+                return;
+            }
+
+            m_pWindow = nullptr;
+            for (int i = 0; i < g.Windows.Size; i++)
+            {
+                if ((g.Windows[i]->LastFrameActive == g.FrameCount) && (g.Windows[i]->BeginOrderWithinContext == beginOrder))
+                {
+                    m_pWindow = g.Windows[i];
+                    ReserveCapacity();
+                    break;
+                }
+            }
+        }
+
+        void ReserveCapacity()
+        {
+            m_pWindow->DrawList->VtxBuffer.reserve(m_capacityHint.vtxCount);
+            m_pWindow->DrawList->IdxBuffer.reserve(m_capacityHint.idxCount);
+            m_pWindow->DrawList->CmdBuffer.reserve(m_capacityHint.cmdCount);
+        }
+
+        // Works out the limits of this node from its own constraints and the limits of its children. Returns whether they
+        // changed. Along the splitter axis the children add up, across it both have to fit.
+        bool UpdateSizeLimits()
+        {
+            ImVec2 limitMin(0.f, 0.f);
+            ImVec2 limitMax(FLT_MAX, FLT_MAX);
+            if (m_isLogicalDomain && (m_pLeft->m_isHidden || m_pRight->m_isHidden))
+            {
+                CustomLayoutNode* pShown = m_pLeft->m_isHidden ? m_pRight : m_pLeft;
+                if (pShown->m_isHidden == false)
+                {
+                    limitMin = pShown->m_limitMin;
+                    limitMax = pShown->m_limitMax;
+                }
+            }
+            else if (m_isLogicalDomain)
+            {
+                int axis = (m_level % 2 == 1) ? 0 : 1;
+                int crossAxis = axis ^ 1;
+
+                limitMin[axis] = m_pLeft->m_limitMin[axis] + m_pRight->m_limitMin[axis] + m_splitterWidth;
+                if ((m_pLeft->m_limitMax[axis] != FLT_MAX) && (m_pRight->m_limitMax[axis] != FLT_MAX))
+                {
+                    limitMax[axis] = m_pLeft->m_limitMax[axis] + m_pRight->m_limitMax[axis] + m_splitterWidth;
+                }
+                limitMin[crossAxis] = ImMax(m_pLeft->m_limitMin[crossAxis], m_pRight->m_limitMin[crossAxis]);
+                limitMax[crossAxis] = ImMin(m_pLeft->m_limitMax[crossAxis], m_pRight->m_limitMax[crossAxis]);
+            }
+
+            limitMin = ImMax(limitMin, m_minSize);
+            limitMax = ImMax(limitMin, ImMin(limitMax, m_maxSize));
+            bool changed = (limitMin.x != m_limitMin.x) || (limitMin.y != m_limitMin.y) ||
+                           (limitMax.x != m_limitMax.x) || (limitMax.y != m_limitMax.y);
+            m_limitMin = limitMin;
+            m_limitMax = limitMax;
+            return changed;
+        }
+
+        // Bottom-up over the subtree. Returns whether the limits of this node changed.
+        bool UpdateSubtreeSizeLimits()
+        {
+            if (m_isLogicalDomain)
+            {
+                m_pLeft->UpdateSubtreeSizeLimits();
+                m_pRight->UpdateSubtreeSizeLimits();
+            }
+            return UpdateSizeLimits();
+        }
+
+        // Top-down over the subtree. The limits have to be up to date.
+        void LayoutNodeAndChildren(
+            ImVec2 newPos,
+            ImVec2 newSize)
+        {
+            // Resize this node. Snapping the two edges rather than the size keeps the neighbours' edges where they are.
+            if (m_isPixelSnapped)
+            {
+                ImVec2 newEnd = ImVec2(SnapToPixel(newPos.x + newSize.x), SnapToPixel(newPos.y + newSize.y));
+                newPos = ImVec2(SnapToPixel(newPos.x), SnapToPixel(newPos.y));
+                newSize = ImVec2(newEnd.x - newPos.x, newEnd.y - newPos.y);
+            }
+            m_domainPos = newPos;
+            m_domainSize = newSize;
+
+            // If this node is a logical domain, then we need to also calculate new pos and domains for its children and
+            // call their resize function.
+            if (m_isLogicalDomain && (m_pLeft->m_isHidden || m_pRight->m_isHidden))
+            {
+                // A hidden child gives its space and the splitter to the other one.
+                CustomLayoutNode* pShown = m_pLeft->m_isHidden ? m_pRight : m_pLeft;
+                if (pShown->m_isHidden == false)
+                {
+                    pShown->LayoutNodeAndChildren(m_domainPos, m_domainSize);
+                }
+            }
+            else if (m_isLogicalDomain)
+            {
+                ImVec2 leftSize;
+                ImVec2 rightPos;
+                ImVec2 rightSize;
+                m_splitterCoord = SplitDomain(leftSize, rightPos, rightSize);
+                m_pLeft->LayoutNodeAndChildren(m_domainPos, leftSize);
+                m_pRight->LayoutNodeAndChildren(rightPos, rightSize);
+            }
+        }
+
+        // Whether laying out this domain again would give its children the rects they have.
+        bool IsSplitUpToDate() const
+        {
+            if ((m_isLogicalDomain == false) || m_pLeft->m_isHidden || m_pRight->m_isHidden)
+            {
+                return true;
+            }
+
+            ImVec2 leftSize;
+            ImVec2 rightPos;
+            ImVec2 rightSize;
+            float splitterCoord = SplitDomain(leftSize, rightPos, rightSize);
+            return (splitterCoord == m_splitterCoord) &&
+                   (leftSize.x == m_pLeft->m_domainSize.x) && (leftSize.y == m_pLeft->m_domainSize.y) &&
+                   (rightPos.x == m_pRight->m_domainPos.x) && (rightPos.y == m_pRight->m_domainPos.y) &&
+                   (rightSize.x == m_pRight->m_domainSize.x) && (rightSize.y == m_pRight->m_domainSize.y);
+        }
+
+        // Rects of the two children in the current domain. Returns the splitter start coordinate.
+        float SplitDomain(
+            ImVec2& leftSize,
+            ImVec2& rightPos,
+            ImVec2& rightSize) const
+        {
+            int axis = (m_level % 2 == 1) ? 0 : 1;
+            float domainCoord = m_domainPos[axis];
+            float domainLen = m_domainSize[axis];
+            float availableLen = domainLen - m_splitterWidth;
+
+            // The ratio gives the left length, then the limits of both children clamp it. The ones applied last win a
+            // conflict: the left ones, unless only the right child has a fixed size. A clamped child gets its limit as is, so a
+            // fixed size comes out exactly the same every time.
+            float leftLen = m_splitterRatio * domainLen;
+            float rightLen = 0.f;
+            bool isLeftClamped = false;
+            bool isRightClamped = false;
+            auto clampLeft = [&]()
+            {
+                if (leftLen <= m_pLeft->m_limitMin[axis])
+                {
+                    leftLen = m_pLeft->m_limitMin[axis];
+                    isLeftClamped = true;
+                    isRightClamped = false;
+                }
+                else if (leftLen >= m_pLeft->m_limitMax[axis])
+                {
+                    leftLen = m_pLeft->m_limitMax[axis];
+                    isLeftClamped = true;
+                    isRightClamped = false;
+                }
+            };
+            auto clampRight = [&]()
+            {
+                if (availableLen - leftLen <= m_pRight->m_limitMin[axis])
+                {
+                    rightLen = m_pRight->m_limitMin[axis];
+                    isRightClamped = true;
+                }
+                else if (availableLen - leftLen >= m_pRight->m_limitMax[axis])
+                {
+                    rightLen = m_pRight->m_limitMax[axis];
+                    isRightClamped = true;
+                }
+
+                if (isRightClamped)
+                {
+                    leftLen = availableLen - rightLen;
+                    isLeftClamped = false;
+                }
+            };
+
+            bool isOnlyRightFixed = (m_pLeft->m_limitMin[axis] != m_pLeft->m_limitMax[axis]) &&
+                                    (m_pRight->m_limitMin[axis] == m_pRight->m_limitMax[axis]);
+            if (isOnlyRightFixed)
+            {
+                clampLeft();
+                clampRight();
+            }
+            else
+            {
+                clampRight();
+                clampLeft();
+            }
+
+            // Two fixed children both keep their size. The rounding of their sum goes to the splitter.
+            if (isLeftClamped && (m_pRight->m_limitMin[axis] == m_pRight->m_limitMax[axis]))
+            {
+                rightLen = m_pRight->m_limitMin[axis];
+                isRightClamped = true;
+            }
+
+            // Snapped, the lengths are rounded on their own against the whole pixel domain edges, so the rounding never adds
+            // up along a chain of splitters and the children tile the domain exactly. Fractional limits go to the nearest pixel.
+            if (m_isPixelSnapped)
+            {
+                leftLen = SnapToPixel(leftLen);
+                rightLen = SnapToPixel(rightLen);
+            }
+
+            float splitterCoord = (isRightClamped && (isLeftClamped == false)) ?
+                                  domainCoord + domainLen - rightLen - m_splitterWidth : domainCoord + leftLen;
+
+            leftSize = m_domainSize;
+            leftSize[axis] = isLeftClamped ? leftLen : splitterCoord - domainCoord;
+            rightPos = m_domainPos;
+            rightPos[axis] = isRightClamped ? domainCoord + domainLen - rightLen : splitterCoord + m_splitterWidth;
+            rightSize = m_domainSize;
+            rightSize[axis] = isRightClamped ? rightLen : domainLen - (splitterCoord - domainCoord + m_splitterWidth);
+            return splitterCoord;
+        }
+
         void SetLeftChild(CustomLayoutNode* pNode)
         {
             m_pLeft = pNode;
             m_pLeft->m_level = m_level + 1;
+            m_pLeft->m_pParent = this;
         }
 
         void SetRightChild(CustomLayoutNode* pNode)
         {
             m_pRight = pNode;
             m_pRight->m_level = m_level + 1;
+            m_pRight->m_pParent = this;
+        }
+
+        // Turns a node of the layout's free list into a new node.
+        void Recycle(
+            bool             isLogicalDomain,
+            float            splitterRatio,
+            CustomWindowFunc customFunc)
+        {
+            m_pLeft = nullptr;
+            m_pRight = nullptr;
+            m_pParent = nullptr;
+            m_level = isLogicalDomain ? 1 : 0;
+            m_domainPos = ImVec2(0.f, 0.f);
+            m_domainSize = ImVec2(0.f, 0.f);
+            m_splitterRatio = splitterRatio;
+            m_pfnCustomWindowFunc = customFunc;
+            m_isLogicalDomain = isLogicalDomain;
+            m_isDirty = true;
+            if (m_pPrepareStage)
+            {
+                delete m_pPrepareStage;
+                m_pPrepareStage = nullptr;
+            }
+            if (m_pTabs)
+            {
+                delete m_pTabs;
+                m_pTabs = nullptr;
+            }
+            SetSubLayout(nullptr);
+            m_pWindow = nullptr;
+            m_capacityHint = CustomLeafCapacity();
+            m_capacityPeak = CustomLeafCapacity();
+            m_nameId = 0;
+            m_isHidden = false;
+            m_needsLayout = false;
+            m_minSize = ImVec2(0.f, 0.f);
+            m_maxSize = ImVec2(FLT_MAX, FLT_MAX);
+            m_limitMin = ImVec2(0.f, 0.f);
+            m_limitMax = ImVec2(FLT_MAX, FLT_MAX);
+            m_splitterCoord = 0.f;
+            m_isPixelSnapped = false;
+        }
+
+        // Structural edits move whole subtrees without changing their levels, so their splitters keep their orientation.
+        void ReplaceChild(
+            CustomLayoutNode* pOld,
+            CustomLayoutNode* pNew)
+        {
+            if (m_pLeft == pOld)
+            {
+                m_pLeft = pNew;
+            }
+            else
+            {
+                m_pRight = pNew;
+            }
+            pNew->m_pParent = this;
+            MarkDirty();
         }
 
 
         CustomLayoutNode* m_pLeft;  // Or top for the even level splitters.
         CustomLayoutNode* m_pRight; // Or down for the even level splitters.
+        CustomLayoutNode* m_pParent;
+        uint32_t          m_id;
         uint32_t          m_level;  // Used to determine whether it is a vertical splitter or a horizontal splitter. 
-                                    // Only for a splitter.
+                                    // Only for a splitter. Only its parity matters.
 
         // Domain represents the screen area that a node occpies. For windows, their domains are just same as the the their
         // starting position and size. But for splitters, their domains represent the area it splits
@@ -295,131 +1280,2116 @@ namespace DearImGuiExt
         CustomWindowFunc m_pfnCustomWindowFunc;
 
         bool m_isLogicalDomain;
+        bool m_isDirty;
+
+        CustomLeafPrepareStage* m_pPrepareStage; // Only for two-phase window nodes.
+        CustomLeafTabs*         m_pTabs;         // Only for tabbed window nodes.
+        CustomLayout*           m_pSubLayout;    // Only for window nodes hosting a layout. Not owned.
+
+        // Only for window nodes.
+        ImGuiWindow*       m_pWindow;
+        CustomLeafCapacity m_capacityHint;
+        CustomLeafCapacity m_capacityPeak;
+
+        ImGuiID m_nameId;
+        bool    m_isHidden;    // Its sibling takes its place. Hiding both children of a domain leaves the domain empty.
+        bool    m_needsLayout; // Its subtree is laid out again at the end of the layout's transaction.
+
+        ImVec2 m_minSize;       // Set by the user.
+        ImVec2 m_maxSize;
+        ImVec2 m_limitMin;      // What the node and its subtree accept together. Kept up to date by the layout.
+        ImVec2 m_limitMax;
+        float  m_splitterCoord; // Splitter start after the children's limits moved it. Only for logical domains.
+        bool   m_isPixelSnapped; // Rects on whole pixels. Set by CustomLayout::SetPixelSnapping().
     };
 
-    // We only need to build the splitter structure at first. We can auto-generate windows from the splitters.
-    class CustomLayout
+    class CustomParallelLeafBuilder;
+
+#ifdef CUSTOM_LAYOUT_PARALLEL_LEAVES
+    // Builds the leaves of a layout in parallel. Every leaf owns a Dear ImGui context that uses the fonts of the main
+    // context's atlas, so its callback can run on any thread. Mouse input goes to the leaf under the cursor, or to the leaf where a
+    // mouse button went down until it is released. Keyboard input goes to the leaf clicked last.
+    class CustomParallelLeafBuilder
     {
     public:
-        explicit CustomLayout(CustomLayoutNode* root)
-            : m_pRoot(root),
-              m_pHeldSplitterDomain(nullptr),
-              m_splitterHeld(false),
-              m_splitterBottonDownDelta(0.f),
-              m_lastViewport(ImVec2(0.f, 0.f)),
-              m_heldMouseCursor(0)
+        explicit CustomParallelLeafBuilder(JobSystem* pJobSystem)
+            : m_pJobSystem(pJobSystem),
+              m_pMouseOwner(nullptr),
+              m_pKeyboardOwner(nullptr),
+              m_anyMouseDown(false),
+              m_displaySize(ImVec2(0.f, 0.f)),
+              m_deltaTime(0.f),
+              m_keyMods(0)
         {
-            assert((void("ERROR: The root node pointer cannot be NULL to init CustomLayout."), root != nullptr));
+            assert((void("ERROR: The job system cannot be NULL."), pJobSystem != nullptr));
         }
-        
-        void ResizeAll()
-        {
-            ImGuiViewport* pViewport = ImGui::GetMainViewport();
 
-            // Dealing with viewport resize
-            if ((pViewport->WorkSize.x != m_lastViewport.x) || (pViewport->WorkSize.y != m_lastViewport.y))
+        ~CustomParallelLeafBuilder()
+        {
+            m_pJobSystem->Wait(&m_counter);
+            for (std::unique_ptr<LeafState>& pLeaf : m_leafStates)
             {
-                m_pRoot->ResizeNodeAndChildren(pViewport->WorkPos, pViewport->WorkSize);
-                m_lastViewport = pViewport->WorkSize;
+                DestroyLeafContext(pLeaf.get());
             }
         }
 
-        // Update Dear ImGUI state
-        void BeginEndLayout()
+        // Main thread, between the main context's NewFrame() and Render(). Routes the input and starts one job per leaf.
+        void Dispatch(CustomLayoutNode* pRoot)
         {
-            ResizeAll();
+            m_pJobSystem->Wait(&m_counter);
 
-            // Dealing with the mouse interactions.
-            if (m_splitterHeld == false)
+            m_leaves.resize(0);
+            m_hostLeaves.resize(0);
+            pRoot->CollectLeaves(m_leaves);
+            for (int i = 0; i < m_leaves.Size;)
             {
-                CustomLayoutNode* pSplitterDomain = m_pRoot->GetHoverSplitter();
-                if (pSplitterDomain)
+                // A sub-layout's frame applies its commands and starts its jobs, so it has to stay on the main thread.
+                if (m_leaves[i]->GetSubLayout())
                 {
-                    // If the mouse cursor hovers on a splitter, then we need to change the appearance of the cursor and
-                    // check whether there is a click event in the event queue. If there is a click event, then the
-                    // splitter is occupied by the mouse.
-                    bool isLeftRightSplitter = (pSplitterDomain->GetLevel() % 2 == 1);
+                    m_hostLeaves.push_back(m_leaves[i]);
+                    m_leaves.erase(m_leaves.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+            SyncLeafStates();
 
-                    isLeftRightSplitter ? ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeEW) :
-                                          ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeNS);
+            ImGuiIO& io = ImGui::GetIO();
+            m_displaySize = io.DisplaySize;
+            m_deltaTime = io.DeltaTime;
 
+            // Snapshot the main context's keyboard state. Jobs must not read the main context while it keeps building.
+            // The mouse aliases and the keys reserved for the mods can't be submitted, the mods go as ImGuiMod_ flags.
+            for (int key = ImGuiKey_NamedKey_BEGIN; key < ImGuiKey_Aliases_BEGIN; key++)
+            {
+                m_keysDown[key - ImGuiKey_NamedKey_BEGIN] = ImGui::IsKeyDown((ImGuiKey)key);
+            }
+            m_keyMods = io.KeyMods;
+            m_inputChars.resize(0);
+            for (int i = 0; i < io.InputQueueCharacters.Size; i++)
+            {
+                m_inputChars.push_back(io.InputQueueCharacters[i]);
+            }
 
-                    if (ImGui::IsMouseClicked(ImGuiMouseButton_Left))
-                    {
-                        m_splitterHeld = true;
+            LeafState* pHovered = nullptr;
+            for (int i = 0; i < m_frameLeaves.Size; i++)
+            {
+                CustomLayoutNode* pNode = m_frameLeaves[i]->pNode;
+                ImVec2 domainPos = pNode->GetDomainPos();
+                ImVec2 domainSize = pNode->GetDomainSize();
+                ImRect domain(domainPos.x, domainPos.y, domainPos.x + domainSize.x, domainPos.y + domainSize.y);
+                if (domain.Contains(io.MousePos))
+                {
+                    pHovered = m_frameLeaves[i];
+                    break;
+                }
+            }
 
-                        ImVec2 splitterPos = pSplitterDomain->GetSplitterPos();
-                        ImVec2 mousePos = ImGui::GetMousePos();
-                        m_splitterBottonDownDelta = isLeftRightSplitter ? splitterPos.x - mousePos.x :
-                            splitterPos.y - mousePos.y;
+            bool anyMouseDown = false;
+            for (int button = 0; button < IM_ARRAYSIZE(io.MouseDown); button++)
+            {
+                anyMouseDown |= io.MouseDown[button];
+            }
+            if ((anyMouseDown == true) && (m_anyMouseDown == false))
+            {
+                m_pMouseOwner = pHovered;
+                m_pKeyboardOwner = pHovered;
+            }
+            else if (anyMouseDown == false)
+            {
+                m_pMouseOwner = nullptr;
+            }
+            m_anyMouseDown = anyMouseDown;
 
-                        m_pHeldSplitterDomain = pSplitterDomain;
-                    }
+            LeafState* pMouseTarget = anyMouseDown ? m_pMouseOwner : pHovered;
+            for (int i = 0; i < m_frameLeaves.Size; i++)
+            {
+                LeafState* pLeaf = m_frameLeaves[i];
+                bool isTarget = (pLeaf == pMouseTarget);
+                pLeaf->mousePos = isTarget ? io.MousePos : ImVec2(-FLT_MAX, -FLT_MAX);
+                for (int button = 0; button < IM_ARRAYSIZE(io.MouseDown); button++)
+                {
+                    pLeaf->mouseDown[button] = isTarget && io.MouseDown[button];
                 }
+                pLeaf->mouseWheel = isTarget ? ImVec2(io.MouseWheelH, io.MouseWheel) : ImVec2(0.f, 0.f);
+                pLeaf->hasKeyboard = (pLeaf == m_pKeyboardOwner);
+                pLeaf->pDrawData = nullptr;
+
+                m_pJobSystem->Submit(BuildLeafJob, pLeaf, &m_counter);
             }
-            else
+
+            // Built in place in the main context while the jobs run. Their windows get the main context's input.
+            for (int i = 0; i < m_hostLeaves.Size; i++)
             {
-                if (ImGui::IsMouseDown(ImGuiMouseButton_Left))
-                {
-                    bool isLeftRightSplitter = (m_pHeldSplitterDomain->GetLevel() % 2 == 1);
-                    ImVec2 domainPos = m_pHeldSplitterDomain->GetDomainPos();
-                    ImVec2 domainSize = m_pHeldSplitterDomain->GetDomainSize();
-                    ImVec2 mousePos = ImGui::GetMousePos();
-                    float newSplitterRatio = -1.f;
+                m_hostLeaves[i]->BeginEndNodeAndChildren();
+            }
+        }
 
-                    if (isLeftRightSplitter)
-                    {
-                        ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeEW);
-                        float newSplitterCoord = m_splitterBottonDownDelta + mousePos.x;
-                        float newSplitterAxisLen = newSplitterCoord - domainPos.x;
-                        newSplitterRatio = newSplitterAxisLen / domainSize.x;
-                    }
-                    else
-                    {
-                        ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeNS);
-                        float newSplitterCoord = m_splitterBottonDownDelta + mousePos.y;
-                        float newSplitterAxisLen = newSplitterCoord - domainPos.y;
-                        newSplitterRatio = newSplitterAxisLen / domainSize.y;
-                    }
+        // Main thread, after the main context's Render(). Waits for the leaves and returns the main context's draw lists
+        // behind the leaves' ones, which are in layout order.
+        ImDrawData* Merge(ImDrawData* pMainDrawData)
+        {
+            m_pJobSystem->Wait(&m_counter);
 
-                    m_pHeldSplitterDomain->SetSplitterRatio(newSplitterRatio);
-                    m_pHeldSplitterDomain->ResizeNodeAndChildren(domainPos, domainSize);
+            m_mergedLists.resize(0);
+            int totalVtxCount = pMainDrawData->TotalVtxCount;
+            int totalIdxCount = pMainDrawData->TotalIdxCount;
+            for (int i = 0; i < m_frameLeaves.Size; i++)
+            {
+                ImDrawData* pLeafDrawData = m_frameLeaves[i]->pDrawData;
+                if (pLeafDrawData == nullptr)
+                {
+                    continue;
                 }
-                else
+
+                for (int n = 0; n < pLeafDrawData->CmdListsCount; n++)
                 {
-                    m_splitterHeld = false;
+                    m_mergedLists.push_back(pLeafDrawData->CmdLists[n]);
                 }
+                totalVtxCount += pLeafDrawData->TotalVtxCount;
+                totalIdxCount += pLeafDrawData->TotalIdxCount;
             }
 
-            // Putting windows data into Dear ImGui's state.
-            if (m_pRoot != nullptr)
+            for (int n = 0; n < pMainDrawData->CmdListsCount; n++)
             {
-                m_pRoot->BeginEndNodeAndChildren();
+                m_mergedLists.push_back(pMainDrawData->CmdLists[n]);
             }
+
+            m_mergedDrawData.Valid            = pMainDrawData->Valid;
+            m_mergedDrawData.TotalVtxCount    = totalVtxCount;
+            m_mergedDrawData.TotalIdxCount    = totalIdxCount;
+            m_mergedDrawData.DisplayPos       = pMainDrawData->DisplayPos;
+            m_mergedDrawData.DisplaySize      = pMainDrawData->DisplaySize;
+            m_mergedDrawData.FramebufferScale = pMainDrawData->FramebufferScale;
+            m_mergedDrawData.OwnerViewport    = pMainDrawData->OwnerViewport;
+            SetDrawDataCmdLists(&m_mergedDrawData, m_mergedLists);
+            return &m_mergedDrawData;
         }
 
-        ~CustomLayout()
+    private:
+        CustomParallelLeafBuilder(const CustomParallelLeafBuilder&) = delete;
+        CustomParallelLeafBuilder& operator=(const CustomParallelLeafBuilder&) = delete;
+
+        struct LeafState
         {
-            if (m_pRoot)
+            CustomParallelLeafBuilder* pBuilder;
+            CustomLayoutNode*          pNode;
+            ImGuiContext*              pContext;
+            ImFontAtlas*               pFontAtlas; // pContext's, holding the fonts of the main context's atlas.
+            ImDrawData*                pDrawData;  // Owned by pContext. Valid until the leaf's next frame.
+            bool                       used;
+
+            // Routed input of the current frame.
+            ImVec2 mousePos;
+            bool   mouseDown[5];
+            ImVec2 mouseWheel;
+            bool   hasKeyboard;
+            bool   hadKeyboard;
+        };
+
+        // Creates contexts for new leaves and destroys the contexts of leaves that left the tree.
+        void SyncLeafStates()
+        {
+            for (std::unique_ptr<LeafState>& pLeaf : m_leafStates)
             {
-                delete m_pRoot;
+                pLeaf->used = false;
             }
-        }
 
-        CustomLayoutNode* m_pRoot;
+            ImFontAtlas* pMainFontAtlas = ImGui::GetIO().Fonts;
+            m_frameLeaves.resize(0);
+            for (int i = 0; i < m_leaves.Size; i++)
+            {
+                LeafState* pLeaf = FindLeafState(m_leaves[i]);
+                if (pLeaf == nullptr)
+                {
+                    pLeaf = CreateLeafState(m_leaves[i]);
+                }
+                SyncFontAtlas(pLeaf->pFontAtlas, pMainFontAtlas);
+                pLeaf->used = true;
+                m_frameLeaves.push_back(pLeaf);
+            }
 
-        bool  m_splitterHeld;
-        float m_splitterBottonDownDelta;
-        
-        int   m_heldMouseCursor; // ImGuiMouseCursor_ Enum.
-        
+            for (size_t i = 0; i < m_leafStates.size();)
+            {
+                if (m_leafStates[i]->used == false)
+                {
+                    LeafState* pLeaf = m_leafStates[i].get();
+                    m_pMouseOwner = (m_pMouseOwner == pLeaf) ? nullptr : m_pMouseOwner;
+                    m_pKeyboardOwner = (m_pKeyboardOwner == pLeaf) ? nullptr : m_pKeyboardOwner;
+                    m_leafIndex.SetVoidPtr(NodeKey(pLeaf->pNode), nullptr);
+                    DestroyLeafContext(pLeaf);
+                    m_leafStates.erase(m_leafStates.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+
+        // Node IDs aren't reused like the addresses of recycled nodes, so a new leaf never inherits an old leaf's context.
+        static ImGuiID NodeKey(const CustomLayoutNode* pNode)
+        {
+            return pNode->GetId();
+        }
+
+        LeafState* FindLeafState(const CustomLayoutNode* pNode)
+        {
+            return (LeafState*)m_leafIndex.GetVoidPtr(NodeKey(pNode));
+        }
+
+        LeafState* CreateLeafState(CustomLayoutNode* pNode)
+        {
+            ImGuiIO& mainIO = ImGui::GetIO();
+            ImGuiStyle mainStyle = ImGui::GetStyle();
+
+            // NewFrame() and EndFrame() toggle ImFontAtlas::Locked of their context's atlas, so leaf contexts sharing
+            // the main atlas would write it from several threads. Each one gets an atlas of its own that only refers to
+            // the fonts of the main atlas, which the leaves just read.
+            ImFontAtlas* pFontAtlas = IM_NEW(ImFontAtlas)();
+            SyncFontAtlas(pFontAtlas, mainIO.Fonts);
+
+            ImGuiContext* pContext = ImGui::CreateContext(pFontAtlas);
+            {
+                CustomContextScope contextScope(pContext);
+                ImGuiIO& io = ImGui::GetIO();
+                io.IniFilename = nullptr;
+                io.FontDefault = mainIO.FontDefault;
+                io.ConfigFlags = mainIO.ConfigFlags;
+                io.BackendFlags = mainIO.BackendFlags;
+                ImGui::GetStyle() = mainStyle;
+            }
+
+            std::unique_ptr<LeafState> pLeaf(new LeafState());
+            pLeaf->pBuilder = this;
+            pLeaf->pNode = pNode;
+            pLeaf->pContext = pContext;
+            pLeaf->pFontAtlas = pFontAtlas;
+            pLeaf->pDrawData = nullptr;
+            pLeaf->hadKeyboard = false;
+
+            m_leafIndex.SetVoidPtr(NodeKey(pNode), pLeaf.get());
+            m_leafStates.push_back(std::move(pLeaf));
+            return m_leafStates.back().get();
+        }
+
+        // Main thread, while no job runs. Picks up fonts added to the main atlas since the last frame.
+        static void SyncFontAtlas(
+            ImFontAtlas*       pLeafAtlas,
+            const ImFontAtlas* pMainAtlas)
+        {
+            pLeafAtlas->Fonts = pMainAtlas->Fonts;
+            pLeafAtlas->TexReady = pMainAtlas->TexReady;
+            pLeafAtlas->TexID = pMainAtlas->TexID;
+        }
+
+        static void DestroyLeafContext(LeafState* pLeaf)
+        {
+            ImGui::DestroyContext(pLeaf->pContext);
+
+            // The fonts belong to the main atlas.
+            pLeaf->pFontAtlas->Fonts.clear();
+            IM_DELETE(pLeaf->pFontAtlas);
+        }
+
+        // Worker thread. Runs one full Dear ImGui frame of a leaf in the leaf's own context.
+        static void BuildLeafJob(void* pUserData)
+        {
+            LeafState* pLeaf = (LeafState*)pUserData;
+            const CustomParallelLeafBuilder* pBuilder = pLeaf->pBuilder;
+
+            CustomContextScope contextScope(pLeaf->pContext);
+
+            ImGuiIO& io = ImGui::GetIO();
+            io.DisplaySize = pBuilder->m_displaySize;
+            io.DeltaTime = pBuilder->m_deltaTime;
+
+            // The event queue drops events that don't change anything, so the full state is sent every frame.
+            io.AddMousePosEvent(pLeaf->mousePos.x, pLeaf->mousePos.y);
+            for (int button = 0; button < IM_ARRAYSIZE(pLeaf->mouseDown); button++)
+            {
+                io.AddMouseButtonEvent(button, pLeaf->mouseDown[button]);
+            }
+            if ((pLeaf->mouseWheel.x != 0.f) || (pLeaf->mouseWheel.y != 0.f))
+            {
+                io.AddMouseWheelEvent(pLeaf->mouseWheel.x, pLeaf->mouseWheel.y);
+            }
+
+            if (pLeaf->hasKeyboard)
+            {
+                for (int key = ImGuiKey_NamedKey_BEGIN; key < ImGuiKey_Aliases_BEGIN; key++)
+                {
+                    io.AddKeyEvent((ImGuiKey)key, pBuilder->m_keysDown[key - ImGuiKey_NamedKey_BEGIN]);
+                }
+                io.AddKeyEvent(ImGuiMod_Ctrl, (pBuilder->m_keyMods & ImGuiMod_Ctrl) != 0);
+                io.AddKeyEvent(ImGuiMod_Shift, (pBuilder->m_keyMods & ImGuiMod_Shift) != 0);
+                io.AddKeyEvent(ImGuiMod_Alt, (pBuilder->m_keyMods & ImGuiMod_Alt) != 0);
+                io.AddKeyEvent(ImGuiMod_Super, (pBuilder->m_keyMods & ImGuiMod_Super) != 0);
+                for (int i = 0; i < pBuilder->m_inputChars.Size; i++)
+                {
+                    io.AddInputCharacter(pBuilder->m_inputChars[i]);
+                }
+            }
+            else if (pLeaf->hadKeyboard)
+            {
+                io.ClearInputKeys();
+            }
+            pLeaf->hadKeyboard = pLeaf->hasKeyboard;
+
+            ImGui::NewFrame();
+            pLeaf->pNode->BeginEndNodeAndChildren();
+            ImGui::Render();
+            pLeaf->pDrawData = ImGui::GetDrawData();
+        }
+
+        JobSystem* m_pJobSystem;
+        JobCounter m_counter;
+
+        std::vector<std::unique_ptr<LeafState>> m_leafStates;
+        ImGuiStorage                            m_leafIndex;   // Node -> LeafState.
+        ImVector<CustomLayoutNode*>             m_leaves;      // Leaves of the current frame in layout order.
+        ImVector<LeafState*>                    m_frameLeaves; // Their states, in the same order.
+        ImVector<CustomLayoutNode*>             m_hostLeaves;  // Leaves hosting a sub-layout, built on the main thread.
+
+        LeafState* m_pMouseOwner;
+        LeafState* m_pKeyboardOwner;
+        bool       m_anyMouseDown;
+
+        // Main context state copied for the jobs of the current frame.
+        ImVec2            m_displaySize;
+        float             m_deltaTime;
+        bool              m_keysDown[ImGuiKey_Aliases_BEGIN - ImGuiKey_NamedKey_BEGIN];
+        int               m_keyMods;
+        ImVector<ImWchar> m_inputChars;
+
+        ImVector<ImDrawList*> m_mergedLists;
+        ImDrawData            m_mergedDrawData;
+    };
+#endif
+
+    enum CustomLayoutCommandType
+    {
+        CustomLayoutCommand_Split,    // Turns a leaf into a domain holding the leaf and a new window.
+        CustomLayoutCommand_Insert,   // Puts a new window next to a node, split like the node's parent domain.
+        CustomLayoutCommand_Remove,   // Removes a node. Its sibling takes the place of their parent.
+        CustomLayoutCommand_Merge,    // Removes the sibling of a node. The node takes the place of their parent.
+        CustomLayoutCommand_SetRatio  // Moves the splitter of a domain.
+    };
+
+    // A structural edit posted to CustomLayout from any thread.
+    struct CustomLayoutCommand
+    {
+        CustomLayoutCommandType type;
+        uint32_t                nodeId;
+        CustomWindowFunc        windowFunc;     // Split and Insert.
+        float                   ratio;          // Splitter ratio of the new or edited domain.
+        bool                    isLeftRight;    // Split: orientation of the new domain.
+        bool                    newWindowFirst; // Split and Insert: the new window goes left (top) of the node.
+    };
+
+    // We only need to build the splitter structure at first. We can auto-generate windows from the splitters.
+    class CustomLayout
+    {
+    public:
+        // Without a context, the layout uses the context that is current when it is drawn.
+        explicit CustomLayout(
+            CustomLayoutNode* root,
+            ImGuiContext*     pContext = nullptr)
+            : m_pRoot(root),
+              m_pHeldSplitterDomain(nullptr),
+              m_splitterHeld(false),
+              m_splitterBottonDownDelta(0.f),
+              m_lastViewport(ImVec2(0.f, 0.f)),
+              m_lastViewportPos(ImVec2(0.f, 0.f)),
+              m_heldMouseCursor(0),
+              m_pJobSystem(nullptr),
+              m_pParallelLeaves(nullptr),
+              m_stats(),
+              m_coroutineBudgetMs(2.0),
+              m_nextNodeId(0),
+              m_transactionDepth(0),
+              m_isPixelSnapping(false),
+              m_pHost(nullptr),
+              m_pContext(pContext)
+#ifdef CUSTOM_LAYOUT_COROUTINES
+              , m_nextCoroutine(0)
+#endif
+        {
+            assert((void("ERROR: The root node pointer cannot be NULL to init CustomLayout."), root != nullptr));
+            RegisterNodes(root);
+            root->UpdateSubtreeSizeLimits();
+        }
+        
+        // The context given to the constructor, or NULL.
+        ImGuiContext* GetContext() const { return m_pContext; }
+
+        // A sub-layout covers its host leaf instead of the main viewport.
+        void ResizeAll()
+        {
+            ImVec2 pos;
+            ImVec2 size;
+            if (m_pHost)
+            {
+                pos = m_pHost->GetDomainPos();
+                size = m_pHost->GetDomainSize();
+            }
+            else
+            {
+                CustomContextScope contextScope(m_pContext);
+                ImGuiViewport* pViewport = ImGui::GetMainViewport();
+                pos = pViewport->WorkPos;
+                size = pViewport->WorkSize;
+            }
+
+            // Dealing with viewport resize
+            if ((size.x != m_lastViewport.x) || (size.y != m_lastViewport.y) ||
+                (pos.x != m_lastViewportPos.x) || (pos.y != m_lastViewportPos.y))
+            {
+                m_pRoot->ResizeNodeAndChildren(pos, size);
+                m_lastViewport = size;
+                m_lastViewportPos = pos;
+                m_stats.viewportLayouts++;
+            }
+        }
+
+        // Update Dear ImGUI state. Sub-layouts are updated by their host leaf, and get the mouse from the outermost layout.
+        void BeginEndLayout()
+        {
+            assert((void("ERROR: A sub-layout is drawn by its host leaf."), m_pHost == nullptr));
+            CustomContextScope contextScope(m_pContext);
+            BeginFrame();
+            FindMouseLayout()->HandleMouse();
+            BeginEndLeaves();
+        }
+
+        // Builds every leaf window in the current frame without drawing it. The windows are created and sized, and reserve
+        // the capacity hints of their leaves, so the first frame that shows them doesn't stall. Call it between NewFrame()
+        // and Render() in place of BeginEndLayout(), e.g. in a loading frame, or for a layout that isn't shown.
+        void WarmUp()
+        {
+#ifdef CUSTOM_LAYOUT_PARALLEL_LEAVES
+            assert((void("ERROR: Parallel leaves build their windows in their own contexts, they can't be warmed up."),
+                    m_pParallelLeaves == nullptr));
+#endif
+            // New windows take the focus when they appear. The user keeps it.
+            CustomContextScope contextScope(m_pContext);
+            ImGuiContext& g = *GImGui;
+            ImGuiWindow* pFocused = g.NavWindow;
+
+            WarmUpLeaves();
+
+            if (g.NavWindow != pFocused)
+            {
+                ImGui::FocusWindow(pFocused);
+            }
+        }
+
+        // Writes the splitter ratios, hidden nodes and the draw list peaks of the leaves in depth-first order. Meant to
+        // be stored with the application's settings and loaded into the same tree in the next session. A leaf keeps the
+        // larger of its peak and its capacity hint, so the saved peaks don't shrink in a quiet session.
+        void SaveState(ImGuiTextBuffer& out)
+        {
+            m_nodes.resize(0);
+            m_pRoot->CollectNodes(m_nodes);
+            for (int i = 0; i < m_nodes.Size; i++)
+            {
+                const CustomLayoutNode* pNode = m_nodes[i];
+                if (pNode->IsLogicalDomain())
+                {
+                    out.appendf("Domain %d %.9g\n", i, pNode->m_splitterRatio);
+                }
+                else
+                {
+                    const CustomLeafCapacity& hint = pNode->GetCapacityHint();
+                    const CustomLeafCapacity& peak = pNode->GetCapacityPeak();
+                    out.appendf("Leaf %d %d %d %d\n", i,
+                                ImMax(hint.vtxCount, peak.vtxCount),
+                                ImMax(hint.idxCount, peak.idxCount),
+                                ImMax(hint.cmdCount, peak.cmdCount));
+                }
+                if (pNode->IsHidden())
+                {
+                    out.appendf("Hidden %d\n", i);
+                }
+            }
+        }
+
+        // Restores the ratios and gives the saved peaks to the leaves as capacity hints, so their windows reserve them as
+        // soon as they exist. Call it before the first frame, or before WarmUp(). Lines that don't match the kind of their
+        // node are skipped. Returns false if any line was skipped.
+        bool LoadState(const char* pText)
+        {
+            m_nodes.resize(0);
+            m_pRoot->CollectNodes(m_nodes);
+
+            // Only the nodes listed as hidden stay hidden. The root comes first and is never hidden.
+            for (int i = 1; i < m_nodes.Size; i++)
+            {
+                SetNodeHidden(m_nodes[i], false);
+            }
+
+            bool matched = true;
+            for (const char* pLine = pText; pLine && (*pLine != '\0');)
+            {
+                int index = -1;
+                float ratio = 0.f;
+                CustomLeafCapacity capacity = {};
+                if (sscanf(pLine, "Domain %d %f", &index, &ratio) == 2)
+                {
+                    if ((index >= 0) && (index < m_nodes.Size) && m_nodes[index]->IsLogicalDomain())
+                    {
+                        m_nodes[index]->SetSplitterRatio(ImClamp(ratio, 0.f, 1.f));
+                    }
+                    else
+                    {
+                        matched = false;
+                    }
+                }
+                else if (sscanf(pLine, "Leaf %d %d %d %d", &index, &capacity.vtxCount, &capacity.idxCount, &capacity.cmdCount) == 4)
+                {
+                    if ((index >= 0) && (index < m_nodes.Size) && (m_nodes[index]->IsLogicalDomain() == false))
+                    {
+                        m_nodes[index]->SetCapacityHint(capacity);
+                    }
+                    else
+                    {
+                        matched = false;
+                    }
+                }
+                else if (sscanf(pLine, "Hidden %d", &index) == 1)
+                {
+                    if ((index > 0) && (index < m_nodes.Size))
+                    {
+                        SetNodeHidden(m_nodes[index], true);
+                    }
+                    else
+                    {
+                        matched = false;
+                    }
+                }
+
+                pLine = strchr(pLine, '\n');
+                pLine = pLine ? pLine + 1 : nullptr;
+            }
+
+            // The next frame lays out the whole tree with the loaded ratios.
+            m_lastViewport = ImVec2(0.f, 0.f);
+            return matched;
+        }
+
+        // Hash of the splitter ratios, node rects and hidden nodes in depth-first order, sub-layouts included. Two runs
+        // of the same tree with the same hash after a frame are laid out the same, e.g. a replayed input trace.
+        ImGuiID GetStateHash()
+        {
+            m_nodes.resize(0);
+            m_pRoot->CollectNodes(m_nodes);
+
+            ImGuiID hash = 0;
+            for (int i = 0; i < m_nodes.Size; i++)
+            {
+                const CustomLayoutNode* pNode = m_nodes[i];
+                const float values[5] = { pNode->m_splitterRatio,
+                                          pNode->m_domainPos.x, pNode->m_domainPos.y,
+                                          pNode->m_domainSize.x, pNode->m_domainSize.y };
+                const unsigned char isHidden = pNode->m_isHidden ? 1 : 0;
+                hash = ImHashData(values, sizeof(values), hash);
+                hash = ImHashData(&isHidden, sizeof(isHidden), hash);
+                if (pNode->m_pSubLayout)
+                {
+                    const ImGuiID subHash = pNode->m_pSubLayout->GetStateHash();
+                    hash = ImHashData(&subHash, sizeof(subHash), hash);
+                }
+            }
+            return hash;
+        }
+
+        // Structural edits on the UI thread, outside of BeginEndLayout(). Only the edited subtree is laid out again. Removed
+        // nodes go to a free list and are recycled by later edits, so steady editing doesn't allocate. Leaves keep their
+        // node and ID through every edit.
+
+        // Turns a leaf into a domain holding the leaf and a new window. Returns the new window's node.
+        CustomLayoutNode* SplitLeaf(
+            CustomLayoutNode* pLeaf,
+            CustomWindowFunc  windowFunc,
+            float             ratio,
+            bool              isLeftRight,
+            bool              newWindowFirst = false)
+        {
+            assert((void("ERROR: Only window nodes can be split."), pLeaf->IsLogicalDomain() == false));
+            // The new domain's level only has to have the parity of the requested orientation.
+            uint32_t level = ((pLeaf->m_level % 2 == 1) == isLeftRight) ? pLeaf->m_level : pLeaf->m_level + 1;
+            return WrapNode(pLeaf, level, windowFunc, ratio, newWindowFirst);
+        }
+
+        // Puts a new window next to a node, split like the node's parent domain. Returns the new window's node.
+        CustomLayoutNode* InsertWindow(
+            CustomLayoutNode* pNode,
+            CustomWindowFunc  windowFunc,
+            float             ratio,
+            bool              newWindowFirst = false)
+        {
+            uint32_t level = pNode->m_pParent ? pNode->m_pParent->m_level : pNode->m_level;
+            return WrapNode(pNode, level, windowFunc, ratio, newWindowFirst);
+        }
+
+        // Removes a node and its subtree. Its sibling takes the place of their parent. The root cannot be removed.
+        void RemoveNode(CustomLayoutNode* pNode)
+        {
+            assert((void("ERROR: The root node cannot be removed."), pNode != m_pRoot));
+            RemoveChild(pNode->m_pParent, pNode);
+        }
+
+        // Removes the sibling of a node. The node takes the place of their parent domain.
+        void MergeWithSibling(CustomLayoutNode* pNode)
+        {
+            assert((void("ERROR: The root node has no sibling."), pNode != m_pRoot));
+            CustomLayoutNode* pParent = pNode->m_pParent;
+            RemoveChild(pParent, (pParent->m_pLeft == pNode) ? pParent->m_pRight : pParent->m_pLeft);
+        }
+
+        void SetSplitterRatio(
+            CustomLayoutNode* pDomain,
+            float             ratio)
+        {
+            assert((void("ERROR: Only logical domains have a splitter."), pDomain->IsLogicalDomain()));
+            pDomain->SetSplitterRatio(ImClamp(ratio, 0.f, 1.f));
+            Relayout(pDomain);
+        }
+
+        // Ratio and visibility changes between the two calls are laid out together at the end: every subtree that
+        // changed is laid out once, and a subtree under another changed one isn't laid out on its own. Transactions nest,
+        // the outermost one lays out.
+        void BeginTransaction()
+        {
+            m_transactionDepth++;
+        }
+
+        void EndTransaction()
+        {
+            assert((void("ERROR: EndTransaction() without BeginTransaction()."), m_transactionDepth > 0));
+            if (--m_transactionDepth > 0)
+            {
+                return;
+            }
+
+            for (int i = 0; i < m_pendingLayouts.Size; i++)
+            {
+                CustomLayoutNode* pNode = m_pendingLayouts[i];
+                bool coveredByAncestor = false;
+                for (CustomLayoutNode* pParent = pNode->m_pParent; pParent; pParent = pParent->m_pParent)
+                {
+                    if (pParent->m_needsLayout)
+                    {
+                        coveredByAncestor = true;
+                        break;
+                    }
+                }
+                if (coveredByAncestor == false)
+                {
+                    pNode->LayoutNodeAndChildren(pNode->GetDomainPos(), pNode->GetDomainSize());
+                }
+            }
+
+            // Flags are cleared only now, the ancestor test above needs all of them.
+            for (int i = 0; i < m_pendingLayouts.Size; i++)
+            {
+                m_pendingLayouts[i]->m_needsLayout = false;
+            }
+            m_pendingLayouts.resize(0);
+        }
+
+        // Names are unique in a layout. Passing NULL or an empty name removes the node's name.
+        void SetNodeName(
+            CustomLayoutNode* pNode,
+            const char*       pName)
+        {
+            if (pNode->m_nameId != 0)
+            {
+                EraseStorageKey(m_nameIndex, pNode->m_nameId);
+            }
+            pNode->SetName(pName);
+            if (pNode->m_nameId != 0)
+            {
+                assert((void("ERROR: Another node of the layout already has this name."),
+                        m_nameIndex.GetVoidPtr(pNode->m_nameId) == nullptr));
+                m_nameIndex.SetVoidPtr(pNode->m_nameId, pNode);
+            }
+            pNode->MarkDirty();
+        }
+
+        // NULL for a NULL or empty name, which no node has.
+        CustomLayoutNode* FindNodeByName(const char* pName) const
+        {
+            if ((pName == nullptr) || (pName[0] == 0))
+            {
+                return nullptr;
+            }
+            return (CustomLayoutNode*)m_nameIndex.GetVoidPtr(ImHashStr(pName));
+        }
+
+        // Indexes the names of all nodes again, e.g. after naming the nodes of the tree directly.
+        void RebuildNameIndex()
+        {
+            m_nodes.resize(0);
+            m_pRoot->CollectNodes(m_nodes);
+            m_nameIndex.Data.resize(0);
+            for (int i = 0; i < m_nodes.Size; i++)
+            {
+                if (m_nodes[i]->m_nameId != 0)
+                {
+                    m_nameIndex.Data.push_back(ImGuiStorage::ImGuiStoragePair(m_nodes[i]->m_nameId, (void*)m_nodes[i]));
+                }
+            }
+            m_nameIndex.BuildSortByKey();
+        }
+
+        // Fixed size: the same size for both. Only the subtrees whose limits changed are laid out again.
+        void SetNodeSizeConstraints(
+            CustomLayoutNode* pNode,
+            ImVec2            minSize,
+            ImVec2            maxSize = ImVec2(FLT_MAX, FLT_MAX))
+        {
+            pNode->SetSizeConstraints(minSize, maxSize);
+            pNode->MarkDirty();
+            Relayout(pNode);
+        }
+
+        // A hidden node gives its space to its sibling. Only the parent's subtree is laid out again, unless the size limits
+        // of the domains above change.
+        void SetNodeVisible(
+            CustomLayoutNode* pNode,
+            bool              isVisible)
+        {
+            assert((void("ERROR: The root node cannot be hidden."), pNode != m_pRoot));
+            if (SetNodeHidden(pNode, isVisible == false))
+            {
+                Relayout(pNode->m_pParent);
+            }
+        }
+
+        // nullptr if the node has been removed.
+        CustomLayoutNode* FindNode(uint32_t nodeId) const
+        {
+            return (CustomLayoutNode*)m_nodeIndex.GetVoidPtr(nodeId);
+        }
+
+        // The same edits from any thread. Nodes are referenced by ID. The commands are applied together at the start of
+        // the next BeginEndLayout(). A command whose node has been removed in the meantime is dropped.
+        void PostSplit(
+            uint32_t         leafId,
+            CustomWindowFunc windowFunc,
+            float            ratio,
+            bool             isLeftRight,
+            bool             newWindowFirst = false)
+        {
+            m_commands.Push(CustomLayoutCommand{ CustomLayoutCommand_Split, leafId, windowFunc, ratio, isLeftRight, newWindowFirst });
+        }
+
+        void PostInsert(
+            uint32_t         nodeId,
+            CustomWindowFunc windowFunc,
+            float            ratio,
+            bool             newWindowFirst = false)
+        {
+            m_commands.Push(CustomLayoutCommand{ CustomLayoutCommand_Insert, nodeId, windowFunc, ratio, false, newWindowFirst });
+        }
+
+        void PostRemove(uint32_t nodeId)
+        {
+            m_commands.Push(CustomLayoutCommand{ CustomLayoutCommand_Remove, nodeId, nullptr, 0.f, false, false });
+        }
+
+        void PostMerge(uint32_t nodeId)
+        {
+            m_commands.Push(CustomLayoutCommand{ CustomLayoutCommand_Merge, nodeId, nullptr, 0.f, false, false });
+        }
+
+        void PostSetRatio(
+            uint32_t domainId,
+            float    ratio)
+        {
+            m_commands.Push(CustomLayoutCommand{ CustomLayoutCommand_SetRatio, domainId, nullptr, ratio, false, false });
+        }
+
+        // Whole pixel rects: every domain edge and splitter lands on an integer coordinate, with the splitters keeping their
+        // full width. The same viewport and ratios always give the same rects, bit for bit, so they can key caches of
+        // retained rendering. The next frame lays out the whole tree again.
+        void SetPixelSnapping(bool isPixelSnapping)
+        {
+            m_isPixelSnapping = isPixelSnapping;
+            for (int i = 0; i < m_nodeIndex.Data.Size; i++)
+            {
+                ((CustomLayoutNode*)m_nodeIndex.Data[i].val_p)->m_isPixelSnapped = isPixelSnapping;
+            }
+            m_lastViewport = ImVec2(0.f, 0.f);
+        }
+
+        bool IsPixelSnapping() const { return m_isPixelSnapping; }
+
+        // Jobs of the layout, e.g. the Prepare stage of two-phase leaves, run on this job system. Without one, they run on
+        // the UI thread. The layout doesn't own the job system.
+        void SetJobSystem(JobSystem* pJobSystem)
+        {
+            if (m_pJobSystem)
+            {
+                m_pJobSystem->Wait(&m_prepareCounter);
+            }
+            m_pJobSystem = pJobSystem;
+        }
+
+        // Prepare latencies are gathered from the leaves on each call.
+        const CustomLayoutStats& GetStats()
+        {
+            m_leaves.resize(0);
+            m_pRoot->CollectLeaves(m_leaves);
+            m_stats.leafPrepares.resize(0);
+            for (int i = 0; i < m_leaves.Size; i++)
+            {
+                if (CustomLeafPrepareStage* pStage = m_leaves[i]->GetPrepareStage())
+                {
+                    m_stats.leafPrepares.push_back(pStage->GetStats());
+                    m_stats.leafPrepares.back().pNode = m_leaves[i];
+                }
+            }
+            return m_stats;
+        }
+
+        // Time all coroutine leaves may run per frame together. At least one coroutine is resumed every frame.
+        void SetCoroutineBudget(double budgetMs) { m_coroutineBudgetMs = budgetMs; }
+
+#ifdef CUSTOM_LAYOUT_COROUTINES
+        // Takes over the coroutine of a leaf. It is resumed at the start of every BeginEndLayout() until it returns.
+        void StartCoroutine(
+            CustomLayoutNode* pLeaf,
+            CustomLeafTask    task)
+        {
+            assert((void("ERROR: The leaf of a coroutine cannot be NULL."), pLeaf != nullptr));
+            std::coroutine_handle<CustomLeafTask::promise_type> handle = std::exchange(task.m_handle, nullptr);
+            handle.promise().pDeadline = &m_coroutineDeadline;
+            m_coroutines.push_back(LeafCoroutine{ pLeaf, handle });
+        }
+
+        bool IsCoroutineRunning(const CustomLayoutNode* pLeaf) const
+        {
+            for (int i = 0; i < m_coroutines.Size; i++)
+            {
+                if (m_coroutines[i].pLeaf == pLeaf)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+#endif
+
+#ifdef CUSTOM_LAYOUT_PARALLEL_LEAVES
+        // Opt-in: build every leaf on the job system set by SetJobSystem() in its own Dear ImGui context.
+        void EnableParallelLeaves()
+        {
+            assert((void("ERROR: Parallel leaves need a job system. Call SetJobSystem() first."), m_pJobSystem != nullptr));
+            DisableParallelLeaves();
+            m_pParallelLeaves = new CustomParallelLeafBuilder(m_pJobSystem);
+        }
+
+        void DisableParallelLeaves()
+        {
+            if (m_pParallelLeaves)
+            {
+                delete m_pParallelLeaves;
+                m_pParallelLeaves = nullptr;
+            }
+        }
+#endif
+
+        // Call with the main context's draw data after ImGui::Render() and render the returned draw data instead.
+        // It is the same draw data unless parallel leaves are enabled. Then the leaves' draw lists are added in front of
+        // the main context's ones in layout order.
+        ImDrawData* MergeDrawData(ImDrawData* pMainDrawData)
+        {
+#ifdef CUSTOM_LAYOUT_PARALLEL_LEAVES
+            if (m_pParallelLeaves)
+            {
+                return m_pParallelLeaves->Merge(pMainDrawData);
+            }
+#endif
+            return pMainDrawData;
+        }
+
+        ~CustomLayout()
+        {
+#ifdef CUSTOM_LAYOUT_PARALLEL_LEAVES
+            DisableParallelLeaves();
+#endif
+            if (m_pJobSystem)
+            {
+                m_pJobSystem->Wait(&m_prepareCounter);
+            }
+#ifdef CUSTOM_LAYOUT_COROUTINES
+            for (int i = 0; i < m_coroutines.Size; i++)
+            {
+                m_coroutines[i].handle.destroy();
+            }
+#endif
+            if (m_pHost)
+            {
+                m_pHost->SetSubLayout(nullptr);
+            }
+            if (m_pRoot)
+            {
+                delete m_pRoot;
+            }
+            for (int i = 0; i < m_freeNodes.Size; i++)
+            {
+                delete m_freeNodes[i];
+            }
+        }
+
+        CustomLayoutNode* m_pRoot;
+
+        bool  m_splitterHeld;
+        float m_splitterBottonDownDelta;
+        
+        int   m_heldMouseCursor; // ImGuiMouseCursor_ Enum.
+        
         CustomLayoutNode* m_pHeldSplitterDomain;
 
-        ImVec2 m_lastViewport;
+        ImVec2 m_lastViewport;
+        ImVec2 m_lastViewportPos;
+
+        JobSystem*                 m_pJobSystem;
+        JobCounter                 m_prepareCounter;
+        CustomParallelLeafBuilder* m_pParallelLeaves; // Only used with CUSTOM_LAYOUT_PARALLEL_LEAVES.
+
+        ImVector<CustomLayoutNode*> m_leaves; // Leaves of the current frame in layout order.
+        ImVector<CustomLayoutNode*> m_nodes;  // All nodes in depth-first order, for saving and loading the state.
+        CustomLayoutStats           m_stats;
+
+        double m_coroutineBudgetMs;
+
+        MpscQueue<CustomLayoutCommand> m_commands;
+
+        uint32_t                    m_nextNodeId;
+        ImGuiStorage                m_nodeIndex; // Node ID to node.
+        ImGuiStorage                m_nameIndex; // Name hash to node.
+
+        int                         m_transactionDepth;
+        ImVector<CustomLayoutNode*> m_pendingLayouts; // Subtrees to lay out at the end of the transaction.
+        ImVector<CustomLayoutNode*> m_freeNodes;
+
+        bool m_isPixelSnapping;
+
+        CustomLayoutNode*           m_pHost;          // Leaf showing this layout. NULL for a layout of the main viewport.
+        ImVector<CustomLayoutNode*> m_subLayoutHosts; // Shown leaves hosting a layout, gathered at the start of each frame.
+
+        ImGuiContext* m_pContext; // NULL for the current context.
+
+    private:
+        friend class CustomLayoutHistory;
+        friend class CustomLayoutNode;
+
+        // Builds the leaves in layout order and hides their windows until the first frame. A host leaf warms its sub-layout
+        // up the same way, unless it is collapsed. No frame is started, so no command is applied and no job is scheduled.
+        void WarmUpLeaves()
+        {
+            ResizeAll();
+            m_leaves.resize(0);
+            m_pRoot->CollectLeaves(m_leaves);
+            for (int i = 0; i < m_leaves.Size; i++)
+            {
+                if (CustomLayout* pSubLayout = m_leaves[i]->GetSubLayout())
+                {
+                    ImVec2 hostSize = m_leaves[i]->GetDomainSize();
+                    if ((hostSize.x > 0.f) && (hostSize.y > 0.f))
+                    {
+                        pSubLayout->WarmUpLeaves();
+                    }
+                    continue;
+                }
+
+                m_leaves[i]->BeginEndNodeAndChildren();
+                if (ImGuiWindow* pWindow = m_leaves[i]->GetWindow())
+                {
+                    pWindow->Hidden = true;
+                }
+                if (CustomLeafTabs* pTabs = m_leaves[i]->GetTabs())
+                {
+                    if (ImGuiWindow* pStripWindow = pTabs->GetStripWindow())
+                    {
+                        pStripWindow->Hidden = true;
+                    }
+                }
+            }
+        }
+
+        void BeginFrame()
+        {
+            m_stats.frameCount++;
+            ApplyCommands();
+            ScheduleLeafWork();
+#ifdef CUSTOM_LAYOUT_COROUTINES
+            ResumeCoroutines();
+#endif
+
+            ResizeAll();
+        }
+
+        // The host leaf's part of a frame, on the main thread. The leaves are always built in place, without parallel
+        // leaves.
+        void BeginEndHosted()
+        {
+            assert((void("ERROR: A sub-layout is drawn in the context of its host."),
+                    (m_pContext == nullptr) || (m_pContext == ImGui::GetCurrentContext())));
+            BeginFrame();
+            m_pRoot->BeginEndNodeAndChildren();
+        }
+
+        // Only one layout of a nest handles the mouse in a frame. The one holding a splitter keeps it until the button is
+        // released. Otherwise it goes to the innermost layout under the mouse, unless a splitter of an outer one is hovered.
+        CustomLayout* FindMouseLayout()
+        {
+            CustomLayout* pLayout = FindHeldLayout();
+            return pLayout ? pLayout : FindHoveredLayout();
+        }
+
+        void HandleMouse()
+        {
+            // Dealing with the mouse interactions.
+            if (m_splitterHeld == false)
+            {
+                CustomLayoutNode* pSplitterDomain = m_pRoot->GetHoverSplitter();
+                if (pSplitterDomain)
+                {
+                    // If the mouse cursor hovers on a splitter, then we need to change the appearance of the cursor and
+                    // check whether there is a click event in the event queue. If there is a click event, then the
+                    // splitter is occupied by the mouse.
+                    bool isLeftRightSplitter = (pSplitterDomain->GetLevel() % 2 == 1);
+
+                    isLeftRightSplitter ? ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeEW) :
+                                          ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeNS);
+
+
+                    if (ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+                    {
+                        m_splitterHeld = true;
+
+                        ImVec2 splitterPos = pSplitterDomain->GetSplitterPos();
+                        ImVec2 mousePos = ImGui::GetMousePos();
+                        m_splitterBottonDownDelta = isLeftRightSplitter ? splitterPos.x - mousePos.x :
+                            splitterPos.y - mousePos.y;
+
+                        m_pHeldSplitterDomain = pSplitterDomain;
+                    }
+                }
+            }
+            else
+            {
+                if (ImGui::IsMouseDown(ImGuiMouseButton_Left))
+                {
+                    bool isLeftRightSplitter = (m_pHeldSplitterDomain->GetLevel() % 2 == 1);
+                    ImVec2 domainPos = m_pHeldSplitterDomain->GetDomainPos();
+                    ImVec2 domainSize = m_pHeldSplitterDomain->GetDomainSize();
+                    ImVec2 mousePos = ImGui::GetMousePos();
+                    float newSplitterRatio = -1.f;
+
+                    if (isLeftRightSplitter)
+                    {
+                        ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeEW);
+                        float newSplitterCoord = m_splitterBottonDownDelta + mousePos.x;
+                        float newSplitterAxisLen = newSplitterCoord - domainPos.x;
+                        newSplitterRatio = newSplitterAxisLen / domainSize.x;
+                    }
+                    else
+                    {
+                        ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeNS);
+                        float newSplitterCoord = m_splitterBottonDownDelta + mousePos.y;
+                        float newSplitterAxisLen = newSplitterCoord - domainPos.y;
+                        newSplitterRatio = newSplitterAxisLen / domainSize.y;
+                    }
+
+                    m_pHeldSplitterDomain->SetSplitterRatio(newSplitterRatio);
+                    m_pHeldSplitterDomain->LayoutNodeAndChildren(domainPos, domainSize);
+                }
+                else
+                {
+                    m_splitterHeld = false;
+                }
+            }
+        }
+
+        void BeginEndLeaves()
+        {
+            // Putting windows data into Dear ImGui's state.
+            if (m_pRoot != nullptr)
+            {
+#ifdef CUSTOM_LAYOUT_PARALLEL_LEAVES
+                if (m_pParallelLeaves)
+                {
+                    m_pParallelLeaves->Dispatch(m_pRoot);
+                    return;
+                }
+#endif
+                m_pRoot->BeginEndNodeAndChildren();
+            }
+        }
+
+        // The sub-layouts' hosts are those of their last frame.
+        CustomLayout* FindHeldLayout()
+        {
+            if (m_splitterHeld)
+            {
+                return this;
+            }
+            for (int i = 0; i < m_subLayoutHosts.Size; i++)
+            {
+                CustomLayout* pSubLayout = m_subLayoutHosts[i]->m_pSubLayout;
+                CustomLayout* pHeld = pSubLayout ? pSubLayout->FindHeldLayout() : nullptr;
+                if (pHeld)
+                {
+                    return pHeld;
+                }
+            }
+            return nullptr;
+        }
+
+        CustomLayout* FindHoveredLayout()
+        {
+            if (m_pRoot->GetHoverSplitter())
+            {
+                return this;
+            }
+            for (int i = 0; i < m_subLayoutHosts.Size; i++)
+            {
+                CustomLayoutNode* pHost = m_subLayoutHosts[i];
+                ImVec2 hostMax(pHost->m_domainPos.x + pHost->m_domainSize.x, pHost->m_domainPos.y + pHost->m_domainSize.y);
+                if (pHost->m_pSubLayout && ImGui::IsMouseHoveringRect(pHost->m_domainPos, hostMax, false))
+                {
+                    return pHost->m_pSubLayout->FindHoveredLayout();
+                }
+            }
+            return this;
+        }
+
+        void ApplyCommands()
+        {
+            BeginTransaction();
+            CustomLayoutCommand command;
+            while (m_commands.Pop(command))
+            {
+                if (ApplyCommand(command))
+                {
+                    m_stats.appliedCommands++;
+                }
+                else
+                {
+                    m_stats.droppedCommands++;
+                }
+            }
+            EndTransaction();
+        }
+
+        bool ApplyCommand(const CustomLayoutCommand& command)
+        {
+            CustomLayoutNode* pNode = FindNode(command.nodeId);
+            if (pNode == nullptr)
+            {
+                return false;
+            }
+
+            switch (command.type)
+            {
+            case CustomLayoutCommand_Split:
+                if (pNode->IsLogicalDomain())
+                {
+                    return false;
+                }
+                SplitLeaf(pNode, command.windowFunc, command.ratio, command.isLeftRight, command.newWindowFirst);
+                return true;
+            case CustomLayoutCommand_Insert:
+                InsertWindow(pNode, command.windowFunc, command.ratio, command.newWindowFirst);
+                return true;
+            case CustomLayoutCommand_Remove:
+            case CustomLayoutCommand_Merge:
+                if (pNode == m_pRoot)
+                {
+                    return false;
+                }
+                if (command.type == CustomLayoutCommand_Remove)
+                {
+                    RemoveNode(pNode);
+                }
+                else
+                {
+                    MergeWithSibling(pNode);
+                }
+                return true;
+            case CustomLayoutCommand_SetRatio:
+                if (pNode->IsLogicalDomain() == false)
+                {
+                    return false;
+                }
+                SetSplitterRatio(pNode, command.ratio);
+                return true;
+            }
+            return false;
+        }
+
+        // Lays out the subtree now, or at the end of the transaction. New size limits of the subtree are passed up as long
+        // as they change, and a domain above is laid out as well when they move its splitter.
+        void Relayout(CustomLayoutNode* pNode)
+        {
+            bool limitsChanged = pNode->UpdateSubtreeSizeLimits();
+            for (CustomLayoutNode* pParent = pNode->m_pParent; limitsChanged && pParent; pParent = pParent->m_pParent)
+            {
+                if (pParent->IsSplitUpToDate() == false)
+                {
+                    pNode = pParent;
+                }
+                limitsChanged = pParent->UpdateSizeLimits();
+            }
+
+            if (m_transactionDepth == 0)
+            {
+                pNode->LayoutNodeAndChildren(pNode->GetDomainPos(), pNode->GetDomainSize());
+            }
+            else if (pNode->m_needsLayout == false)
+            {
+                pNode->m_needsLayout = true;
+                m_pendingLayouts.push_back(pNode);
+            }
+        }
+
+        void WaitForPrepareJobs()
+        {
+            if (m_pJobSystem)
+            {
+                m_pJobSystem->Wait(&m_prepareCounter);
+            }
+        }
+
+        // Takes a node from the free list if there is one.
+        // A node ID can be passed to bring back a node removed earlier, e.g. by the layout history.
+        CustomLayoutNode* NewNode(
+            bool             isLogicalDomain,
+            float            splitterRatio,
+            CustomWindowFunc windowFunc,
+            uint32_t         nodeId = 0)
+        {
+            CustomLayoutNode* pNode = nullptr;
+            if (m_freeNodes.Size > 0)
+            {
+                pNode = m_freeNodes.back();
+                m_freeNodes.pop_back();
+                pNode->Recycle(isLogicalDomain, splitterRatio, windowFunc);
+                m_stats.nodesRecycled++;
+            }
+            else
+            {
+                pNode = isLogicalDomain ? new CustomLayoutNode(splitterRatio) : new CustomLayoutNode(windowFunc);
+                m_stats.nodesCreated++;
+            }
+            pNode->m_id = (nodeId != 0) ? nodeId : ++m_nextNodeId;
+            pNode->m_isPixelSnapped = m_isPixelSnapping;
+            m_nodeIndex.SetVoidPtr(pNode->m_id, pNode);
+            return pNode;
+        }
+
+        void RegisterNodes(CustomLayoutNode* pNode)
+        {
+            pNode->m_id = ++m_nextNodeId;
+            m_nodeIndex.SetVoidPtr(pNode->m_id, pNode);
+            if (pNode->m_nameId != 0)
+            {
+                m_nameIndex.SetVoidPtr(pNode->m_nameId, pNode);
+            }
+            if (pNode->m_pLeft)
+            {
+                RegisterNodes(pNode->m_pLeft);
+            }
+            if (pNode->m_pRight)
+            {
+                RegisterNodes(pNode->m_pRight);
+            }
+        }
+
+        // Moves a detached subtree to the free list. Running prepare jobs must have been waited for.
+        void FreeNodes(CustomLayoutNode* pNode)
+        {
+            if (pNode->m_pLeft)
+            {
+                FreeNodes(pNode->m_pLeft);
+            }
+            if (pNode->m_pRight)
+            {
+                FreeNodes(pNode->m_pRight);
+            }
+            ReleaseNode(pNode);
+        }
+
+        // Moves a single detached node to the free list and drops what the layout keeps about it.
+        void ReleaseNode(CustomLayoutNode* pNode)
+        {
+            if (m_pHeldSplitterDomain == pNode)
+            {
+                m_pHeldSplitterDomain = nullptr;
+                m_splitterHeld = false;
+            }
+
+#ifdef CUSTOM_LAYOUT_COROUTINES
+            for (int i = 0; i < m_coroutines.Size;)
+            {
+                if (m_coroutines[i].pLeaf == pNode)
+                {
+                    m_coroutines[i].handle.destroy();
+                    m_coroutines.erase(m_coroutines.Data + i);
+                    m_nextCoroutine = 0;
+                }
+                else
+                {
+                    i++;
+                }
+            }
+#endif
+
+            EraseStorageKey(m_nodeIndex, pNode->m_id);
+            if (pNode->m_needsLayout)
+            {
+                m_pendingLayouts.find_erase_unsorted(pNode);
+            }
+            if ((pNode->m_nameId != 0) && (m_nameIndex.GetVoidPtr(pNode->m_nameId) == pNode))
+            {
+                EraseStorageKey(m_nameIndex, pNode->m_nameId);
+            }
+            pNode->Recycle(false, 0.f, nullptr);
+            m_freeNodes.push_back(pNode);
+        }
+
+        // Puts a new domain in the place of the node and gives it the node and a new window as children. Returns the
+        // new window's node.
+        CustomLayoutNode* WrapNode(
+            CustomLayoutNode* pNode,
+            uint32_t          level,
+            CustomWindowFunc  windowFunc,
+            float             ratio,
+            bool              newWindowFirst)
+        {
+            CustomLayoutNode* pParent = pNode->m_pParent;
+            CustomLayoutNode* pDomain = NewNode(true, ImClamp(ratio, 0.f, 1.f), nullptr);
+            pDomain->m_level = level;
+            if (pParent)
+            {
+                pParent->ReplaceChild(pNode, pDomain);
+            }
+            else
+            {
+                m_pRoot = pDomain;
+            }
+
+            CustomLayoutNode* pWindow = NewNode(false, 0.f, windowFunc);
+            pDomain->m_pLeft = newWindowFirst ? pWindow : pNode;
+            pDomain->m_pRight = newWindowFirst ? pNode : pWindow;
+            pNode->m_pParent = pDomain;
+            pWindow->m_pParent = pDomain;
+            pWindow->m_level = level + 1;
+
+            // The domain takes over the place of the node, and the limits its parent knew for that place. The change of
+            // limits is measured against them.
+            pDomain->SetDomainPos(pNode->GetDomainPos());
+            pDomain->SetDomainSize(pNode->GetDomainSize());
+            pDomain->m_limitMin = pNode->m_limitMin;
+            pDomain->m_limitMax = pNode->m_limitMax;
+            Relayout(pDomain);
+            return pWindow;
+        }
+
+        // Changes the hidden flag without laying out. A splitter held inside the node is released. Returns false if the
+        // flag didn't change.
+        bool SetNodeHidden(
+            CustomLayoutNode* pNode,
+            bool              isHidden)
+        {
+            if (pNode->m_isHidden == isHidden)
+            {
+                return false;
+            }
+
+            pNode->m_isHidden = isHidden;
+            pNode->MarkDirty();
+            if (m_pHeldSplitterDomain && pNode->ContainsNode(m_pHeldSplitterDomain))
+            {
+                m_pHeldSplitterDomain = nullptr;
+                m_splitterHeld = false;
+            }
+            return true;
+        }
+
+        // Removes a child of a domain with its subtree. The other child keeps its level and takes the place of the domain,
+        // hidden if the domain was. The root is always visible.
+        void RemoveChild(
+            CustomLayoutNode* pParent,
+            CustomLayoutNode* pNode)
+        {
+            CustomLayoutNode* pSibling = (pParent->m_pLeft == pNode) ? pParent->m_pRight : pParent->m_pLeft;
+            SetNodeHidden(pSibling, pParent->m_pParent ? pParent->m_isHidden : false);
+            if (pParent->m_pParent)
+            {
+                pParent->m_pParent->ReplaceChild(pParent, pSibling);
+            }
+            else
+            {
+                m_pRoot = pSibling;
+                pSibling->m_pParent = nullptr;
+            }
+
+            // Prepare jobs may still use the stages of the removed leaves.
+            WaitForPrepareJobs();
+
+            pSibling->SetDomainPos(pParent->GetDomainPos());
+            pSibling->SetDomainSize(pParent->GetDomainSize());
+            pSibling->m_limitMin = pParent->m_limitMin;
+            pSibling->m_limitMax = pParent->m_limitMax;
+            Relayout(pSibling);
+
+            pParent->m_pLeft = nullptr;
+            pParent->m_pRight = nullptr;
+            FreeNodes(pParent);
+            FreeNodes(pNode);
+        }
+
+#ifdef CUSTOM_LAYOUT_COROUTINES
+        struct LeafCoroutine
+        {
+            CustomLayoutNode*                                   pLeaf;
+            std::coroutine_handle<CustomLeafTask::promise_type> handle;
+        };
+
+        // Resumes the coroutines round robin until the budget is used up. The next frame starts after the last one resumed,
+        // so a coroutine that uses the whole budget doesn't starve the others.
+        void ResumeCoroutines()
+        {
+            if (m_coroutines.Size == 0)
+            {
+                return;
+            }
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            m_coroutineDeadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(m_coroutineBudgetMs));
+
+            // The next coroutine only starts when its last chunk of work still fits in the budget.
+            int count = m_coroutines.Size;
+            int resumed = 0;
+            while (resumed < count)
+            {
+                CustomLeafTask::promise_type& promise = m_coroutines[(m_nextCoroutine + resumed) % count].handle.promise();
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if ((resumed > 0) && ((now + promise.lastChunk) >= m_coroutineDeadline))
+                {
+                    break;
+                }
+
+                promise.lastCheck = now;
+                m_coroutines[(m_nextCoroutine + resumed) % count].handle.resume();
+                resumed++;
+            }
+            m_nextCoroutine = (m_nextCoroutine + resumed) % count;
+
+            double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            m_stats.lastCoroutineMs = elapsedMs;
+            if (elapsedMs > m_coroutineBudgetMs * 1.05)
+            {
+                m_stats.budgetOverruns++;
+                m_stats.maxOverrunMs = ImMax(m_stats.maxOverrunMs, elapsedMs - m_coroutineBudgetMs);
+            }
+
+            // Finished coroutines are dropped. The order of the others is kept.
+            for (int i = 0; i < m_coroutines.Size;)
+            {
+                if (m_coroutines[i].handle.done())
+                {
+                    m_coroutines[i].handle.destroy();
+                    m_coroutines.erase(m_coroutines.Data + i);
+                    if (m_nextCoroutine > i)
+                    {
+                        m_nextCoroutine--;
+                    }
+                }
+                else
+                {
+                    i++;
+                }
+            }
+            if (m_nextCoroutine >= m_coroutines.Size)
+            {
+                m_nextCoroutine = 0;
+            }
+        }
+
+        ImVector<LeafCoroutine>               m_coroutines;
+        int                                   m_nextCoroutine;
+        std::chrono::steady_clock::time_point m_coroutineDeadline;
+#endif
+
+        // Starts the Prepare stage of every two-phase leaf. They run while the rest of the frame is built. Ticks the inactive
+        // tabs of the tabbed leaves.
+        void ScheduleLeafWork()
+        {
+            m_leaves.resize(0);
+            m_pRoot->CollectLeaves(m_leaves);
+            m_subLayoutHosts.resize(0);
+            for (int i = 0; i < m_leaves.Size; i++)
+            {
+                if (CustomLeafPrepareStage* pStage = m_leaves[i]->GetPrepareStage())
+                {
+                    pStage->Schedule(m_pJobSystem, &m_prepareCounter);
+                }
+                else if (CustomLeafTabs* pTabs = m_leaves[i]->GetTabs())
+                {
+                    pTabs->TickBackground();
+                }
+                else if (m_leaves[i]->GetSubLayout())
+                {
+                    m_subLayoutHosts.push_back(m_leaves[i]);
+                }
+            }
+        }
+    };
+
+    inline void CustomLayoutNode::SetSubLayout(CustomLayout* pLayout)
+    {
+        assert((void("ERROR: Only window nodes can host a layout."), (pLayout == nullptr) || (m_isLogicalDomain == false)));
+        assert((void("ERROR: A two-phase or tabbed leaf can't host a layout."),
+                (pLayout == nullptr) || ((m_pPrepareStage == nullptr) && (m_pTabs == nullptr))));
+        assert((void("ERROR: The layout already has another host."),
+                (pLayout == nullptr) || (pLayout->m_pHost == nullptr) || (pLayout->m_pHost == this)));
+        if (m_pSubLayout)
+        {
+            m_pSubLayout->m_pHost = nullptr;
+        }
+        m_pSubLayout = pLayout;
+        m_pWindow = nullptr;
+        if (pLayout)
+        {
+            pLayout->m_pHost = this;
+            pLayout->m_lastViewport = ImVec2(0.f, 0.f);
+        }
+    }
+
+    // Collapsed to nothing, the leaf has nothing to show. Its sub-layout waits until it opens again.
+    inline void CustomLayoutNode::BeginEndSubLayout()
+    {
+        if ((m_domainSize.x > 0.f) && (m_domainSize.y > 0.f))
+        {
+            m_pSubLayout->BeginEndHosted();
+        }
+    }
+
+    // One node of a recorded layout version. Versions share every subtree that didn't change between them.
+    struct CustomLayoutVersionNode
+    {
+        int                      refCount;
+        uint32_t                 nodeId;
+        uint32_t                 level;
+        ImGuiID                  nameId;
+        bool                     isLogicalDomain;
+        bool                     isHidden;
+        float                    splitterRatio;
+        ImVec2                   minSize;
+        ImVec2                   maxSize;
+        CustomWindowFunc         windowFunc;
+        CustomLayoutVersionNode* pLeft;
+        CustomLayoutVersionNode* pRight;
+    };
+
+    // Undo/redo for the structure, names, visibility, size constraints and splitter ratios of a layout. A version only copies the nodes changed since the one
+    // before, plus their ancestors, and points to the previous version for the rest. A splitter drag costs O(depth) and
+    // undoing it only touches the nodes on that path.
+    // Restored leaves get their window function back. Prepare stages and coroutines of removed leaves aren't restored.
+    class CustomLayoutHistory
+    {
+    public:
+        explicit CustomLayoutHistory(
+            CustomLayout* pLayout,
+            size_t        memoryCapBytes = 1024 * 1024)
+            : m_pLayout(pLayout),
+              m_pCurrent(nullptr),
+              m_memoryUsed(0),
+              m_memoryCap(memoryCapBytes)
+        {
+            assert((void("ERROR: The layout of a history cannot be NULL."), pLayout != nullptr));
+            m_pCurrent = RecordNode(m_pLayout->m_pRoot);
+        }
+
+        ~CustomLayoutHistory()
+        {
+            ClearStack(m_undo);
+            ClearStack(m_redo);
+            Release(m_pCurrent);
+        }
+
+        // Call once per frame after BeginEndLayout(). Adds a version when the layout changed since the last one.
+        // Nothing is recorded while a splitter is held, so a whole drag becomes one version. Returns true if one was added.
+        bool Record()
+        {
+            if (m_pLayout->m_splitterHeld)
+            {
+                return false;
+            }
+
+            CustomLayoutVersionNode* pVersion = RecordNode(m_pLayout->m_pRoot);
+            if (pVersion == m_pCurrent)
+            {
+                Release(pVersion);
+                return false;
+            }
+
+            m_undo.push_back(m_pCurrent);
+            m_pCurrent = pVersion;
+            ClearStack(m_redo);
+            EnforceMemoryCap();
+            return true;
+        }
+
+        // Changes made since the last Record() are recorded first, so they can be redone.
+        bool Undo()
+        {
+            if (m_pLayout->m_splitterHeld)
+            {
+                return false;
+            }
+
+            Record();
+            if (m_undo.Size == 0)
+            {
+                return false;
+            }
+
+            CustomLayoutVersionNode* pTarget = m_undo.back();
+            m_undo.pop_back();
+            Restore(pTarget);
+            m_redo.push_back(m_pCurrent);
+            m_pCurrent = pTarget;
+            return true;
+        }
+
+        // Recording a change after an undo drops the redo versions.
+        bool Redo()
+        {
+            if (m_pLayout->m_splitterHeld)
+            {
+                return false;
+            }
+
+            Record();
+            if (m_redo.Size == 0)
+            {
+                return false;
+            }
+
+            CustomLayoutVersionNode* pTarget = m_redo.back();
+            m_redo.pop_back();
+            Restore(pTarget);
+            m_undo.push_back(m_pCurrent);
+            m_pCurrent = pTarget;
+            return true;
+        }
+
+        bool CanUndo() const { return m_undo.Size > 0; }
+        bool CanRedo() const { return m_redo.Size > 0; }
+        int GetUndoCount() const { return m_undo.Size; }
+        int GetRedoCount() const { return m_redo.Size; }
+
+        // Bytes of the version nodes of all kept versions. Shared nodes are counted once.
+        size_t GetMemoryUsed() const { return m_memoryUsed; }
+
+        // The oldest undo versions are dropped until the history fits. The current version is always kept.
+        void SetMemoryCap(size_t memoryCapBytes)
+        {
+            m_memoryCap = memoryCapBytes;
+            EnforceMemoryCap();
+        }
+
+    private:
+        CustomLayoutHistory(const CustomLayoutHistory&) = delete;
+        CustomLayoutHistory& operator=(const CustomLayoutHistory&) = delete;
+
+        // A clean node and its subtree are the same as in the current version, they are shared as they are.
+        CustomLayoutVersionNode* RecordNode(CustomLayoutNode* pNode)
+        {
+            if (pNode->m_isDirty == false)
+            {
+                if (CustomLayoutVersionNode* pShared = (CustomLayoutVersionNode*)m_latest.GetVoidPtr(pNode->m_id))
+                {
+                    pShared->refCount++;
+                    return pShared;
+                }
+            }
+
+            CustomLayoutVersionNode* pVersion = new CustomLayoutVersionNode();
+            m_memoryUsed += sizeof(CustomLayoutVersionNode);
+            pVersion->refCount = 1;
+            pVersion->nodeId = pNode->m_id;
+            pVersion->level = pNode->m_level;
+            pVersion->nameId = pNode->m_nameId;
+            pVersion->isLogicalDomain = pNode->m_isLogicalDomain;
+            pVersion->isHidden = pNode->m_isHidden;
+            pVersion->splitterRatio = pNode->m_splitterRatio;
+            pVersion->minSize = pNode->m_minSize;
+            pVersion->maxSize = pNode->m_maxSize;
+            pVersion->windowFunc = pNode->m_pfnCustomWindowFunc;
+            pVersion->pLeft = pNode->m_pLeft ? RecordNode(pNode->m_pLeft) : nullptr;
+            pVersion->pRight = pNode->m_pRight ? RecordNode(pNode->m_pRight) : nullptr;
+
+            pNode->m_isDirty = false;
+            m_latest.SetVoidPtr(pNode->m_id, pVersion);
+            return pVersion;
+        }
+
+        void Release(CustomLayoutVersionNode* pVersion)
+        {
+            if (--pVersion->refCount > 0)
+            {
+                return;
+            }
+
+            if (pVersion->pLeft)
+            {
+                Release(pVersion->pLeft);
+            }
+            if (pVersion->pRight)
+            {
+                Release(pVersion->pRight);
+            }
+            if (m_latest.GetVoidPtr(pVersion->nodeId) == pVersion)
+            {
+                EraseStorageKey(m_latest, pVersion->nodeId);
+            }
+            m_memoryUsed -= sizeof(CustomLayoutVersionNode);
+            delete pVersion;
+        }
+
+        void ClearStack(ImVector<CustomLayoutVersionNode*>& stack)
+        {
+            for (int i = 0; i < stack.Size; i++)
+            {
+                Release(stack[i]);
+            }
+            stack.resize(0);
+        }
+
+        void EnforceMemoryCap()
+        {
+            int dropped = 0;
+            while ((m_memoryUsed > m_memoryCap) && (dropped < m_undo.Size))
+            {
+                Release(m_undo[dropped]);
+                dropped++;
+            }
+            if (dropped > 0)
+            {
+                m_undo.erase(m_undo.Data, m_undo.Data + dropped);
+            }
+        }
+
+        // Hiding a child changes how its parent lays out its children, so it counts as a change of the parent.
+        static bool SameNode(
+            const CustomLayoutVersionNode* pA,
+            const CustomLayoutVersionNode* pB)
+        {
+            return (pA->level == pB->level) &&
+                   (pA->nameId == pB->nameId) &&
+                   (pA->isLogicalDomain == pB->isLogicalDomain) &&
+                   (pA->isHidden == pB->isHidden) &&
+                   (pA->splitterRatio == pB->splitterRatio) &&
+                   (pA->minSize.x == pB->minSize.x) && (pA->minSize.y == pB->minSize.y) &&
+                   (pA->maxSize.x == pB->maxSize.x) && (pA->maxSize.y == pB->maxSize.y) &&
+                   (pA->windowFunc == pB->windowFunc) &&
+                   SameChild(pA->pLeft, pB->pLeft) &&
+                   SameChild(pA->pRight, pB->pRight);
+        }
+
+        static bool SameChild(
+            const CustomLayoutVersionNode* pA,
+            const CustomLayoutVersionNode* pB)
+        {
+            if ((pA == nullptr) || (pB == nullptr))
+            {
+                return pA == pB;
+            }
+            return (pA->nodeId == pB->nodeId) && (pA->isHidden == pB->isHidden);
+        }
+
+        static CustomLayoutVersionNode* FindChild(
+            CustomLayoutVersionNode* pCurrent,
+            uint32_t                 nodeId)
+        {
+            if (pCurrent == nullptr)
+            {
+                return nullptr;
+            }
+            if (pCurrent->pLeft && (pCurrent->pLeft->nodeId == nodeId))
+            {
+                return pCurrent->pLeft;
+            }
+            if (pCurrent->pRight && (pCurrent->pRight->nodeId == nodeId))
+            {
+                return pCurrent->pRight;
+            }
+            return nullptr;
+        }
+
+        // Turns the live tree, which matches the current version, into the target version. Subtrees both versions share
+        // aren't visited. Nodes only the current version has go back to the layout's free list.
+        void Restore(CustomLayoutVersionNode* pTarget)
+        {
+            // Prepare jobs may still use the stages of the leaves about to be removed.
+            m_pLayout->WaitForPrepareJobs();
+
+            CustomLayoutNode* pOldRoot = m_pLayout->m_pRoot;
+            ImVec2 rootPos = pOldRoot->GetDomainPos();
+            ImVec2 rootSize = pOldRoot->GetDomainSize();
+
+            m_kept.Data.resize(0);
+            m_shared.Data.resize(0);
+            m_relayoutRoots.resize(0);
+            CustomLayoutNode* pNewRoot = RestoreNode(pTarget, m_pCurrent, false);
+            pNewRoot->m_pParent = nullptr;
+            m_pLayout->m_pRoot = pNewRoot;
+
+            ReleaseRemovedNodes(m_pCurrent);
+
+            // A changed node under an unchanged parent still has the domain its parent gave it. The layout goes up from there
+            // when the size limits changed, once all of them are known.
+            pNewRoot->SetDomainPos(rootPos);
+            pNewRoot->SetDomainSize(rootSize);
+            m_pLayout->BeginTransaction();
+            for (int i = 0; i < m_relayoutRoots.Size; i++)
+            {
+                m_pLayout->Relayout(m_relayoutRoots[i]);
+            }
+            m_pLayout->EndTransaction();
+        }
+
+        CustomLayoutNode* RestoreNode(
+            CustomLayoutVersionNode* pTarget,
+            CustomLayoutVersionNode* pCurrent,
+            bool                     parentChanged)
+        {
+            CustomLayoutNode* pNode = m_pLayout->FindNode(pTarget->nodeId);
+            if (pTarget == pCurrent)
+            {
+                m_shared.SetVoidPtr(pTarget->nodeId, pTarget);
+                return pNode;
+            }
+
+            m_kept.SetBool(pTarget->nodeId, true);
+            if (pNode == nullptr)
+            {
+                pNode = m_pLayout->NewNode(pTarget->isLogicalDomain, pTarget->splitterRatio, pTarget->windowFunc, pTarget->nodeId);
+            }
+
+            bool changed = (pCurrent == nullptr) || (SameNode(pTarget, pCurrent) == false);
+            pNode->m_level = pTarget->level;
+            pNode->m_isLogicalDomain = pTarget->isLogicalDomain;
+            pNode->m_isHidden = pTarget->isHidden;
+            if (pNode->m_nameId != pTarget->nameId)
+            {
+                // The old name may already belong to another restored node.
+                if ((pNode->m_nameId != 0) && (m_pLayout->m_nameIndex.GetVoidPtr(pNode->m_nameId) == pNode))
+                {
+                    EraseStorageKey(m_pLayout->m_nameIndex, pNode->m_nameId);
+                }
+                pNode->m_nameId = pTarget->nameId;
+                if (pNode->m_nameId != 0)
+                {
+                    m_pLayout->m_nameIndex.SetVoidPtr(pNode->m_nameId, pNode);
+                }
+            }
+            pNode->m_splitterRatio = pTarget->splitterRatio;
+            pNode->m_minSize = pTarget->minSize;
+            pNode->m_maxSize = pTarget->maxSize;
+            pNode->m_pfnCustomWindowFunc = pTarget->windowFunc;
+
+            pNode->m_pLeft = nullptr;
+            pNode->m_pRight = nullptr;
+            if (pTarget->pLeft)
+            {
+                pNode->m_pLeft = RestoreNode(pTarget->pLeft, FindChild(pCurrent, pTarget->pLeft->nodeId), changed || parentChanged);
+                pNode->m_pLeft->m_pParent = pNode;
+            }
+            if (pTarget->pRight)
+            {
+                pNode->m_pRight = RestoreNode(pTarget->pRight, FindChild(pCurrent, pTarget->pRight->nodeId), changed || parentChanged);
+                pNode->m_pRight->m_pParent = pNode;
+            }
+
+            pNode->m_isDirty = false;
+            m_latest.SetVoidPtr(pTarget->nodeId, pTarget);
+            if (changed && (parentChanged == false))
+            {
+                m_relayoutRoots.push_back(pNode);
+            }
+            return pNode;
+        }
+
+        void ReleaseRemovedNodes(CustomLayoutVersionNode* pCurrent)
+        {
+            if (m_shared.GetVoidPtr(pCurrent->nodeId) == pCurrent)
+            {
+                return;
+            }
+
+            if (m_kept.GetBool(pCurrent->nodeId) == false)
+            {
+                if (CustomLayoutNode* pNode = m_pLayout->FindNode(pCurrent->nodeId))
+                {
+                    pNode->m_pLeft = nullptr;
+                    pNode->m_pRight = nullptr;
+                    m_pLayout->ReleaseNode(pNode);
+                }
+            }
+
+            if (pCurrent->pLeft)
+            {
+                ReleaseRemovedNodes(pCurrent->pLeft);
+            }
+            if (pCurrent->pRight)
+            {
+                ReleaseRemovedNodes(pCurrent->pRight);
+            }
+        }
+
+        CustomLayout*                      m_pLayout;
+        CustomLayoutVersionNode*           m_pCurrent;     // Version of the live tree, as of the last Record() or restore.
+        ImVector<CustomLayoutVersionNode*> m_undo;         // Oldest first.
+        ImVector<CustomLayoutVersionNode*> m_redo;
+        ImGuiStorage                       m_latest;       // Node ID to the newest version node recorded for it.
+        size_t                             m_memoryUsed;
+        size_t                             m_memoryCap;
+
+        // Scratch state of Restore().
+        ImGuiStorage                m_kept;                // Node IDs of the target outside the shared subtrees.
+        ImGuiStorage                m_shared;              // Node ID to the roots of the subtrees both versions share.
+        ImVector<CustomLayoutNode*> m_relayoutRoots;
+    };
+
+    // Keeps several layouts resident and shows one of them. Switching is O(1) and only lays the new layout out again if
+    // the viewport changed since it was last shown.
+    // The leaf windows of hidden layouts stay in Dear ImGui with their size and draw list buffers, which are kept from
+    // being compacted. Prewarm() creates the windows of a layout that wasn't shown yet, so its first frame doesn't stall.
+    // Window names must be unique across the layouts. Windows are only kept for layouts without parallel leaves.
+    class CustomWorkspaces
+    {
+    public:
+        CustomWorkspaces()
+            : m_active(-1)
+        {}
+
+        ~CustomWorkspaces()
+        {
+            for (int i = 0; i < m_workspaces.Size; i++)
+            {
+                delete m_workspaces[i];
+            }
+        }
+
+        // Takes ownership of the layout. The first layout added becomes the active one.
+        int Add(CustomLayout* pLayout)
+        {
+            assert((void("ERROR: The layout of a workspace cannot be NULL."), pLayout != nullptr));
+            m_workspaces.push_back(pLayout);
+            if (m_active < 0)
+            {
+                m_active = 0;
+            }
+            return m_workspaces.Size - 1;
+        }
+
+        // Takes effect at the next BeginEndLayout().
+        void SetActive(int index)
+        {
+            assert((void("ERROR: Workspace index out of range."), (index >= 0) && (index < m_workspaces.Size)));
+            m_active = index;
+        }
+
+        int GetActive() const { return m_active; }
+        int GetCount() const { return m_workspaces.Size; }
+        CustomLayout* GetLayout(int index) const { return m_workspaces[index]; }
+
+        // Warms up a hidden layout with CustomLayout::WarmUp(). Call it between NewFrame() and Render(), e.g. for all
+        // workspaces right after startup or one per frame.
+        void Prewarm(int index)
+        {
+            assert((void("ERROR: Workspace index out of range."), (index >= 0) && (index < m_workspaces.Size)));
+            if (index == m_active)
+            {
+                return;
+            }
+
+            m_workspaces[index]->WarmUp();
+        }
+
+        // Builds the active layout. Call it where CustomLayout::BeginEndLayout() would be called.
+        void BeginEndLayout()
+        {
+            if (m_active < 0)
+            {
+                return;
+            }
+
+            m_workspaces[m_active]->BeginEndLayout();
+
+            // Dear ImGui frees the buffers of windows that weren't active for a while (io.ConfigMemoryCompactTimer).
+            CustomContextScope contextScope(m_workspaces[m_active]->GetContext());
+            ImGuiContext& g = *GImGui;
+            for (int i = 0; i < m_workspaces.Size; i++)
+            {
+                if (i == m_active)
+                {
+                    continue;
+                }
+
+                m_leaves.resize(0);
+                m_workspaces[i]->m_pRoot->CollectLeaves(m_leaves);
+                for (int j = 0; j < m_leaves.Size; j++)
+                {
+                    if (ImGuiWindow* pWindow = m_leaves[j]->GetWindow())
+                    {
+                        pWindow->LastTimeActive = (float)g.Time;
+                    }
+                }
+            }
+        }
+
+    private:
+        CustomWorkspaces(const CustomWorkspaces&) = delete;
+        CustomWorkspaces& operator=(const CustomWorkspaces&) = delete;
+
+        ImVector<CustomLayout*>     m_workspaces;
+        int                         m_active;
+        ImVector<CustomLayoutNode*> m_leaves; // Scratch state.
     };
 
-    bool BeginBottomMainMenuBar()
+    // Context that was current before BeginBottomMainMenuBar() switched, restored by EndBottomMainMenuBar(). NULL when
+    // it didn't switch, or when no context was current. One per thread.
+    inline ImGuiContext*& BottomMainMenuBarPrevContext()
+    {
+        static thread_local ImGuiContext* s_pPrevContext = nullptr;
+        return s_pPrevContext;
+    }
+
+    // Like ImGui::BeginMainMenuBar(), at the bottom of the main viewport of the context. NULL means the current one.
+    // The context stays current until the matching EndBottomMainMenuBar(), only called when this returns true.
+    inline bool BeginBottomMainMenuBar(ImGuiContext* pContext = nullptr)
     {
+        ImGuiContext* pPrevContext = ImGui::GetCurrentContext();
+        const bool isSwitched = (pContext != nullptr) && (pContext != pPrevContext);
+        if (isSwitched)
+        {
+            ImGui::SetCurrentContext(pContext);
+        }
+
         ImGuiContext& g = *GImGui;
         ImGuiViewportP* viewport = (ImGuiViewportP*)(void*)ImGui::GetMainViewport();
         // For the main menu bar, which cannot be moved, we honor g.Style.DisplaySafeAreaPadding to ensure text can be visible on a TV set.
@@ -432,9 +3402,29 @@ namespace DearImGuiExt
         g.NextWindowData.MenuBarOffsetMinVal = ImVec2(0.0f, 0.0f);
 
         if (is_open)
+        {
             ImGui::BeginMenuBar();
+            BottomMainMenuBarPrevContext() = isSwitched ? pPrevContext : nullptr;
+        }
         else
+        {
             ImGui::End();
+            if (isSwitched)
+            {
+                ImGui::SetCurrentContext(pPrevContext);
+            }
+        }
         return is_open;
     }
+
+    // Ends the bar and makes the context that was current before BeginBottomMainMenuBar() current again.
+    inline void EndBottomMainMenuBar()
+    {
+        ImGui::EndMainMenuBar();
+        if (ImGuiContext* pPrevContext = BottomMainMenuBarPrevContext())
+        {
+            ImGui::SetCurrentContext(pPrevContext);
+            BottomMainMenuBarPrevContext() = nullptr;
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,466 @@
+#pragma once
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "CustomDearImGuiLayout.h"
+#include "CustomDearImGuiMpscQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// A log console leaf for live log tails fed by many threads. AddLine() copies a line into a lock-free ring from any
+// thread. Once per frame the leaf moves the new lines into an arena of large blocks, drops the oldest ones beyond the
+// retention limit and only draws the rows that fit in its domain. The filter is indexed incrementally by the Prepare
+// phase of the leaf, on the layout's job system, a chunk of lines per frame, so a new filter never stalls the frame.
+namespace DearImGuiExt
+{
+    struct CustomLogConsoleStats
+    {
+        uint64_t receivedLines; // Moved from the ring to the arena.
+        uint64_t droppedLines;  // Rejected by a full ring, e.g. while the leaf is hidden.
+        uint64_t evictedLines;  // Dropped by the retention limit or Clear().
+        int      retainedLines;
+        int      matchingLines; // Retained lines passing the filter, among the indexed ones.
+        int      indexedLines;  // Retained lines checked against the filter. All of them without a filter.
+        size_t   arenaBytes;    // Allocated blocks, in use or free.
+        double   lastDrainMs;   // Moving the new lines and dropping the old ones in the last frame.
+    };
+
+    // Lives as long as the layout of its leaf. Attach() turns a window node into the console.
+    class CustomLogConsole
+    {
+    public:
+        static constexpr uint32_t ArenaBlockSize      = 1 << 20;
+        static constexpr uint32_t MaxLineLength       = 4096;    // Longer lines are cut.
+        static constexpr uint32_t FilterLinesPerFrame = 1 << 17; // Lines indexed by one Prepare.
+
+        // The ring holds the lines of about one frame: ringSlots slots of MpscByteRing::SlotBytes bytes.
+        CustomLogConsole(
+            const char* pWindowName,
+            int         maxLines = 1 << 20,
+            uint32_t    ringSlots = 1 << 16)
+            : m_pWindowName(ImStrdup(pWindowName)),
+              m_ring(ringSlots),
+              m_droppedLines(0),
+              m_maxLines((uint64_t)maxLines),
+              m_firstLine(0),
+              m_endLine(0),
+              m_clearedLine(0),
+              m_firstBlock(0),
+              m_blockUsed(0),
+              m_matchStart(0),
+              m_indexedEnd(0),
+              m_filterGeneration(0),
+              m_isRequestPending(false),
+              m_requestBegin(0),
+              m_requestEnd(0),
+              m_requestGeneration(0),
+              m_chunkGeneration(UINT32_MAX),
+              m_requestSeq(0),
+              m_doneSeq(0),
+              m_isAutoScrolling(true),
+              m_stats()
+        {
+            assert((void("ERROR: The console must retain at least one line."), maxLines > 0));
+
+            // Room for the retained lines and a full ring more, drained while an indexing chunk still reads the old ones.
+            uint64_t capacity = 1;
+            while (capacity < m_maxLines + ringSlots)
+            {
+                capacity <<= 1;
+            }
+            m_lines.resize((int)capacity);
+            m_lineMask = capacity - 1;
+        }
+
+        ~CustomLogConsole()
+        {
+            for (int i = 0; i < m_blocks.Size; i++)
+            {
+                IM_FREE(m_blocks[i]);
+            }
+            for (int i = 0; i < m_freeBlocks.Size; i++)
+            {
+                IM_FREE(m_freeBlocks[i]);
+            }
+            IM_FREE(m_pWindowName);
+        }
+
+        // The leaf becomes a two-phase leaf: Prepare indexes the filter, Emit draws the console.
+        void Attach(CustomLayoutNode* pLeaf)
+        {
+            pLeaf->SetPrepareStage(&PrepareFunc, &EmitFunc, this);
+        }
+
+        // Any thread. One line per call, without its line break. Returns false if the ring is full.
+        bool AddLine(
+            const char* pText,
+            size_t      length)
+        {
+            length = ImMin(length, ImMin((size_t)MaxLineLength, m_ring.GetMaxRecordSize()));
+            while ((length > 0) && ((pText[length - 1] == '\n') || (pText[length - 1] == '\r')))
+            {
+                length--;
+            }
+            if (m_ring.Push(pText, length))
+            {
+                return true;
+            }
+            m_droppedLines.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        bool AddLine(const char* pText)
+        {
+            return AddLine(pText, strlen(pText));
+        }
+
+        bool AddLinef(const char* pFormat, ...) IM_FMTARGS(2)
+        {
+            char line[MaxLineLength];
+            va_list args;
+            va_start(args, pFormat);
+            int length = vsnprintf(line, sizeof(line), pFormat, args);
+            va_end(args);
+            return (length >= 0) && AddLine(line, ImMin((size_t)length, sizeof(line) - 1));
+        }
+
+        // UI thread. Drops every retained line.
+        void Clear()
+        {
+            m_clearedLine = m_endLine;
+            EvictLines();
+        }
+
+        // UI thread. Same syntax as ImGuiTextFilter: "incl,-excl".
+        void SetFilter(const char* pFilter)
+        {
+            ImStrncpy(m_filter.InputBuf, pFilter, IM_ARRAYSIZE(m_filter.InputBuf));
+            m_filter.Build();
+            ResetFilterIndex();
+        }
+
+        bool IsAutoScrolling() const { return m_isAutoScrolling; }
+        void SetAutoScrolling(bool isAutoScrolling) { m_isAutoScrolling = isAutoScrolling; }
+
+        // UI thread. Moves the new lines to the arena, drops the old ones and starts the next indexing chunk. The leaf
+        // calls it before drawing. Call it yourself when drawing the console with Draw() outside of a leaf.
+        void Update()
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            CompleteRequest();
+
+            // Lines can't overwrite the slots of lines the pending chunk still reads, so the arena takes what fits.
+            EvictLines();
+            uint64_t room = (uint64_t)m_lines.Size - (m_endLine - m_firstLine);
+            m_ring.PopAll([this](const char* pText, size_t length) { AppendLine(pText, (uint32_t)length); }, (size_t)room);
+            EvictLines();
+
+            StartRequest();
+            m_stats.lastDrainMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // UI thread. Draws the console's window. The window takes the next window position and size, e.g. of the leaf.
+        void Draw()
+        {
+            constexpr ImGuiWindowFlags WindowFlags = ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove |
+                                                     ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings;
+            if (ImGui::Begin(m_pWindowName, nullptr, WindowFlags))
+            {
+                if (m_filter.Draw("Filter", ImGui::GetFontSize() * 16.f))
+                {
+                    ResetFilterIndex();
+                }
+                ImGui::SameLine();
+                ImGui::Checkbox("Auto-scroll", &m_isAutoScrolling);
+                ImGui::SameLine();
+                if (ImGui::SmallButton("Clear"))
+                {
+                    Clear();
+                }
+                ImGui::SameLine();
+                const CustomLogConsoleStats& stats = GetStats();
+                if (stats.indexedLines < stats.retainedLines)
+                {
+                    ImGui::Text("%d / %d lines, indexing %d%%", stats.matchingLines, stats.retainedLines,
+                                (int)(100.f * (float)stats.indexedLines / (float)stats.retainedLines));
+                }
+                else
+                {
+                    ImGui::Text("%d / %d lines", stats.matchingLines, stats.retainedLines);
+                }
+                ImGui::Separator();
+
+                // Only the rows inside the leaf's domain are submitted.
+                ImGui::BeginChild("##Lines", ImVec2(0.f, 0.f), false, ImGuiWindowFlags_HorizontalScrollbar);
+                const bool isFiltered = m_filter.IsActive();
+                const int rowCount = isFiltered ? (m_matches.Size - m_matchStart) : (int)(m_endLine - m_firstLine);
+                ImGuiListClipper clipper;
+                clipper.Begin(rowCount, ImGui::GetTextLineHeightWithSpacing());
+                while (clipper.Step())
+                {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+                    {
+                        uint64_t line = isFiltered ? m_matches[m_matchStart + row] : m_firstLine + (uint64_t)row;
+                        const LineRef& ref = m_lines[(int)(line & m_lineMask)];
+                        ImGui::TextUnformatted(ref.pText, ref.pText + ref.length);
+                    }
+                }
+                clipper.End();
+                if (m_isAutoScrolling && (ImGui::GetScrollY() >= ImGui::GetScrollMaxY()))
+                {
+                    ImGui::SetScrollHereY(1.f);
+                }
+                ImGui::EndChild();
+            }
+            ImGui::End();
+        }
+
+        // Retained line by age, 0 being the oldest.
+        const char* GetLine(
+            int  index,
+            int* pLength = nullptr) const
+        {
+            assert((void("ERROR: The line index is out of range."), (index >= 0) && ((uint64_t)index < m_endLine - m_firstLine)));
+            const LineRef& ref = m_lines[(int)((m_firstLine + (uint64_t)index) & m_lineMask)];
+            if (pLength)
+            {
+                *pLength = (int)ref.length;
+            }
+            return ref.pText;
+        }
+
+        const CustomLogConsoleStats& GetStats()
+        {
+            m_stats.droppedLines = m_droppedLines.load(std::memory_order_relaxed);
+            m_stats.retainedLines = (int)(m_endLine - m_firstLine);
+            if (m_filter.IsActive())
+            {
+                m_stats.matchingLines = m_matches.Size - m_matchStart;
+                m_stats.indexedLines = (int)(ImMax(m_indexedEnd, m_firstLine) - m_firstLine);
+            }
+            else
+            {
+                m_stats.matchingLines = m_stats.retainedLines;
+                m_stats.indexedLines = m_stats.retainedLines;
+            }
+            m_stats.arenaBytes = (size_t)(m_blocks.Size + m_freeBlocks.Size) * ArenaBlockSize;
+            return m_stats;
+        }
+
+    private:
+        CustomLogConsole(const CustomLogConsole&) = delete;
+        CustomLogConsole& operator=(const CustomLogConsole&) = delete;
+
+        struct LineRef
+        {
+            const char* pText;
+            uint32_t    length;
+            uint32_t    block; // Absolute index of its arena block.
+        };
+
+        static void PrepareFunc(void* pUserData, uint32_t bufferIndex)
+        {
+            (void)bufferIndex;
+            ((CustomLogConsole*)pUserData)->IndexChunk();
+        }
+
+        static void EmitFunc(void* pUserData, uint32_t bufferIndex)
+        {
+            (void)bufferIndex;
+            CustomLogConsole* pConsole = (CustomLogConsole*)pUserData;
+            pConsole->Update();
+            pConsole->Draw();
+        }
+
+        // Job thread, or the UI thread without a job system. Only reads the lines of the requested chunk, which the UI
+        // thread leaves alone until the chunk is done. Doesn't call Dear ImGui.
+        void IndexChunk()
+        {
+            uint64_t seq = m_requestSeq.load(std::memory_order_acquire);
+            if (seq == m_doneSeq.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            m_chunkMatches.clear();
+            for (uint64_t line = m_requestBegin; line < m_requestEnd; line++)
+            {
+                const LineRef& ref = m_lines[(int)(line & m_lineMask)];
+                if (m_chunkFilter.PassFilter(ref.pText, ref.pText + ref.length))
+                {
+                    m_chunkMatches.push_back(line);
+                }
+            }
+            m_doneSeq.store(seq, std::memory_order_release);
+        }
+
+        // Takes the result of a finished chunk. Chunks of an older filter are dropped.
+        void CompleteRequest()
+        {
+            if ((m_isRequestPending == false) ||
+                (m_doneSeq.load(std::memory_order_acquire) != m_requestSeq.load(std::memory_order_relaxed)))
+            {
+                return;
+            }
+
+            m_isRequestPending = false;
+            if (m_requestGeneration == m_filterGeneration)
+            {
+                for (uint64_t line : m_chunkMatches)
+                {
+                    if (line >= m_firstLine)
+                    {
+                        m_matches.push_back(line);
+                    }
+                }
+                m_indexedEnd = m_requestEnd;
+            }
+        }
+
+        void StartRequest()
+        {
+            m_indexedEnd = ImMax(m_indexedEnd, m_firstLine);
+            if (m_isRequestPending || (m_filter.IsActive() == false) || (m_indexedEnd == m_endLine))
+            {
+                return;
+            }
+
+            if (m_chunkGeneration != m_filterGeneration)
+            {
+                memcpy(m_chunkFilter.InputBuf, m_filter.InputBuf, sizeof(m_chunkFilter.InputBuf));
+                m_chunkFilter.Build();
+                m_chunkGeneration = m_filterGeneration;
+            }
+            m_requestBegin = m_indexedEnd;
+            m_requestEnd = ImMin(m_endLine, m_indexedEnd + FilterLinesPerFrame);
+            m_requestGeneration = m_filterGeneration;
+            m_isRequestPending = true;
+            m_requestSeq.store(m_requestSeq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        void ResetFilterIndex()
+        {
+            m_filterGeneration++;
+            m_matches.resize(0);
+            m_matchStart = 0;
+            m_indexedEnd = m_firstLine;
+        }
+
+        void AppendLine(
+            const char* pText,
+            uint32_t    length)
+        {
+            if ((m_blockUsed + length > ArenaBlockSize) || (m_blocks.Size == 0))
+            {
+                char* pBlock = nullptr;
+                if (m_freeBlocks.Size > 0)
+                {
+                    pBlock = m_freeBlocks.back();
+                    m_freeBlocks.pop_back();
+                }
+                else
+                {
+                    pBlock = (char*)IM_ALLOC(ArenaBlockSize);
+                }
+                m_blocks.push_back(pBlock);
+                m_blockUsed = 0;
+            }
+
+            char* pDest = m_blocks.back() + m_blockUsed;
+            memcpy(pDest, pText, length);
+            m_blockUsed += length;
+
+            LineRef& ref = m_lines[(int)(m_endLine & m_lineMask)];
+            ref.pText = pDest;
+            ref.length = length;
+            ref.block = m_firstBlock + (uint32_t)m_blocks.Size - 1;
+            m_endLine++;
+            m_stats.receivedLines++;
+        }
+
+        // Drops the lines beyond the retention limit or cleared, except those of a pending chunk, and recycles the arena
+        // blocks nothing points to anymore.
+        void EvictLines()
+        {
+            uint64_t first = ImMax(m_clearedLine, (m_endLine > m_maxLines) ? m_endLine - m_maxLines : 0);
+            if (m_isRequestPending)
+            {
+                first = ImMin(first, m_requestBegin);
+            }
+            if (first <= m_firstLine)
+            {
+                return;
+            }
+
+            m_stats.evictedLines += first - m_firstLine;
+            m_firstLine = first;
+            while ((m_matchStart < m_matches.Size) && (m_matches[m_matchStart] < m_firstLine))
+            {
+                m_matchStart++;
+            }
+            if (m_matchStart > m_matches.Size / 2)
+            {
+                m_matches.erase(m_matches.begin(), m_matches.begin() + m_matchStart);
+                m_matchStart = 0;
+            }
+
+            // The current block stays, it is still being filled.
+            uint32_t firstUsedBlock = (m_firstLine < m_endLine) ? m_lines[(int)(m_firstLine & m_lineMask)].block
+                                                                : m_firstBlock + (uint32_t)m_blocks.Size - 1;
+            int freedCount = ImMin((int)(firstUsedBlock - m_firstBlock), m_blocks.Size - 1);
+            if (freedCount > 0)
+            {
+                for (int i = 0; i < freedCount; i++)
+                {
+                    m_freeBlocks.push_back(m_blocks[i]);
+                }
+                m_blocks.erase(m_blocks.begin(), m_blocks.begin() + freedCount);
+                m_firstBlock += (uint32_t)freedCount;
+            }
+        }
+
+        char*                 m_pWindowName;
+        MpscByteRing          m_ring;
+        std::atomic<uint64_t> m_droppedLines;
+
+        // Retained lines, by absolute line number in a ring of slots.
+        ImVector<LineRef> m_lines;
+        uint64_t          m_lineMask;
+        uint64_t          m_maxLines;
+        uint64_t          m_firstLine;
+        uint64_t          m_endLine;
+        uint64_t          m_clearedLine;
+
+        // Arena blocks in the order they were filled. Blocks before the first line's one are recycled.
+        ImVector<char*> m_blocks;
+        ImVector<char*> m_freeBlocks;
+        uint32_t        m_firstBlock; // Absolute index of m_blocks[0].
+        uint32_t        m_blockUsed;  // Bytes used in the last block.
+
+        // Filter index: matching line numbers in order, for the lines before m_indexedEnd.
+        ImGuiTextFilter    m_filter;
+        ImVector<uint64_t> m_matches;
+        int                m_matchStart; // Matches of evicted lines before it.
+        uint64_t           m_indexedEnd;
+        uint32_t           m_filterGeneration;
+
+        // The chunk being indexed. Written by the UI thread while no chunk is pending, read by the Prepare phase.
+        bool                  m_isRequestPending;
+        uint64_t              m_requestBegin;
+        uint64_t              m_requestEnd;
+        uint32_t              m_requestGeneration;
+        ImGuiTextFilter       m_chunkFilter;
+        uint32_t              m_chunkGeneration;
+        std::vector<uint64_t> m_chunkMatches; // Not ImVector: the Prepare phase doesn't use Dear ImGui's allocator.
+        std::atomic<uint64_t> m_requestSeq;
+        std::atomic<uint64_t> m_doneSeq;
+
+        bool                  m_isAutoScrolling;
+        CustomLogConsoleStats m_stats;
+    };
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Lock-free multi-producer single-consumer queues. Any thread can push, only one thread pops.
+// Nothing in here touches Dear ImGui.
+namespace DearImGuiExt
+{
+    // Unbounded linked list queue with a stub node: producers swap themselves in at the head with a single atomic exchange
+    // and the consumer walks from the tail. A push doesn't wait for other producers or the consumer, but it allocates its
+    // node with new, so it is only as wait-free as the allocator. Use MpscByteRing where pushes must not allocate.
+    // Pop() can miss an item whose producer was preempted between the exchange and the link. It shows up on a later Pop().
+    template<typename T>
+    class MpscQueue
+    {
+    public:
+        MpscQueue()
+            : m_head(new Node()),
+              m_pTail(m_head.load(std::memory_order_relaxed))
+        {}
+
+        ~MpscQueue()
+        {
+            T item;
+            while (Pop(item))
+            {
+            }
+            delete m_pTail;
+        }
+
+        // Any thread.
+        void Push(T item)
+        {
+            Node* pNode = new Node();
+            pNode->item = std::move(item);
+            Node* pPrev = m_head.exchange(pNode, std::memory_order_acq_rel);
+            pPrev->pNext.store(pNode, std::memory_order_release);
+        }
+
+        // Consumer thread only.
+        bool Pop(T& item)
+        {
+            Node* pNext = m_pTail->pNext.load(std::memory_order_acquire);
+            if (pNext == nullptr)
+            {
+                return false;
+            }
+
+            // The next node becomes the new stub. Its item is moved out, the old stub is freed.
+            item = std::move(pNext->item);
+            delete m_pTail;
+            m_pTail = pNext;
+            return true;
+        }
+
+        // Consumer thread only. Same caveat as Pop() about producers in the middle of a push.
+        bool IsEmpty() const { return m_pTail->pNext.load(std::memory_order_acquire) == nullptr; }
+
+    private:
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        struct Node
+        {
+            Node() : pNext(nullptr), item() {}
+
+            std::atomic<Node*> pNext;
+            T                  item;
+        };
+
+        std::atomic<Node*> m_head;  // Last pushed node.
+        Node*              m_pTail; // Stub node. Its successor is the next item to pop.
+    };
+
+    // Bounded ring of variable sized byte records, e.g. log lines, in fixed 64-byte slots. A record takes as many
+    // consecutive slots as it needs. Producers claim their slots with a compare-and-swap and publish each slot with its
+    // sequence number, the consumer frees them in order, so nothing is allocated after construction. Push() never waits:
+    // it returns false when the ring is full.
+    class MpscByteRing
+    {
+    public:
+        static constexpr uint32_t SlotSize  = 64;
+        static constexpr uint32_t SlotBytes = SlotSize - sizeof(size_t) - sizeof(uint32_t); // Record bytes per slot.
+
+        // The slot count must be a power of two of at least 2.
+        explicit MpscByteRing(uint32_t slotCount)
+            : m_pSlots(new Slot[slotCount]),
+              m_mask(slotCount - 1),
+              m_enqueuePos(0),
+              m_dequeuePos(0)
+        {
+            assert((void("ERROR: The slot count must be a power of two of at least 2."),
+                    (slotCount >= 2) && ((slotCount & (slotCount - 1)) == 0)));
+            for (uint32_t i = 0; i < slotCount; i++)
+            {
+                m_pSlots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        uint32_t GetSlotCount() const { return m_mask + 1; }
+        size_t   GetMaxRecordSize() const { return (size_t)(m_mask + 1) * SlotBytes; }
+
+        // Any thread. Returns false if the ring has no room for the record.
+        bool Push(
+            const void* pData,
+            size_t      size)
+        {
+            if (size > GetMaxRecordSize())
+            {
+                return false;
+            }
+            const size_t slotCount = SlotsFor(size);
+
+            // The consumer frees slots in order, so the last slot of the record being free means they all are.
+            size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                size_t last = pos + slotCount - 1;
+                size_t sequence = m_pSlots[last & m_mask].sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)sequence - (intptr_t)last;
+                if (diff == 0)
+                {
+                    if (m_enqueuePos.compare_exchange_weak(pos, pos + slotCount, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = m_enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            const char* pBytes = (const char*)pData;
+            size_t left = size;
+            for (size_t i = 0; i < slotCount; i++)
+            {
+                Slot& slot = m_pSlots[(pos + i) & m_mask];
+                size_t bytes = (left < SlotBytes) ? left : SlotBytes;
+                slot.size = (uint32_t)size;
+                memcpy(slot.bytes, pBytes, bytes);
+                pBytes += bytes;
+                left -= bytes;
+                slot.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+            return true;
+        }
+
+        // Consumer thread only. Calls func(const char* pData, size_t size) for up to maxRecords records in push order and
+        // returns their count. The data is only valid during the call. Stops at a record whose producer hasn't finished.
+        template<typename Func>
+        size_t PopAll(
+            Func&& func,
+            size_t maxRecords = SIZE_MAX)
+        {
+            size_t count = 0;
+            while (count < maxRecords)
+            {
+                size_t pos = m_dequeuePos;
+                Slot& first = m_pSlots[pos & m_mask];
+                if (first.sequence.load(std::memory_order_acquire) != pos + 1)
+                {
+                    break;
+                }
+
+                size_t size = first.size;
+                size_t slotCount = SlotsFor(size);
+                bool isReady = true;
+                for (size_t i = 1; (i < slotCount) && isReady; i++)
+                {
+                    isReady = m_pSlots[(pos + i) & m_mask].sequence.load(std::memory_order_acquire) == pos + i + 1;
+                }
+                if (isReady == false)
+                {
+                    break;
+                }
+
+                if (slotCount == 1)
+                {
+                    func((const char*)first.bytes, size);
+                }
+                else
+                {
+                    m_scratch.resize(size);
+                    for (size_t i = 0, offset = 0; i < slotCount; i++, offset += SlotBytes)
+                    {
+                        size_t bytes = (size - offset < SlotBytes) ? size - offset : SlotBytes;
+                        memcpy(m_scratch.data() + offset, m_pSlots[(pos + i) & m_mask].bytes, bytes);
+                    }
+                    func((const char*)m_scratch.data(), size);
+                }
+
+                for (size_t i = 0; i < slotCount; i++)
+                {
+                    m_pSlots[(pos + i) & m_mask].sequence.store(pos + i + m_mask + 1, std::memory_order_release);
+                }
+                m_dequeuePos = pos + slotCount;
+                count++;
+            }
+            return count;
+        }
+
+    private:
+        MpscByteRing(const MpscByteRing&) = delete;
+        MpscByteRing& operator=(const MpscByteRing&) = delete;
+
+        // Free for position p when sequence == p, holds the record of position p when sequence == p + 1.
+        struct alignas(SlotSize) Slot
+        {
+            std::atomic<size_t> sequence;
+            uint32_t            size; // Of the whole record.
+            char                bytes[SlotBytes];
+        };
+
+        static size_t SlotsFor(size_t size)
+        {
+            return (size == 0) ? 1 : (size + SlotBytes - 1) / SlotBytes;
+        }
+
+        std::unique_ptr<Slot[]> m_pSlots;
+        size_t                  m_mask;
+
+        alignas(SlotSize) std::atomic<size_t> m_enqueuePos;
+        alignas(SlotSize) size_t              m_dequeuePos; // Consumer only.
+        std::vector<char>                     m_scratch;    // Records spanning several slots.
+    };
+}
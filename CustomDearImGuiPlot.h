@@ -0,0 +1,749 @@
+#pragma once
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "CustomDearImGuiLayout.h"
+#include "CustomDearImGuiMpscQueue.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cassert>
+#include <limits>
+#include <mutex>
+#include <vector>
+#if !defined(CUSTOM_PLOT_SCALAR) && defined(__AVX2__)
+#define CUSTOM_PLOT_AVX2
+#include <immintrin.h>
+#elif !defined(CUSTOM_PLOT_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define CUSTOM_PLOT_SSE2
+#include <emmintrin.h>
+#endif
+
+// A plot leaf for long time series, e.g. sensor channels with millions of samples. The samples are never sent to the
+// draw list: the leaf draws a polyline of a few points per pixel column of its domain. The min and max of every bucket of
+// 8, 64, 512... samples are kept in a pyramid, so a column is reduced from a handful of buckets whatever its sample count.
+// The pyramid is updated with the appended samples only, and the polyline is only computed again when the visible samples
+// or the width of the leaf change. Both run in the Prepare phase of the leaf, on the layout's job system.
+// The min/max reductions use AVX2, SSE2 or scalar code. Define CUSTOM_PLOT_SCALAR to build without SIMD.
+namespace DearImGuiExt
+{
+    enum CustomPlotDecimation
+    {
+        CustomPlotDecimation_MinMax, // Min and max of every pixel column. Every spike stays visible.
+        CustomPlotDecimation_Lttb    // Largest-Triangle-Three-Buckets, one point per column. Smoother, can skip a spike.
+    };
+
+    struct CustomPlotStats
+    {
+        uint64_t sampleCount;
+        uint64_t viewBegin;        // First visible sample.
+        uint64_t viewEnd;          // After the last visible sample.
+        int      width;            // Pixel columns of the polyline.
+        int      pointCount;       // Points of the polyline.
+        int      levelCount;       // Pyramid levels above the samples.
+        size_t   pyramidBytes;     // Samples and levels.
+        uint64_t recomputeCount;   // Prepare calls that computed the polyline again.
+        uint64_t reuseCount;       // Prepare calls that kept the previous polyline.
+        double   lastAppendMs;     // Adding the last appended samples to the pyramid.
+        double   lastDownsampleMs; // Last polyline computation.
+    };
+
+    // Lives as long as the layout of its leaf. Attach() turns a window node into the plot. Samples are evenly spaced, the
+    // x axis is the sample index.
+    class CustomTimeSeriesPlot
+    {
+    public:
+        static constexpr uint32_t FanoutShift = 3;
+        static constexpr uint32_t Fanout = 1 << FanoutShift; // Buckets of a level per bucket of the next one.
+
+        // A color of 0 uses the style's ImGuiCol_PlotLines.
+        explicit CustomTimeSeriesPlot(
+            const char* pWindowName,
+            ImU32       color = 0)
+            : m_pWindowName(ImStrdup(pWindowName)),
+              m_color(color),
+              m_stats(),
+              m_recomputeCount(0),
+              m_reuseCount(0),
+              m_lastAppendMs(0.0),
+              m_lastDownsampleMs(0.0)
+        {
+            m_request.width = 0;
+            m_request.decimation = CustomPlotDecimation_MinMax;
+            m_request.viewBegin = 0;
+            m_request.viewEnd = UINT64_MAX;
+            m_request.lastCount = 0;
+            m_request.isSimdEnabled = true;
+        }
+
+        ~CustomTimeSeriesPlot()
+        {
+            IM_FREE(m_pWindowName);
+        }
+
+        // The leaf becomes a two-phase leaf: Prepare downsamples, Emit draws the polyline.
+        void Attach(CustomLayoutNode* pLeaf)
+        {
+            pLeaf->SetPrepareStage(&PrepareFunc, &EmitFunc, this);
+        }
+
+        // Any thread. The samples are copied and show up after the next Prepare. NaN samples leave a gap in a column.
+        void Append(
+            const float* pValues,
+            size_t       count)
+        {
+            if (count > 0)
+            {
+                m_appended.Push(std::vector<float>(pValues, pValues + count));
+            }
+        }
+
+        // Any thread. The view follows the end of the series unless a fixed range is set.
+        void SetViewAll()
+        {
+            SetView(0, UINT64_MAX, 0);
+        }
+
+        void SetViewLast(uint64_t sampleCount)
+        {
+            SetView(0, UINT64_MAX, sampleCount);
+        }
+
+        void SetViewRange(
+            uint64_t begin,
+            uint64_t end)
+        {
+            SetView(begin, end, 0);
+        }
+
+        void SetDecimation(CustomPlotDecimation decimation)
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            m_request.decimation = decimation;
+        }
+
+        CustomPlotDecimation GetDecimation()
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            return m_request.decimation;
+        }
+
+        // Turns the SIMD kernels off to compare with the scalar ones. Both give the same points.
+        void SetSimdEnabled(bool isEnabled)
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            m_request.isSimdEnabled = isEnabled;
+        }
+
+        // Name of the instruction set used when SIMD is enabled.
+        static const char* GetSimdName()
+        {
+#if defined(CUSTOM_PLOT_AVX2)
+            return "AVX2";
+#elif defined(CUSTOM_PLOT_SSE2)
+            return "SSE2";
+#else
+            return "scalar";
+#endif
+        }
+
+        // UI thread. Stats of the polyline drawn in the last frame.
+        const CustomPlotStats& GetStats() const { return m_stats; }
+
+    private:
+        CustomTimeSeriesPlot(const CustomTimeSeriesPlot&) = delete;
+        CustomTimeSeriesPlot& operator=(const CustomTimeSeriesPlot&) = delete;
+
+        // What the UI thread asks the next Prepare for.
+        struct Request
+        {
+            int                  width;
+            CustomPlotDecimation decimation;
+            uint64_t             viewBegin;
+            uint64_t             viewEnd;
+            uint64_t             lastCount; // Last samples of the series when not 0, instead of the range.
+            bool                 isSimdEnabled;
+        };
+
+        // A polyline is valid for its view, width and decimation. The samples are only ever appended, so the visible ones
+        // can't change without the view changing.
+        struct ResultKey
+        {
+            uint64_t             viewBegin;
+            uint64_t             viewEnd;
+            int                  width;
+            CustomPlotDecimation decimation;
+
+            bool operator==(const ResultKey& other) const
+            {
+                return (viewBegin == other.viewBegin) && (viewEnd == other.viewEnd) &&
+                       (width == other.width) && (decimation == other.decimation);
+            }
+        };
+
+        // Written by Prepare, read by Emit. x is in pixel columns from the left of the plot, y is the sample value.
+        struct Result
+        {
+            Result() : key{ 0, 0, -1, CustomPlotDecimation_MinMax }, minY(0.f), maxY(0.f), stats() {}
+
+            ResultKey           key;
+            std::vector<ImVec2> points; // Not ImVector: the Prepare phase doesn't use Dear ImGui's allocator.
+            float               minY;
+            float               maxY;
+            CustomPlotStats     stats;
+        };
+
+        // Min and max of every bucket of Fanout^level samples, for the complete buckets.
+        struct Level
+        {
+            std::vector<float> mins;
+            std::vector<float> maxs;
+        };
+
+        static void PrepareFunc(void* pUserData, uint32_t bufferIndex)
+        {
+            ((CustomTimeSeriesPlot*)pUserData)->Prepare(bufferIndex);
+        }
+
+        static void EmitFunc(void* pUserData, uint32_t bufferIndex)
+        {
+            ((CustomTimeSeriesPlot*)pUserData)->Emit(bufferIndex);
+        }
+
+        void SetView(
+            uint64_t begin,
+            uint64_t end,
+            uint64_t lastCount)
+        {
+            std::lock_guard<std::mutex> lock(m_requestMutex);
+            m_request.viewBegin = begin;
+            m_request.viewEnd = end;
+            m_request.lastCount = lastCount;
+        }
+
+        // Job thread, or the UI thread without a job system. Owns the samples and the pyramid. Doesn't call Dear ImGui.
+        void Prepare(uint32_t bufferIndex)
+        {
+            Request request;
+            {
+                std::lock_guard<std::mutex> lock(m_requestMutex);
+                request = m_request;
+            }
+
+            AppendPending(request.isSimdEnabled);
+
+            ResultKey key;
+            const uint64_t sampleCount = m_samples.size();
+            if (request.lastCount > 0)
+            {
+                key.viewEnd = sampleCount;
+                key.viewBegin = (sampleCount > request.lastCount) ? sampleCount - request.lastCount : 0;
+            }
+            else
+            {
+                key.viewEnd = ImMin(request.viewEnd, sampleCount);
+                key.viewBegin = ImMin(request.viewBegin, key.viewEnd);
+            }
+            key.width = request.width;
+            key.decimation = request.decimation;
+
+            // The other buffer is the one Emit reads. Reading it here at the same time is fine.
+            Result& result = m_results[bufferIndex];
+            const Result& previous = m_results[bufferIndex ^ 1];
+            if (result.key == key)
+            {
+                m_reuseCount++;
+            }
+            else if (previous.key == key)
+            {
+                result.key = previous.key;
+                result.points = previous.points;
+                result.minY = previous.minY;
+                result.maxY = previous.maxY;
+                m_reuseCount++;
+            }
+            else
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                result.key = key;
+                result.points.clear();
+                if ((key.width > 0) && (key.viewEnd > key.viewBegin))
+                {
+                    if (key.viewEnd - key.viewBegin <= (uint64_t)key.width * 2)
+                    {
+                        AddSamplePoints(key, result.points);
+                    }
+                    else if (key.decimation == CustomPlotDecimation_MinMax)
+                    {
+                        DownsampleMinMax(key, request.isSimdEnabled, result.points);
+                    }
+                    else
+                    {
+                        DownsampleLttb(key, result.points);
+                    }
+                }
+
+                result.minY = std::numeric_limits<float>::infinity();
+                result.maxY = -std::numeric_limits<float>::infinity();
+                for (const ImVec2& point : result.points)
+                {
+                    result.minY = ImMin(result.minY, point.y);
+                    result.maxY = ImMax(result.maxY, point.y);
+                }
+                m_recomputeCount++;
+                m_lastDownsampleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            CustomPlotStats& stats = result.stats;
+            stats.sampleCount = sampleCount;
+            stats.viewBegin = key.viewBegin;
+            stats.viewEnd = key.viewEnd;
+            stats.width = key.width;
+            stats.pointCount = (int)result.points.size();
+            stats.levelCount = (int)m_levels.size();
+            stats.pyramidBytes = m_samples.capacity() * sizeof(float);
+            for (const Level& level : m_levels)
+            {
+                stats.pyramidBytes += (level.mins.capacity() + level.maxs.capacity()) * sizeof(float);
+            }
+            stats.recomputeCount = m_recomputeCount;
+            stats.reuseCount = m_reuseCount;
+            stats.lastAppendMs = m_lastAppendMs;
+            stats.lastDownsampleMs = m_lastDownsampleMs;
+        }
+
+        // UI thread, in place of the window function.
+        void Emit(uint32_t bufferIndex)
+        {
+            constexpr ImGuiWindowFlags WindowFlags = ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove |
+                                                     ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings;
+            const Result& result = m_results[bufferIndex];
+            m_stats = result.stats;
+            if (ImGui::Begin(m_pWindowName, nullptr, WindowFlags))
+            {
+                if (ImGui::RadioButton("Min/max", result.key.decimation == CustomPlotDecimation_MinMax))
+                {
+                    SetDecimation(CustomPlotDecimation_MinMax);
+                }
+                ImGui::SameLine();
+                if (ImGui::RadioButton("LTTB", result.key.decimation == CustomPlotDecimation_Lttb))
+                {
+                    SetDecimation(CustomPlotDecimation_Lttb);
+                }
+                ImGui::SameLine();
+                ImGui::Text("%llu samples, %d points", (unsigned long long)m_stats.sampleCount, m_stats.pointCount);
+
+                // The next Prepare downsamples to the width of the plot. Until then the polyline is stretched.
+                ImVec2 pos = ImGui::GetCursorScreenPos();
+                ImVec2 size = ImMax(ImGui::GetContentRegionAvail(), ImVec2(1.f, 1.f));
+                {
+                    std::lock_guard<std::mutex> lock(m_requestMutex);
+                    m_request.width = (int)size.x;
+                }
+
+                ImDrawList* pDrawList = ImGui::GetWindowDrawList();
+                ImVec2 max(pos.x + size.x, pos.y + size.y);
+                pDrawList->AddRect(pos, max, ImGui::GetColorU32(ImGuiCol_Border));
+                if ((result.points.size() >= 2) && (result.key.width > 0))
+                {
+                    const float padding = 2.f;
+                    float rangeY = (result.maxY > result.minY) ? result.maxY - result.minY : 1.f;
+                    float scaleX = size.x / (float)result.key.width;
+                    float scaleY = (size.y - 2.f * padding) / rangeY;
+                    m_drawPoints.resize((int)result.points.size());
+                    for (int i = 0; i < m_drawPoints.Size; i++)
+                    {
+                        const ImVec2& point = result.points[i];
+                        m_drawPoints[i] = ImVec2(pos.x + point.x * scaleX, max.y - padding - (point.y - result.minY) * scaleY);
+                    }
+                    pDrawList->PushClipRect(pos, max, true);
+                    pDrawList->AddPolyline(m_drawPoints.Data, m_drawPoints.Size,
+                                           m_color ? m_color : ImGui::GetColorU32(ImGuiCol_PlotLines), 0, 1.f);
+                    pDrawList->PopClipRect();
+                }
+                ImGui::Dummy(size);
+            }
+            ImGui::End();
+        }
+
+        // Moves the appended samples to the series and reduces the new complete buckets of every level.
+        void AppendPending(bool isSimdEnabled)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            std::vector<float> values;
+            bool isAppended = false;
+            while (m_appended.Pop(values))
+            {
+                if (m_samples.empty())
+                {
+                    m_samples.swap(values); // E.g. a whole recording, not copied again.
+                }
+                else
+                {
+                    m_samples.insert(m_samples.end(), values.begin(), values.end());
+                }
+                isAppended = true;
+            }
+            if (isAppended == false)
+            {
+                return;
+            }
+
+            for (int level = 1; ; level++)
+            {
+                size_t bucketCount = GetBucketCount(level - 1) / Fanout;
+                if (bucketCount == 0)
+                {
+                    break;
+                }
+                if (level > (int)m_levels.size())
+                {
+                    m_levels.emplace_back();
+                }
+
+                Level& target = m_levels[level - 1];
+                size_t doneCount = target.mins.size();
+                if (doneCount == bucketCount)
+                {
+                    break; // Nothing new above either.
+                }
+                target.mins.resize(bucketCount);
+                target.maxs.resize(bucketCount);
+                ReduceGroups(GetMins(level - 1) + doneCount * Fanout,
+                             GetMaxs(level - 1) + doneCount * Fanout,
+                             bucketCount - doneCount,
+                             isSimdEnabled,
+                             target.mins.data() + doneCount,
+                             target.maxs.data() + doneCount);
+            }
+            m_lastAppendMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Level 0 is the samples, their own min and max.
+        size_t GetBucketCount(int level) const { return (level == 0) ? m_samples.size() : m_levels[level - 1].mins.size(); }
+        const float* GetMins(int level) const { return (level == 0) ? m_samples.data() : m_levels[level - 1].mins.data(); }
+        const float* GetMaxs(int level) const { return (level == 0) ? m_samples.data() : m_levels[level - 1].maxs.data(); }
+
+        static uint64_t GetBucketSize(int level) { return (uint64_t)1 << (FanoutShift * level); }
+
+        // Highest level whose buckets hold at most sampleCount samples.
+        int GetLevelFor(uint64_t sampleCount) const
+        {
+            int level = 0;
+            while ((level < (int)m_levels.size()) && (GetBucketSize(level + 1) <= sampleCount))
+            {
+                level++;
+            }
+            return level;
+        }
+
+        // Few enough samples for one point each.
+        void AddSamplePoints(
+            const ResultKey&     key,
+            std::vector<ImVec2>& points) const
+        {
+            const double scale = (double)key.width / (double)(key.viewEnd - key.viewBegin);
+            for (uint64_t i = key.viewBegin; i < key.viewEnd; i++)
+            {
+                float value = m_samples[(size_t)i];
+                if (std::isnan(value) == false)
+                {
+                    points.push_back(ImVec2((float)(((double)(i - key.viewBegin) + 0.5) * scale), value));
+                }
+            }
+        }
+
+        // Min and max of the samples [begin, end): the complete buckets of the level, and the edges from the levels below.
+        void ReduceRange(
+            int      level,
+            uint64_t begin,
+            uint64_t end,
+            bool     isSimdEnabled,
+            float&   minValue,
+            float&   maxValue) const
+        {
+            while ((level > 0) && (begin < end))
+            {
+                const uint32_t shift = FanoutShift * (uint32_t)level;
+                uint64_t first = (begin + GetBucketSize(level) - 1) >> shift;
+                uint64_t last = ImMin(end >> shift, (uint64_t)GetBucketCount(level));
+                if (first < last)
+                {
+                    ReduceMinMax(GetMins(level) + first, GetMaxs(level) + first, (size_t)(last - first), isSimdEnabled,
+                                 minValue, maxValue);
+                    ReduceRange(level - 1, last << shift, end, isSimdEnabled, minValue, maxValue);
+                    end = first << shift;
+                }
+                level--;
+            }
+            if (begin < end)
+            {
+                ReduceMinMax(m_samples.data() + begin, m_samples.data() + begin, (size_t)(end - begin), isSimdEnabled,
+                             minValue, maxValue);
+            }
+        }
+
+        // Two points per column, min then max or max then min, so that neighbour columns join at their nearest ends.
+        void DownsampleMinMax(
+            const ResultKey&     key,
+            bool                 isSimdEnabled,
+            std::vector<ImVec2>& points) const
+        {
+            const uint64_t sampleCount = key.viewEnd - key.viewBegin;
+            const int level = GetLevelFor(sampleCount / (uint64_t)key.width);
+            points.reserve((size_t)key.width * 2);
+            for (int column = 0; column < key.width; column++)
+            {
+                uint64_t begin = key.viewBegin + sampleCount * (uint64_t)column / (uint64_t)key.width;
+                uint64_t end = key.viewBegin + sampleCount * (uint64_t)(column + 1) / (uint64_t)key.width;
+                float minValue = std::numeric_limits<float>::infinity();
+                float maxValue = -std::numeric_limits<float>::infinity();
+                ReduceRange(level, begin, end, isSimdEnabled, minValue, maxValue);
+                if (minValue > maxValue)
+                {
+                    continue; // Only NaN.
+                }
+
+                float x = (float)column + 0.5f;
+                bool isRising = (column & 1) == 0;
+                points.push_back(ImVec2(x, isRising ? minValue : maxValue));
+                points.push_back(ImVec2(x, isRising ? maxValue : minValue));
+            }
+        }
+
+        // LTTB over the min and max of the buckets of the level with at least 4 buckets per column, at the bucket centers,
+        // or over the samples when a column holds fewer than 32. Its input is a few points per column whatever the sample
+        // count.
+        void DownsampleLttb(
+            const ResultKey&     key,
+            std::vector<ImVec2>& points)
+        {
+            const uint64_t sampleCount = key.viewEnd - key.viewBegin;
+            const int level = GetLevelFor(sampleCount / ((uint64_t)key.width * 4));
+            const double scale = (double)key.width / (double)sampleCount;
+            std::vector<ImVec2>& candidates = m_candidates;
+            candidates.clear();
+
+            uint64_t sampleBegin = key.viewBegin;
+            if (level > 0)
+            {
+                uint64_t bucketSize = GetBucketSize(level);
+                uint64_t first = key.viewBegin / bucketSize;
+                uint64_t last = ImMin((key.viewEnd + bucketSize - 1) / bucketSize, (uint64_t)GetBucketCount(level));
+                const float* pMins = GetMins(level);
+                const float* pMaxs = GetMaxs(level);
+                for (uint64_t bucket = first; bucket < last; bucket++)
+                {
+                    if (pMins[bucket] <= pMaxs[bucket])
+                    {
+                        float x = (float)(((double)(bucket * bucketSize) + 0.5 * (double)bucketSize - (double)key.viewBegin) * scale);
+                        candidates.push_back(ImVec2(x, pMins[bucket]));
+                        candidates.push_back(ImVec2(x, pMaxs[bucket]));
+                    }
+                }
+                sampleBegin = ImMax(key.viewBegin, last * bucketSize); // The incomplete bucket at the end.
+            }
+            for (uint64_t i = sampleBegin; i < key.viewEnd; i++)
+            {
+                float value = m_samples[(size_t)i];
+                if (std::isnan(value) == false)
+                {
+                    candidates.push_back(ImVec2((float)(((double)(i - key.viewBegin) + 0.5) * scale), value));
+                }
+            }
+
+            const int pointCount = key.width;
+            const int candidateCount = (int)candidates.size();
+            if (candidateCount <= pointCount)
+            {
+                points = candidates;
+                return;
+            }
+            if (pointCount < 3)
+            {
+                points.push_back(candidates[0]);
+                points.push_back(candidates[candidateCount - 1]);
+                return;
+            }
+
+            // Each point is the candidate of its bucket making the largest triangle with the previous point and the average
+            // of the next bucket. The first and last candidates are kept.
+            points.reserve((size_t)pointCount);
+            points.push_back(candidates[0]);
+            const double bucketSize = (double)(candidateCount - 2) / (double)(pointCount - 2);
+            int selected = 0;
+            for (int i = 0; i < pointCount - 2; i++)
+            {
+                int begin = (int)(i * bucketSize) + 1;
+                int end = (int)((i + 1) * bucketSize) + 1;
+                int nextEnd = ImMin((int)((i + 2) * bucketSize) + 1, candidateCount);
+
+                float averageX = 0.f;
+                float averageY = 0.f;
+                for (int j = end; j < nextEnd; j++)
+                {
+                    averageX += candidates[j].x;
+                    averageY += candidates[j].y;
+                }
+                int nextCount = ImMax(nextEnd - end, 1);
+                averageX /= (float)nextCount;
+                averageY /= (float)nextCount;
+
+                const ImVec2& a = candidates[selected];
+                float maxArea = -1.f;
+                for (int j = begin; j < end; j++)
+                {
+                    float area = ImFabs((a.x - averageX) * (candidates[j].y - a.y) - (a.x - candidates[j].x) * (averageY - a.y));
+                    if (area > maxArea)
+                    {
+                        maxArea = area;
+                        selected = j;
+                    }
+                }
+                points.push_back(candidates[selected]);
+            }
+            points.push_back(candidates[candidateCount - 1]);
+        }
+
+        // The SIMD min and max skip NaN like the scalar loops: they return their second operand when one is NaN, and the
+        // accumulators never are.
+        static void ReduceMinMax(
+            const float* pMins,
+            const float* pMaxs,
+            size_t       count,
+            bool         isSimdEnabled,
+            float&       minValue,
+            float&       maxValue)
+        {
+            size_t i = 0;
+#if defined(CUSTOM_PLOT_AVX2)
+            if (isSimdEnabled && (count >= 8))
+            {
+                __m256 mins = _mm256_set1_ps(minValue);
+                __m256 maxs = _mm256_set1_ps(maxValue);
+                for (; i + 8 <= count; i += 8)
+                {
+                    mins = _mm256_min_ps(_mm256_loadu_ps(pMins + i), mins);
+                    maxs = _mm256_max_ps(_mm256_loadu_ps(pMaxs + i), maxs);
+                }
+                minValue = HorizontalMin(_mm_min_ps(_mm256_castps256_ps128(mins), _mm256_extractf128_ps(mins, 1)));
+                maxValue = HorizontalMax(_mm_max_ps(_mm256_castps256_ps128(maxs), _mm256_extractf128_ps(maxs, 1)));
+            }
+#elif defined(CUSTOM_PLOT_SSE2)
+            if (isSimdEnabled && (count >= 4))
+            {
+                __m128 mins = _mm_set1_ps(minValue);
+                __m128 maxs = _mm_set1_ps(maxValue);
+                for (; i + 4 <= count; i += 4)
+                {
+                    mins = _mm_min_ps(_mm_loadu_ps(pMins + i), mins);
+                    maxs = _mm_max_ps(_mm_loadu_ps(pMaxs + i), maxs);
+                }
+                minValue = HorizontalMin(mins);
+                maxValue = HorizontalMax(maxs);
+            }
+#else
+            (void)isSimdEnabled;
+#endif
+            for (; i < count; i++)
+            {
+                minValue = (pMins[i] < minValue) ? pMins[i] : minValue;
+                maxValue = (pMaxs[i] > maxValue) ? pMaxs[i] : maxValue;
+            }
+        }
+
+        // Min of each group of Fanout mins and max of each group of Fanout maxs, for the next level.
+        static void ReduceGroups(
+            const float* pMins,
+            const float* pMaxs,
+            size_t       groupCount,
+            bool         isSimdEnabled,
+            float*       pGroupMins,
+            float*       pGroupMaxs)
+        {
+            static_assert(Fanout == 8, "The SIMD paths reduce groups of 8.");
+            const float inf = std::numeric_limits<float>::infinity();
+#if defined(CUSTOM_PLOT_AVX2)
+            if (isSimdEnabled)
+            {
+                const __m256 posInf = _mm256_set1_ps(inf);
+                const __m256 negInf = _mm256_set1_ps(-inf);
+                for (size_t group = 0; group < groupCount; group++)
+                {
+                    __m256 mins = _mm256_min_ps(_mm256_loadu_ps(pMins + group * 8), posInf);
+                    __m256 maxs = _mm256_max_ps(_mm256_loadu_ps(pMaxs + group * 8), negInf);
+                    pGroupMins[group] = HorizontalMin(_mm_min_ps(_mm256_castps256_ps128(mins), _mm256_extractf128_ps(mins, 1)));
+                    pGroupMaxs[group] = HorizontalMax(_mm_max_ps(_mm256_castps256_ps128(maxs), _mm256_extractf128_ps(maxs, 1)));
+                }
+                return;
+            }
+#elif defined(CUSTOM_PLOT_SSE2)
+            if (isSimdEnabled)
+            {
+                const __m128 posInf = _mm_set1_ps(inf);
+                const __m128 negInf = _mm_set1_ps(-inf);
+                for (size_t group = 0; group < groupCount; group++)
+                {
+                    const float* pGroupMin = pMins + group * 8;
+                    const float* pGroupMax = pMaxs + group * 8;
+                    __m128 mins = _mm_min_ps(_mm_loadu_ps(pGroupMin + 4), _mm_min_ps(_mm_loadu_ps(pGroupMin), posInf));
+                    __m128 maxs = _mm_max_ps(_mm_loadu_ps(pGroupMax + 4), _mm_max_ps(_mm_loadu_ps(pGroupMax), negInf));
+                    pGroupMins[group] = HorizontalMin(mins);
+                    pGroupMaxs[group] = HorizontalMax(maxs);
+                }
+                return;
+            }
+#else
+            (void)isSimdEnabled;
+#endif
+            for (size_t group = 0; group < groupCount; group++)
+            {
+                float minValue = inf;
+                float maxValue = -inf;
+                for (size_t i = group * 8; i < group * 8 + 8; i++)
+                {
+                    minValue = (pMins[i] < minValue) ? pMins[i] : minValue;
+                    maxValue = (pMaxs[i] > maxValue) ? pMaxs[i] : maxValue;
+                }
+                pGroupMins[group] = minValue;
+                pGroupMaxs[group] = maxValue;
+            }
+        }
+
+#if defined(CUSTOM_PLOT_AVX2) || defined(CUSTOM_PLOT_SSE2)
+        static float HorizontalMin(__m128 values)
+        {
+            values = _mm_min_ps(values, _mm_movehl_ps(values, values));
+            values = _mm_min_ss(values, _mm_shuffle_ps(values, values, 1));
+            return _mm_cvtss_f32(values);
+        }
+
+        static float HorizontalMax(__m128 values)
+        {
+            values = _mm_max_ps(values, _mm_movehl_ps(values, values));
+            values = _mm_max_ss(values, _mm_shuffle_ps(values, values, 1));
+            return _mm_cvtss_f32(values);
+        }
+#endif
+
+        char* m_pWindowName;
+        ImU32 m_color;
+
+        // UI thread.
+        ImVector<ImVec2> m_drawPoints;
+        CustomPlotStats  m_stats;
+
+        std::mutex                     m_requestMutex;
+        Request                        m_request;
+        MpscQueue<std::vector<float>>  m_appended;
+
+        // Prepare only, except the result Emit reads.
+        std::vector<float>  m_samples;
+        std::vector<Level>  m_levels;     // Level 1 first.
+        std::vector<ImVec2> m_candidates; // LTTB input.
+        Result              m_results[2];
+        uint64_t            m_recomputeCount;
+        uint64_t            m_reuseCount;
+        double              m_lastAppendMs;
+        double              m_lastDownsampleMs;
+    };
+}
@@ -0,0 +1,1371 @@
+#pragma once
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "CustomDearImGuiDrawData.h"
+#include <cstdint>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#ifndef _WIN32
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Remote viewing of a Dear ImGui application. The draw data of every frame is encoded into a small binary message for a
+// viewer that draws it with its own renderer backend, and the viewer's input events come back the other way.
+// Both sides must use the same ImDrawVert and ImDrawIdx. The messages are little endian.
+namespace DearImGuiExt
+{
+    // First byte of every message.
+    enum RemoteMessageType : uint8_t
+    {
+        RemoteMessage_Invalid = 0,
+        RemoteMessage_Frame   = 1, // Application -> viewer. Draw data.
+        RemoteMessage_Texture = 2, // Application -> viewer. RGBA32 pixels of a texture, e.g. the font atlas.
+        RemoteMessage_Input   = 3, // Viewer -> application. Input events.
+    };
+
+    // Input events of a RemoteMessage_Input message.
+    enum RemoteInputEventType : uint8_t
+    {
+        RemoteInputEvent_MousePos    = 0,
+        RemoteInputEvent_MouseButton = 1,
+        RemoteInputEvent_MouseWheel  = 2,
+        RemoteInputEvent_Key         = 3,
+        RemoteInputEvent_Char        = 4,
+        RemoteInputEvent_Focus       = 5,
+    };
+
+    // Whether ImGuiIO::AddKeyEvent() takes the key from a backend: a named key that isn't a mouse alias or reserved for
+    // the mods, or a single ImGuiMod_ flag. Keys received from elsewhere must pass it before they are submitted.
+    inline bool IsRemoteInputKey(ImGuiKey key)
+    {
+        if ((key >= ImGuiKey_NamedKey_BEGIN) && (key < ImGuiKey_Aliases_BEGIN))
+        {
+            return true;
+        }
+        return (key == ImGuiMod_Ctrl) || (key == ImGuiMod_Shift) || (key == ImGuiMod_Alt) || (key == ImGuiMod_Super);
+    }
+
+    inline RemoteMessageType GetRemoteMessageType(
+        const unsigned char* pData,
+        size_t               size)
+    {
+        return (size > 0) ? (RemoteMessageType)pData[0] : RemoteMessage_Invalid;
+    }
+
+    // Appends little endian values to a message.
+    class RemoteWriter
+    {
+    public:
+        explicit RemoteWriter(ImVector<unsigned char>& buffer)
+            : m_buffer(buffer)
+        {}
+
+        void WriteU8(uint8_t value) { m_buffer.push_back(value); }
+
+        void WriteU32(uint32_t value)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                m_buffer.push_back((unsigned char)(value >> (8 * i)));
+            }
+        }
+
+        void WriteU64(uint64_t value)
+        {
+            WriteU32((uint32_t)value);
+            WriteU32((uint32_t)(value >> 32));
+        }
+
+        // 7 bits per byte, small values take a single byte.
+        void WriteVarU32(uint32_t value)
+        {
+            while (value >= 0x80)
+            {
+                m_buffer.push_back((unsigned char)(value | 0x80));
+                value >>= 7;
+            }
+            m_buffer.push_back((unsigned char)value);
+        }
+
+        void WriteFloat(float value)
+        {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            WriteU32(bits);
+        }
+
+        void WriteBytes(
+            const void* pData,
+            size_t      size)
+        {
+            int offset = m_buffer.Size;
+            m_buffer.resize(offset + (int)size);
+            if (size > 0)
+            {
+                memcpy(m_buffer.Data + offset, pData, size);
+            }
+        }
+
+        // Writes a buffer as the XOR with its previous version, zero extended: runs of unchanged bytes are skipped and only
+        // the changed bytes are written. An unchanged buffer takes 3 bytes, a new one is written almost as it is.
+        void WriteDelta(
+            const void* pCurrent,
+            int         currentSize,
+            const void* pPrevious,
+            int         previousSize)
+        {
+            const unsigned char* pCur = (const unsigned char*)pCurrent;
+            const unsigned char* pPrev = (const unsigned char*)pPrevious;
+            auto xorAt = [&](int i) { return (unsigned char)(pCur[i] ^ ((i < previousSize) ? pPrev[i] : 0)); };
+
+            WriteVarU32((uint32_t)currentSize);
+            int pos = 0;
+            while (pos < currentSize)
+            {
+                int skip = 0;
+                while ((pos + skip < currentSize) && (xorAt(pos + skip) == 0))
+                {
+                    skip++;
+                }
+
+                // A changed run ends before MinUnchangedRun unchanged bytes: fewer cost less as literals than as a skip.
+                int start = pos + skip;
+                int end = start;
+                int unchanged = 0;
+                while ((end + unchanged < currentSize) && (unchanged < MinUnchangedRun))
+                {
+                    if (xorAt(end + unchanged) == 0)
+                    {
+                        unchanged++;
+                    }
+                    else
+                    {
+                        end += unchanged + 1;
+                        unchanged = 0;
+                    }
+                }
+
+                WriteVarU32((uint32_t)skip);
+                WriteVarU32((uint32_t)(end - start));
+                for (int i = start; i < end; i++)
+                {
+                    m_buffer.push_back(xorAt(i));
+                }
+                pos = end;
+            }
+        }
+
+    private:
+        static constexpr int MinUnchangedRun = 4;
+
+        ImVector<unsigned char>& m_buffer;
+    };
+
+    // Reads what a RemoteWriter wrote. Reading past the end or a malformed delta makes the reader invalid and every later
+    // read returns 0.
+    class RemoteReader
+    {
+    public:
+        RemoteReader(
+            const unsigned char* pData,
+            size_t               size)
+            : m_pData(pData),
+              m_pEnd(pData + size),
+              m_isValid(true)
+        {}
+
+        bool   IsValid() const { return m_isValid; }
+        bool   IsAtEnd() const { return m_pData == m_pEnd; }
+        size_t GetRemainingSize() const { return (size_t)(m_pEnd - m_pData); }
+
+        // For callers that find a read value out of range.
+        void Invalidate() { m_isValid = false; }
+
+        uint8_t ReadU8()
+        {
+            if (Require(1) == false)
+            {
+                return 0;
+            }
+            return *m_pData++;
+        }
+
+        uint32_t ReadU32()
+        {
+            if (Require(4) == false)
+            {
+                return 0;
+            }
+            uint32_t value = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                value |= (uint32_t)(*m_pData++) << (8 * i);
+            }
+            return value;
+        }
+
+        uint64_t ReadU64()
+        {
+            uint64_t low = ReadU32();
+            uint64_t high = ReadU32();
+            return low | (high << 32);
+        }
+
+        uint32_t ReadVarU32()
+        {
+            uint32_t value = 0;
+            for (int shift = 0; shift < 35; shift += 7)
+            {
+                uint8_t byte = ReadU8();
+                value |= (uint32_t)(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+            m_isValid = false;
+            return 0;
+        }
+
+        float ReadFloat()
+        {
+            uint32_t bits = ReadU32();
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        bool ReadBytes(
+            void*  pData,
+            size_t size)
+        {
+            if (Require(size) == false)
+            {
+                return false;
+            }
+            memcpy(pData, m_pData, size);
+            m_pData += size;
+            return true;
+        }
+
+        // Applies a delta written by RemoteWriter::WriteDelta() to the previous version of the buffer.
+        template<typename T>
+        bool ReadDelta(ImVector<T>& buffer)
+        {
+            uint32_t byteSize = ReadVarU32();
+            if ((m_isValid == false) || (byteSize % sizeof(T) != 0) || (byteSize > MaxBufferBytes))
+            {
+                m_isValid = false;
+                return false;
+            }
+
+            int previousByteSize = buffer.size_in_bytes();
+            buffer.resize((int)(byteSize / sizeof(T)));
+            unsigned char* pBytes = (unsigned char*)buffer.Data;
+            if ((int)byteSize > previousByteSize)
+            {
+                memset(pBytes + previousByteSize, 0, byteSize - (uint32_t)previousByteSize);
+            }
+
+            uint32_t pos = 0;
+            while (pos < byteSize)
+            {
+                uint32_t skip = ReadVarU32();
+                uint32_t count = ReadVarU32();
+                if ((m_isValid == false) || (skip > byteSize - pos) || (count > byteSize - pos - skip) || (Require(count) == false))
+                {
+                    m_isValid = false;
+                    return false;
+                }
+
+                pos += skip;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    pBytes[pos + i] ^= m_pData[i];
+                }
+                m_pData += count;
+                pos += count;
+            }
+            return true;
+        }
+
+    private:
+        static constexpr uint32_t MaxBufferBytes = 1u << 30;
+
+        bool Require(size_t size)
+        {
+            if (m_isValid && ((size_t)(m_pEnd - m_pData) >= size))
+            {
+                return true;
+            }
+            m_isValid = false;
+            return false;
+        }
+
+        const unsigned char* m_pData;
+        const unsigned char* m_pEnd;
+        bool                 m_isValid;
+    };
+
+    // Per frame counters of a DrawDataEncoder.
+    struct DrawDataStreamStats
+    {
+        size_t rawBytes;     // Vertex, index and command bytes of the frame's draw lists.
+        size_t encodedBytes; // Size of the frame message.
+        int    listsSent;    // Lists sent as a delta against their previous version.
+        int    listsKept;    // Unchanged lists, sent as a reference.
+    };
+
+    // Application side. Every draw list gets an ID on the first frame it appears in and is then sent as the changes since the
+    // previous frame, or as its bare ID when it didn't change. The viewer must decode every message in order. Commands are
+    // sent without their callbacks, which can't run remotely. Texture IDs are sent as they are, see DrawDataDecoder.
+    class DrawDataEncoder
+    {
+    public:
+        DrawDataEncoder()
+            : m_frameIndex(0),
+              m_nextListId(1),
+              m_stats()
+        {}
+
+        ~DrawDataEncoder()
+        {
+            Reset();
+        }
+
+        // Replaces the content of 'message' with the frame message.
+        void EncodeFrame(
+            const ImDrawData*        pDrawData,
+            ImVector<unsigned char>& message)
+        {
+            assert((void("ERROR: The draw data cannot be NULL."), pDrawData != nullptr));
+            m_stats = DrawDataStreamStats();
+            message.resize(0);
+            RemoteWriter writer(message);
+            writer.WriteU8(RemoteMessage_Frame);
+            writer.WriteU8((uint8_t)sizeof(ImDrawVert));
+            writer.WriteU8((uint8_t)sizeof(ImDrawIdx));
+            writer.WriteVarU32(m_frameIndex++);
+            writer.WriteFloat(pDrawData->DisplayPos.x);
+            writer.WriteFloat(pDrawData->DisplayPos.y);
+            writer.WriteFloat(pDrawData->DisplaySize.x);
+            writer.WriteFloat(pDrawData->DisplaySize.y);
+            writer.WriteFloat(pDrawData->FramebufferScale.x);
+            writer.WriteFloat(pDrawData->FramebufferScale.y);
+            writer.WriteVarU32((uint32_t)pDrawData->CmdListsCount);
+
+            for (int i = 0; i < m_lists.Size; i++)
+            {
+                m_lists[i]->isSeen = false;
+            }
+
+            for (int i = 0; i < pDrawData->CmdListsCount; i++)
+            {
+                const ImDrawList* pList = pDrawData->CmdLists[i];
+                ImGuiID key = ImHashData(&pList, sizeof(pList));
+                ListState* pState = (ListState*)m_listIndex.GetVoidPtr(key);
+                bool isNew = (pState == nullptr);
+                if (isNew)
+                {
+                    pState = IM_NEW(ListState)();
+                    pState->key = key;
+                    pState->id = m_nextListId++;
+                    m_lists.push_back(pState);
+                    m_listIndex.SetVoidPtr(key, pState);
+                }
+                pState->isSeen = true;
+
+                WriteCommands(pList->CmdBuffer, m_cmds);
+                m_stats.rawBytes += (size_t)(pList->VtxBuffer.size_in_bytes() + pList->IdxBuffer.size_in_bytes() + m_cmds.Size);
+                writer.WriteVarU32(pState->id);
+                if ((isNew == false) && IsSame(pState->vtx, pList->VtxBuffer) && IsSame(pState->idx, pList->IdxBuffer) &&
+                    IsSame(pState->cmds, m_cmds))
+                {
+                    writer.WriteU8(ListKept);
+                    m_stats.listsKept++;
+                    continue;
+                }
+
+                writer.WriteU8(ListDelta);
+                writer.WriteDelta(pList->VtxBuffer.Data, pList->VtxBuffer.size_in_bytes(), pState->vtx.Data, pState->vtx.Size);
+                writer.WriteDelta(pList->IdxBuffer.Data, pList->IdxBuffer.size_in_bytes(), pState->idx.Data, pState->idx.Size);
+                writer.WriteDelta(m_cmds.Data, m_cmds.Size, pState->cmds.Data, pState->cmds.Size);
+                CopyBytes(pState->vtx, pList->VtxBuffer);
+                CopyBytes(pState->idx, pList->IdxBuffer);
+                CopyBytes(pState->cmds, m_cmds);
+                m_stats.listsSent++;
+            }
+
+            // The viewer drops the lists that aren't in the frame.
+            for (int i = 0; i < m_lists.Size;)
+            {
+                if (m_lists[i]->isSeen)
+                {
+                    i++;
+                    continue;
+                }
+                IM_DELETE(m_lists[i]);
+                m_lists.erase(m_lists.begin() + i);
+            }
+            if (m_listIndex.Data.Size != m_lists.Size)
+            {
+                m_listIndex.Data.resize(0);
+                for (int i = 0; i < m_lists.Size; i++)
+                {
+                    m_listIndex.Data.push_back(ImGuiStorage::ImGuiStoragePair(m_lists[i]->key, m_lists[i]));
+                }
+                m_listIndex.BuildSortByKey();
+            }
+
+            m_stats.encodedBytes = (size_t)message.Size;
+        }
+
+        // Replaces the content of 'message' with a texture message, e.g. for the pixels of ImFontAtlas::GetTexDataAsRGBA32().
+        // Send it again whenever the texture changes.
+        static void EncodeTexture(
+            ImTextureID              textureId,
+            const unsigned char*     pPixels,
+            int                      width,
+            int                      height,
+            ImVector<unsigned char>& message)
+        {
+            assert((void("ERROR: The pixels cannot be NULL."), pPixels != nullptr));
+            message.resize(0);
+            RemoteWriter writer(message);
+            writer.WriteU8(RemoteMessage_Texture);
+            writer.WriteU64((uint64_t)(intptr_t)textureId);
+            writer.WriteVarU32((uint32_t)width);
+            writer.WriteVarU32((uint32_t)height);
+            writer.WriteDelta(pPixels, width * height * 4, nullptr, 0);
+        }
+
+        // Forgets every list, so the next frame is sent whole. Call it for a new viewer.
+        void Reset()
+        {
+            for (int i = 0; i < m_lists.Size; i++)
+            {
+                IM_DELETE(m_lists[i]);
+            }
+            m_lists.resize(0);
+            m_listIndex.Data.resize(0);
+        }
+
+        const DrawDataStreamStats& GetStats() const { return m_stats; }
+
+    private:
+        DrawDataEncoder(const DrawDataEncoder&) = delete;
+        DrawDataEncoder& operator=(const DrawDataEncoder&) = delete;
+
+        // What the viewer has of a list, as bytes.
+        struct ListState
+        {
+            ImVector<unsigned char> vtx;
+            ImVector<unsigned char> idx;
+            ImVector<unsigned char> cmds;
+            ImGuiID                 key;
+            uint32_t                id;
+            bool                    isSeen;
+        };
+
+        // Commands as fixed size records, without their callbacks.
+        static void WriteCommands(
+            const ImVector<ImDrawCmd>& cmds,
+            ImVector<unsigned char>&   bytes)
+        {
+            bytes.resize(0);
+            RemoteWriter writer(bytes);
+            for (int i = 0; i < cmds.Size; i++)
+            {
+                const ImDrawCmd& cmd = cmds[i];
+                if (cmd.UserCallback || (cmd.ElemCount == 0))
+                {
+                    continue;
+                }
+                writer.WriteFloat(cmd.ClipRect.x);
+                writer.WriteFloat(cmd.ClipRect.y);
+                writer.WriteFloat(cmd.ClipRect.z);
+                writer.WriteFloat(cmd.ClipRect.w);
+                writer.WriteU64((uint64_t)(intptr_t)cmd.TextureId);
+                writer.WriteU32(cmd.VtxOffset);
+                writer.WriteU32(cmd.IdxOffset);
+                writer.WriteU32(cmd.ElemCount);
+            }
+        }
+
+        template<typename T>
+        static bool IsSame(
+            const ImVector<unsigned char>& bytes,
+            const ImVector<T>&             buffer)
+        {
+            return (bytes.Size == buffer.size_in_bytes()) && ((bytes.Size == 0) || (memcmp(bytes.Data, buffer.Data, (size_t)bytes.Size) == 0));
+        }
+
+        template<typename T>
+        static void CopyBytes(
+            ImVector<unsigned char>& bytes,
+            const ImVector<T>&       buffer)
+        {
+            bytes.resize(buffer.size_in_bytes());
+            if (bytes.Size > 0)
+            {
+                memcpy(bytes.Data, buffer.Data, (size_t)bytes.Size);
+            }
+        }
+
+        static constexpr uint8_t ListKept = 0;
+        static constexpr uint8_t ListDelta = 1;
+
+        ImVector<ListState*>    m_lists;
+        ImGuiStorage            m_listIndex; // Source list -> ListState.
+        ImVector<unsigned char> m_cmds;      // Records of the list being encoded.
+        uint32_t                m_frameIndex;
+        uint32_t                m_nextListId;
+        DrawDataStreamStats     m_stats;
+
+        friend class DrawDataDecoder;
+    };
+
+    // A texture received by a DrawDataDecoder.
+    struct RemoteTexture
+    {
+        uint64_t                remoteId; // ImTextureID on the application side.
+        ImTextureID             localId;  // ImTextureID given to the viewer's renderer. Set it in the texture callback.
+        int                     width;
+        int                     height;
+        ImVector<unsigned char> pixels;   // RGBA32.
+    };
+
+    // Called by DrawDataDecoder::Decode() when a texture was received, to upload it and set its localId.
+    typedef void (*RemoteTextureFunc)(RemoteTexture& texture, void* pUserData);
+
+    // Viewer side. Rebuilds the application's draw data from the messages of a DrawDataEncoder, keeping every list between
+    // frames to apply the next changes to. Textures without a local ID are drawn with the application's texture ID.
+    class DrawDataDecoder
+    {
+    public:
+        explicit DrawDataDecoder(ImDrawListSharedData* pSharedData = nullptr)
+            : m_pSharedData(pSharedData),
+              m_pfnTextureFunc(nullptr),
+              m_pTextureUserData(nullptr),
+              m_frameIndex(0)
+        {}
+
+        ~DrawDataDecoder()
+        {
+            Reset();
+        }
+
+        void SetTextureCallback(
+            RemoteTextureFunc func,
+            void*             pUserData)
+        {
+            m_pfnTextureFunc = func;
+            m_pTextureUserData = pUserData;
+        }
+
+        // Decodes a frame or a texture message. Returns false on a malformed message or on a frame that refers to lists it
+        // doesn't have, e.g. after a missed message: Reset() it and have the encoder Reset() too.
+        // A frame that fails leaves no draw data: it is invalid and empty until a frame decodes again.
+        bool Decode(
+            const unsigned char* pData,
+            size_t               size)
+        {
+            RemoteReader reader(pData, size);
+            RemoteMessageType type = (RemoteMessageType)reader.ReadU8();
+            if (type == RemoteMessage_Texture)
+            {
+                return DecodeTexture(reader);
+            }
+            if (type != RemoteMessage_Frame)
+            {
+                return false;
+            }
+
+            if (DecodeFrame(reader) == false)
+            {
+                // The lists may be half updated. The next frames can't be applied to them.
+                DestroyLists();
+                return false;
+            }
+            return true;
+        }
+
+        // The last decoded frame.
+        ImDrawData* GetDrawData() { return &m_drawData; }
+        uint32_t GetFrameIndex() const { return m_frameIndex; }
+
+        RemoteTexture* FindTexture(uint64_t remoteId)
+        {
+            for (int i = 0; i < m_textures.Size; i++)
+            {
+                if (m_textures[i]->remoteId == remoteId)
+                {
+                    return m_textures[i];
+                }
+            }
+            return nullptr;
+        }
+
+        // Forgets every list and texture.
+        void Reset()
+        {
+            DestroyLists();
+            for (int i = 0; i < m_textures.Size; i++)
+            {
+                IM_DELETE(m_textures[i]);
+            }
+            m_textures.resize(0);
+        }
+
+    private:
+        DrawDataDecoder(const DrawDataDecoder&) = delete;
+        DrawDataDecoder& operator=(const DrawDataDecoder&) = delete;
+
+        struct ListState
+        {
+            ImDrawList*             pList;
+            ImVector<unsigned char> cmds; // Command records, as sent.
+            uint32_t                id;
+            bool                    isSeen;
+        };
+
+        static constexpr int CmdRecordSize = 4 * 4 + 8 + 3 * 4;
+
+        bool DecodeFrame(RemoteReader& reader)
+        {
+            if ((reader.ReadU8() != sizeof(ImDrawVert)) || (reader.ReadU8() != sizeof(ImDrawIdx)))
+            {
+                return false;
+            }
+            m_frameIndex = reader.ReadVarU32();
+            m_drawData.DisplayPos.x       = reader.ReadFloat();
+            m_drawData.DisplayPos.y       = reader.ReadFloat();
+            m_drawData.DisplaySize.x      = reader.ReadFloat();
+            m_drawData.DisplaySize.y      = reader.ReadFloat();
+            m_drawData.FramebufferScale.x = reader.ReadFloat();
+            m_drawData.FramebufferScale.y = reader.ReadFloat();
+            uint32_t listCount = reader.ReadVarU32();
+
+            for (int i = 0; i < m_lists.Size; i++)
+            {
+                m_lists[i]->isSeen = false;
+            }
+
+            m_frameLists.resize(0);
+            m_drawData.TotalVtxCount = 0;
+            m_drawData.TotalIdxCount = 0;
+            for (uint32_t i = 0; (i < listCount) && reader.IsValid(); i++)
+            {
+                uint32_t id = reader.ReadVarU32();
+                uint8_t mode = reader.ReadU8();
+                ListState* pState = (ListState*)m_listIndex.GetVoidPtr(ImHashData(&id, sizeof(id)));
+                if (pState == nullptr)
+                {
+                    if (mode != DrawDataEncoder::ListDelta)
+                    {
+                        return false;
+                    }
+                    pState = IM_NEW(ListState)();
+                    pState->pList = IM_NEW(ImDrawList)(m_pSharedData);
+                    pState->id = id;
+                    m_lists.push_back(pState);
+                    m_listIndex.SetVoidPtr(ImHashData(&id, sizeof(id)), pState);
+                }
+                if (pState->isSeen)
+                {
+                    return false;
+                }
+                pState->isSeen = true;
+
+                if (mode == DrawDataEncoder::ListDelta)
+                {
+                    if ((reader.ReadDelta(pState->pList->VtxBuffer) == false) || (reader.ReadDelta(pState->pList->IdxBuffer) == false) ||
+                        (reader.ReadDelta(pState->cmds) == false) || (ReadCommands(pState) == false))
+                    {
+                        return false;
+                    }
+                }
+                else if (mode != DrawDataEncoder::ListKept)
+                {
+                    return false;
+                }
+
+                m_frameLists.push_back(pState->pList);
+                m_drawData.TotalVtxCount += pState->pList->VtxBuffer.Size;
+                m_drawData.TotalIdxCount += pState->pList->IdxBuffer.Size;
+            }
+            if ((reader.IsValid() == false) || (reader.IsAtEnd() == false))
+            {
+                return false;
+            }
+
+            for (int i = 0; i < m_lists.Size;)
+            {
+                if (m_lists[i]->isSeen)
+                {
+                    i++;
+                    continue;
+                }
+                DestroyList(m_lists[i]);
+                m_lists.erase(m_lists.begin() + i);
+            }
+            if (m_listIndex.Data.Size != m_lists.Size)
+            {
+                m_listIndex.Data.resize(0);
+                for (int i = 0; i < m_lists.Size; i++)
+                {
+                    m_listIndex.Data.push_back(ImGuiStorage::ImGuiStoragePair(ImHashData(&m_lists[i]->id, sizeof(uint32_t)), m_lists[i]));
+                }
+                m_listIndex.BuildSortByKey();
+            }
+
+            m_drawData.Valid = true;
+            SetDrawDataCmdLists(&m_drawData, m_frameLists);
+            return true;
+        }
+
+        // Also empties the draw data, which points into the lists.
+        void DestroyLists()
+        {
+            for (int i = 0; i < m_lists.Size; i++)
+            {
+                DestroyList(m_lists[i]);
+            }
+            m_lists.resize(0);
+            m_listIndex.Data.resize(0);
+            m_frameLists.resize(0);
+            SetDrawDataCmdLists(&m_drawData, m_frameLists);
+            m_drawData.Valid = false;
+            m_drawData.TotalVtxCount = 0;
+            m_drawData.TotalIdxCount = 0;
+        }
+
+        // Rebuilds the commands from their records and checks that they only reach the list's own vertices.
+        bool ReadCommands(ListState* pState)
+        {
+            if (pState->cmds.Size % CmdRecordSize != 0)
+            {
+                return false;
+            }
+
+            ImDrawList* pList = pState->pList;
+            pList->CmdBuffer.resize(0);
+            RemoteReader reader(pState->cmds.Data, (size_t)pState->cmds.Size);
+            while (reader.IsAtEnd() == false)
+            {
+                ImDrawCmd cmd;
+                cmd.ClipRect.x = reader.ReadFloat();
+                cmd.ClipRect.y = reader.ReadFloat();
+                cmd.ClipRect.z = reader.ReadFloat();
+                cmd.ClipRect.w = reader.ReadFloat();
+                uint64_t textureId = reader.ReadU64();
+                cmd.VtxOffset = reader.ReadU32();
+                cmd.IdxOffset = reader.ReadU32();
+                cmd.ElemCount = reader.ReadU32();
+                if (((uint64_t)cmd.IdxOffset + cmd.ElemCount > (uint64_t)pList->IdxBuffer.Size) ||
+                    (cmd.VtxOffset > (unsigned int)pList->VtxBuffer.Size))
+                {
+                    return false;
+                }
+                for (unsigned int i = 0; i < cmd.ElemCount; i++)
+                {
+                    if ((uint64_t)cmd.VtxOffset + pList->IdxBuffer[(int)(cmd.IdxOffset + i)] >= (uint64_t)pList->VtxBuffer.Size)
+                    {
+                        return false;
+                    }
+                }
+
+                RemoteTexture* pTexture = FindTexture(textureId);
+                cmd.TextureId = (pTexture && pTexture->localId) ? pTexture->localId : (ImTextureID)(intptr_t)textureId;
+                pList->CmdBuffer.push_back(cmd);
+            }
+            return reader.IsValid();
+        }
+
+        bool DecodeTexture(RemoteReader& reader)
+        {
+            uint64_t remoteId = reader.ReadU64();
+            uint32_t width = reader.ReadVarU32();
+            uint32_t height = reader.ReadVarU32();
+            if ((reader.IsValid() == false) || (width > 16384) || (height > 16384))
+            {
+                return false;
+            }
+
+            RemoteTexture* pTexture = FindTexture(remoteId);
+            if (pTexture == nullptr)
+            {
+                pTexture = IM_NEW(RemoteTexture)();
+                pTexture->remoteId = remoteId;
+                pTexture->localId = ImTextureID();
+                m_textures.push_back(pTexture);
+            }
+            pTexture->width = (int)width;
+            pTexture->height = (int)height;
+            pTexture->pixels.resize(0);
+            if ((reader.ReadDelta(pTexture->pixels) == false) || (pTexture->pixels.Size != (int)(width * height * 4)) ||
+                (reader.IsAtEnd() == false))
+            {
+                return false;
+            }
+
+            if (m_pfnTextureFunc)
+            {
+                m_pfnTextureFunc(*pTexture, m_pTextureUserData);
+            }
+
+            // Unchanged lists aren't sent again, so their commands pick up the new local ID here.
+            for (int i = 0; i < m_lists.Size; i++)
+            {
+                ReadCommands(m_lists[i]);
+            }
+            return true;
+        }
+
+        static void DestroyList(ListState* pState)
+        {
+            IM_DELETE(pState->pList);
+            IM_DELETE(pState);
+        }
+
+        ImDrawListSharedData*    m_pSharedData;
+        ImVector<ListState*>     m_lists;
+        ImGuiStorage             m_listIndex;  // List ID -> ListState.
+        ImVector<ImDrawList*>    m_frameLists; // Lists of the last frame, in draw order.
+        ImVector<RemoteTexture*> m_textures;
+        RemoteTextureFunc        m_pfnTextureFunc;
+        void*                    m_pTextureUserData;
+        ImDrawData               m_drawData;
+        uint32_t                 m_frameIndex;
+    };
+
+    // Viewer side. Collects input events with the same calls as ImGuiIO, to send them to the application.
+    class RemoteInputEncoder
+    {
+    public:
+        RemoteInputEncoder()
+            : m_eventCount(0)
+        {}
+
+        void AddMousePosEvent(float x, float y)
+        {
+            RemoteWriter writer(m_events);
+            writer.WriteU8(RemoteInputEvent_MousePos);
+            writer.WriteFloat(x);
+            writer.WriteFloat(y);
+            m_eventCount++;
+        }
+
+        void AddMouseButtonEvent(int button, bool down)
+        {
+            RemoteWriter writer(m_events);
+            writer.WriteU8(RemoteInputEvent_MouseButton);
+            writer.WriteU8((uint8_t)button);
+            writer.WriteU8(down ? 1 : 0);
+            m_eventCount++;
+        }
+
+        void AddMouseWheelEvent(float x, float y)
+        {
+            RemoteWriter writer(m_events);
+            writer.WriteU8(RemoteInputEvent_MouseWheel);
+            writer.WriteFloat(x);
+            writer.WriteFloat(y);
+            m_eventCount++;
+        }
+
+        void AddKeyEvent(ImGuiKey key, bool down)
+        {
+            RemoteWriter writer(m_events);
+            writer.WriteU8(RemoteInputEvent_Key);
+            writer.WriteVarU32((uint32_t)key);
+            writer.WriteU8(down ? 1 : 0);
+            m_eventCount++;
+        }
+
+        void AddInputCharacter(unsigned int c)
+        {
+            RemoteWriter writer(m_events);
+            writer.WriteU8(RemoteInputEvent_Char);
+            writer.WriteVarU32(c);
+            m_eventCount++;
+        }
+
+        void AddFocusEvent(bool focused)
+        {
+            RemoteWriter writer(m_events);
+            writer.WriteU8(RemoteInputEvent_Focus);
+            writer.WriteU8(focused ? 1 : 0);
+            m_eventCount++;
+        }
+
+        // Replaces the content of 'message' with the events collected since the last call. Returns false without events.
+        bool Flush(ImVector<unsigned char>& message)
+        {
+            if (m_eventCount == 0)
+            {
+                return false;
+            }
+
+            message.resize(0);
+            RemoteWriter writer(message);
+            writer.WriteU8(RemoteMessage_Input);
+            writer.WriteVarU32((uint32_t)m_eventCount);
+            writer.WriteBytes(m_events.Data, (size_t)m_events.Size);
+            m_events.resize(0);
+            m_eventCount = 0;
+            return true;
+        }
+
+    private:
+        ImVector<unsigned char> m_events;
+        int                     m_eventCount;
+    };
+
+    // Application side. Queues the events of a RemoteInputEncoder message in the IO, before ImGui::NewFrame().
+    // Returns false on a malformed message. The events before the malformed one are applied.
+    inline bool ApplyRemoteInput(
+        const unsigned char* pData,
+        size_t               size,
+        ImGuiIO&             io)
+    {
+        RemoteReader reader(pData, size);
+        if (reader.ReadU8() != RemoteMessage_Input)
+        {
+            return false;
+        }
+
+        uint32_t eventCount = reader.ReadVarU32();
+        for (uint32_t i = 0; (i < eventCount) && reader.IsValid(); i++)
+        {
+            switch (reader.ReadU8())
+            {
+            case RemoteInputEvent_MousePos:
+            {
+                float x = reader.ReadFloat();
+                float y = reader.ReadFloat();
+                if (reader.IsValid())
+                {
+                    io.AddMousePosEvent(x, y);
+                }
+                break;
+            }
+            case RemoteInputEvent_MouseButton:
+            {
+                int button = reader.ReadU8();
+                bool down = reader.ReadU8() != 0;
+                if (reader.IsValid() && (button < ImGuiMouseButton_COUNT))
+                {
+                    io.AddMouseButtonEvent(button, down);
+                }
+                break;
+            }
+            case RemoteInputEvent_MouseWheel:
+            {
+                float x = reader.ReadFloat();
+                float y = reader.ReadFloat();
+                if (reader.IsValid())
+                {
+                    io.AddMouseWheelEvent(x, y);
+                }
+                break;
+            }
+            case RemoteInputEvent_Key:
+            {
+                ImGuiKey key = (ImGuiKey)reader.ReadVarU32();
+                bool down = reader.ReadU8() != 0;
+                if (reader.IsValid() && IsRemoteInputKey(key))
+                {
+                    io.AddKeyEvent(key, down);
+                }
+                break;
+            }
+            case RemoteInputEvent_Char:
+            {
+                unsigned int c = reader.ReadVarU32();
+                if (reader.IsValid())
+                {
+                    io.AddInputCharacter(c);
+                }
+                break;
+            }
+            case RemoteInputEvent_Focus:
+            {
+                bool focused = reader.ReadU8() != 0;
+                if (reader.IsValid())
+                {
+                    io.AddFocusEvent(focused);
+                }
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return reader.IsValid() && reader.IsAtEnd();
+    }
+
+#ifndef _WIN32
+    // A connected stream socket, TCP or Unix domain, carrying messages prefixed with their 32-bit length. POSIX only.
+    class RemoteConnection
+    {
+    public:
+        RemoteConnection()
+            : m_socket(-1),
+              m_readOffset(0)
+        {}
+
+        ~RemoteConnection()
+        {
+            Close();
+        }
+
+        bool ConnectTcp(
+            const char* pHost,
+            uint16_t    port)
+        {
+            Close();
+            char service[8];
+            snprintf(service, sizeof(service), "%u", (unsigned int)port);
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* pAddresses = nullptr;
+            if (getaddrinfo(pHost, service, &hints, &pAddresses) != 0)
+            {
+                return false;
+            }
+
+            for (addrinfo* pAddress = pAddresses; pAddress && (m_socket < 0); pAddress = pAddress->ai_next)
+            {
+                int sock = socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+                if (sock < 0)
+                {
+                    continue;
+                }
+                if (connect(sock, pAddress->ai_addr, pAddress->ai_addrlen) == 0)
+                {
+                    Adopt(sock, true);
+                }
+                else
+                {
+                    close(sock);
+                }
+            }
+            freeaddrinfo(pAddresses);
+            return m_socket >= 0;
+        }
+
+        bool ConnectUnix(const char* pPath)
+        {
+            Close();
+            sockaddr_un address = {};
+            if (MakeUnixAddress(pPath, address) == false)
+            {
+                return false;
+            }
+
+            int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (sock < 0)
+            {
+                return false;
+            }
+            if (connect(sock, (const sockaddr*)&address, sizeof(address)) != 0)
+            {
+                close(sock);
+                return false;
+            }
+            Adopt(sock, false);
+            return true;
+        }
+
+        bool IsOpen() const { return m_socket >= 0; }
+
+        void Close()
+        {
+            if (m_socket >= 0)
+            {
+                close(m_socket);
+                m_socket = -1;
+            }
+            m_received.resize(0);
+            m_readOffset = 0;
+        }
+
+        // Blocks until the whole message is sent. Returns false and closes the connection on failure.
+        bool Send(const ImVector<unsigned char>& message)
+        {
+            if (m_socket < 0)
+            {
+                return false;
+            }
+
+            // One send for the length and the message, so small messages go out as one packet.
+            m_sending.resize(0);
+            RemoteWriter writer(m_sending);
+            writer.WriteU32((uint32_t)message.Size);
+            writer.WriteBytes(message.Data, (size_t)message.Size);
+
+            int offset = 0;
+            while (offset < m_sending.Size)
+            {
+                ssize_t sent = send(m_socket, m_sending.Data + offset, (size_t)(m_sending.Size - offset), SendFlags);
+                if (sent > 0)
+                {
+                    offset += (int)sent;
+                }
+                else if ((sent < 0) && (errno == EINTR))
+                {
+                    continue;
+                }
+                else
+                {
+                    Close();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Returns 1 when a message was received, 0 when wait is false and no whole message is there yet, and -1 when the
+        // connection was closed or failed.
+        int Receive(
+            ImVector<unsigned char>& message,
+            bool                     wait)
+        {
+            while (m_socket >= 0)
+            {
+                int available = m_received.Size - m_readOffset;
+                if (available >= 4)
+                {
+                    RemoteReader reader(m_received.Data + m_readOffset, 4);
+                    uint32_t size = reader.ReadU32();
+                    if (size > MaxMessageBytes)
+                    {
+                        Close();
+                        return -1;
+                    }
+                    if ((uint32_t)available - 4 >= size)
+                    {
+                        message.resize((int)size);
+                        if (size > 0)
+                        {
+                            memcpy(message.Data, m_received.Data + m_readOffset + 4, size);
+                        }
+                        m_readOffset += 4 + (int)size;
+                        return 1;
+                    }
+                }
+
+                // Moves the partial message to the front before reading more.
+                if (m_readOffset > 0)
+                {
+                    if (available > 0)
+                    {
+                        memmove(m_received.Data, m_received.Data + m_readOffset, (size_t)available);
+                    }
+                    m_received.resize(available);
+                    m_readOffset = 0;
+                }
+
+                int size = m_received.Size;
+                m_received.resize(size + ReceiveChunkBytes);
+                ssize_t received = recv(m_socket, m_received.Data + size, ReceiveChunkBytes, wait ? 0 : MSG_DONTWAIT);
+                m_received.resize(size + ImMax((int)received, 0));
+                if (received > 0)
+                {
+                    continue;
+                }
+                if ((received < 0) && (errno == EINTR))
+                {
+                    continue;
+                }
+                if ((received < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+                {
+                    return 0;
+                }
+                Close();
+            }
+            return -1;
+        }
+
+    private:
+        RemoteConnection(const RemoteConnection&) = delete;
+        RemoteConnection& operator=(const RemoteConnection&) = delete;
+
+        friend class RemoteListener;
+
+#ifdef MSG_NOSIGNAL
+        static constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+        static constexpr int SendFlags = 0;
+#endif
+        static constexpr int      ReceiveChunkBytes = 64 * 1024;
+        static constexpr uint32_t MaxMessageBytes = 1u << 30;
+
+        static bool MakeUnixAddress(
+            const char*  pPath,
+            sockaddr_un& address)
+        {
+            if (strlen(pPath) >= sizeof(address.sun_path))
+            {
+                return false;
+            }
+            address.sun_family = AF_UNIX;
+            strcpy(address.sun_path, pPath);
+            return true;
+        }
+
+        // Frames are sent as soon as they are encoded, so Nagle's algorithm would only add latency.
+        void Adopt(int sock, bool isTcp)
+        {
+            int one = 1;
+            if (isTcp)
+            {
+                setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+#ifdef SO_NOSIGPIPE
+            setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+            m_socket = sock;
+        }
+
+        int                     m_socket;
+        ImVector<unsigned char> m_received;   // Bytes received but not returned yet, from m_readOffset.
+        int                     m_readOffset;
+        ImVector<unsigned char> m_sending;
+    };
+
+    // Waits for viewers on a TCP port or a Unix domain socket. POSIX only.
+    class RemoteListener
+    {
+    public:
+        RemoteListener()
+            : m_socket(-1),
+              m_port(0),
+              m_isTcp(false)
+        {
+            m_path[0] = '\0';
+        }
+
+        ~RemoteListener()
+        {
+            Close();
+        }
+
+        // Port 0 picks a free port, see GetPort(). Listens on the loopback interface only unless isPublic is true.
+        bool ListenTcp(
+            uint16_t port,
+            bool     isPublic = false)
+        {
+            Close();
+            int sock = socket(AF_INET, SOCK_STREAM, 0);
+            if (sock < 0)
+            {
+                return false;
+            }
+            int one = 1;
+            setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(isPublic ? INADDR_ANY : INADDR_LOOPBACK);
+            socklen_t length = sizeof(address);
+            if ((bind(sock, (const sockaddr*)&address, sizeof(address)) != 0) || (listen(sock, 1) != 0) ||
+                (getsockname(sock, (sockaddr*)&address, &length) != 0))
+            {
+                close(sock);
+                return false;
+            }
+            m_socket = sock;
+            m_port = ntohs(address.sin_port);
+            m_isTcp = true;
+            return true;
+        }
+
+        // Replaces a socket file left at the path.
+        bool ListenUnix(const char* pPath)
+        {
+            Close();
+            sockaddr_un address = {};
+            if (RemoteConnection::MakeUnixAddress(pPath, address) == false)
+            {
+                return false;
+            }
+
+            int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (sock < 0)
+            {
+                return false;
+            }
+            unlink(pPath);
+            if ((bind(sock, (const sockaddr*)&address, sizeof(address)) != 0) || (listen(sock, 1) != 0))
+            {
+                close(sock);
+                return false;
+            }
+            m_socket = sock;
+            strcpy(m_path, address.sun_path);
+            m_isTcp = false;
+            return true;
+        }
+
+        uint16_t GetPort() const { return m_port; }
+
+        // Blocks until a viewer connects.
+        bool Accept(RemoteConnection& connection)
+        {
+            if (m_socket < 0)
+            {
+                return false;
+            }
+
+            int sock = -1;
+            do
+            {
+                sock = accept(m_socket, nullptr, nullptr);
+            } while ((sock < 0) && (errno == EINTR));
+            if (sock < 0)
+            {
+                return false;
+            }
+
+            connection.Close();
+            connection.Adopt(sock, m_isTcp);
+            return true;
+        }
+
+        void Close()
+        {
+            if (m_socket >= 0)
+            {
+                close(m_socket);
+                m_socket = -1;
+            }
+            if (m_path[0] != '\0')
+            {
+                unlink(m_path);
+                m_path[0] = '\0';
+            }
+            m_port = 0;
+        }
+
+    private:
+        RemoteListener(const RemoteListener&) = delete;
+        RemoteListener& operator=(const RemoteListener&) = delete;
+
+        int         m_socket;
+        uint16_t    m_port;
+        bool        m_isTcp;
+        char        m_path[sizeof(sockaddr_un::sun_path)]; // Unix domain socket file, removed on Close().
+    };
+#endif
+}
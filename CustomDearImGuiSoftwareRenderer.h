@@ -0,0 +1,800 @@
+#pragma once
+#include "imgui.h"
+#include "imgui_internal.h"
+#include "CustomDearImGuiJobSystem.h"
+#include <cstdint>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#if !defined(CUSTOM_SOFTWARE_RENDERER_SCALAR) && defined(__AVX2__)
+#define CUSTOM_SOFTWARE_RENDERER_AVX2
+#include <immintrin.h>
+#elif !defined(CUSTOM_SOFTWARE_RENDERER_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define CUSTOM_SOFTWARE_RENDERER_SSE2
+#include <emmintrin.h>
+#endif
+
+// A CPU renderer for Dear ImGui draw data, for machines without a GPU: screenshots, remote viewers, visual tests.
+// Textured, clipped triangles are drawn into an RGBA32 buffer with the alpha blending of the GPU backends. The buffer is
+// cut into tiles that are drawn in parallel on a JobSystem, 8 pixels at a time with AVX2, 4 with SSE2, or 1 without.
+// Define CUSTOM_SOFTWARE_RENDERER_SCALAR to build without SIMD.
+namespace DearImGuiExt
+{
+    // Counters of the last SoftwareRenderer::Render().
+    struct SoftwareRenderStats
+    {
+        int primitives;       // Triangles and rects left after clipping.
+        int rects;            // Quads drawn as one axis aligned rect, e.g. glyphs and filled rects.
+        int binnedPrimitives; // Primitives drawn by a tile, counted once per tile.
+        int tiles;            // Tiles with at least one primitive.
+    };
+
+    class SoftwareRenderer
+    {
+    public:
+        static constexpr int TileSize = 64;
+
+        // Without a job system the tiles are drawn on the calling thread.
+        explicit SoftwareRenderer(JobSystem* pJobSystem = nullptr)
+            : m_pJobSystem(pJobSystem),
+              m_width(0),
+              m_height(0),
+              m_pitch(0),
+              m_tileCountX(0),
+              m_tileCountY(0),
+              m_clearColor(0),
+              m_isSimdEnabled(true),
+              m_stats()
+        {}
+
+        // Name of the instruction set used when SIMD is enabled.
+        static const char* GetSimdName()
+        {
+#if defined(CUSTOM_SOFTWARE_RENDERER_AVX2)
+            return "AVX2";
+#elif defined(CUSTOM_SOFTWARE_RENDERER_SSE2)
+            return "SSE2";
+#else
+            return "scalar";
+#endif
+        }
+
+        // Turns the SIMD path off to compare with the scalar one. Both draw the same pixels unless the compiler contracts
+        // the scalar multiply-adds into FMAs.
+        void SetSimdEnabled(bool isEnabled) { m_isSimdEnabled = isEnabled; }
+
+        // Registers the RGBA32 pixels of a texture, e.g. from ImFontAtlas::GetTexDataAsRGBA32(). They aren't copied and
+        // must stay alive while rendering. Commands with an unknown texture ID sample white.
+        void SetTexture(
+            ImTextureID          textureId,
+            const unsigned char* pPixels,
+            int                  width,
+            int                  height)
+        {
+            assert((void("ERROR: The texture pixels cannot be NULL."), pPixels != nullptr));
+            assert((void("ERROR: The texture cannot be empty."), (width > 0) && (height > 0)));
+            Texture* pTexture = FindTexture(textureId);
+            if (pTexture == nullptr)
+            {
+                m_textures.push_back(Texture());
+                pTexture = &m_textures.back();
+                pTexture->textureId = textureId;
+            }
+            pTexture->pTexels = (const uint32_t*)pPixels;
+            pTexture->width = width;
+            pTexture->height = height;
+        }
+
+        void Resize(
+            int width,
+            int height)
+        {
+            assert((void("ERROR: The size cannot be negative."), (width >= 0) && (height >= 0)));
+            m_width = width;
+            m_height = height;
+            m_tileCountX = (width + TileSize - 1) / TileSize;
+            m_tileCountY = (height + TileSize - 1) / TileSize;
+            m_pitch = m_tileCountX * TileSize;
+            m_pixels.resize(m_pitch * height);
+        }
+
+        // Clears the buffer and draws the draw data. Its framebuffer scale applies, as with the GPU backends.
+        // Callbacks are skipped, there is no render state to reset and no GPU to run user callbacks on.
+        void Render(
+            const ImDrawData* pDrawData,
+            ImU32             clearColor = IM_COL32(0, 0, 0, 255))
+        {
+            assert((void("ERROR: The draw data cannot be NULL."), pDrawData != nullptr));
+            m_clearColor = clearColor;
+            m_stats = SoftwareRenderStats();
+            SetupTriangles(pDrawData);
+            BinTriangles();
+
+            int tileCount = m_tileCountX * m_tileCountY;
+            if ((m_pJobSystem == nullptr) || (tileCount <= 1))
+            {
+                for (int tile = 0; tile < tileCount; tile++)
+                {
+                    DrawTile(tile);
+                }
+                return;
+            }
+
+            m_tileJobs.resize(tileCount);
+            JobCounter counter;
+            for (int tile = 0; tile < tileCount; tile++)
+            {
+                m_tileJobs[tile].pRenderer = this;
+                m_tileJobs[tile].tile = tile;
+                m_pJobSystem->Submit(DrawTileJob, &m_tileJobs[tile], &counter);
+            }
+            m_pJobSystem->Wait(&counter);
+        }
+
+        // RGBA32 pixels in IM_COL32 layout, GetPitch() pixels per row.
+        const uint32_t* GetPixels() const { return m_pixels.Data; }
+        int GetWidth() const { return m_width; }
+        int GetHeight() const { return m_height; }
+        int GetPitch() const { return m_pitch; }
+
+        const SoftwareRenderStats& GetStats() const { return m_stats; }
+
+    private:
+        SoftwareRenderer(const SoftwareRenderer&) = delete;
+        SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+        struct Texture
+        {
+            ImTextureID     textureId;
+            const uint32_t* pTexels;
+            int             width;
+            int             height;
+        };
+
+        enum AttributeIndex
+        {
+            Attribute_U,
+            Attribute_V,
+            Attribute_R,
+            Attribute_G,
+            Attribute_B,
+            Attribute_A,
+            Attribute_COUNT
+        };
+
+        // Edge functions and attributes are planes relative to the first vertex: value = dx * (x - x0) + dy * (y - y0) + value0.
+        // The pixels whose center has every edge function positive are drawn, or zero on a top or left edge.
+        struct Triangle
+        {
+            float           originX;
+            float           originY;
+            float           edgeDx[3];
+            float           edgeDy[3];
+            float           edgeAtOrigin[3];
+            uint32_t        isTopLeft[3]; // All bits set for a top or left edge.
+            float           attributeDx[Attribute_COUNT];
+            float           attributeDy[Attribute_COUNT];
+            float           attributeAtOrigin[Attribute_COUNT];
+            int             minX;         // Bounding box clipped to the scissor rect, max excluded.
+            int             minY;
+            int             maxX;
+            int             maxY;
+            const Texture*  pTexture;     // nullptr samples white.
+            bool            isRect;       // Axis aligned quad, the bounding box is the coverage and there are no edges.
+            bool            isSolid;      // Same color and texel everywhere, multiplied together in solidColor.
+            bool            isFlatColor;  // Same vertex color everywhere, e.g. text. Only the texture coordinates vary.
+            float           solidColor[4];
+        };
+
+        struct TileJob
+        {
+            SoftwareRenderer* pRenderer;
+            int               tile;
+        };
+
+        Texture* FindTexture(ImTextureID textureId)
+        {
+            for (int i = 0; i < m_textures.Size; i++)
+            {
+                if (m_textures[i].textureId == textureId)
+                {
+                    return &m_textures[i];
+                }
+            }
+            return nullptr;
+        }
+
+        static float Channel(ImU32 color, int shift)
+        {
+            return (float)((color >> shift) & 0xFF);
+        }
+
+        static ImU32 Texel(
+            const Texture* pTexture,
+            float          u,
+            float          v)
+        {
+            return pTexture ? ScalarLanes::Fetch(pTexture->pTexels, pTexture->width, pTexture->height, u, v) : 0xFFFFFFFF;
+        }
+
+        void SetupTriangles(const ImDrawData* pDrawData)
+        {
+            m_triangles.resize(0);
+            ImVec2 offset = pDrawData->DisplayPos;
+            ImVec2 scale = pDrawData->FramebufferScale;
+            for (int n = 0; n < pDrawData->CmdListsCount; n++)
+            {
+                const ImDrawList* pList = pDrawData->CmdLists[n];
+                for (const ImDrawCmd& cmd : pList->CmdBuffer)
+                {
+                    if (cmd.UserCallback)
+                    {
+                        continue;
+                    }
+
+                    // Same scissor rect as the Vulkan backend.
+                    float clipMinX = ImMax((cmd.ClipRect.x - offset.x) * scale.x, 0.f);
+                    float clipMinY = ImMax((cmd.ClipRect.y - offset.y) * scale.y, 0.f);
+                    float clipMaxX = ImMin((cmd.ClipRect.z - offset.x) * scale.x, (float)m_width);
+                    float clipMaxY = ImMin((cmd.ClipRect.w - offset.y) * scale.y, (float)m_height);
+                    if ((clipMaxX <= clipMinX) || (clipMaxY <= clipMinY))
+                    {
+                        continue;
+                    }
+                    int scissorMinX = (int)clipMinX;
+                    int scissorMinY = (int)clipMinY;
+                    int scissorMaxX = scissorMinX + (int)(clipMaxX - clipMinX);
+                    int scissorMaxY = scissorMinY + (int)(clipMaxY - clipMinY);
+
+                    const Texture* pTexture = FindTexture(cmd.TextureId);
+                    for (unsigned int i = 0; i + 2 < cmd.ElemCount; i += 3)
+                    {
+                        const ImDrawIdx* pIndices = pList->IdxBuffer.Data + cmd.IdxOffset + i;
+                        const ImDrawVert* pVertices[3] = { &pList->VtxBuffer[(int)(cmd.VtxOffset + pIndices[0])],
+                                                           &pList->VtxBuffer[(int)(cmd.VtxOffset + pIndices[1])],
+                                                           &pList->VtxBuffer[(int)(cmd.VtxOffset + pIndices[2])] };
+
+                        // The two triangles of a quad, as emitted by ImDrawList::PrimRectUV().
+                        bool isRect = (i + 5 < cmd.ElemCount) && (pIndices[3] == pIndices[0]) && (pIndices[4] == pIndices[2]) &&
+                                      IsRect(pVertices, &pList->VtxBuffer[(int)(cmd.VtxOffset + pIndices[5])]);
+                        AddTriangle(pVertices, offset, scale, scissorMinX, scissorMinY, scissorMaxX, scissorMaxY, pTexture, isRect);
+                        i += isRect ? 3 : 0;
+                    }
+                }
+            }
+            m_stats.primitives = m_triangles.Size;
+        }
+
+        // The quad is axis aligned and its attributes fit one plane, so the plane of its first triangle holds everywhere.
+        static bool IsRect(
+            const ImDrawVert* pVertices[3],
+            const ImDrawVert* pFourth)
+        {
+            ImVec2 p0 = pVertices[0]->pos;
+            ImVec2 p1 = pVertices[1]->pos;
+            ImVec2 p2 = pVertices[2]->pos;
+            ImVec2 p3 = pFourth->pos;
+            bool isAligned = ((p0.y == p1.y) && (p1.x == p2.x) && (p2.y == p3.y) && (p3.x == p0.x)) ||
+                             ((p0.x == p1.x) && (p1.y == p2.y) && (p2.x == p3.x) && (p3.y == p0.y));
+            if ((isAligned == false) ||
+                (pVertices[0]->uv.x + pVertices[2]->uv.x != pVertices[1]->uv.x + pFourth->uv.x) ||
+                (pVertices[0]->uv.y + pVertices[2]->uv.y != pVertices[1]->uv.y + pFourth->uv.y))
+            {
+                return false;
+            }
+
+            const int shifts[] = { IM_COL32_R_SHIFT, IM_COL32_G_SHIFT, IM_COL32_B_SHIFT, IM_COL32_A_SHIFT };
+            for (int shift : shifts)
+            {
+                if (Channel(pVertices[0]->col, shift) + Channel(pVertices[2]->col, shift) !=
+                    Channel(pVertices[1]->col, shift) + Channel(pFourth->col, shift))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void AddTriangle(
+            const ImDrawVert* pVertices[3],
+            ImVec2            offset,
+            ImVec2            scale,
+            int               scissorMinX,
+            int               scissorMinY,
+            int               scissorMaxX,
+            int               scissorMaxY,
+            const Texture*    pTexture,
+            bool              isRect)
+        {
+            ImVec2 positions[3];
+            for (int k = 0; k < 3; k++)
+            {
+                positions[k] = ImVec2((pVertices[k]->pos.x - offset.x) * scale.x, (pVertices[k]->pos.y - offset.y) * scale.y);
+            }
+
+            // Dear ImGui uses both windings. The vertices are ordered so that the inside is on the positive side of the edges.
+            float area = (positions[1].x - positions[0].x) * (positions[2].y - positions[0].y) -
+                         (positions[2].x - positions[0].x) * (positions[1].y - positions[0].y);
+            if ((area > 0.f) == false)
+            {
+                if ((area < 0.f) == false)
+                {
+                    return;
+                }
+                ImSwap(positions[1], positions[2]);
+                ImSwap(pVertices[1], pVertices[2]);
+                area = -area;
+            }
+
+            // A rect covers the pixels whose center is inside, or on its top or left edge.
+            float boundsMinX = ImMin(positions[0].x, ImMin(positions[1].x, positions[2].x));
+            float boundsMinY = ImMin(positions[0].y, ImMin(positions[1].y, positions[2].y));
+            float boundsMaxX = ImMax(positions[0].x, ImMax(positions[1].x, positions[2].x));
+            float boundsMaxY = ImMax(positions[0].y, ImMax(positions[1].y, positions[2].y));
+            int minX = ImMax(isRect ? (int)ceilf(boundsMinX - 0.5f) : (int)floorf(boundsMinX), scissorMinX);
+            int minY = ImMax(isRect ? (int)ceilf(boundsMinY - 0.5f) : (int)floorf(boundsMinY), scissorMinY);
+            int maxX = ImMin(isRect ? (int)ceilf(boundsMaxX - 0.5f) : (int)ceilf(boundsMaxX), scissorMaxX);
+            int maxY = ImMin(isRect ? (int)ceilf(boundsMaxY - 0.5f) : (int)ceilf(boundsMaxY), scissorMaxY);
+            if ((minX >= maxX) || (minY >= maxY))
+            {
+                return;
+            }
+
+            m_triangles.push_back(Triangle());
+            Triangle& triangle = m_triangles.back();
+            triangle.originX = positions[0].x;
+            triangle.originY = positions[0].y;
+            triangle.minX = minX;
+            triangle.minY = minY;
+            triangle.maxX = maxX;
+            triangle.maxY = maxY;
+            triangle.pTexture = pTexture;
+            triangle.isRect = isRect;
+            m_stats.rects += isRect ? 1 : 0;
+
+            for (int k = 0; k < 3; k++)
+            {
+                ImVec2 from = positions[k];
+                ImVec2 to = positions[(k + 1) % 3];
+                float dx = to.x - from.x;
+                float dy = to.y - from.y;
+                triangle.edgeDx[k] = -dy;
+                triangle.edgeDy[k] = dx;
+                triangle.edgeAtOrigin[k] = dx * (positions[0].y - from.y) - dy * (positions[0].x - from.x);
+                triangle.isTopLeft[k] = ((dy < 0.f) || ((dy == 0.f) && (dx > 0.f))) ? 0xFFFFFFFF : 0;
+            }
+
+            float values[3][Attribute_COUNT];
+            for (int k = 0; k < 3; k++)
+            {
+                values[k][Attribute_U] = pVertices[k]->uv.x;
+                values[k][Attribute_V] = pVertices[k]->uv.y;
+                values[k][Attribute_R] = Channel(pVertices[k]->col, IM_COL32_R_SHIFT);
+                values[k][Attribute_G] = Channel(pVertices[k]->col, IM_COL32_G_SHIFT);
+                values[k][Attribute_B] = Channel(pVertices[k]->col, IM_COL32_B_SHIFT);
+                values[k][Attribute_A] = Channel(pVertices[k]->col, IM_COL32_A_SHIFT);
+            }
+
+            float x1 = positions[1].x - positions[0].x;
+            float y1 = positions[1].y - positions[0].y;
+            float x2 = positions[2].x - positions[0].x;
+            float y2 = positions[2].y - positions[0].y;
+            bool isFlatColor = true;
+            bool isSolid = true;
+            for (int a = 0; a < Attribute_COUNT; a++)
+            {
+                float d1 = values[1][a] - values[0][a];
+                float d2 = values[2][a] - values[0][a];
+                triangle.attributeDx[a] = (d1 * y2 - d2 * y1) / area;
+                triangle.attributeDy[a] = (d2 * x1 - d1 * x2) / area;
+                triangle.attributeAtOrigin[a] = values[0][a];
+                isFlatColor = isFlatColor && ((a < Attribute_R) || ((d1 == 0.f) && (d2 == 0.f)));
+                isSolid = isSolid && (d1 == 0.f) && (d2 == 0.f);
+            }
+
+            // Rectangles and most shapes: one color sampled once.
+            triangle.isFlatColor = isFlatColor;
+            triangle.isSolid = isSolid;
+            if (isSolid)
+            {
+                ImU32 texel = Texel(pTexture, values[0][Attribute_U], values[0][Attribute_V]);
+                float alpha = values[0][Attribute_A] * Channel(texel, IM_COL32_A_SHIFT) / 255.f;
+                triangle.solidColor[0] = values[0][Attribute_R] * Channel(texel, IM_COL32_R_SHIFT) / 255.f;
+                triangle.solidColor[1] = values[0][Attribute_G] * Channel(texel, IM_COL32_G_SHIFT) / 255.f;
+                triangle.solidColor[2] = values[0][Attribute_B] * Channel(texel, IM_COL32_B_SHIFT) / 255.f;
+                triangle.solidColor[3] = alpha;
+                if (alpha == 0.f)
+                {
+                    m_stats.rects -= isRect ? 1 : 0;
+                    m_triangles.pop_back();
+                }
+            }
+        }
+
+        // Lists the triangles of every tile in draw order, in one array sorted by tile.
+        void BinTriangles()
+        {
+            int tileCount = m_tileCountX * m_tileCountY;
+            m_tileStarts.resize(tileCount + 1);
+            memset(m_tileStarts.Data, 0, (size_t)m_tileStarts.size_in_bytes());
+            for (const Triangle& triangle : m_triangles)
+            {
+                for (int tileY = triangle.minY / TileSize; tileY <= (triangle.maxY - 1) / TileSize; tileY++)
+                {
+                    for (int tileX = triangle.minX / TileSize; tileX <= (triangle.maxX - 1) / TileSize; tileX++)
+                    {
+                        m_tileStarts[tileY * m_tileCountX + tileX + 1]++;
+                    }
+                }
+            }
+            for (int tile = 0; tile < tileCount; tile++)
+            {
+                m_stats.tiles += (m_tileStarts[tile + 1] > 0) ? 1 : 0;
+                m_tileStarts[tile + 1] += m_tileStarts[tile];
+            }
+            m_stats.binnedPrimitives = m_tileStarts[tileCount];
+
+            m_tileTriangles.resize(m_tileStarts[tileCount]);
+            m_tileFill.resize(tileCount);
+            memcpy(m_tileFill.Data, m_tileStarts.Data, (size_t)m_tileFill.size_in_bytes());
+            for (int i = 0; i < m_triangles.Size; i++)
+            {
+                const Triangle& triangle = m_triangles[i];
+                for (int tileY = triangle.minY / TileSize; tileY <= (triangle.maxY - 1) / TileSize; tileY++)
+                {
+                    for (int tileX = triangle.minX / TileSize; tileX <= (triangle.maxX - 1) / TileSize; tileX++)
+                    {
+                        m_tileTriangles[m_tileFill[tileY * m_tileCountX + tileX]++] = i;
+                    }
+                }
+            }
+        }
+
+        static void DrawTileJob(void* pUserData)
+        {
+            TileJob* pJob = (TileJob*)pUserData;
+            pJob->pRenderer->DrawTile(pJob->tile);
+        }
+
+        void DrawTile(int tile)
+        {
+#if defined(CUSTOM_SOFTWARE_RENDERER_AVX2)
+            if (m_isSimdEnabled)
+            {
+                DrawTileLanes<Avx2Lanes>(tile);
+                return;
+            }
+#elif defined(CUSTOM_SOFTWARE_RENDERER_SSE2)
+            if (m_isSimdEnabled)
+            {
+                DrawTileLanes<Sse2Lanes>(tile);
+                return;
+            }
+#endif
+            DrawTileLanes<ScalarLanes>(tile);
+        }
+
+        template<typename Lanes>
+        void DrawTileLanes(int tile)
+        {
+            int tileMinX = (tile % m_tileCountX) * TileSize;
+            int tileMinY = (tile / m_tileCountX) * TileSize;
+            int tileMaxY = ImMin(tileMinY + TileSize, m_height);
+            for (int y = tileMinY; y < tileMaxY; y++)
+            {
+                uint32_t* pRow = m_pixels.Data + y * m_pitch + tileMinX;
+                for (int x = 0; x < TileSize; x++)
+                {
+                    pRow[x] = m_clearColor;
+                }
+            }
+
+            for (int i = m_tileStarts[tile]; i < m_tileStarts[tile + 1]; i++)
+            {
+                DrawTriangle<Lanes>(m_triangles[m_tileTriangles[i]], tileMinX, tileMinY, tileMaxY);
+            }
+        }
+
+        // Every lane type has the same operations on the same float values, so they all draw the same pixels.
+        template<typename Lanes>
+        void DrawTriangle(
+            const Triangle& triangle,
+            int             tileMinX,
+            int             tileMinY,
+            int             tileMaxY)
+        {
+            typedef typename Lanes::Float Float;
+            typedef typename Lanes::Mask Mask;
+            typedef typename Lanes::Pixels Pixels;
+
+            int minX = ImMax(triangle.minX, tileMinX);
+            int maxX = ImMin(triangle.maxX, tileMinX + TileSize);
+            int minY = ImMax(triangle.minY, tileMinY);
+            int maxY = ImMin(triangle.maxY, tileMaxY);
+            int startX = tileMinX + ((minX - tileMinX) / Lanes::Count) * Lanes::Count;
+
+            Float originX = Lanes::Set(triangle.originX);
+            Float minCenterX = Lanes::Set((float)minX);
+            Float maxCenterX = Lanes::Set((float)maxX);
+            Mask isTopLeft[3];
+            Float edgeDx[3];
+            for (int k = 0; k < 3; k++)
+            {
+                isTopLeft[k] = Lanes::SetMask(triangle.isTopLeft[k]);
+                edgeDx[k] = Lanes::Set(triangle.edgeDx[k]);
+            }
+            // Attributes that don't vary keep their value at the origin.
+            int varyingCount = triangle.isSolid ? 0 : (triangle.isFlatColor ? Attribute_R : Attribute_COUNT);
+            Float attributeDx[Attribute_COUNT];
+            Float values[Attribute_COUNT];
+            for (int a = 0; a < Attribute_COUNT; a++)
+            {
+                attributeDx[a] = Lanes::Set(triangle.attributeDx[a]);
+                values[a] = Lanes::Set(triangle.attributeAtOrigin[a]);
+            }
+
+            const float* pSolid = triangle.solidColor;
+            Float solidAlpha = Lanes::Set(pSolid[3] * (1.f / 255.f));
+            Float solidInverseAlpha = Lanes::Sub(Lanes::Set(1.f), solidAlpha);
+            Float solidRed = Lanes::Mul(Lanes::Set(pSolid[0]), solidAlpha);
+            Float solidGreen = Lanes::Mul(Lanes::Set(pSolid[1]), solidAlpha);
+            Float solidBlue = Lanes::Mul(Lanes::Set(pSolid[2]), solidAlpha);
+            Float solidAlphaOut = Lanes::Set(pSolid[3]);
+            bool isOpaque = triangle.isSolid && (pSolid[3] == 255.f);
+            Pixels opaquePixels = Lanes::Pack(Lanes::Set(pSolid[0]), Lanes::Set(pSolid[1]), Lanes::Set(pSolid[2]), solidAlphaOut);
+
+            for (int y = minY; y < maxY; y++)
+            {
+                float dy = ((float)y + 0.5f) - triangle.originY;
+                Float rowEdges[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    rowEdges[k] = Lanes::Set(triangle.edgeDy[k] * dy + triangle.edgeAtOrigin[k]);
+                }
+                Float rowValues[Attribute_COUNT];
+                for (int a = 0; a < varyingCount; a++)
+                {
+                    rowValues[a] = Lanes::Set(triangle.attributeDy[a] * dy + triangle.attributeAtOrigin[a]);
+                }
+
+                uint32_t* pRow = m_pixels.Data + y * m_pitch;
+                for (int x = startX; x < maxX; x += Lanes::Count)
+                {
+                    Float centerX = Lanes::Ramp((float)x + 0.5f);
+                    Float dx = Lanes::Sub(centerX, originX);
+                    Mask inside = Lanes::And(Lanes::Greater(centerX, minCenterX), Lanes::Greater(maxCenterX, centerX));
+                    for (int k = 0; (k < 3) && (triangle.isRect == false); k++)
+                    {
+                        Float edge = Lanes::Add(Lanes::Mul(edgeDx[k], dx), rowEdges[k]);
+                        Mask isOnEdge = Lanes::And(Lanes::Equal(edge, Lanes::Set(0.f)), isTopLeft[k]);
+                        inside = Lanes::And(inside, Lanes::Or(Lanes::Greater(edge, Lanes::Set(0.f)), isOnEdge));
+                    }
+                    if (Lanes::IsAny(inside) == false)
+                    {
+                        continue;
+                    }
+
+                    Pixels destination = Lanes::Load(pRow + x);
+                    Pixels result;
+                    if (isOpaque)
+                    {
+                        result = opaquePixels;
+                    }
+                    else if (triangle.isSolid)
+                    {
+                        result = Blend<Lanes>(destination, solidRed, solidGreen, solidBlue, solidAlphaOut, solidInverseAlpha);
+                    }
+                    else
+                    {
+                        for (int a = 0; a < varyingCount; a++)
+                        {
+                            values[a] = Lanes::Add(Lanes::Mul(attributeDx[a], dx), rowValues[a]);
+                        }
+
+                        Float texel[4] = { Lanes::Set(255.f), Lanes::Set(255.f), Lanes::Set(255.f), Lanes::Set(255.f) };
+                        if (triangle.pTexture)
+                        {
+                            Pixels texels = Lanes::Fetch(triangle.pTexture->pTexels,
+                                                         triangle.pTexture->width,
+                                                         triangle.pTexture->height,
+                                                         values[Attribute_U],
+                                                         values[Attribute_V]);
+                            texel[0] = Lanes::template Channel<IM_COL32_R_SHIFT>(texels);
+                            texel[1] = Lanes::template Channel<IM_COL32_G_SHIFT>(texels);
+                            texel[2] = Lanes::template Channel<IM_COL32_B_SHIFT>(texels);
+                            texel[3] = Lanes::template Channel<IM_COL32_A_SHIFT>(texels);
+                        }
+
+                        Float scale = Lanes::Set(1.f / 255.f);
+                        Float alpha = Lanes::Mul(Lanes::Mul(values[Attribute_A], texel[3]), scale);
+                        Float premultiply = Lanes::Mul(alpha, scale);
+                        Float red = Lanes::Mul(Lanes::Mul(Lanes::Mul(values[Attribute_R], texel[0]), scale), premultiply);
+                        Float green = Lanes::Mul(Lanes::Mul(Lanes::Mul(values[Attribute_G], texel[1]), scale), premultiply);
+                        Float blue = Lanes::Mul(Lanes::Mul(Lanes::Mul(values[Attribute_B], texel[2]), scale), premultiply);
+                        result = Blend<Lanes>(destination, red, green, blue, alpha, Lanes::Sub(Lanes::Set(1.f), premultiply));
+                    }
+                    Lanes::Store(pRow + x, Lanes::Select(inside, result, destination));
+                }
+            }
+        }
+
+        // Color: source * source alpha + destination * (1 - source alpha). Alpha: source + destination * (1 - source alpha).
+        // The source color comes premultiplied.
+        template<typename Lanes>
+        static typename Lanes::Pixels Blend(
+            typename Lanes::Pixels destination,
+            typename Lanes::Float  red,
+            typename Lanes::Float  green,
+            typename Lanes::Float  blue,
+            typename Lanes::Float  alpha,
+            typename Lanes::Float  inverseAlpha)
+        {
+            return Lanes::Pack(
+                Lanes::Add(red, Lanes::Mul(Lanes::template Channel<IM_COL32_R_SHIFT>(destination), inverseAlpha)),
+                Lanes::Add(green, Lanes::Mul(Lanes::template Channel<IM_COL32_G_SHIFT>(destination), inverseAlpha)),
+                Lanes::Add(blue, Lanes::Mul(Lanes::template Channel<IM_COL32_B_SHIFT>(destination), inverseAlpha)),
+                Lanes::Add(alpha, Lanes::Mul(Lanes::template Channel<IM_COL32_A_SHIFT>(destination), inverseAlpha)));
+        }
+
+        // One pixel at a time. Masks have all bits set or none.
+        struct ScalarLanes
+        {
+            static constexpr int Count = 1;
+            typedef float    Float;
+            typedef uint32_t Mask;
+            typedef uint32_t Pixels;
+
+            static Float Set(float value) { return value; }
+            static Float Ramp(float start) { return start; }
+            static Float Add(Float a, Float b) { return a + b; }
+            static Float Sub(Float a, Float b) { return a - b; }
+            static Float Mul(Float a, Float b) { return a * b; }
+            static Float Min(Float a, Float b) { return (a < b) ? a : b; }
+            static Float Max(Float a, Float b) { return (a > b) ? a : b; }
+            static Mask SetMask(uint32_t mask) { return mask; }
+            static Mask Greater(Float a, Float b) { return (a > b) ? 0xFFFFFFFF : 0; }
+            static Mask Equal(Float a, Float b) { return (a == b) ? 0xFFFFFFFF : 0; }
+            static Mask And(Mask a, Mask b) { return a & b; }
+            static Mask Or(Mask a, Mask b) { return a | b; }
+            static bool IsAny(Mask mask) { return mask != 0; }
+            static Pixels Load(const uint32_t* pPixels) { return *pPixels; }
+            static void Store(uint32_t* pPixels, Pixels pixels) { *pPixels = pixels; }
+            static Pixels Select(Mask mask, Pixels a, Pixels b) { return (a & mask) | (b & ~mask); }
+
+            template<int Shift>
+            static Float Channel(Pixels pixels) { return (float)((pixels >> Shift) & 0xFF); }
+
+            static Pixels Pack(Float red, Float green, Float blue, Float alpha)
+            {
+                return (ToByte(red) << IM_COL32_R_SHIFT) | (ToByte(green) << IM_COL32_G_SHIFT) |
+                       (ToByte(blue) << IM_COL32_B_SHIFT) | (ToByte(alpha) << IM_COL32_A_SHIFT);
+            }
+
+            // Nearest texel, clamped to the edges.
+            static Pixels Fetch(const uint32_t* pTexels, int width, int height, Float u, Float v)
+            {
+                Float x = Min(Max(Mul(u, (float)width), 0.f), (float)(width - 1));
+                Float y = Min(Max(Mul(v, (float)height), 0.f), (float)(height - 1));
+                return pTexels[(int)y * width + (int)x];
+            }
+
+            static uint32_t ToByte(Float value) { return (uint32_t)(int)Min(Add(value, 0.5f), 255.f); }
+        };
+
+#if defined(CUSTOM_SOFTWARE_RENDERER_SSE2)
+        struct Sse2Lanes
+        {
+            static constexpr int Count = 4;
+            typedef __m128  Float;
+            typedef __m128i Mask;
+            typedef __m128i Pixels;
+
+            static Float Set(float value) { return _mm_set1_ps(value); }
+            static Float Ramp(float start) { return _mm_add_ps(_mm_set1_ps(start), _mm_setr_ps(0.f, 1.f, 2.f, 3.f)); }
+            static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+            static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+            static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+            static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+            static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+            static Mask SetMask(uint32_t mask) { return _mm_set1_epi32((int)mask); }
+            static Mask Greater(Float a, Float b) { return _mm_castps_si128(_mm_cmpgt_ps(a, b)); }
+            static Mask Equal(Float a, Float b) { return _mm_castps_si128(_mm_cmpeq_ps(a, b)); }
+            static Mask And(Mask a, Mask b) { return _mm_and_si128(a, b); }
+            static Mask Or(Mask a, Mask b) { return _mm_or_si128(a, b); }
+            static bool IsAny(Mask mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask)) != 0; }
+            static Pixels Load(const uint32_t* pPixels) { return _mm_loadu_si128((const __m128i*)pPixels); }
+            static void Store(uint32_t* pPixels, Pixels pixels) { _mm_storeu_si128((__m128i*)pPixels, pixels); }
+            static Pixels Select(Mask mask, Pixels a, Pixels b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+            template<int Shift>
+            static Float Channel(Pixels pixels) { return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, Shift), _mm_set1_epi32(0xFF))); }
+
+            static Pixels Pack(Float red, Float green, Float blue, Float alpha)
+            {
+                return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(ToByte(red), IM_COL32_R_SHIFT), _mm_slli_epi32(ToByte(green), IM_COL32_G_SHIFT)),
+                                    _mm_or_si128(_mm_slli_epi32(ToByte(blue), IM_COL32_B_SHIFT), _mm_slli_epi32(ToByte(alpha), IM_COL32_A_SHIFT)));
+            }
+
+            // SSE2 has no gather, the texels are read one by one.
+            static Pixels Fetch(const uint32_t* pTexels, int width, int height, Float u, Float v)
+            {
+                Float x = Min(Max(Mul(u, Set((float)width)), Set(0.f)), Set((float)(width - 1)));
+                Float y = Min(Max(Mul(v, Set((float)height)), Set(0.f)), Set((float)(height - 1)));
+                alignas(16) int32_t xs[4];
+                alignas(16) int32_t ys[4];
+                _mm_store_si128((__m128i*)xs, _mm_cvttps_epi32(x));
+                _mm_store_si128((__m128i*)ys, _mm_cvttps_epi32(y));
+                return _mm_setr_epi32((int)pTexels[ys[0] * width + xs[0]],
+                                      (int)pTexels[ys[1] * width + xs[1]],
+                                      (int)pTexels[ys[2] * width + xs[2]],
+                                      (int)pTexels[ys[3] * width + xs[3]]);
+            }
+
+            static __m128i ToByte(Float value) { return _mm_cvttps_epi32(Min(Add(value, Set(0.5f)), Set(255.f))); }
+        };
+#endif
+
+#if defined(CUSTOM_SOFTWARE_RENDERER_AVX2)
+        struct Avx2Lanes
+        {
+            static constexpr int Count = 8;
+            typedef __m256  Float;
+            typedef __m256i Mask;
+            typedef __m256i Pixels;
+
+            static Float Set(float value) { return _mm256_set1_ps(value); }
+            static Float Ramp(float start) { return _mm256_add_ps(_mm256_set1_ps(start), _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f)); }
+            static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+            static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+            static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+            static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+            static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+            static Mask SetMask(uint32_t mask) { return _mm256_set1_epi32((int)mask); }
+            static Mask Greater(Float a, Float b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+            static Mask Equal(Float a, Float b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+            static Mask And(Mask a, Mask b) { return _mm256_and_si256(a, b); }
+            static Mask Or(Mask a, Mask b) { return _mm256_or_si256(a, b); }
+            static bool IsAny(Mask mask) { return _mm256_movemask_ps(_mm256_castsi256_ps(mask)) != 0; }
+            static Pixels Load(const uint32_t* pPixels) { return _mm256_loadu_si256((const __m256i*)pPixels); }
+            static void Store(uint32_t* pPixels, Pixels pixels) { _mm256_storeu_si256((__m256i*)pPixels, pixels); }
+            static Pixels Select(Mask mask, Pixels a, Pixels b) { return _mm256_blendv_epi8(b, a, mask); }
+
+            template<int Shift>
+            static Float Channel(Pixels pixels) { return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, Shift), _mm256_set1_epi32(0xFF))); }
+
+            static Pixels Pack(Float red, Float green, Float blue, Float alpha)
+            {
+                return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(ToByte(red), IM_COL32_R_SHIFT), _mm256_slli_epi32(ToByte(green), IM_COL32_G_SHIFT)),
+                                       _mm256_or_si256(_mm256_slli_epi32(ToByte(blue), IM_COL32_B_SHIFT), _mm256_slli_epi32(ToByte(alpha), IM_COL32_A_SHIFT)));
+            }
+
+            static Pixels Fetch(const uint32_t* pTexels, int width, int height, Float u, Float v)
+            {
+                Float x = Min(Max(Mul(u, Set((float)width)), Set(0.f)), Set((float)(width - 1)));
+                Float y = Min(Max(Mul(v, Set((float)height)), Set(0.f)), Set((float)(height - 1)));
+                __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(y), _mm256_set1_epi32(width)), _mm256_cvttps_epi32(x));
+                return _mm256_i32gather_epi32((const int*)pTexels, index, 4);
+            }
+
+            static __m256i ToByte(Float value) { return _mm256_cvttps_epi32(Min(Add(value, Set(0.5f)), Set(255.f))); }
+        };
+#endif
+
+        JobSystem*                  m_pJobSystem;
+        ImVector<Texture>           m_textures;
+        ImVector<uint32_t>          m_pixels;
+        int                         m_width;
+        int                         m_height;
+        int                         m_pitch;         // Pixels per row, a whole number of tiles.
+        int                         m_tileCountX;
+        int                         m_tileCountY;
+        ImU32                       m_clearColor;
+        bool                        m_isSimdEnabled;
+        ImVector<Triangle>          m_triangles;
+        ImVector<int>               m_tileStarts;    // Tile -> first entry in m_tileTriangles, one past the end last.
+        ImVector<int>               m_tileFill;
+        ImVector<int>               m_tileTriangles; // Triangle indices, grouped by tile.
+        ImVector<TileJob>           m_tileJobs;
+        SoftwareRenderStats         m_stats;
+    };
+}
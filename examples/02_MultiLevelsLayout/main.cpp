@@ -10,11 +10,14 @@
 // Read comments in imgui_impl_vulkan.h.
 
 #include "CustomDearImGuiLayout.h"
+#include "CustomDearImGuiDrawData.h"
+#include "CustomDearImGuiInputTrace.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_vulkan.h"
 #include <stdio.h>          // printf, fprintf
 #include <stdlib.h>         // abort
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <string>
 #define GLFW_INCLUDE_NONE
@@ -30,6 +33,10 @@
 #endif
 
 //#define IMGUI_UNLIMITED_FRAME_RATE
+//#define CUSTOM_LAYOUT_RENDER_THREAD // Record and present on a render thread while the next frame is built.
+//#define CUSTOM_LAYOUT_DAMAGE_REGIONS // Redraw and present only the parts of the window that changed.
+//#define CUSTOM_LAYOUT_BATCH_DRAW_CALLS // Join the draw calls of all the windows before recording them.
+//#define CUSTOM_LAYOUT_RECORD_INPUT // Save the input of the session to input_trace.imtr, see CustomDearImGuiInputTrace.h.
 #ifdef _DEBUG
 #define IMGUI_VULKAN_DEBUG_REPORT
 #endif
@@ -46,7 +53,20 @@ static VkDescriptorPool         g_DescriptorPool = VK_NULL_HANDLE;
 
 static ImGui_ImplVulkanH_Window g_MainWindowData;
 static int                      g_MinImageCount = 2;
-static bool                     g_SwapChainRebuild = false;
+static std::atomic<bool>        g_SwapChainRebuild(false);
+
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+static bool                                g_HasIncrementalPresent = false;
+static VkRenderPass                        g_LoadRenderPass = VK_NULL_HANDLE; // Draws over the image's previous pixels.
+static DearImGuiExt::DrawDataDamageTracker g_DamageTracker;
+static DearImGuiExt::DrawDataClipper       g_DamageClipper;
+static ImVector<ImVec4>                    g_DamageRects;
+static ImVector<uint64_t>                  g_ImageFrameNumbers; // Frame that last rendered each swapchain image, 0 if none.
+static uint64_t                            g_FrameNumber = 0;
+static ImVector<VkRectLayerKHR>            g_PresentRects;      // What changed since the previous present, in pixels.
+static bool                                g_IsFullPresent = true;
+static std::atomic<bool>                   g_IsWindowExposed(false); // The swapchain is clipped: hidden pixels are lost.
+#endif
 
 static void check_vk_result(VkResult err)
 {
@@ -163,7 +183,21 @@ static void SetupVulkan(const char** extensions, uint32_t extensions_count)
     // Create Logical Device (with 1 queue)
     {
         int device_extension_count = 1;
-        const char* device_extensions[] = { "VK_KHR_swapchain" };
+        const char* device_extensions[] = { "VK_KHR_swapchain", NULL };
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+        {
+            uint32_t properties_count;
+            vkEnumerateDeviceExtensionProperties(g_PhysicalDevice, NULL, &properties_count, NULL);
+            ImVector<VkExtensionProperties> properties;
+            properties.resize(properties_count);
+            vkEnumerateDeviceExtensionProperties(g_PhysicalDevice, NULL, &properties_count, properties.Data);
+            for (const VkExtensionProperties& property : properties)
+                if (strcmp(property.extensionName, VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME) == 0)
+                    g_HasIncrementalPresent = true;
+            if (g_HasIncrementalPresent)
+                device_extensions[device_extension_count++] = VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME;
+        }
+#endif
         const float queue_priority[] = { 1.0f };
         VkDeviceQueueCreateInfo queue_info[1] = {};
         queue_info[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -256,12 +290,88 @@ static void CleanupVulkan()
     vkDestroyInstance(g_Instance, g_Allocator);
 }
 
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+// Damage rects cover whole framebuffer pixels already.
+static VkRect2D DamageRectToPixels(const ImVec4& rect, const ImDrawData* draw_data)
+{
+    VkRect2D pixels = {};
+    pixels.offset.x = (int32_t)((rect.x - draw_data->DisplayPos.x) * draw_data->FramebufferScale.x + 0.5f);
+    pixels.offset.y = (int32_t)((rect.y - draw_data->DisplayPos.y) * draw_data->FramebufferScale.y + 0.5f);
+    pixels.extent.width = (uint32_t)((int32_t)((rect.z - draw_data->DisplayPos.x) * draw_data->FramebufferScale.x + 0.5f) - pixels.offset.x);
+    pixels.extent.height = (uint32_t)((int32_t)((rect.w - draw_data->DisplayPos.y) * draw_data->FramebufferScale.y + 0.5f) - pixels.offset.y);
+    return pixels;
+}
+
+// Call after the swapchain was created or resized: the images hold nothing worth keeping yet.
+static void ResetDamageRegions(ImGui_ImplVulkanH_Window* wd)
+{
+    if (g_LoadRenderPass != VK_NULL_HANDLE)
+        vkDestroyRenderPass(g_Device, g_LoadRenderPass, g_Allocator);
+
+    // Same as the window's render pass but it keeps the pixels, so it's compatible with the same framebuffers and pipeline.
+    VkAttachmentDescription attachment = {};
+    attachment.format = wd->SurfaceFormat.format;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    VkAttachmentReference color_attachment = {};
+    color_attachment.attachment = 0;
+    color_attachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_attachment;
+    VkSubpassDependency dependency = {};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = 0;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    VkRenderPassCreateInfo info = {};
+    info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    info.attachmentCount = 1;
+    info.pAttachments = &attachment;
+    info.subpassCount = 1;
+    info.pSubpasses = &subpass;
+    info.dependencyCount = 1;
+    info.pDependencies = &dependency;
+    VkResult err = vkCreateRenderPass(g_Device, &info, g_Allocator, &g_LoadRenderPass);
+    check_vk_result(err);
+
+    g_ImageFrameNumbers.resize((int)wd->ImageCount);
+    for (uint64_t& frame_number : g_ImageFrameNumbers)
+        frame_number = 0;
+    g_DamageTracker.Reset();
+}
+#endif
+
 static void CleanupVulkanWindow()
 {
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+    vkDestroyRenderPass(g_Device, g_LoadRenderPass, g_Allocator);
+#endif
     ImGui_ImplVulkanH_DestroyWindow(g_Instance, g_Device, &g_MainWindowData, g_Allocator);
 }
 
-static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
+#ifdef CUSTOM_LAYOUT_BATCH_DRAW_CALLS
+static DearImGuiExt::DrawDataBatcher g_DrawDataBatcher;
+#endif
+
+static void RecordDrawData(ImDrawData* draw_data, VkCommandBuffer command_buffer)
+{
+#ifdef CUSTOM_LAYOUT_BATCH_DRAW_CALLS
+    draw_data = g_DrawDataBatcher.Batch(draw_data);
+#endif
+    ImGui_ImplVulkan_RenderDrawData(draw_data, command_buffer);
+}
+
+// list_keys identifies the draw lists across frames when draw_data is a snapshot, see DrawDataDamageTracker::Update().
+static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data, const ImDrawList* const* list_keys = NULL)
 {
     VkResult err;
 
@@ -275,6 +385,29 @@ static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
     }
     check_vk_result(err);
 
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+    // The image still holds the frame it was last rendered with: only what changed since then is drawn again.
+    g_DamageTracker.Update(draw_data, list_keys);
+    g_FrameNumber++;
+    if (g_IsWindowExposed.exchange(false))
+        for (uint64_t& frame_number : g_ImageFrameNumbers)
+            frame_number = 0;
+    uint64_t& image_frame_number = g_ImageFrameNumbers[(int)wd->FrameIndex];
+    const int image_age = (int)ImMin<uint64_t>(g_FrameNumber - image_frame_number, DearImGuiExt::DrawDataDamageTracker::HistoryFrames + 1);
+    const bool is_partial = (image_frame_number != 0) && g_DamageTracker.CollectDamage(image_age, g_DamageRects);
+    image_frame_number = g_FrameNumber;
+
+    // The compositor only needs what changed since the previous present, whichever image that was.
+    g_IsFullPresent = !is_partial;
+    g_PresentRects.resize(0);
+    for (const ImVec4& rect : g_DamageTracker.GetDamageRects())
+    {
+        VkRect2D pixels = DamageRectToPixels(rect, draw_data);
+        VkRectLayerKHR present_rect = { pixels.offset, pixels.extent, 0 };
+        g_PresentRects.push_back(present_rect);
+    }
+#endif
+
     ImGui_ImplVulkanH_Frame* fd = &wd->Frames[wd->FrameIndex];
     {
         err = vkWaitForFences(g_Device, 1, &fd->Fence, VK_TRUE, UINT64_MAX);    // wait indefinitely instead of periodically checking
@@ -292,6 +425,52 @@ static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
         err = vkBeginCommandBuffer(fd->CommandBuffer, &info);
         check_vk_result(err);
     }
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+    if (is_partial)
+    {
+        // Without damage, the image is presented again as it is.
+        if (g_DamageRects.Size > 0)
+        {
+            ImVector<VkClearRect> clear_rects;
+            VkRect2D render_area = { { INT32_MAX, INT32_MAX }, { 0, 0 } };
+            int32_t render_area_max_x = 0;
+            int32_t render_area_max_y = 0;
+            for (const ImVec4& rect : g_DamageRects)
+            {
+                VkClearRect clear_rect = {};
+                clear_rect.rect = DamageRectToPixels(rect, draw_data);
+                clear_rect.layerCount = 1;
+                clear_rects.push_back(clear_rect);
+                render_area.offset.x = ImMin(render_area.offset.x, clear_rect.rect.offset.x);
+                render_area.offset.y = ImMin(render_area.offset.y, clear_rect.rect.offset.y);
+                render_area_max_x = ImMax(render_area_max_x, clear_rect.rect.offset.x + (int32_t)clear_rect.rect.extent.width);
+                render_area_max_y = ImMax(render_area_max_y, clear_rect.rect.offset.y + (int32_t)clear_rect.rect.extent.height);
+            }
+            render_area.extent.width = (uint32_t)(render_area_max_x - render_area.offset.x);
+            render_area.extent.height = (uint32_t)(render_area_max_y - render_area.offset.y);
+
+            VkRenderPassBeginInfo info = {};
+            info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            info.renderPass = g_LoadRenderPass;
+            info.framebuffer = fd->Framebuffer;
+            info.renderArea = render_area;
+            vkCmdBeginRenderPass(fd->CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
+
+            VkClearAttachment clear_attachment = {};
+            clear_attachment.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            clear_attachment.colorAttachment = 0;
+            clear_attachment.clearValue = wd->ClearValue;
+            vkCmdClearAttachments(fd->CommandBuffer, 1, &clear_attachment, (uint32_t)clear_rects.Size, clear_rects.Data);
+
+            // Scissored to the damage: the rest of the image keeps the pixels of the last time it was rendered.
+            g_DamageClipper.Clip(draw_data, g_DamageRects);
+            RecordDrawData(draw_data, fd->CommandBuffer);
+            g_DamageClipper.Restore();
+            vkCmdEndRenderPass(fd->CommandBuffer);
+        }
+    }
+    else
+#endif
     {
         VkRenderPassBeginInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -302,13 +481,13 @@ static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
         info.clearValueCount = 1;
         info.pClearValues = &wd->ClearValue;
         vkCmdBeginRenderPass(fd->CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
-    }
 
-    // Record dear imgui primitives into command buffer
-    ImGui_ImplVulkan_RenderDrawData(draw_data, fd->CommandBuffer);
+        // Record dear imgui primitives into command buffer
+        RecordDrawData(draw_data, fd->CommandBuffer);
+        vkCmdEndRenderPass(fd->CommandBuffer);
+    }
 
     // Submit command buffer
-    vkCmdEndRenderPass(fd->CommandBuffer);
     {
         VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         VkSubmitInfo info = {};
@@ -340,6 +519,19 @@ static void FramePresent(ImGui_ImplVulkanH_Window* wd)
     info.swapchainCount = 1;
     info.pSwapchains = &wd->Swapchain;
     info.pImageIndices = &wd->FrameIndex;
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+    // No rectangle means the whole image changed, so an unchanged image reports a single pixel.
+    VkRectLayerKHR unchanged_rect = { { 0, 0 }, { 1, 1 }, 0 };
+    VkPresentRegionKHR region = {};
+    region.rectangleCount = g_IsFullPresent ? 0 : ((g_PresentRects.Size > 0) ? (uint32_t)g_PresentRects.Size : 1);
+    region.pRectangles = (g_PresentRects.Size > 0) ? g_PresentRects.Data : &unchanged_rect;
+    VkPresentRegionsKHR regions = {};
+    regions.sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR;
+    regions.swapchainCount = 1;
+    regions.pRegions = &region;
+    if (g_HasIncrementalPresent)
+        info.pNext = &regions;
+#endif
     VkResult err = vkQueuePresentKHR(g_Queue, &info);
     if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
     {
@@ -355,6 +547,39 @@ static void glfw_error_callback(int error, const char* description)
     fprintf(stderr, "Glfw Error %d: %s\n", error, description);
 }
 
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+static void glfw_window_refresh_callback(GLFWwindow*)
+{
+    g_IsWindowExposed = true;
+}
+#endif
+
+#ifdef CUSTOM_LAYOUT_RENDER_THREAD
+struct RenderThreadData
+{
+    ImGui_ImplVulkanH_Window*   wd;
+    ImVec4                      clear_color;
+    DearImGuiExt::RenderThread* render_thread;
+};
+
+// Runs on the render thread with a snapshot of the frame's draw data.
+static void RenderThreadSubmit(ImDrawData* draw_data, void* user_data)
+{
+    RenderThreadData* data = (RenderThreadData*)user_data;
+    ImGui_ImplVulkanH_Window* wd = data->wd;
+    const bool is_minimized = (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f);
+    if (!is_minimized)
+    {
+        wd->ClearValue.color.float32[0] = data->clear_color.x * data->clear_color.w;
+        wd->ClearValue.color.float32[1] = data->clear_color.y * data->clear_color.w;
+        wd->ClearValue.color.float32[2] = data->clear_color.z * data->clear_color.w;
+        wd->ClearValue.color.float32[3] = data->clear_color.w;
+        FrameRender(wd, draw_data, data->render_thread->GetRenderingSnapshot()->GetSourceLists());
+        FramePresent(wd);
+    }
+}
+#endif
+
 // Custom system start
 
 constexpr ImGuiWindowFlags TestWindowFlag = ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDecoration;
@@ -502,12 +727,16 @@ DearImGuiExt::CustomLayoutNode* MultiLevelsLayout()
     DearImGuiExt::CustomLayoutNode* pLeftDownDomain = pLeftDomain->GetRightChild();
     pLeftDownDomain->CreateLeftChild(MultiLevelsLeftDown1Window);
     pLeftDownDomain->CreateRightChild(MultiLevelsLeftDown2Window);
+    pLeftDownDomain->GetLeftChild()->SetName("LeftDown1");
+    pLeftDownDomain->GetRightChild()->SetName("LeftDown2");
 
     // Right splitter's top and bottom windows
     DearImGuiExt::CustomLayoutNode* pRightDomain = pRoot->GetRightChild();
 
     pRightDomain->CreateLeftChild(MultiLevelsRightUpWindow);
     pRightDomain->CreateRightChild(MultiLevelsRightDownWindow);
+    pRightDomain->GetLeftChild()->SetName("RightUp");
+    pRightDomain->GetRightChild()->SetName("RightDown");
 
     return pRoot;
 }
@@ -542,6 +771,9 @@ int main(int, char**)
     glfwGetFramebufferSize(window, &w, &h);
     ImGui_ImplVulkanH_Window* wd = &g_MainWindowData;
     SetupVulkanWindow(wd, surface, w, h);
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+    ResetDamageRegions(wd);
+#endif
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -556,6 +788,9 @@ int main(int, char**)
 
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForVulkan(window, true);
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+    glfwSetWindowRefreshCallback(window, glfw_window_refresh_callback);
+#endif
     ImGui_ImplVulkan_InitInfo init_info = {};
     init_info.Instance = g_Instance;
     init_info.PhysicalDevice = g_PhysicalDevice;
@@ -630,6 +865,17 @@ int main(int, char**)
     // Choose a layout that you want to see.
     DearImGuiExt::CustomLayout myLayout(MultiLevelsLayout());
 
+#ifdef CUSTOM_LAYOUT_RECORD_INPUT
+    DearImGuiExt::InputTraceRecorder inputRecorder;
+    inputRecorder.Start(&myLayout);
+#endif
+
+#ifdef CUSTOM_LAYOUT_RENDER_THREAD
+    RenderThreadData render_thread_data = { wd, clear_color, NULL };
+    DearImGuiExt::RenderThread renderThread(RenderThreadSubmit, &render_thread_data);
+    render_thread_data.render_thread = &renderThread;
+#endif
+
     // Main loop
     while (!glfwWindowShouldClose(window))
     {
@@ -647,9 +893,16 @@ int main(int, char**)
             glfwGetFramebufferSize(window, &width, &height);
             if (width > 0 && height > 0)
             {
+#ifdef CUSTOM_LAYOUT_RENDER_THREAD
+                // The render thread may still be recording with the old swapchain.
+                renderThread.WaitIdle();
+#endif
                 ImGui_ImplVulkan_SetMinImageCount(g_MinImageCount);
                 ImGui_ImplVulkanH_CreateOrResizeWindow(g_Instance, g_PhysicalDevice, g_Device, &g_MainWindowData, g_QueueFamily, g_Allocator, width, height, g_MinImageCount);
                 g_MainWindowData.FrameIndex = 0;
+#ifdef CUSTOM_LAYOUT_DAMAGE_REGIONS
+                ResetDamageRegions(&g_MainWindowData);
+#endif
                 g_SwapChainRebuild = false;
             }
         }
@@ -671,12 +924,26 @@ int main(int, char**)
                 {
                     ImGui::EndMenu();
                 }
+                if (ImGui::BeginMenu("View"))
+                {
+                    // Named leaves are found without walking the tree.
+                    const char* names[] = { "LeftDown1", "LeftDown2", "RightUp", "RightDown" };
+                    for (const char* pName : names)
+                    {
+                        DearImGuiExt::CustomLayoutNode* pNode = myLayout.FindNodeByName(pName);
+                        if (ImGui::MenuItem(pName, nullptr, pNode->IsHidden() == false))
+                        {
+                            myLayout.SetNodeVisible(pNode, pNode->IsHidden());
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
                 ImGui::EndMainMenuBar();
             }
 
             if (DearImGuiExt::BeginBottomMainMenuBar())
             {
-                ImGui::EndMainMenuBar();
+                DearImGuiExt::EndBottomMainMenuBar();
             }
         }
         
@@ -685,6 +952,9 @@ int main(int, char**)
         // Rendering
         ImGui::Render();
         ImDrawData* draw_data = ImGui::GetDrawData();
+#ifdef CUSTOM_LAYOUT_RENDER_THREAD
+        renderThread.Submit(draw_data);
+#else
         const bool is_minimized = (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f);
         if (!is_minimized)
         {
@@ -695,13 +965,24 @@ int main(int, char**)
             FrameRender(wd, draw_data);
             FramePresent(wd);
         }
+#endif
     }
 
     // Cleanup
+#ifdef CUSTOM_LAYOUT_RENDER_THREAD
+    renderThread.Stop();
+#endif
     err = vkDeviceWaitIdle(g_Device);
     check_vk_result(err);
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
+#ifdef CUSTOM_LAYOUT_RECORD_INPUT
+    inputRecorder.Stop();
+    if (inputRecorder.SaveFile("input_trace.imtr") == false)
+    {
+        fprintf(stderr, "Can't save input_trace.imtr\n");
+    }
+#endif
     ImGui::DestroyContext();
 
     CleanupVulkanWindow();
@@ -0,0 +1,7 @@
+#pragma once
+// Dear ImGui user config of the headless benchmark. Passed through IMGUI_USER_CONFIG.
+
+// One current context per thread, so the parallel leaves of the layout can build their own frames.
+struct ImGuiContext;
+extern thread_local ImGuiContext* g_ImGuiTLS;
+#define GImGui g_ImGuiTLS
@@ -0,0 +1,3335 @@
+// Headless benchmarks for the custom layout and its extensions.
+// There is no window and no GPU: Dear ImGui runs with a fixed display size and the draw data goes to a submitter that
+// only simulates the GPU submission cost. Run "HeadlessBenchmark <name>" for one benchmark or no argument for all.
+// "HeadlessBenchmark input_replay <file>" replays an input trace recorded by the 01_SimpleTwoLayouts example.
+
+#include "CustomDearImGuiLayout.h"
+#include "CustomDearImGuiDrawData.h"
+#include "CustomDearImGuiJobSystem.h"
+#include "CustomDearImGuiRemote.h"
+#include "CustomDearImGuiInputTrace.h"
+#include "CustomDearImGuiSoftwareRenderer.h"
+#include "CustomDearImGuiLogConsole.h"
+#include "CustomDearImGuiPlot.h"
+#include <stdio.h>          // printf, snprintf
+#include <string.h>         // strcmp, memset
+#include <math.h>           // sinf
+#include <stdint.h>
+#include <stdlib.h>         // malloc, free
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Declared by HeadlessImConfig.h.
+thread_local ImGuiContext* g_ImGuiTLS = nullptr;
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Counts every allocation made through Dear ImGui's allocator.
+static std::atomic<uint64_t> g_AllocationCount(0);
+
+static void* CountingAlloc(size_t size, void* pUserData)
+{
+    (void)pUserData;
+    g_AllocationCount++;
+    return malloc(size);
+}
+
+static void CountingFree(void* ptr, void* pUserData)
+{
+    (void)pUserData;
+    free(ptr);
+}
+
+// Headless Dear ImGui context. The font atlas is built so NewFrame() is happy, but nothing uploads it anywhere.
+static ImGuiContext* CreateHeadlessContext(ImVec2 displaySize)
+{
+    // CreateContext() keeps the previous context current.
+    ImGuiContext* pContext = ImGui::CreateContext();
+    ImGui::SetCurrentContext(pContext);
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = displaySize;
+    io.DeltaTime = 1.f / 60.f;
+    io.IniFilename = nullptr;
+
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    io.Fonts->SetTexID((ImTextureID)(intptr_t)1);
+
+    ImGui::StyleColorsDark();
+    return pContext;
+}
+
+// Custom system start
+
+constexpr ImGuiWindowFlags TestWindowFlag = ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDecoration;
+
+static void DrawBasicTrees()
+{
+    ImGui::SetNextItemOpen(true, ImGuiCond_Once);
+    if (ImGui::TreeNode("Basic trees"))
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            ImGui::SetNextItemOpen(true, ImGuiCond_Once);
+            if (ImGui::TreeNode((void*)(intptr_t)i, "Child %d", i))
+            {
+                ImGui::Text("blah blah");
+                ImGui::SameLine();
+                if (ImGui::SmallButton("button")) {}
+                ImGui::TreePop();
+            }
+        }
+        ImGui::TreePop();
+    }
+}
+
+void BlenderStyleTestLeftUpWindow()
+{
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 6.f);
+    ImGui::Begin("Left-Up Window", nullptr, TestWindowFlag);
+
+    if (ImGui::BeginTabBar("##Tabs", ImGuiTabBarFlags_None))
+    {
+        if (ImGui::BeginTabItem("Description"))
+        {
+            ImGui::TextWrapped("Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. ");
+            ImGui::EndTabItem();
+        }
+        if (ImGui::BeginTabItem("Details"))
+        {
+            ImGui::Text("ID: 0123456789");
+            ImGui::EndTabItem();
+        }
+        ImGui::EndTabBar();
+    }
+
+    ImGui::End();
+    ImGui::PopStyleVar(1);
+}
+
+void BlenderStyleTestLeftDownWindow()
+{
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 6.f);
+    ImGui::Begin("Left-Down Window", nullptr, TestWindowFlag);
+    DrawBasicTrees();
+    ImGui::End();
+    ImGui::PopStyleVar(1);
+}
+
+void BlenderStyleTestRightUpWindow()
+{
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 6.f);
+    ImGui::Begin("Right-Up Window", nullptr, TestWindowFlag);
+    DrawBasicTrees();
+    ImGui::End();
+    ImGui::PopStyleVar(1);
+}
+
+void BlenderStyleTestRightDownWindow()
+{
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 6.f);
+    ImGui::Begin("Right-Down Window", nullptr, TestWindowFlag);
+    DrawBasicTrees();
+    ImGui::End();
+    ImGui::PopStyleVar(1);
+}
+
+// Same as the 01_SimpleTwoLayouts example.
+DearImGuiExt::CustomLayoutNode* BlenderStartLayout()
+{
+    DearImGuiExt::CustomLayoutNode* pRoot = new DearImGuiExt::CustomLayoutNode(0.8f);
+
+    pRoot->CreateLeftChild(0.8f);
+    pRoot->CreateRightChild(0.3f);
+
+    DearImGuiExt::CustomLayoutNode* pLeftDomain = pRoot->GetLeftChild();
+    pLeftDomain->CreateLeftChild(BlenderStyleTestLeftUpWindow);
+    pLeftDomain->CreateRightChild(BlenderStyleTestLeftDownWindow);
+
+    DearImGuiExt::CustomLayoutNode* pRightDomain = pRoot->GetRightChild();
+    pRightDomain->CreateLeftChild(BlenderStyleTestRightUpWindow);
+    pRightDomain->CreateRightChild(BlenderStyleTestRightDownWindow);
+
+    return pRoot;
+}
+
+// A panel that is expensive to build. Every instance needs its own window name when they share a context.
+template<int Index>
+void HeavyPanelWindow()
+{
+    char name[32];
+    snprintf(name, sizeof(name), "Heavy Panel %d", Index);
+    ImGui::Begin(name, nullptr, TestWindowFlag);
+    for (int i = 0; i < 400; i++)
+    {
+        ImGui::Text("Panel %d row %d value %.3f", Index, i, (float)i * 0.001f);
+    }
+    DrawBasicTrees();
+    ImGui::End();
+}
+
+constexpr int HeavyPanelCount = 40;
+
+template<int... Indices>
+static constexpr std::array<CustomWindowFunc, sizeof...(Indices)> MakeHeavyPanels(std::integer_sequence<int, Indices...>)
+{
+    return { { HeavyPanelWindow<Indices>... } };
+}
+
+static const std::array<CustomWindowFunc, HeavyPanelCount> HeavyPanels =
+    MakeHeavyPanels(std::make_integer_sequence<int, HeavyPanelCount>());
+
+// Splits a domain between the given windows, half of them on each side.
+static void FillBalancedDomain(
+    DearImGuiExt::CustomLayoutNode* pDomain,
+    const CustomWindowFunc*         pFuncs,
+    int                             count)
+{
+    int leftCount = count / 2;
+    int rightCount = count - leftCount;
+
+    if (leftCount == 1)
+    {
+        pDomain->CreateLeftChild(pFuncs[0]);
+    }
+    else
+    {
+        pDomain->CreateLeftChild((float)(leftCount / 2) / (float)leftCount);
+        FillBalancedDomain(pDomain->GetLeftChild(), pFuncs, leftCount);
+    }
+
+    if (rightCount == 1)
+    {
+        pDomain->CreateRightChild(pFuncs[leftCount]);
+    }
+    else
+    {
+        pDomain->CreateRightChild((float)(rightCount / 2) / (float)rightCount);
+        FillBalancedDomain(pDomain->GetRightChild(), pFuncs + leftCount, rightCount);
+    }
+}
+
+// A layout of at least two windows with the same number of windows on both sides of every splitter.
+static DearImGuiExt::CustomLayoutNode* BalancedLayout(
+    const CustomWindowFunc* pFuncs,
+    int                     count)
+{
+    DearImGuiExt::CustomLayoutNode* pRoot = new DearImGuiExt::CustomLayoutNode((float)(count / 2) / (float)count);
+    FillBalancedDomain(pRoot, pFuncs, count);
+    return pRoot;
+}
+
+// One frame of the examples' main loop without the platform and renderer backends. Takes a layout or workspaces.
+template<typename Layout>
+static ImDrawData* BuildFrame(Layout& layout)
+{
+    ImGui::NewFrame();
+
+    if (ImGui::BeginMainMenuBar())
+    {
+        if (ImGui::BeginMenu("File"))
+        {
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
+    }
+
+    if (DearImGuiExt::BeginBottomMainMenuBar())
+    {
+        DearImGuiExt::EndBottomMainMenuBar();
+    }
+
+    layout.BeginEndLayout();
+
+    ImGui::Render();
+    return ImGui::GetDrawData();
+}
+
+// Busy waits to simulate the command recording and queue submission of a GPU backend.
+static void SimulatedSubmit(ImDrawData* pDrawData, void* pUserData)
+{
+    (void)pDrawData;
+    const double submitMs = *(const double*)pUserData;
+    Clock::time_point start = Clock::now();
+    while (ElapsedMs(start) < submitMs)
+    {
+    }
+}
+
+// Serial main loop vs. a render thread consuming double-buffered snapshots.
+static void BenchRenderThread()
+{
+    constexpr int FrameCount = 600;
+    const double submitCostsMs[] = { 0.0, 1.0, 4.0 };
+
+    printf("[render_thread] %d frames of the Blender style layout at 1280x720.\n", FrameCount);
+    for (double submitMs : submitCostsMs)
+    {
+        ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1280.f, 720.f));
+
+        double serialMs = 0.0;
+        {
+            DearImGuiExt::CustomLayout layout(BlenderStartLayout());
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < FrameCount; i++)
+            {
+                SimulatedSubmit(BuildFrame(layout), &submitMs);
+            }
+            serialMs = ElapsedMs(start);
+        }
+
+        double threadedMs = 0.0;
+        double captureMs = 0.0;
+        double waitMs = 0.0;
+        {
+            DearImGuiExt::CustomLayout layout(BlenderStartLayout());
+            DearImGuiExt::RenderThread renderThread(SimulatedSubmit, &submitMs);
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < FrameCount; i++)
+            {
+                renderThread.Submit(BuildFrame(layout));
+                DearImGuiExt::RenderThreadStats stats = renderThread.GetStats();
+                captureMs += stats.lastCaptureMs;
+                waitMs += stats.lastWaitMs;
+            }
+            renderThread.Stop();
+            threadedMs = ElapsedMs(start);
+        }
+
+        printf("  submit %.1f ms: serial %.3f ms/frame, render thread %.3f ms/frame (snapshot %.3f ms, wait %.3f ms)\n",
+               submitMs,
+               serialMs / FrameCount,
+               threadedMs / FrameCount,
+               captureMs / FrameCount,
+               waitMs / FrameCount);
+
+        ImGui::DestroyContext(pContext);
+    }
+}
+
+// Cloning every draw list per frame vs. a snapshot pool that keeps the capacity of the previous frames.
+static void BenchSnapshotPool()
+{
+    constexpr int WarmUpFrames = 10;
+    constexpr int FrameCount = 1000;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    DearImGuiExt::CustomLayout layout(BlenderStartLayout());
+    for (int i = 0; i < WarmUpFrames; i++)
+    {
+        BuildFrame(layout);
+    }
+
+    double cloneMs = 0.0;
+    uint64_t cloneAllocations = 0;
+    for (int i = 0; i < FrameCount; i++)
+    {
+        ImDrawData* pDrawData = BuildFrame(layout);
+        uint64_t allocationsBefore = g_AllocationCount;
+        Clock::time_point start = Clock::now();
+
+        ImVector<ImDrawList*> clones;
+        for (int n = 0; n < pDrawData->CmdListsCount; n++)
+        {
+            clones.push_back(pDrawData->CmdLists[n]->CloneOutput());
+        }
+        for (int n = 0; n < clones.Size; n++)
+        {
+            IM_DELETE(clones[n]);
+        }
+
+        cloneMs += ElapsedMs(start);
+        cloneAllocations += g_AllocationCount - allocationsBefore;
+    }
+
+    double poolMs = 0.0;
+    uint64_t poolAllocations = 0;
+    size_t bytesCopied = 0;
+    DearImGuiExt::DrawDataSnapshotPool pool;
+    for (int i = 0; i < FrameCount + WarmUpFrames; i++)
+    {
+        ImDrawData* pDrawData = BuildFrame(layout);
+        uint64_t allocationsBefore = g_AllocationCount;
+        Clock::time_point start = Clock::now();
+
+        DearImGuiExt::DrawDataSnapshot* pSnapshot = pool.Capture(pDrawData);
+        pool.Release(pSnapshot);
+
+        // The first captures size the pool. Only the steady state is measured.
+        if (i >= WarmUpFrames)
+        {
+            poolMs += ElapsedMs(start);
+            poolAllocations += g_AllocationCount - allocationsBefore;
+            bytesCopied += pool.GetLastBytesCopied();
+        }
+    }
+
+    printf("[snapshot_pool] %d frames of the Blender style layout at 1920x1080.\n", FrameCount);
+    printf("  clone per frame: %.4f ms/frame, %.2f allocations/frame\n",
+           cloneMs / FrameCount, (double)cloneAllocations / FrameCount);
+    printf("  snapshot pool:   %.4f ms/frame, %.2f allocations/frame, %zu bytes copied/frame\n",
+           poolMs / FrameCount, (double)poolAllocations / FrameCount, bytesCopied / FrameCount);
+
+    ImGui::DestroyContext(pContext);
+}
+
+// Builds 40 heavy leaves serially and then on 1 to N threads, each leaf in its own Dear ImGui context.
+static void BenchParallelLeaves()
+{
+    constexpr int WarmUpFrames = 10;
+    constexpr int FrameCount = 200;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    printf("[parallel_leaves] %d frames of %d heavy leaves at 1920x1080.\n", FrameCount, HeavyPanelCount);
+
+    double serialMs = 0.0;
+    {
+        DearImGuiExt::CustomLayout layout(BalancedLayout(HeavyPanels.data(), HeavyPanelCount));
+        for (int i = 0; i < WarmUpFrames; i++)
+        {
+            BuildFrame(layout);
+        }
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < FrameCount; i++)
+        {
+            BuildFrame(layout);
+        }
+        serialMs = ElapsedMs(start) / FrameCount;
+    }
+    printf("  serial:    %.3f ms/frame\n", serialMs);
+
+    // 1, 2, 4... and the core count.
+    uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    ImVector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (uint32_t threads : threadCounts)
+    {
+        // The layout waits for its jobs when it is destroyed, so the job system has to outlive it.
+        DearImGuiExt::JobSystem jobSystem(threads - 1);
+        DearImGuiExt::CustomLayout layout(BalancedLayout(HeavyPanels.data(), HeavyPanelCount));
+        layout.SetJobSystem(&jobSystem);
+        layout.EnableParallelLeaves();
+
+        for (int i = 0; i < WarmUpFrames; i++)
+        {
+            layout.MergeDrawData(BuildFrame(layout));
+        }
+
+        int listCount = 0;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < FrameCount; i++)
+        {
+            listCount = layout.MergeDrawData(BuildFrame(layout))->CmdListsCount;
+        }
+        double parallelMs = ElapsedMs(start) / FrameCount;
+
+        printf("  %2u thread%s %.3f ms/frame, %.2fx, %d draw lists\n",
+               threads, (threads == 1) ? ": " : "s:", parallelMs, serialMs / parallelMs, listCount);
+    }
+
+    ImGui::DestroyContext(pContext);
+}
+
+// Text fields of the parallel_leaves_input benchmark. Each one is only touched by the job building its leaf.
+static char g_LeafInputText[2][64];
+
+template<int Index>
+void TextInputPanelWindow()
+{
+    char name[32];
+    snprintf(name, sizeof(name), "Text Input Panel %d", Index);
+    ImGui::Begin(name, nullptr, TestWindowFlag);
+    ImGui::InputText("##Text", g_LeafInputText[Index], sizeof(g_LeafInputText[Index]));
+    ImGui::End();
+}
+
+// Clicks into the text field of one leaf with parallel leaves on and types with a backspace and Ctrl+A in the middle.
+// The leaf contexts only accept what their ImGuiIO takes from a backend, so every key the builder forwards must be one.
+static void BenchParallelLeavesInput()
+{
+    constexpr int WarmUpFrames = 10;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1280.f, 720.f));
+    ImGuiIO& io = ImGui::GetIO();
+    memset(g_LeafInputText, 0, sizeof(g_LeafInputText));
+
+    double frameMs = 0.0;
+    int frameCount = 0;
+    {
+        DearImGuiExt::JobSystem jobSystem(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        DearImGuiExt::CustomLayoutNode* pRoot = new DearImGuiExt::CustomLayoutNode(0.5f);
+        pRoot->CreateLeftChild(TextInputPanelWindow<0>);
+        pRoot->CreateRightChild(TextInputPanelWindow<1>);
+        DearImGuiExt::CustomLayout layout(pRoot);
+        layout.SetJobSystem(&jobSystem);
+        layout.EnableParallelLeaves();
+
+        auto runFrames = [&](int count)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                Clock::time_point start = Clock::now();
+                layout.MergeDrawData(BuildFrame(layout));
+                frameMs += ElapsedMs(start);
+                frameCount++;
+            }
+        };
+        runFrames(WarmUpFrames);
+
+        // Inside the text field at the top of the left leaf.
+        const ImGuiStyle& style = ImGui::GetStyle();
+        ImVec2 field = pRoot->GetLeftChild()->GetDomainPos();
+        field.x += style.WindowPadding.x + 20.f;
+        field.y += style.WindowPadding.y + style.FramePadding.y + 2.f;
+
+        // One change per frame, the way the event queue trickles them anyway.
+        io.AddMousePosEvent(field.x, field.y);
+        runFrames(1);
+        io.AddMouseButtonEvent(ImGuiMouseButton_Left, true);
+        runFrames(1);
+        io.AddMouseButtonEvent(ImGuiMouseButton_Left, false);
+        runFrames(1);
+        for (const char* pChar = "abcd"; *pChar; pChar++)
+        {
+            io.AddInputCharacter((unsigned int)*pChar);
+        }
+        runFrames(1);
+        io.AddKeyEvent(ImGuiKey_Backspace, true);
+        runFrames(1);
+        io.AddKeyEvent(ImGuiKey_Backspace, false);
+        runFrames(1);
+        io.AddKeyEvent(ImGuiMod_Ctrl, true);
+        runFrames(1);
+        io.AddKeyEvent(ImGuiKey_A, true);
+        runFrames(1);
+        io.AddKeyEvent(ImGuiKey_A, false);
+        runFrames(1);
+        io.AddKeyEvent(ImGuiMod_Ctrl, false);
+        runFrames(1);
+        io.AddInputCharacter('o');
+        io.AddInputCharacter('k');
+        runFrames(1);
+        io.AddMousePosEvent(-FLT_MAX, -FLT_MAX);
+        runFrames(WarmUpFrames);
+    }
+
+    bool isTyped = (strcmp(g_LeafInputText[0], "ok") == 0) && (g_LeafInputText[1][0] == 0);
+    printf("[parallel_leaves_input] Typing into one of 2 parallel leaves at 1280x720, %d frames.\n", frameCount);
+    printf("  %.3f ms/frame, clicked leaf '%s', other leaf '%s': %s\n",
+           frameMs / ImMax(frameCount, 1),
+           g_LeafInputText[0],
+           g_LeafInputText[1],
+           isTyped ? "as typed" : "differs from 'ok' and ''");
+
+    ImGui::DestroyContext(pContext);
+}
+
+// An OS window of an application with one window per monitor: its own context and layout.
+struct MonitorContext
+{
+    ImGuiContext*               pContext;
+    DearImGuiExt::CustomLayout* pLayout;
+    int                         vtxCount; // Of the last frame.
+};
+
+static void BuildMonitorFrames(
+    MonitorContext& monitor,
+    int             frameCount)
+{
+    DearImGuiExt::CustomContextScope contextScope(monitor.pContext);
+    for (int i = 0; i < frameCount; i++)
+    {
+        monitor.vtxCount = BuildFrame(*monitor.pLayout)->TotalVtxCount;
+    }
+}
+
+// One context of heavy panels per monitor. Builds the frames of all the contexts on one thread, switching contexts like a
+// single threaded application, then every context on its own thread.
+static void BenchParallelContexts()
+{
+    constexpr int PanelCount = 8;
+    constexpr int WarmUpFrames = 10;
+    constexpr int FrameCount = 100;
+
+    printf("[parallel_contexts] One context of %d heavy panels at 1920x1080 per monitor, %d frames.\n", PanelCount, FrameCount);
+
+    // 1, 2, 4... and the core count.
+    uint32_t maxContexts = std::max(1u, std::thread::hardware_concurrency());
+    ImVector<uint32_t> contextCounts;
+    for (uint32_t contexts = 1; contexts < maxContexts; contexts *= 2)
+    {
+        contextCounts.push_back(contexts);
+    }
+    contextCounts.push_back(maxContexts);
+
+    double singleMs = 0.0;
+    for (uint32_t contextCount : contextCounts)
+    {
+        std::vector<MonitorContext> monitors(contextCount);
+        for (MonitorContext& monitor : monitors)
+        {
+            monitor.pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+            monitor.pLayout = new DearImGuiExt::CustomLayout(BalancedLayout(HeavyPanels.data(), PanelCount), monitor.pContext);
+            monitor.vtxCount = 0;
+            BuildMonitorFrames(monitor, WarmUpFrames);
+        }
+        ImGui::SetCurrentContext(nullptr);
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < FrameCount; i++)
+        {
+            for (MonitorContext& monitor : monitors)
+            {
+                BuildMonitorFrames(monitor, 1);
+            }
+        }
+        double serialMs = ElapsedMs(start) / FrameCount;
+
+        std::vector<std::thread> threads;
+        start = Clock::now();
+        for (MonitorContext& monitor : monitors)
+        {
+            threads.emplace_back([&monitor]() { BuildMonitorFrames(monitor, FrameCount); });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        double parallelMs = ElapsedMs(start) / FrameCount;
+        singleMs = (contextCount == 1) ? parallelMs : singleMs;
+
+        bool isSame = true;
+        for (const MonitorContext& monitor : monitors)
+        {
+            isSame = isSame && (monitor.vtxCount == monitors[0].vtxCount);
+        }
+        printf("  %2u context%s one thread %7.3f ms/frame, a thread each %7.3f ms/frame (%.2fx), %.0f%% scaling efficiency, same drawing: %s\n",
+               contextCount,
+               (contextCount == 1) ? ": " : "s:",
+               serialMs,
+               parallelMs,
+               serialMs / parallelMs,
+               100. * singleMs / parallelMs,
+               isSame ? "yes" : "NO");
+
+        for (MonitorContext& monitor : monitors)
+        {
+            delete monitor.pLayout;
+            ImGui::DestroyContext(monitor.pContext);
+        }
+    }
+}
+
+// A panel whose data takes a while to aggregate. Prepare averages a fresh batch of samples, Emit only shows the result.
+struct AggregatedPanel
+{
+    int      index;
+    int      sampleCount;
+    uint32_t seed;
+    double   means[2];
+};
+
+static void AggregatedPanelPrepare(void* pUserData, uint32_t bufferIndex)
+{
+    AggregatedPanel* pPanel = (AggregatedPanel*)pUserData;
+    double sum = 0.0;
+    for (int i = 0; i < pPanel->sampleCount; i++)
+    {
+        pPanel->seed = pPanel->seed * 1664525u + 1013904223u;
+        sum += (double)(pPanel->seed >> 8) / (double)(1u << 24);
+    }
+    pPanel->means[bufferIndex] = sum / pPanel->sampleCount;
+}
+
+static void AggregatedPanelEmit(void* pUserData, uint32_t bufferIndex)
+{
+    AggregatedPanel* pPanel = (AggregatedPanel*)pUserData;
+    char name[32];
+    snprintf(name, sizeof(name), "Aggregated Panel %d", pPanel->index);
+    ImGui::Begin(name, nullptr, TestWindowFlag);
+    ImGui::Text("Mean of %d samples: %.6f", pPanel->sampleCount, pPanel->means[bufferIndex]);
+    DrawBasicTrees();
+    ImGui::End();
+}
+
+// Runs the aggregated panels as two-phase leaves. Without a job system, Prepare runs inline on the UI thread.
+static double RunAggregatedPanels(
+    AggregatedPanel*         pPanels,
+    int                      panelCount,
+    int                      frameCount,
+    DearImGuiExt::JobSystem* pJobSystem,
+    uint64_t*                pLateFrames,
+    double*                  pMaxLatencyMs)
+{
+    ImVector<DearImGuiExt::CustomLayoutNode*> leaves;
+    DearImGuiExt::CustomLayoutNode* pRoot = BalancedLayout(HeavyPanels.data(), panelCount);
+    pRoot->CollectLeaves(leaves);
+    for (int i = 0; i < leaves.Size; i++)
+    {
+        leaves[i]->SetPrepareStage(AggregatedPanelPrepare, AggregatedPanelEmit, &pPanels[i]);
+    }
+
+    DearImGuiExt::CustomLayout layout(pRoot);
+    layout.SetJobSystem(pJobSystem);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < frameCount; i++)
+    {
+        BuildFrame(layout);
+    }
+    double frameMs = ElapsedMs(start) / frameCount;
+
+    *pLateFrames = 0;
+    *pMaxLatencyMs = 0.0;
+    for (const DearImGuiExt::CustomLeafPrepareStats& leaf : layout.GetStats().leafPrepares)
+    {
+        *pLateFrames += leaf.lateFrames;
+        *pMaxLatencyMs = std::max(*pMaxLatencyMs, leaf.maxLatencyMs);
+    }
+    return frameMs;
+}
+
+// Preparing on the UI thread vs. on the job system while the rest of the frame is built.
+static void BenchTwoPhase()
+{
+    constexpr int PanelCount = 8;
+    constexpr int FrameCount = 300;
+    const int sampleCounts[] = { 20000, 200000, 2000000 };
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    DearImGuiExt::JobSystem jobSystem(DearImGuiExt::JobSystem::DefaultWorkerCount());
+    printf("[two_phase] %d frames of %d aggregated leaves at 1920x1080.\n", FrameCount, PanelCount);
+
+    for (int sampleCount : sampleCounts)
+    {
+        AggregatedPanel panels[PanelCount];
+        for (int i = 0; i < PanelCount; i++)
+        {
+            panels[i] = AggregatedPanel{ i, sampleCount, (uint32_t)i + 1, { 0.0, 0.0 } };
+        }
+
+        uint64_t lateFrames = 0;
+        double maxLatencyMs = 0.0;
+        double inlineMs = RunAggregatedPanels(panels, PanelCount, FrameCount, nullptr, &lateFrames, &maxLatencyMs);
+        double jobsMs = RunAggregatedPanels(panels, PanelCount, FrameCount, &jobSystem, &lateFrames, &maxLatencyMs);
+
+        printf("  %7d samples: inline %.3f ms/frame, job system %.3f ms/frame (%.1f%% late leaf frames, max prepare latency %.3f ms)\n",
+               sampleCount,
+               inlineMs,
+               jobsMs,
+               100.0 * (double)lateFrames / (double)(FrameCount * PanelCount),
+               maxLatencyMs);
+    }
+
+    ImGui::DestroyContext(pContext);
+}
+
+static void CollectNodeIds(
+    DearImGuiExt::CustomLayoutNode* pNode,
+    ImVector<uint32_t>&             nodeIds)
+{
+    nodeIds.push_back(pNode->GetId());
+    if (pNode->IsLogicalDomain())
+    {
+        CollectNodeIds(pNode->GetLeftChild(), nodeIds);
+        CollectNodeIds(pNode->GetRightChild(), nodeIds);
+    }
+}
+
+// Stress test of the command queue: producer threads post random edits on the nodes published after every frame, while
+// the UI thread applies them and builds frames. Meant to be run under ThreadSanitizer as well.
+static void BenchMutationQueue()
+{
+    constexpr int ProducerCount = 4;
+    constexpr int CommandsPerProducer = 20000;
+    constexpr int CommandsPerFrame = 4;  // Per producer and frame. The producers and the UI thread stay at most a frame
+                                         // apart, so most commands target nodes that still exist.
+    constexpr int MaxNodeCount = 64;     // Above it, the producers remove nodes instead of adding windows.
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    CustomWindowFunc funcs[] = { BlenderStyleTestLeftUpWindow, BlenderStyleTestLeftDownWindow,
+                                 BlenderStyleTestRightUpWindow, BlenderStyleTestRightDownWindow };
+    DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, 4));
+
+    // Producers only see node IDs. Commands on removed nodes are dropped by the layout.
+    std::mutex nodesMutex;
+    ImVector<uint32_t> publishedNodes;
+    CollectNodeIds(layout.m_pRoot, publishedNodes);
+
+    std::atomic<int> publishedFrames(0);
+    std::atomic<int> postedCommands(0);
+    std::atomic<int> finishedProducers(0);
+    std::vector<std::thread> producers;
+    Clock::time_point start = Clock::now();
+    for (int producer = 0; producer < ProducerCount; producer++)
+    {
+        producers.emplace_back([&, producer]()
+        {
+            uint32_t seed = (uint32_t)producer * 7919u + 1u;
+            for (int i = 0; i < CommandsPerProducer; i++)
+            {
+                while (publishedFrames < i / CommandsPerFrame)
+                {
+                    std::this_thread::yield();
+                }
+
+                seed = seed * 1664525u + 1013904223u;
+                uint32_t nodeId = 0;
+                bool shrink = false;
+                {
+                    std::lock_guard<std::mutex> lock(nodesMutex);
+                    nodeId = publishedNodes[(int)((seed >> 8) % (uint32_t)publishedNodes.Size)];
+                    shrink = publishedNodes.Size > MaxNodeCount;
+                }
+
+                float ratio = (float)((seed >> 4) % 64u + 16u) / 96.f;
+                CustomWindowFunc windowFunc = funcs[(seed >> 12) % 4u];
+                uint32_t roll = (seed >> 16) % 10u;
+                if (shrink && (roll < 4u))
+                {
+                    roll += 4u;
+                }
+
+                switch (roll)
+                {
+                case 0:
+                case 1:
+                    layout.PostSplit(nodeId, windowFunc, ratio, (seed & 1u) != 0u);
+                    break;
+                case 2:
+                case 3:
+                    layout.PostInsert(nodeId, windowFunc, ratio, (seed & 2u) != 0u);
+                    break;
+                case 4:
+                case 5:
+                    layout.PostRemove(nodeId);
+                    break;
+                case 6:
+                    layout.PostMerge(nodeId);
+                    break;
+                default:
+                    layout.PostSetRatio(nodeId, ratio);
+                    break;
+                }
+                postedCommands++;
+            }
+            finishedProducers++;
+        });
+    }
+
+    int frameCount = 0;
+    double maxFrameMs = 0.0;
+    while (finishedProducers < ProducerCount)
+    {
+        while ((postedCommands < (publishedFrames - 1) * CommandsPerFrame * ProducerCount) &&
+               (finishedProducers < ProducerCount))
+        {
+            std::this_thread::yield();
+        }
+
+        Clock::time_point frameStart = Clock::now();
+        BuildFrame(layout);
+        maxFrameMs = std::max(maxFrameMs, ElapsedMs(frameStart));
+        frameCount++;
+
+        std::lock_guard<std::mutex> lock(nodesMutex);
+        publishedNodes.resize(0);
+        CollectNodeIds(layout.m_pRoot, publishedNodes);
+        publishedFrames++;
+    }
+
+    for (std::thread& producer : producers)
+    {
+        producer.join();
+    }
+    BuildFrame(layout);
+    double totalMs = ElapsedMs(start);
+
+    const DearImGuiExt::CustomLayoutStats& stats = layout.GetStats();
+    ImVector<DearImGuiExt::CustomLayoutNode*> leaves;
+    layout.m_pRoot->CollectLeaves(leaves);
+    uint64_t commandCount = stats.appliedCommands + stats.droppedCommands;
+    printf("[mutation_queue] %d producers posting %d commands each.\n", ProducerCount, CommandsPerProducer);
+    printf("  %llu commands in %.1f ms (%.0f commands/s): %llu applied, %llu dropped, %s\n",
+           (unsigned long long)commandCount,
+           totalMs,
+           (double)commandCount / (totalMs / 1000.0),
+           (unsigned long long)stats.appliedCommands,
+           (unsigned long long)stats.droppedCommands,
+           (commandCount == (uint64_t)ProducerCount * CommandsPerProducer) ? "none lost" : "COMMANDS LOST");
+    printf("  %d frames, max frame %.3f ms, %d leaves at the end\n", frameCount + 1, maxFrameMs, leaves.Size);
+
+    ImGui::DestroyContext(pContext);
+}
+
+// Random split and merge operations on the UI thread between frames. Every split is eventually undone by a merge, so the
+// node free list makes the steady state allocation free.
+static void BenchSplitMerge()
+{
+    constexpr int OperationsPerFrame = 1000;
+    constexpr int FrameCount = 200;
+    constexpr int MinLeafCount = 4;
+    constexpr int MaxLeafCount = 64;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    CustomWindowFunc funcs[] = { BlenderStyleTestLeftUpWindow, BlenderStyleTestLeftDownWindow,
+                                 BlenderStyleTestRightUpWindow, BlenderStyleTestRightDownWindow };
+    DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, 4));
+    BuildFrame(layout);
+
+    ImVector<DearImGuiExt::CustomLayoutNode*> leaves;
+    layout.m_pRoot->CollectLeaves(leaves);
+    // The probe leaf is never merged away. It has to keep its node and ID through all the edits around it.
+    DearImGuiExt::CustomLayoutNode* pProbe = leaves[0];
+    uint32_t probeId = pProbe->GetId();
+
+    uint32_t seed = 1;
+    uint64_t splits = 0;
+    uint64_t merges = 0;
+    uint64_t createdAfterWarmUp = 0;
+    double operationsMs = 0.0;
+    for (int frame = 0; frame < FrameCount; frame++)
+    {
+        uint64_t createdBefore = layout.GetStats().nodesCreated;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < OperationsPerFrame; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            int index = (int)((seed >> 8) % (uint32_t)leaves.Size);
+            DearImGuiExt::CustomLayoutNode* pLeaf = leaves[index];
+            DearImGuiExt::CustomLayoutNode* pParent = pLeaf->GetParent();
+            DearImGuiExt::CustomLayoutNode* pSibling = pParent ?
+                ((pParent->GetLeftChild() == pLeaf) ? pParent->GetRightChild() : pParent->GetLeftChild()) : nullptr;
+
+            bool merge = (pSibling != nullptr) && (pSibling->IsLogicalDomain() == false) && (pSibling != pProbe) &&
+                         (leaves.Size > MinLeafCount) &&
+                         ((leaves.Size >= MaxLeafCount) || ((seed >> 20) & 1u));
+            if (merge)
+            {
+                layout.MergeWithSibling(pLeaf);
+                leaves.find_erase_unsorted(pSibling);
+                merges++;
+            }
+            else
+            {
+                float ratio = (float)((seed >> 4) % 64u + 16u) / 96.f;
+                leaves.push_back(layout.SplitLeaf(pLeaf, funcs[(seed >> 12) % 4u], ratio, (seed & 1u) != 0u));
+                splits++;
+            }
+        }
+        operationsMs += ElapsedMs(start);
+
+        // The first frames fill the free list.
+        if (frame >= 10)
+        {
+            createdAfterWarmUp += layout.GetStats().nodesCreated - createdBefore;
+        }
+        BuildFrame(layout);
+    }
+
+    const DearImGuiExt::CustomLayoutStats& stats = layout.GetStats();
+    uint64_t operationCount = splits + merges;
+    printf("[split_merge] %d frames with %d split or merge operations each.\n", FrameCount, OperationsPerFrame);
+    printf("  %.0f operations/s (%.3f us each): %llu splits, %llu merges, %d leaves at the end\n",
+           (double)operationCount / (operationsMs / 1000.0),
+           operationsMs * 1000.0 / (double)operationCount,
+           (unsigned long long)splits,
+           (unsigned long long)merges,
+           leaves.Size);
+    printf("  nodes: %llu created, %llu recycled, %llu created after warm-up, probe leaf %s\n",
+           (unsigned long long)stats.nodesCreated,
+           (unsigned long long)stats.nodesRecycled,
+           (unsigned long long)createdAfterWarmUp,
+           (layout.FindNode(probeId) == pProbe) ? "kept its node and ID" : "LOST ITS IDENTITY");
+
+    ImGui::DestroyContext(pContext);
+}
+
+// Splitter drags on a layout of all heavy panels, each recorded as one history version, then undone and redone. Compares
+// the memory of a version with a full copy of the tree.
+static void BenchHistory()
+{
+    constexpr int WindowCount = HeavyPanelCount;
+    constexpr int DragCount = 5000;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    DearImGuiExt::CustomLayout layout(BalancedLayout(HeavyPanels.data(), WindowCount));
+    BuildFrame(layout);
+
+    ImVector<uint32_t> nodeIds;
+    CollectNodeIds(layout.m_pRoot, nodeIds);
+    ImVector<uint32_t> domainIds;
+    for (int i = 0; i < nodeIds.Size; i++)
+    {
+        if (layout.FindNode(nodeIds[i])->IsLogicalDomain())
+        {
+            domainIds.push_back(nodeIds[i]);
+        }
+    }
+
+    DearImGuiExt::CustomLayoutHistory history(&layout, (size_t)256 * 1024 * 1024);
+    size_t firstVersionBytes = history.GetMemoryUsed();
+
+    uint32_t seed = 1;
+    double recordMs = 0.0;
+    for (int i = 0; i < DragCount; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        DearImGuiExt::CustomLayoutNode* pDomain = layout.FindNode(domainIds[(int)((seed >> 8) % (uint32_t)domainIds.Size)]);
+        layout.SetSplitterRatio(pDomain, (float)((seed >> 4) % 64u + 16u) / 96.f);
+
+        Clock::time_point start = Clock::now();
+        history.Record();
+        recordMs += ElapsedMs(start);
+    }
+    size_t dragBytes = history.GetMemoryUsed() - firstVersionBytes;
+    int versionCount = history.GetUndoCount();
+
+    Clock::time_point undoStart = Clock::now();
+    while (history.Undo())
+    {
+    }
+    double undoMs = ElapsedMs(undoStart);
+    BuildFrame(layout);
+
+    Clock::time_point redoStart = Clock::now();
+    while (history.Redo())
+    {
+    }
+    double redoMs = ElapsedMs(redoStart);
+    BuildFrame(layout);
+
+    printf("[history] %d splitter drags on %d windows (%d nodes), one version each.\n", DragCount, WindowCount, nodeIds.Size);
+    printf("  %d versions, %.1f bytes per version vs %llu bytes for a full copy, %.3f us per record\n",
+           versionCount,
+           (double)dragBytes / (double)ImMax(versionCount, 1),
+           (unsigned long long)firstVersionBytes,
+           recordMs * 1000.0 / (double)DragCount);
+    printf("  undo %.3f us, redo %.3f us per version\n",
+           undoMs * 1000.0 / (double)ImMax(versionCount, 1),
+           redoMs * 1000.0 / (double)ImMax(versionCount, 1));
+
+    history.SetMemoryCap(64 * 1024);
+    printf("  with a 64 KiB cap: %d undo versions kept, %llu bytes used\n",
+           history.GetUndoCount(),
+           (unsigned long long)history.GetMemoryUsed());
+
+    ImGui::DestroyContext(pContext);
+}
+
+// Three resident workspaces sharing the heavy panels. Measures the first frame after switching to a workspace that was
+// never shown, with and without prewarming it, and the first frame of later switches.
+static void RunWorkspaceSwitches(bool prewarm)
+{
+    constexpr int WorkspaceCount = 3;
+    constexpr int SwitchCount = 30;
+    constexpr int FramesPerSwitch = 5;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    DearImGuiExt::CustomWorkspaces workspaces;
+    int offset = 0;
+    for (int i = 0; i < WorkspaceCount; i++)
+    {
+        int count = (HeavyPanelCount - offset) / (WorkspaceCount - i);
+        workspaces.Add(new DearImGuiExt::CustomLayout(BalancedLayout(HeavyPanels.data() + offset, count)));
+        offset += count;
+    }
+
+    for (int frame = 0; frame < 10; frame++)
+    {
+        BuildFrame(workspaces);
+    }
+
+    double prewarmMs = 0.0;
+    if (prewarm)
+    {
+        ImGui::NewFrame();
+        workspaces.BeginEndLayout();
+        Clock::time_point start = Clock::now();
+        for (int i = 1; i < WorkspaceCount; i++)
+        {
+            workspaces.Prewarm(i);
+        }
+        prewarmMs = ElapsedMs(start);
+        ImGui::Render();
+        BuildFrame(workspaces);
+    }
+
+    // The first switch to every other workspace.
+    double firstShowMs = 0.0;
+    uint64_t firstShowAllocations = 0;
+    double steadyMs = 0.0;
+    for (int i = 1; i < WorkspaceCount; i++)
+    {
+        workspaces.SetActive(i);
+        uint64_t allocationsBefore = g_AllocationCount;
+        Clock::time_point start = Clock::now();
+        BuildFrame(workspaces);
+        firstShowMs += ElapsedMs(start);
+        firstShowAllocations += g_AllocationCount - allocationsBefore;
+
+        start = Clock::now();
+        for (int frame = 0; frame < FramesPerSwitch; frame++)
+        {
+            BuildFrame(workspaces);
+        }
+        steadyMs += ElapsedMs(start) / (double)FramesPerSwitch;
+    }
+
+    // Every workspace was shown by now.
+    double switchMs = 0.0;
+    double maxSwitchMs = 0.0;
+    for (int i = 0; i < SwitchCount; i++)
+    {
+        workspaces.SetActive(i % WorkspaceCount);
+        Clock::time_point start = Clock::now();
+        BuildFrame(workspaces);
+        double frameMs = ElapsedMs(start);
+        switchMs += frameMs;
+        maxSwitchMs = ImMax(maxSwitchMs, frameMs);
+        BuildFrame(workspaces);
+    }
+
+    const int firstShowCount = WorkspaceCount - 1;
+    printf("  %-10s first frame %.3f ms (%llu allocations), steady frame %.3f ms, later switches %.3f ms avg %.3f ms max",
+           prewarm ? "prewarmed:" : "cold:",
+           firstShowMs / firstShowCount,
+           (unsigned long long)(firstShowAllocations / firstShowCount),
+           steadyMs / firstShowCount,
+           switchMs / SwitchCount,
+           maxSwitchMs);
+    if (prewarm)
+    {
+        printf(", prewarm %.3f ms", prewarmMs);
+    }
+    printf("\n");
+
+    ImGui::DestroyContext(pContext);
+}
+
+static void BenchWorkspaces()
+{
+    printf("[workspaces] 3 workspaces of the %d heavy panels, first frame after a switch.\n", HeavyPanelCount);
+    RunWorkspaceSwitches(false);
+    RunWorkspaceSwitches(true);
+}
+
+// Frames until the frame time settles, starting from a new context and layout. A frame is stable when it and every frame
+// after it stay within 1.5 times the median of the last half.
+struct WarmUpResult
+{
+    double   firstFrameMs;
+    double   timeToStableMs; // Includes the warm-up frame.
+    int      framesToStable;
+    uint64_t firstFrameAllocations;
+};
+
+static WarmUpResult RunWarmUp(
+    bool                                        warmUp,
+    ImVector<DearImGuiExt::CustomLeafCapacity>& capacities)
+{
+    constexpr int FrameCount = 100;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    DearImGuiExt::CustomLayout layout(BalancedLayout(HeavyPanels.data(), HeavyPanelCount));
+    ImVector<DearImGuiExt::CustomLayoutNode*> leaves;
+    layout.m_pRoot->CollectLeaves(leaves);
+
+    WarmUpResult result = {};
+    double warmUpMs = 0.0;
+    if (warmUp)
+    {
+        for (int i = 0; (i < leaves.Size) && (i < capacities.Size); i++)
+        {
+            leaves[i]->SetCapacityHint(capacities[i]);
+        }
+
+        Clock::time_point start = Clock::now();
+        ImGui::NewFrame();
+        layout.WarmUp();
+        ImGui::Render();
+        warmUpMs = ElapsedMs(start);
+    }
+
+    double frameMs[FrameCount];
+    for (int frame = 0; frame < FrameCount; frame++)
+    {
+        uint64_t allocationsBefore = g_AllocationCount;
+        Clock::time_point start = Clock::now();
+        BuildFrame(layout);
+        frameMs[frame] = ElapsedMs(start);
+        if (frame == 0)
+        {
+            result.firstFrameAllocations = g_AllocationCount - allocationsBefore;
+        }
+    }
+
+    double sorted[FrameCount / 2];
+    std::copy(frameMs + FrameCount / 2, frameMs + FrameCount, sorted);
+    std::sort(sorted, sorted + FrameCount / 2);
+    double stableMs = sorted[FrameCount / 4] * 1.5;
+
+    int firstStable = FrameCount;
+    while ((firstStable > 0) && (frameMs[firstStable - 1] <= stableMs))
+    {
+        firstStable--;
+    }
+
+    result.firstFrameMs = frameMs[0];
+    result.framesToStable = firstStable + 1;
+    result.timeToStableMs = warmUpMs;
+    for (int frame = 0; (frame <= firstStable) && (frame < FrameCount); frame++)
+    {
+        result.timeToStableMs += frameMs[frame];
+    }
+
+    // The draw list sizes of the last frame are the hints of the next run, like a previous session would record them.
+    capacities.resize(0);
+    for (int i = 0; i < leaves.Size; i++)
+    {
+        DearImGuiExt::CustomLeafCapacity capacity = {};
+        if (ImGuiWindow* pWindow = leaves[i]->GetWindow())
+        {
+            capacity.vtxCount = pWindow->DrawList->VtxBuffer.Size;
+            capacity.idxCount = pWindow->DrawList->IdxBuffer.Size;
+            capacity.cmdCount = pWindow->DrawList->CmdBuffer.Size;
+        }
+        capacities.push_back(capacity);
+    }
+
+    ImGui::DestroyContext(pContext);
+    return result;
+}
+
+static void BenchWarmUp()
+{
+    ImVector<DearImGuiExt::CustomLeafCapacity> capacities;
+    WarmUpResult cold = RunWarmUp(false, capacities);
+    WarmUpResult warm = RunWarmUp(true, capacities);
+
+    printf("[warm_up] %d heavy panels, from a new context to the first stable frame.\n", HeavyPanelCount);
+    printf("  without warm-up: first frame %.3f ms (%llu allocations), stable after %d frames, %.3f ms\n",
+           cold.firstFrameMs,
+           (unsigned long long)cold.firstFrameAllocations,
+           cold.framesToStable,
+           cold.timeToStableMs);
+    printf("  with warm-up:    first frame %.3f ms (%llu allocations), stable after %d frames, %.3f ms with the warm-up frame\n",
+           warm.firstFrameMs,
+           (unsigned long long)warm.firstFrameAllocations,
+           warm.framesToStable,
+           warm.timeToStableMs);
+}
+
+// A panel whose content grows over the first frames, like a log filling up after startup.
+template<int Index>
+void GrowingPanelWindow()
+{
+    char name[32];
+    snprintf(name, sizeof(name), "Growing Panel %d", Index);
+    ImGui::Begin(name, nullptr, TestWindowFlag);
+    int rowCount = ImMin(ImGui::GetFrameCount() * 4, 400);
+    for (int i = 0; i < rowCount; i++)
+    {
+        ImGui::Text("Panel %d row %d value %.3f", Index, i, (float)i * 0.001f);
+    }
+    ImGui::End();
+}
+
+// Allocations made through Dear ImGui over the first frames of a session, optionally starting from a saved state.
+static void RunCapacitySession(
+    const char*      pLabel,
+    const char*      pSavedState,
+    bool             warmUp,
+    ImGuiTextBuffer& savedState)
+{
+    constexpr int FrameCount = 100;
+    CustomWindowFunc funcs[] = { GrowingPanelWindow<0>, GrowingPanelWindow<1>, GrowingPanelWindow<2>, GrowingPanelWindow<3>,
+                                 GrowingPanelWindow<4>, GrowingPanelWindow<5>, GrowingPanelWindow<6>, GrowingPanelWindow<7> };
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, 8));
+    if (pSavedState)
+    {
+        layout.LoadState(pSavedState);
+    }
+
+    uint64_t allocationsBefore = g_AllocationCount;
+    if (warmUp)
+    {
+        ImGui::NewFrame();
+        layout.WarmUp();
+        ImGui::Render();
+    }
+    uint64_t warmUpAllocations = g_AllocationCount - allocationsBefore;
+
+    uint64_t firstFrameAllocations = 0;
+    int framesWithAllocations = 0;
+    for (int frame = 0; frame < FrameCount; frame++)
+    {
+        uint64_t frameStart = g_AllocationCount;
+        BuildFrame(layout);
+        uint64_t frameAllocations = g_AllocationCount - frameStart;
+        if (frame == 0)
+        {
+            firstFrameAllocations = frameAllocations;
+        }
+        if (frameAllocations > 0)
+        {
+            framesWithAllocations++;
+        }
+    }
+
+    printf("  %-22s %llu allocations in %d frames (%llu in the first frame, %llu warming up), %d frames allocated\n",
+           pLabel,
+           (unsigned long long)(g_AllocationCount - allocationsBefore),
+           FrameCount,
+           (unsigned long long)firstFrameAllocations,
+           (unsigned long long)warmUpAllocations,
+           framesWithAllocations);
+
+    savedState.clear();
+    layout.SaveState(savedState);
+    ImGui::DestroyContext(pContext);
+}
+
+static void BenchCapacityHighWaterMark()
+{
+    printf("[capacity_hwm] 8 panels growing over the first 100 frames.\n");
+    ImGuiTextBuffer savedState;
+    ImGuiTextBuffer unused;
+    RunCapacitySession("first session:", nullptr, false, savedState);
+    RunCapacitySession("with saved peaks:", savedState.c_str(), false, unused);
+    RunCapacitySession("saved peaks, warm-up:", savedState.c_str(), true, unused);
+}
+
+static void CollectDomainRects(
+    DearImGuiExt::CustomLayoutNode* pNode,
+    ImVector<ImVec4>&               rects)
+{
+    if (pNode->IsHidden())
+    {
+        return;
+    }
+    rects.push_back(ImVec4(pNode->GetDomainPos().x, pNode->GetDomainPos().y, pNode->GetDomainSize().x, pNode->GetDomainSize().y));
+    if (pNode->IsLogicalDomain())
+    {
+        CollectDomainRects(pNode->GetLeftChild(), rects);
+        CollectDomainRects(pNode->GetRightChild(), rects);
+    }
+}
+
+// 10k ratio and visibility updates on a large tree, applied one by one and in a single transaction. No frames are built.
+static void BenchBatchedUpdates()
+{
+    constexpr int WindowCount = 4096;
+    constexpr int UpdateCount = 10000;
+
+    std::vector<CustomWindowFunc> funcs(WindowCount, BlenderStyleTestLeftUpWindow);
+    DearImGuiExt::CustomLayout naive(BalancedLayout(funcs.data(), WindowCount));
+    DearImGuiExt::CustomLayout batched(BalancedLayout(funcs.data(), WindowCount));
+    naive.m_pRoot->ResizeNodeAndChildren(ImVec2(0.f, 0.f), ImVec2(1920.f, 1080.f));
+    batched.m_pRoot->ResizeNodeAndChildren(ImVec2(0.f, 0.f), ImVec2(1920.f, 1080.f));
+
+    // Both layouts got the same node IDs.
+    ImVector<uint32_t> nodeIds;
+    CollectNodeIds(naive.m_pRoot, nodeIds);
+
+    double timesMs[2] = {};
+    for (int pass = 0; pass < 2; pass++)
+    {
+        DearImGuiExt::CustomLayout& layout = (pass == 0) ? naive : batched;
+        uint32_t seed = 1;
+        Clock::time_point start = Clock::now();
+        if (pass == 1)
+        {
+            layout.BeginTransaction();
+        }
+        for (int i = 0; i < UpdateCount; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            DearImGuiExt::CustomLayoutNode* pNode = layout.FindNode(nodeIds[1 + (int)((seed >> 8) % (uint32_t)(nodeIds.Size - 1))]);
+            if ((seed >> 28) == 0)
+            {
+                layout.SetNodeVisible(pNode, pNode->IsHidden());
+            }
+            else if (pNode->IsLogicalDomain())
+            {
+                layout.SetSplitterRatio(pNode, (float)((seed >> 4) % 64u + 16u) / 96.f);
+            }
+            else
+            {
+                layout.SetSplitterRatio(pNode->GetParent(), (float)((seed >> 4) % 64u + 16u) / 96.f);
+            }
+        }
+        if (pass == 1)
+        {
+            layout.EndTransaction();
+        }
+        timesMs[pass] = ElapsedMs(start);
+    }
+
+    ImVector<ImVec4> naiveRects;
+    ImVector<ImVec4> batchedRects;
+    CollectDomainRects(naive.m_pRoot, naiveRects);
+    CollectDomainRects(batched.m_pRoot, batchedRects);
+    bool same = (naiveRects.Size == batchedRects.Size) &&
+                (memcmp(naiveRects.Data, batchedRects.Data, (size_t)naiveRects.size_in_bytes()) == 0);
+
+    printf("[batched_updates] %d ratio and visibility updates on %d windows.\n", UpdateCount, WindowCount);
+    printf("  one by one %.3f ms, in a transaction %.3f ms (%.1fx), same rects: %s\n",
+           timesMs[0],
+           timesMs[1],
+           timesMs[0] / ImMax(timesMs[1], 1e-6),
+           same ? "yes" : "NO");
+}
+
+// A random tree of windows. The splitter ratios stay between 1/6 and 5/6.
+static void FillRandomDomain(
+    DearImGuiExt::CustomLayoutNode* pDomain,
+    int                             windowCount,
+    uint32_t&                       seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    int leftCount = 1 + (int)((seed >> 8) % (uint32_t)(windowCount - 1));
+    int rightCount = windowCount - leftCount;
+
+    if (leftCount == 1)
+    {
+        pDomain->CreateLeftChild(BlenderStyleTestLeftUpWindow);
+    }
+    else
+    {
+        seed = seed * 1664525u + 1013904223u;
+        pDomain->CreateLeftChild((float)((seed >> 8) % 64u + 16u) / 96.f);
+        FillRandomDomain(pDomain->GetLeftChild(), leftCount, seed);
+    }
+
+    if (rightCount == 1)
+    {
+        pDomain->CreateRightChild(BlenderStyleTestLeftUpWindow);
+    }
+    else
+    {
+        seed = seed * 1664525u + 1013904223u;
+        pDomain->CreateRightChild((float)((seed >> 8) % 64u + 16u) / 96.f);
+        FillRandomDomain(pDomain->GetRightChild(), rightCount, seed);
+    }
+}
+
+static void CollectVisibleNodes(
+    DearImGuiExt::CustomLayoutNode*          pNode,
+    ImVector<DearImGuiExt::CustomLayoutNode*>& nodes)
+{
+    if (pNode->IsHidden())
+    {
+        return;
+    }
+    nodes.push_back(pNode);
+    if (pNode->IsLogicalDomain())
+    {
+        CollectVisibleNodes(pNode->GetLeftChild(), nodes);
+        CollectVisibleNodes(pNode->GetRightChild(), nodes);
+    }
+}
+
+// Whole pixel sizes for the visible nodes of a subtree, in the order of CollectVisibleNodes(). Every domain is split at a
+// random place that leaves its children at least their minimum size, so all the sizes fit together exactly.
+static void CollectWholePixelSizes(
+    const DearImGuiExt::CustomLayoutNode* pNode,
+    ImVec2                                size,
+    uint32_t&                             seed,
+    ImVector<ImVec2>&                     sizes)
+{
+    if (pNode->IsHidden())
+    {
+        return;
+    }
+    sizes.push_back(size);
+    if (pNode->IsLogicalDomain() == false)
+    {
+        return;
+    }
+
+    const DearImGuiExt::CustomLayoutNode* pLeft = pNode->GetLeftChild();
+    const DearImGuiExt::CustomLayoutNode* pRight = pNode->GetRightChild();
+    if (pLeft->IsHidden() || pRight->IsHidden())
+    {
+        CollectWholePixelSizes(pLeft, size, seed, sizes);
+        CollectWholePixelSizes(pRight, size, seed, sizes);
+        return;
+    }
+
+    int axis = (pNode->GetLevel() % 2 == 1) ? 0 : 1;
+    float leftMin = pLeft->GetSizeLimitMin()[axis];
+    float slack = size[axis] - pNode->GetSplitterWidth() - leftMin - pRight->GetSizeLimitMin()[axis];
+    seed = seed * 1664525u + 1013904223u;
+    ImVec2 leftSize = size;
+    leftSize[axis] = leftMin + ImFloor(slack * (float)((seed >> 8) % 1000u) / 1000.f);
+    ImVec2 rightSize = size;
+    rightSize[axis] = size[axis] - pNode->GetSplitterWidth() - leftSize[axis];
+    CollectWholePixelSizes(pLeft, leftSize, seed, sizes);
+    CollectWholePixelSizes(pRight, rightSize, seed, sizes);
+}
+
+// Largest error in pixels of a laid out subtree: gaps or overlaps between the children and the splitter of a domain, and
+// sizes out of the constraints.
+static float LayoutError(const DearImGuiExt::CustomLayoutNode* pNode)
+{
+    ImVec2 pos = pNode->GetDomainPos();
+    ImVec2 size = pNode->GetDomainSize();
+    float error = ImMax(ImMax(pNode->GetMinSize().x - size.x, pNode->GetMinSize().y - size.y),
+                        ImMax(size.x - pNode->GetMaxSize().x, size.y - pNode->GetMaxSize().y));
+    if (pNode->IsLogicalDomain() == false)
+    {
+        return ImMax(error, 0.f);
+    }
+
+    const DearImGuiExt::CustomLayoutNode* pLeft = pNode->GetLeftChild();
+    const DearImGuiExt::CustomLayoutNode* pRight = pNode->GetRightChild();
+    if (pLeft->IsHidden() && pRight->IsHidden())
+    {
+        return ImMax(error, 0.f);
+    }
+    else if (pLeft->IsHidden() || pRight->IsHidden())
+    {
+        const DearImGuiExt::CustomLayoutNode* pShown = pLeft->IsHidden() ? pRight : pLeft;
+        error = ImMax(error, ImMax(ImFabs(pShown->GetDomainPos().x - pos.x), ImFabs(pShown->GetDomainPos().y - pos.y)));
+        error = ImMax(error, ImMax(ImFabs(pShown->GetDomainSize().x - size.x), ImFabs(pShown->GetDomainSize().y - size.y)));
+        return ImMax(error, LayoutError(pShown));
+    }
+
+    int axis = (pNode->GetLevel() % 2 == 1) ? 0 : 1;
+    int crossAxis = axis ^ 1;
+    float splitterCoord = pNode->GetSplitterStartCoord();
+    error = ImMax(error, ImFabs(pLeft->GetDomainPos()[axis] - pos[axis]));
+    error = ImMax(error, ImFabs(pLeft->GetDomainPos()[axis] + pLeft->GetDomainSize()[axis] - splitterCoord));
+    error = ImMax(error, ImFabs(pRight->GetDomainPos()[axis] - (splitterCoord + pNode->GetSplitterWidth())));
+    error = ImMax(error, ImFabs(pRight->GetDomainPos()[axis] + pRight->GetDomainSize()[axis] - (pos[axis] + size[axis])));
+    for (const DearImGuiExt::CustomLayoutNode* pChild : { pLeft, pRight })
+    {
+        error = ImMax(error, ImFabs(pChild->GetDomainPos()[crossAxis] - pos[crossAxis]));
+        error = ImMax(error, ImFabs(pChild->GetDomainSize()[crossAxis] - size[crossAxis]));
+    }
+    return ImMax(error, ImMax(LayoutError(pLeft), LayoutError(pRight)));
+}
+
+// Property checks on random trees, then full layouts of up to 100k nodes with and without constraints.
+// The constraints of a random tree come from a layout of it, so there is a size that meets all of them. Every root size within
+// the root's limits then has to meet them as well, and the fixed panels have to keep exactly their size.
+static void BenchConstraints()
+{
+    constexpr int TreeCount = 500;
+    constexpr int ResizeCount = 20;
+    constexpr float Tolerance = 0.01f;
+
+    uint32_t seed = 7;
+    int constrainedCount = 0;
+    int fixedCount = 0;
+    int failedTrees = 0;
+    int resizedFixedPanels = 0;
+    int incrementalMismatches = 0;
+    float maxError = 0.f;
+    for (int tree = 0; tree < TreeCount; tree++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int windowCount = 2 + (int)((seed >> 8) % 63u);
+        seed = seed * 1664525u + 1013904223u;
+        DearImGuiExt::CustomLayoutNode* pRoot = new DearImGuiExt::CustomLayoutNode((float)((seed >> 8) % 64u + 16u) / 96.f);
+        FillRandomDomain(pRoot, windowCount, seed);
+        DearImGuiExt::CustomLayout layout(pRoot);
+
+        seed = seed * 1664525u + 1013904223u;
+        ImVec2 referenceSize((float)(800u + (seed >> 8) % 1600u), (float)(600u + (seed >> 20) % 1000u));
+        layout.m_pRoot->ResizeNodeAndChildren(ImVec2(0.f, 0.f), referenceSize);
+
+        ImVector<DearImGuiExt::CustomLayoutNode*> nodes;
+        layout.m_pRoot->CollectNodes(nodes);
+        for (int i = 1; i < nodes.Size; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            if ((seed >> 8) % 10u == 0)
+            {
+                layout.SetNodeVisible(nodes[i], false);
+            }
+        }
+
+        // Fixed, min, max or both, taken from a whole pixel layout at the reference size.
+        referenceSize = ImMax(referenceSize, layout.m_pRoot->GetSizeLimitMin());
+        nodes.resize(0);
+        CollectVisibleNodes(layout.m_pRoot, nodes);
+        ImVector<ImVec2> sizes;
+        CollectWholePixelSizes(layout.m_pRoot, referenceSize, seed, sizes);
+        ImVector<DearImGuiExt::CustomLayoutNode*> constrained;
+        ImVector<ImVec4> constraints;
+        for (int i = 1; i < nodes.Size; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            if ((seed >> 8) % 4u != 0)
+            {
+                continue;
+            }
+            ImVec2 size = sizes[i];
+            switch ((seed >> 16) % 4u)
+            {
+            case 0: constraints.push_back(ImVec4(size.x, size.y, size.x, size.y)); break;
+            case 1: constraints.push_back(ImVec4(ImFloor(size.x * 0.5f), ImFloor(size.y * 0.5f), FLT_MAX, FLT_MAX)); break;
+            case 2: constraints.push_back(ImVec4(0.f, 0.f, ImCeil(size.x * 1.5f), ImCeil(size.y * 1.5f))); break;
+            default: constraints.push_back(ImVec4(ImFloor(size.x * 0.75f), ImFloor(size.y * 0.75f), ImCeil(size.x * 1.25f), ImCeil(size.y * 1.25f))); break;
+            }
+            constrained.push_back(nodes[i]);
+        }
+
+        // Half of the trees get their constraints one by one, the other half in a transaction.
+        if (tree % 2 == 1)
+        {
+            layout.BeginTransaction();
+        }
+        for (int i = 0; i < constrained.Size; i++)
+        {
+            layout.SetNodeSizeConstraints(constrained[i],
+                                          ImVec2(constraints[i].x, constraints[i].y),
+                                          ImVec2(constraints[i].z, constraints[i].w));
+        }
+        if (tree % 2 == 1)
+        {
+            layout.EndTransaction();
+        }
+        constrainedCount += constrained.Size;
+
+        // The layouts of the edited subtrees have to match a full layout.
+        ImVector<ImVec4> incrementalRects;
+        ImVector<ImVec4> fullRects;
+        CollectDomainRects(layout.m_pRoot, incrementalRects);
+        layout.m_pRoot->ResizeNodeAndChildren(ImVec2(0.f, 0.f), referenceSize);
+        CollectDomainRects(layout.m_pRoot, fullRects);
+        if ((incrementalRects.Size != fullRects.Size) ||
+            (memcmp(incrementalRects.Data, fullRects.Data, (size_t)fullRects.size_in_bytes()) != 0))
+        {
+            incrementalMismatches++;
+        }
+
+        ImVector<DearImGuiExt::CustomLayoutNode*> fixedPanels;
+        ImVector<ImVec2> fixedSizes;
+        for (int i = 0; i < constrained.Size; i++)
+        {
+            if ((constraints[i].x == constraints[i].z) && (constraints[i].y == constraints[i].w))
+            {
+                fixedPanels.push_back(constrained[i]);
+                fixedSizes.push_back(ImVec2(constraints[i].x, constraints[i].y));
+            }
+        }
+        fixedCount += fixedPanels.Size;
+
+        float treeError = LayoutError(layout.m_pRoot);
+        ImVec2 limitMin = layout.m_pRoot->GetSizeLimitMin();
+        ImVec2 limitMax = ImMin(layout.m_pRoot->GetSizeLimitMax(), ImVec2(limitMin.x + 2500.f, limitMin.y + 2500.f));
+        for (int resize = 0; resize < ResizeCount; resize++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            ImVec2 size(limitMin.x + (limitMax.x - limitMin.x) * (float)((seed >> 8) & 0xFFu) / 255.f,
+                        limitMin.y + (limitMax.y - limitMin.y) * (float)((seed >> 16) & 0xFFu) / 255.f);
+            layout.m_pRoot->ResizeNodeAndChildren(ImVec2(0.f, 0.f), size);
+            treeError = ImMax(treeError, LayoutError(layout.m_pRoot));
+            for (int i = 0; i < fixedPanels.Size; i++)
+            {
+                if ((fixedPanels[i]->GetDomainSize().x != fixedSizes[i].x) || (fixedPanels[i]->GetDomainSize().y != fixedSizes[i].y))
+                {
+                    resizedFixedPanels++;
+                }
+            }
+        }
+
+        maxError = ImMax(maxError, treeError);
+        if (treeError > Tolerance)
+        {
+            failedTrees++;
+        }
+    }
+
+    printf("[constraints] %d random trees, %d constrained nodes (%d fixed), %d root sizes each.\n",
+           TreeCount,
+           constrainedCount,
+           fixedCount,
+           ResizeCount);
+    printf("  trees out of tolerance: %d (max error %.5f px), fixed panel size changes: %d, incremental != full: %d\n",
+           failedTrees,
+           maxError,
+           resizedFixedPanels,
+           incrementalMismatches);
+
+    // Linear time: the cost per node stays flat as the tree grows.
+    constexpr int LayoutCount = 20;
+    for (int windowCount = 6250; windowCount <= 50000; windowCount *= 2)
+    {
+        std::vector<CustomWindowFunc> funcs(windowCount, BlenderStyleTestLeftUpWindow);
+        DearImGuiExt::CustomLayout layout(BalancedLayout(funcs.data(), windowCount));
+        int nodeCount = 2 * windowCount - 1;
+
+        double timesMs[2] = {};
+        for (int pass = 0; pass < 2; pass++)
+        {
+            if (pass == 1)
+            {
+                ImVector<DearImGuiExt::CustomLayoutNode*> leaves;
+                layout.m_pRoot->CollectLeaves(leaves);
+                layout.BeginTransaction();
+                for (int i = 0; i < leaves.Size; i += 8)
+                {
+                    layout.SetNodeSizeConstraints(leaves[i], ImVec2(2.f, 2.f), ImVec2(6.f, 6.f));
+                }
+                layout.EndTransaction();
+            }
+
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < LayoutCount; i++)
+            {
+                ImVec2 size = (i % 2 == 0) ? ImVec2(1920.f, 1080.f) : ImVec2(2560.f, 1440.f);
+                layout.m_pRoot->ResizeNodeAndChildren(ImVec2(0.f, 0.f), size);
+            }
+            timesMs[pass] = ElapsedMs(start) / LayoutCount;
+        }
+
+        printf("  %6d nodes: %.3f ms per layout (%.1f ns per node), with every 8th leaf constrained %.3f ms (%.1f ns per node)\n",
+               nodeCount,
+               timesMs[0],
+               timesMs[0] * 1e6 / nodeCount,
+               timesMs[1],
+               timesMs[1] * 1e6 / nodeCount);
+    }
+}
+
+static bool IsWholePixelRect(const ImVec4& rect)
+{
+    return (rect.x == floorf(rect.x)) && (rect.y == floorf(rect.y)) && (rect.z == floorf(rect.z)) && (rect.w == floorf(rect.w));
+}
+
+// Leaf rects that differ from the previous frame's, as a rect-keyed cache would see them.
+static int CountChangedRects(
+    const ImVector<ImVec4>& previousRects,
+    const ImVector<ImVec4>& rects)
+{
+    int changed = 0;
+    for (int i = 0; i < rects.Size; i++)
+    {
+        if (memcmp(&previousRects[i], &rects[i], sizeof(ImVec4)) != 0)
+        {
+            changed++;
+        }
+    }
+    return changed;
+}
+
+// Property checks of the snapped layout on random trees at fractional root rects and splitter drags, then how often the leaf
+// rects change during a slow sub-pixel resize with and without snapping.
+static void BenchPixelSnap()
+{
+    constexpr int TreeCount = 500;
+    constexpr int ResizeCount = 20;
+
+    uint32_t seed = 11;
+    int fractionalRects = 0;
+    int inexactTrees = 0;
+    int unstableLayouts = 0;
+    int incrementalMismatches = 0;
+    for (int tree = 0; tree < TreeCount; tree++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int windowCount = 2 + (int)((seed >> 8) % 63u);
+        seed = seed * 1664525u + 1013904223u;
+        DearImGuiExt::CustomLayoutNode* pRoot = new DearImGuiExt::CustomLayoutNode((float)((seed >> 8) % 64u + 16u) / 96.f);
+        FillRandomDomain(pRoot, windowCount, seed);
+        DearImGuiExt::CustomLayout layout(pRoot);
+        layout.SetPixelSnapping(true);
+
+        ImVector<DearImGuiExt::CustomLayoutNode*> nodes;
+        layout.m_pRoot->CollectNodes(nodes);
+        for (int i = 1; i < nodes.Size; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            if ((seed >> 8) % 10u == 0)
+            {
+                layout.SetNodeVisible(nodes[i], false);
+            }
+        }
+        ImVector<DearImGuiExt::CustomLayoutNode*> domains;
+        for (int i = 0; i < nodes.Size; i++)
+        {
+            if (nodes[i]->IsLogicalDomain())
+            {
+                domains.push_back(nodes[i]);
+            }
+        }
+
+        float treeError = 0.f;
+        for (int resize = 0; resize < ResizeCount; resize++)
+        {
+            // Fractional positions and sizes, as with a DPI scale, and a drag of a random splitter by a fraction of a pixel.
+            seed = seed * 1664525u + 1013904223u;
+            ImVec2 pos((float)((seed >> 8) % 64u) / 7.f, (float)((seed >> 14) % 64u) / 7.f);
+            ImVec2 size(800.f + (float)((seed >> 20) % 1600u) / 3.f, 600.f + (float)((seed >> 12) % 1000u) / 3.f);
+            layout.m_pRoot->ResizeNodeAndChildren(pos, size);
+
+            seed = seed * 1664525u + 1013904223u;
+            DearImGuiExt::CustomLayoutNode* pDomain = domains[(seed >> 8) % (uint32_t)domains.Size];
+            float dragLen = pDomain->GetDomainSize()[(pDomain->GetLevel() % 2 == 1) ? 0 : 1];
+            float ratio = pDomain->GetSplitterRatio() + ((float)((seed >> 16) % 200u) - 100.f) / 37.f / ImMax(dragLen, 1.f);
+            layout.SetSplitterRatio(pDomain, ratio);
+
+            ImVector<ImVec4> incrementalRects;
+            ImVector<ImVec4> rects;
+            CollectDomainRects(layout.m_pRoot, incrementalRects);
+            layout.m_pRoot->ResizeNodeAndChildren(pos, size);
+            CollectDomainRects(layout.m_pRoot, rects);
+            if ((incrementalRects.Size != rects.Size) ||
+                (memcmp(incrementalRects.Data, rects.Data, (size_t)rects.size_in_bytes()) != 0))
+            {
+                incrementalMismatches++;
+            }
+
+            for (int i = 0; i < rects.Size; i++)
+            {
+                fractionalRects += IsWholePixelRect(rects[i]) ? 0 : 1;
+            }
+            treeError = ImMax(treeError, LayoutError(layout.m_pRoot));
+
+            // The same inputs after a detour through another size give the same rects, bit for bit.
+            ImVector<ImVec4> againRects;
+            layout.m_pRoot->ResizeNodeAndChildren(ImVec2(pos.x + 0.5f, pos.y), ImVec2(size.x * 0.75f, size.y + 13.3f));
+            layout.m_pRoot->ResizeNodeAndChildren(pos, size);
+            CollectDomainRects(layout.m_pRoot, againRects);
+            if (memcmp(againRects.Data, rects.Data, (size_t)rects.size_in_bytes()) != 0)
+            {
+                unstableLayouts++;
+            }
+        }
+
+        if (treeError != 0.f)
+        {
+            inexactTrees++;
+        }
+    }
+
+    printf("[pixel_snap] %d random trees, %d fractional root rects and splitter drags each.\n", TreeCount, ResizeCount);
+    printf("  rects off the pixel grid: %d, trees with gaps or overlaps: %d, different rects for the same inputs: %d, incremental != full: %d\n",
+           fractionalRects,
+           inexactTrees,
+           unstableLayouts,
+           incrementalMismatches);
+
+    // A window edge dragged by a quarter pixel per frame. Every leaf rect that changes invalidates its cached rendering.
+    constexpr int WindowCount = 64;
+    constexpr int FrameCount = 400;
+    std::vector<CustomWindowFunc> funcs(WindowCount, BlenderStyleTestLeftUpWindow);
+    DearImGuiExt::CustomLayout layout(BalancedLayout(funcs.data(), WindowCount));
+    for (int pass = 0; pass < 2; pass++)
+    {
+        layout.SetPixelSnapping(pass == 1);
+        ImVector<ImVec4> previousRects;
+        ImVector<ImVec4> rects;
+        ImVector<DearImGuiExt::CustomLayoutNode*> leaves;
+        int changedRects = 0;
+        int fractionalLeaves = 0;
+        for (int frame = 0; frame < FrameCount; frame++)
+        {
+            layout.m_pRoot->ResizeNodeAndChildren(ImVec2(0.f, 0.f), ImVec2(1600.f + 0.25f * (float)frame, 900.f));
+            leaves.resize(0);
+            layout.m_pRoot->CollectLeaves(leaves);
+            rects.resize(0);
+            for (int i = 0; i < leaves.Size; i++)
+            {
+                rects.push_back(ImVec4(leaves[i]->GetDomainPos().x, leaves[i]->GetDomainPos().y, leaves[i]->GetDomainSize().x, leaves[i]->GetDomainSize().y));
+                fractionalLeaves += IsWholePixelRect(rects.back()) ? 0 : 1;
+            }
+            if (frame > 0)
+            {
+                changedRects += CountChangedRects(previousRects, rects);
+            }
+            previousRects.swap(rects);
+        }
+
+        printf("  %-9s %5.1f of %d leaf rects change per frame, %5.1f off the pixel grid\n",
+               (pass == 1) ? "snapped:" : "float:",
+               (float)changedRects / (FrameCount - 1),
+               WindowCount,
+               (float)fractionalLeaves / FrameCount);
+    }
+}
+
+// Stands in for the background work of an inactive tab, e.g. polling a data source.
+static void PollingTabTick(void* pUserData)
+{
+    uint64_t* pValue = (uint64_t*)pUserData;
+    for (int i = 0; i < 1000; i++)
+    {
+        *pValue = *pValue * 6364136223846793005ull + 1442695040888963407ull;
+    }
+}
+
+// A root leaf holding the first 10 heavy panels as tabs.
+static DearImGuiExt::CustomLayoutNode* TabbedLeaf(
+    int       tabCount,
+    uint64_t* pTickValue)
+{
+    DearImGuiExt::CustomLayoutNode* pLeaf =
+        new DearImGuiExt::CustomLayoutNode(false, 0, ImVec2(0.f, 0.f), ImVec2(0.f, 0.f), 0.f);
+    for (int i = 0; i < tabCount; i++)
+    {
+        char label[32];
+        snprintf(label, sizeof(label), "Panel %d", i);
+        pLeaf->AddTab(label, HeavyPanels[i], pTickValue ? PollingTabTick : nullptr, pTickValue);
+    }
+    return pLeaf;
+}
+
+static double RunTabFrames(
+    DearImGuiExt::CustomLayout& layout,
+    int                         frameCount,
+    int                         switchEvery,
+    int*                        pVtxCount)
+{
+    BuildFrame(layout);
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        DearImGuiExt::CustomLeafTabs* pTabs = layout.m_pRoot->GetTabs();
+        if (pTabs && (switchEvery > 0) && (frame % switchEvery == 0))
+        {
+            pTabs->SetActiveTab((pTabs->GetActiveTab() + 1) % pTabs->GetTabCount());
+        }
+        *pVtxCount = BuildFrame(layout)->TotalVtxCount;
+    }
+    return ElapsedMs(start) / frameCount;
+}
+
+// 10 heavy panels as 10 leaves that all run, vs. as the tabs of one leaf that only runs the active one.
+static void BenchTabbedLeaves()
+{
+    constexpr int TabCount = 10;
+    constexpr int FrameCount = 200;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    printf("[tabbed_leaves] %d frames of %d heavy panels at 1920x1080.\n", FrameCount, TabCount);
+
+    int vtxCount = 0;
+    {
+        DearImGuiExt::CustomLayout layout(BalancedLayout(HeavyPanels.data(), TabCount));
+        double frameMs = RunTabFrames(layout, FrameCount, 0, &vtxCount);
+        printf("  %-38s %.3f ms/frame, %d vertices\n", "10 visible leaves:", frameMs, vtxCount);
+    }
+    {
+        DearImGuiExt::CustomLayout layout(TabbedLeaf(TabCount, nullptr));
+        double frameMs = RunTabFrames(layout, FrameCount, 0, &vtxCount);
+        printf("  %-38s %.3f ms/frame, %d vertices\n", "1 leaf of 10 tabs:", frameMs, vtxCount);
+    }
+    {
+        uint64_t tickValue = 1;
+        DearImGuiExt::CustomLayout layout(TabbedLeaf(TabCount, &tickValue));
+        layout.m_pRoot->GetTabs()->SetBackgroundTickInterval(10);
+        double frameMs = RunTabFrames(layout, FrameCount, 0, &vtxCount);
+        printf("  %-38s %.3f ms/frame, %d vertices, %llu ticks\n",
+               "1 leaf of 10 tabs, ticks every 10:",
+               frameMs,
+               vtxCount,
+               (unsigned long long)layout.m_pRoot->GetTabs()->GetBackgroundTickCount());
+    }
+    {
+        DearImGuiExt::CustomLayout layout(TabbedLeaf(TabCount, nullptr));
+        double frameMs = RunTabFrames(layout, FrameCount, 1, &vtxCount);
+        printf("  %-38s %.3f ms/frame, %d vertices\n", "1 leaf of 10 tabs, switching each frame:", frameMs, vtxCount);
+    }
+
+    ImGui::DestroyContext(pContext);
+}
+
+// Splitter ratios of a tree in depth-first order.
+static void CollectRatios(
+    DearImGuiExt::CustomLayoutNode* pNode,
+    ImVector<float>&                ratios)
+{
+    if (pNode->IsLogicalDomain())
+    {
+        ratios.push_back(pNode->GetSplitterRatio());
+        CollectRatios(pNode->GetLeftChild(), ratios);
+        CollectRatios(pNode->GetRightChild(), ratios);
+    }
+}
+
+// Presses the left button on the middle of a left-right splitter, at a quarter of its height, and drags it by dx.
+static void DragSplitter(
+    DearImGuiExt::CustomLayout&     layout,
+    DearImGuiExt::CustomLayoutNode* pDomain,
+    float                           dx,
+    int                             frameCount)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    ImVec2 start(pDomain->GetSplitterStartCoord() + 0.5f * pDomain->GetSplitterWidth(),
+                 pDomain->GetDomainPos().y + 0.25f * pDomain->GetDomainSize().y);
+    io.AddMousePosEvent(start.x, start.y);
+    BuildFrame(layout);
+    io.AddMouseButtonEvent(ImGuiMouseButton_Left, true);
+    BuildFrame(layout);
+    for (int frame = 1; frame <= frameCount; frame++)
+    {
+        io.AddMousePosEvent(start.x + dx * (float)frame / (float)frameCount, start.y);
+        BuildFrame(layout);
+    }
+    io.AddMouseButtonEvent(ImGuiMouseButton_Left, false);
+    BuildFrame(layout);
+    io.AddMousePosEvent(-FLT_MAX, -FLT_MAX);
+    BuildFrame(layout);
+}
+
+// Three heavy panels and a leaf hosting 8 more in a sub-layout. Checks that the sub-layout is only laid out when its host
+// moves, that splitter drags only reach the layout they belong to, and what a collapsed host costs.
+static void BenchSubLayouts()
+{
+    constexpr int InnerCount = 8;
+    constexpr int FrameCount = 100;
+    constexpr int DragFrames = 30;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    CustomWindowFunc outerFuncs[] = { HeavyPanels[0], HeavyPanels[1], HeavyPanels[2], BlenderStyleTestLeftUpWindow };
+    DearImGuiExt::CustomLayout outer(BalancedLayout(outerFuncs, 4));
+    DearImGuiExt::CustomLayout inner(BalancedLayout(HeavyPanels.data() + 3, InnerCount));
+    ImVector<DearImGuiExt::CustomLayoutNode*> leaves;
+    outer.m_pRoot->CollectLeaves(leaves);
+    DearImGuiExt::CustomLayoutNode* pHost = leaves.back();
+    pHost->SetSubLayout(&inner);
+    printf("[sub_layouts] 3 heavy panels and a leaf hosting %d more at 1920x1080.\n", InnerCount);
+
+    BuildFrame(outer);
+    uint64_t innerLayouts = inner.GetStats().viewportLayouts;
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < FrameCount; frame++)
+    {
+        BuildFrame(outer);
+    }
+    double shownMs = ElapsedMs(start) / FrameCount;
+    printf("  %d still frames: %.3f ms/frame, sub-layout laid out %d times\n",
+           FrameCount,
+           shownMs,
+           (int)(inner.GetStats().viewportLayouts - innerLayouts));
+
+    // The outer root splitter moves the host, so the sub-layout follows it. Its ratios stay.
+    ImVector<float> outerRatios;
+    ImVector<float> innerRatios;
+    ImVector<float> ratios;
+    CollectRatios(outer.m_pRoot, outerRatios);
+    CollectRatios(inner.m_pRoot, innerRatios);
+    innerLayouts = inner.GetStats().viewportLayouts;
+    DragSplitter(outer, outer.m_pRoot, -200.f, DragFrames);
+    CollectRatios(inner.m_pRoot, ratios);
+    bool innerKept = (memcmp(ratios.Data, innerRatios.Data, (size_t)ratios.size_in_bytes()) == 0);
+    printf("  outer splitter drag over %d frames: outer root ratio %.3f -> %.3f, sub-layout laid out %d times, its ratios %s\n",
+           DragFrames,
+           outerRatios[0],
+           outer.m_pRoot->GetSplitterRatio(),
+           (int)(inner.GetStats().viewportLayouts - innerLayouts),
+           innerKept ? "kept" : "CHANGED");
+
+    // The sub-layout's root splitter lies inside the host. Only the sub-layout gets the drag.
+    outerRatios.resize(0);
+    CollectRatios(outer.m_pRoot, outerRatios);
+    innerLayouts = inner.GetStats().viewportLayouts;
+    DragSplitter(outer, inner.m_pRoot, 100.f, DragFrames);
+    ratios.resize(0);
+    CollectRatios(outer.m_pRoot, ratios);
+    bool outerKept = (memcmp(ratios.Data, outerRatios.Data, (size_t)ratios.size_in_bytes()) == 0);
+    printf("  inner splitter drag over %d frames: inner root ratio %.3f -> %.3f, outer ratios %s, sub-layout host layouts %d\n",
+           DragFrames,
+           innerRatios[0],
+           inner.m_pRoot->GetSplitterRatio(),
+           outerKept ? "kept" : "CHANGED",
+           (int)(inner.GetStats().viewportLayouts - innerLayouts));
+
+    // A hidden host skips its whole sub-layout.
+    outer.SetNodeVisible(pHost, false);
+    BuildFrame(outer);
+    uint64_t innerFrames = inner.GetStats().frameCount;
+    start = Clock::now();
+    for (int frame = 0; frame < FrameCount; frame++)
+    {
+        BuildFrame(outer);
+    }
+    double hiddenMs = ElapsedMs(start) / FrameCount;
+    printf("  host hidden: %.3f ms/frame (%.3f shown), sub-layout frames %d\n",
+           hiddenMs,
+           shownMs,
+           (int)(inner.GetStats().frameCount - innerFrames));
+
+    pHost->SetSubLayout(nullptr);
+    ImGui::DestroyContext(pContext);
+}
+
+// A light dashboard panel: a few rows of numbers and two buttons. Nothing in it changes unless the mouse hovers a button.
+template<int Index>
+void DashboardPanelWindow()
+{
+    char name[32];
+    snprintf(name, sizeof(name), "Dashboard %d", Index);
+    ImGui::Begin(name, nullptr, TestWindowFlag);
+    ImGui::Text("Sensor %d", Index);
+    ImGui::Separator();
+    for (int i = 0; i < 8; i++)
+    {
+        ImGui::Text("Channel %d: %.2f", i, (float)(Index * 8 + i) * 0.25f);
+    }
+    ImGui::Button("Reset");
+    ImGui::SameLine();
+    ImGui::Button("Details");
+    ImGui::End();
+}
+
+static int g_DashboardTicks = 0;
+
+// The only dashboard panel that changes by itself, when g_DashboardTicks does.
+static void DashboardLiveWindow()
+{
+    ImGui::Begin("Dashboard Live", nullptr, TestWindowFlag);
+    ImGui::Text("Tick %d", g_DashboardTicks);
+    ImGui::ProgressBar((float)(g_DashboardTicks % 120) / 120.f);
+    ImGui::End();
+}
+
+// Input or state changes before frame 'frame' of 'frameCount'.
+typedef void (*DamageStepFunc)(int frame, int frameCount);
+
+static ImVec2 g_DamageDragStart;
+
+static void IdleStep(int, int) {}
+
+static void LiveStep(int, int)
+{
+    g_DashboardTicks++;
+}
+
+// The mouse crosses the display diagonally, hovering buttons on the way.
+static void HoverStep(int frame, int frameCount)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    float t = (float)frame / (float)(frameCount - 1);
+    io.AddMousePosEvent(t * io.DisplaySize.x, 0.1f * io.DisplaySize.y + t * 0.8f * io.DisplaySize.y);
+}
+
+// Presses the mouse on g_DamageDragStart, drags 300 pixels to the left and releases on the last frame.
+static void DragStep(int frame, int frameCount)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    if (frame == 0)
+    {
+        io.AddMousePosEvent(g_DamageDragStart.x, g_DamageDragStart.y);
+    }
+    else if (frame == 1)
+    {
+        io.AddMouseButtonEvent(ImGuiMouseButton_Left, true);
+    }
+    else if (frame == frameCount - 1)
+    {
+        io.AddMouseButtonEvent(ImGuiMouseButton_Left, false);
+    }
+    else
+    {
+        io.AddMousePosEvent(g_DamageDragStart.x - 300.f * (float)(frame - 1) / (float)(frameCount - 3), g_DamageDragStart.y);
+    }
+}
+
+static float DamagedFraction(const ImVector<ImVec4>& rects)
+{
+    ImVec2 displaySize = ImGui::GetIO().DisplaySize;
+    float area = 0.f;
+    for (const ImVec4& rect : rects)
+    {
+        area += (rect.z - rect.x) * (rect.w - rect.y);
+    }
+    return area / (displaySize.x * displaySize.y);
+}
+
+// Damaged share of the display per frame, since the previous frame and since 3 frames ago (a triple buffered swapchain).
+static void MeasureDamage(
+    const char*                          label,
+    DearImGuiExt::CustomLayout&          layout,
+    DearImGuiExt::DrawDataDamageTracker& tracker,
+    DamageStepFunc                       pfnStep,
+    int                                  frameCount)
+{
+    double fraction = 0.;
+    double imageAgeFraction = 0.;
+    int rectCount = 0;
+    int maxRectCount = 0;
+    double trackerMs = 0.;
+    ImVector<ImVec4> rects;
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        pfnStep(frame, frameCount);
+        ImDrawData* pDrawData = BuildFrame(layout);
+
+        Clock::time_point start = Clock::now();
+        tracker.Update(pDrawData);
+        trackerMs += ElapsedMs(start);
+
+        const DearImGuiExt::DrawDataDamageStats& stats = tracker.GetStats();
+        fraction += stats.damagedFraction;
+        rectCount += stats.damageRects;
+        maxRectCount = ImMax(maxRectCount, stats.damageRects);
+        imageAgeFraction += tracker.CollectDamage(3, rects) ? DamagedFraction(rects) : 1.f;
+    }
+    printf("  %-14s damaged %5.1f%% of the display per frame (%5.1f%% for an image 3 frames old), %.1f rects (max %d), tracker %.3f ms/frame\n",
+           label,
+           100. * fraction / frameCount,
+           100. * imageAgeFraction / frameCount,
+           (double)rectCount / frameCount,
+           maxRectCount,
+           trackerMs / frameCount);
+}
+
+// A dashboard of 8 light panels, one of them live. Reports how much of the display a renderer drawing only the damage
+// regions would draw again: idle, with the live panel ticking, with the mouse moving over buttons and during a drag of
+// the root splitter.
+static void BenchDamage()
+{
+    constexpr int FrameCount = 120;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    CustomWindowFunc funcs[] = { DashboardPanelWindow<0>,
+                                 DashboardPanelWindow<1>,
+                                 DashboardPanelWindow<2>,
+                                 DashboardLiveWindow,
+                                 DashboardPanelWindow<3>,
+                                 DashboardPanelWindow<4>,
+                                 DashboardPanelWindow<5>,
+                                 DashboardPanelWindow<6> };
+    DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, IM_ARRAYSIZE(funcs)));
+    DearImGuiExt::DrawDataDamageTracker tracker;
+    printf("[damage] A dashboard of %d light panels at 1920x1080, %d frames per case.\n", IM_ARRAYSIZE(funcs), FrameCount);
+
+    // The first frames create the windows and damage everything.
+    for (int frame = 0; frame < 3; frame++)
+    {
+        tracker.Update(BuildFrame(layout));
+    }
+
+    MeasureDamage("idle", layout, tracker, IdleStep, FrameCount);
+    MeasureDamage("live panel", layout, tracker, LiveStep, FrameCount);
+    MeasureDamage("mouse moving", layout, tracker, HoverStep, FrameCount);
+    ImGui::GetIO().AddMousePosEvent(-FLT_MAX, -FLT_MAX);
+    tracker.Update(BuildFrame(layout));
+
+    DearImGuiExt::CustomLayoutNode* pRoot = layout.m_pRoot;
+    g_DamageDragStart = ImVec2(pRoot->GetSplitterStartCoord() + 0.5f * pRoot->GetSplitterWidth(),
+                               pRoot->GetDomainPos().y + 0.25f * pRoot->GetDomainSize().y);
+    MeasureDamage("splitter drag", layout, tracker, DragStep, FrameCount);
+
+    ImGui::DestroyContext(pContext);
+}
+
+constexpr int DashboardPanelCount = 60;
+
+template<int... Indices>
+static constexpr std::array<CustomWindowFunc, sizeof...(Indices)> MakeDashboardPanels(std::integer_sequence<int, Indices...>)
+{
+    return { { DashboardPanelWindow<Indices>... } };
+}
+
+static const std::array<CustomWindowFunc, DashboardPanelCount> DashboardPanels =
+    MakeDashboardPanels(std::make_integer_sequence<int, DashboardPanelCount>());
+
+// One triangle as the renderer sees it.
+struct DrawnTriangle
+{
+    ImDrawVert  vertices[3];
+    ImTextureID textureId;
+    ImVec4      clipRect;
+};
+
+static void CollectTriangles(
+    const ImDrawData*           pDrawData,
+    std::vector<DrawnTriangle>& triangles)
+{
+    triangles.clear();
+    for (int i = 0; i < pDrawData->CmdListsCount; i++)
+    {
+        const ImDrawList* pList = pDrawData->CmdLists[i];
+        for (const ImDrawCmd& cmd : pList->CmdBuffer)
+        {
+            for (unsigned int n = 0; n + 2 < cmd.ElemCount; n += 3)
+            {
+                DrawnTriangle triangle;
+                for (int k = 0; k < 3; k++)
+                {
+                    triangle.vertices[k] = pList->VtxBuffer[cmd.VtxOffset + pList->IdxBuffer[cmd.IdxOffset + n + k]];
+                }
+                triangle.textureId = cmd.TextureId;
+                triangle.clipRect = cmd.ClipRect;
+                triangles.push_back(triangle);
+            }
+        }
+    }
+}
+
+// The batched draw data draws the same triangles in the same order with the same texture, and each triangle's pixels are
+// the same: it keeps its clip rect, or it lies within its clip rect and gets a larger one.
+static bool IsSameDrawing(
+    const ImDrawData* pSrc,
+    const ImDrawData* pBatched)
+{
+    std::vector<DrawnTriangle> srcTriangles;
+    std::vector<DrawnTriangle> batchedTriangles;
+    CollectTriangles(pSrc, srcTriangles);
+    CollectTriangles(pBatched, batchedTriangles);
+    if (srcTriangles.size() != batchedTriangles.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < srcTriangles.size(); i++)
+    {
+        const DrawnTriangle& a = srcTriangles[i];
+        const DrawnTriangle& b = batchedTriangles[i];
+        if ((memcmp(a.vertices, b.vertices, sizeof(a.vertices)) != 0) || (a.textureId != b.textureId))
+        {
+            return false;
+        }
+
+        if (memcmp(&a.clipRect, &b.clipRect, sizeof(ImVec4)) != 0)
+        {
+            for (const ImDrawVert& vertex : a.vertices)
+            {
+                if ((vertex.pos.x < a.clipRect.x) || (vertex.pos.y < a.clipRect.y) || (vertex.pos.x > a.clipRect.z) ||
+                    (vertex.pos.y > a.clipRect.w))
+                {
+                    return false;
+                }
+            }
+            if ((b.clipRect.x > a.clipRect.x) || (b.clipRect.y > a.clipRect.y) || (b.clipRect.z < a.clipRect.z) ||
+                (b.clipRect.w < a.clipRect.w))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void RunDrawBatching(
+    const char*             label,
+    const CustomWindowFunc* pFuncs,
+    int                     count)
+{
+    constexpr int FrameCount = 100;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    DearImGuiExt::CustomLayout layout(BalancedLayout(pFuncs, count));
+    DearImGuiExt::DrawDataBatcher batcher;
+    for (int frame = 0; frame < 3; frame++)
+    {
+        BuildFrame(layout);
+    }
+
+    double batchMs = 0.;
+    for (int frame = 0; frame < FrameCount; frame++)
+    {
+        ImDrawData* pDrawData = BuildFrame(layout);
+        Clock::time_point start = Clock::now();
+        batcher.Batch(pDrawData);
+        batchMs += ElapsedMs(start);
+    }
+
+    ImDrawData* pDrawData = BuildFrame(layout);
+    ImDrawData* pBatched = batcher.Batch(pDrawData);
+    const DearImGuiExt::DrawDataBatchStats& stats = batcher.GetStats();
+    printf("  %-16s %d lists, %d draw calls -> %d, %d vertices, batching %.3f ms/frame, same drawing: %s\n",
+           label,
+           stats.listsBefore,
+           stats.cmdsBefore,
+           stats.cmdsAfter,
+           pBatched->TotalVtxCount,
+           batchMs / FrameCount,
+           IsSameDrawing(pDrawData, pBatched) ? "yes" : "NO");
+
+    ImGui::DestroyContext(pContext);
+}
+
+// Draw calls of a frame before and after DrawDataBatcher, for light panels that fit their leaves and for heavy panels
+// whose text runs past their clip rects.
+static void BenchDrawBatching()
+{
+    printf("[draw_batching] Balanced layouts at 1920x1080.\n");
+    RunDrawBatching("60 light panels", DashboardPanels.data(), DashboardPanelCount);
+    RunDrawBatching("40 heavy panels", HeavyPanels.data(), HeavyPanelCount);
+}
+
+static int CountDifferentPixels(
+    const DearImGuiExt::SoftwareRenderer& a,
+    const DearImGuiExt::SoftwareRenderer& b)
+{
+    int count = 0;
+    for (int y = 0; y < a.GetHeight(); y++)
+    {
+        const uint32_t* pRowA = a.GetPixels() + y * a.GetPitch();
+        const uint32_t* pRowB = b.GetPixels() + y * b.GetPitch();
+        for (int x = 0; x < a.GetWidth(); x++)
+        {
+            count += (pRowA[x] != pRowB[x]) ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+static double TimeSoftwareRender(
+    DearImGuiExt::SoftwareRenderer& renderer,
+    const ImDrawData*               pDrawData,
+    int                             frameCount)
+{
+    renderer.Render(pDrawData);
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        renderer.Render(pDrawData);
+    }
+    return ElapsedMs(start) / frameCount;
+}
+
+static void RunSoftwareRender(
+    const char*                     label,
+    DearImGuiExt::CustomLayoutNode* (*pfnCreateLayout)(),
+    ImVec2                          displaySize,
+    DearImGuiExt::JobSystem&        jobSystem)
+{
+    constexpr int FrameCount = 10;
+
+    ImGuiContext* pContext = CreateHeadlessContext(displaySize);
+    DearImGuiExt::CustomLayout layout(pfnCreateLayout());
+    for (int frame = 0; frame < 3; frame++)
+    {
+        BuildFrame(layout);
+    }
+    ImDrawData* pDrawData = BuildFrame(layout);
+
+    unsigned char* pPixels = nullptr;
+    int width = 0;
+    int height = 0;
+    ImGuiIO& io = ImGui::GetIO();
+    io.Fonts->GetTexDataAsRGBA32(&pPixels, &width, &height);
+
+    DearImGuiExt::SoftwareRenderer scalar;
+    DearImGuiExt::SoftwareRenderer simd;
+    DearImGuiExt::SoftwareRenderer tiled(&jobSystem);
+    scalar.SetSimdEnabled(false);
+    DearImGuiExt::SoftwareRenderer* renderers[] = { &scalar, &simd, &tiled };
+    for (DearImGuiExt::SoftwareRenderer* pRenderer : renderers)
+    {
+        pRenderer->SetTexture(io.Fonts->TexID, pPixels, width, height);
+        pRenderer->Resize((int)displaySize.x, (int)displaySize.y);
+    }
+
+    double megapixels = (double)(displaySize.x * displaySize.y) / 1e6;
+    double scalarMs = TimeSoftwareRender(scalar, pDrawData, FrameCount);
+    double simdMs = TimeSoftwareRender(simd, pDrawData, FrameCount);
+    double tiledMs = TimeSoftwareRender(tiled, pDrawData, FrameCount);
+    const DearImGuiExt::SoftwareRenderStats& stats = tiled.GetStats();
+    printf("  %-16s %4dx%-4d %6d primitives (%5d rects) in %4d tiles | scalar %7.2f ms %6.0f MP/s | %s %7.2f ms %6.0f MP/s | %s x%u threads %6.2f ms %6.0f MP/s | same pixels: %s\n",
+           label,
+           (int)displaySize.x,
+           (int)displaySize.y,
+           stats.primitives,
+           stats.rects,
+           stats.tiles,
+           scalarMs,
+           megapixels * 1000. / scalarMs,
+           DearImGuiExt::SoftwareRenderer::GetSimdName(),
+           simdMs,
+           megapixels * 1000. / simdMs,
+           DearImGuiExt::SoftwareRenderer::GetSimdName(),
+           jobSystem.GetWorkerCount() + 1,
+           tiledMs,
+           megapixels * 1000. / tiledMs,
+           ((CountDifferentPixels(scalar, simd) == 0) && (CountDifferentPixels(simd, tiled) == 0)) ? "yes" : "NO");
+
+    ImGui::DestroyContext(pContext);
+}
+
+static DearImGuiExt::CustomLayoutNode* DashboardLayout()
+{
+    return BalancedLayout(DashboardPanels.data(), DashboardPanelCount);
+}
+
+static DearImGuiExt::CustomLayoutNode* HeavyPanelsLayout()
+{
+    return BalancedLayout(HeavyPanels.data(), HeavyPanelCount);
+}
+
+// Frame time and fill rate of SoftwareRenderer, without SIMD, with SIMD and with SIMD on every core. Megapixels per
+// second count the pixels of the display.
+static void BenchSoftwareRender()
+{
+    DearImGuiExt::JobSystem jobSystem(DearImGuiExt::JobSystem::DefaultWorkerCount());
+    printf("[software_render] The last frame of each layout, %dx%d tiles.\n",
+           DearImGuiExt::SoftwareRenderer::TileSize,
+           DearImGuiExt::SoftwareRenderer::TileSize);
+    ImVec2 displaySizes[] = { ImVec2(1920.f, 1080.f), ImVec2(3840.f, 2160.f) };
+    for (ImVec2 displaySize : displaySizes)
+    {
+        RunSoftwareRender("01 example", BlenderStartLayout, displaySize, jobSystem);
+        RunSoftwareRender("60 light panels", DashboardLayout, displaySize, jobSystem);
+        RunSoftwareRender("40 heavy panels", HeavyPanelsLayout, displaySize, jobSystem);
+    }
+}
+
+#ifndef _WIN32
+
+// Viewer side of BenchRemoteStream, on its own thread.
+struct RemoteViewer
+{
+    DearImGuiExt::RemoteConnection connection;
+    DearImGuiExt::DrawDataDecoder  decoder;
+    uint32_t                       mouseFrameStart; // Frames from this one on are answered with a mouse move.
+    uint32_t                       frameCount;
+    int                            decodedFrames;
+    int                            failedMessages;
+    int                            mappedCmds;      // Commands of the last frame drawn with the local font texture.
+    double                         decodeMs;
+};
+
+static const ImTextureID RemoteFontTextureId = (ImTextureID)(intptr_t)0x100;
+
+static void MapRemoteTexture(DearImGuiExt::RemoteTexture& texture, void* pUserData)
+{
+    (void)pUserData;
+    texture.localId = RemoteFontTextureId;
+}
+
+static void RunRemoteViewer(RemoteViewer& viewer)
+{
+    viewer.decoder.SetTextureCallback(MapRemoteTexture, nullptr);
+    ImVector<unsigned char> message;
+    DearImGuiExt::RemoteInputEncoder input;
+    while (viewer.connection.Receive(message, true) > 0)
+    {
+        Clock::time_point start = Clock::now();
+        bool isDecoded = viewer.decoder.Decode(message.Data, (size_t)message.Size);
+        viewer.decodeMs += ElapsedMs(start);
+        if (isDecoded == false)
+        {
+            // The application waits for answers, closing tells it to stop.
+            viewer.failedMessages++;
+            viewer.connection.Close();
+            break;
+        }
+        if (DearImGuiExt::GetRemoteMessageType(message.Data, (size_t)message.Size) != DearImGuiExt::RemoteMessage_Frame)
+        {
+            continue;
+        }
+        viewer.decodedFrames++;
+
+        // The mouse crosses the display diagonally, as in HoverStep.
+        uint32_t frame = viewer.decoder.GetFrameIndex();
+        if (frame >= viewer.mouseFrameStart)
+        {
+            ImVec2 displaySize = viewer.decoder.GetDrawData()->DisplaySize;
+            float t = (float)(frame - viewer.mouseFrameStart) / (float)(viewer.frameCount - viewer.mouseFrameStart);
+            input.AddMousePosEvent(t * displaySize.x, 0.1f * displaySize.y + t * 0.8f * displaySize.y);
+            input.Flush(message);
+            viewer.connection.Send(message);
+        }
+    }
+
+    const ImDrawData* pDrawData = viewer.decoder.GetDrawData();
+    for (int i = 0; i < pDrawData->CmdListsCount; i++)
+    {
+        for (const ImDrawCmd& cmd : pDrawData->CmdLists[i]->CmdBuffer)
+        {
+            viewer.mappedCmds += (cmd.TextureId == RemoteFontTextureId) ? 1 : 0;
+        }
+    }
+}
+
+// Streams a dashboard to a viewer thread over a Unix domain socket or the TCP loopback: first idle, then with the live
+// panel ticking, then with the viewer moving the mouse. Every frame is also decoded locally and compared to the source.
+static void RunRemoteStream(
+    const char* label,
+    bool        isTcp)
+{
+    constexpr int PhaseFrameCount = 120;
+    const char* PhaseNames[] = { "idle", "live panel", "remote mouse" };
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    CustomWindowFunc funcs[] = { DashboardPanelWindow<0>,
+                                 DashboardPanelWindow<1>,
+                                 DashboardPanelWindow<2>,
+                                 DashboardLiveWindow,
+                                 DashboardPanelWindow<3>,
+                                 DashboardPanelWindow<4>,
+                                 DashboardPanelWindow<5>,
+                                 DashboardPanelWindow<6> };
+    DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, IM_ARRAYSIZE(funcs)));
+
+    DearImGuiExt::RemoteListener listener;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/imgui_remote_bench_%d.sock", (int)getpid());
+    if ((isTcp ? listener.ListenTcp(0) : listener.ListenUnix(path)) == false)
+    {
+        printf("  %-6s cannot listen, skipped\n", label);
+        ImGui::DestroyContext(pContext);
+        return;
+    }
+
+    RemoteViewer viewer;
+    viewer.mouseFrameStart = 2 * PhaseFrameCount;
+    viewer.frameCount = 3 * PhaseFrameCount + 1;
+    viewer.decodedFrames = 0;
+    viewer.failedMessages = 0;
+    viewer.mappedCmds = 0;
+    viewer.decodeMs = 0.;
+    std::thread viewerThread([&viewer, &listener, isTcp, &path]()
+    {
+        if (isTcp ? viewer.connection.ConnectTcp("127.0.0.1", listener.GetPort()) : viewer.connection.ConnectUnix(path))
+        {
+            RunRemoteViewer(viewer);
+        }
+    });
+
+    DearImGuiExt::RemoteConnection connection;
+    DearImGuiExt::DrawDataEncoder encoder;
+    DearImGuiExt::DrawDataDecoder localDecoder;
+    ImVector<unsigned char> message;
+    bool isConnected = listener.Accept(connection);
+
+    unsigned char* pPixels = nullptr;
+    int width = 0;
+    int height = 0;
+    ImGuiIO& io = ImGui::GetIO();
+    io.Fonts->GetTexDataAsRGBA32(&pPixels, &width, &height);
+    DearImGuiExt::DrawDataEncoder::EncodeTexture(io.Fonts->TexID, pPixels, width, height, message);
+    size_t textureBytes = (size_t)message.Size;
+    isConnected = isConnected && connection.Send(message);
+
+    // The first frame is sent whole.
+    encoder.EncodeFrame(BuildFrame(layout), message);
+    size_t firstFrameBytes = (size_t)message.Size;
+    localDecoder.Decode(message.Data, (size_t)message.Size);
+    isConnected = isConnected && connection.Send(message);
+
+    bool isSame = true;
+    int inputMessages = 0;
+    for (int phase = 0; phase < IM_ARRAYSIZE(PhaseNames); phase++)
+    {
+        size_t rawBytes = 0;
+        size_t encodedBytes = 0;
+        int listsKept = 0;
+        int listsSent = 0;
+        double encodeMs = 0.;
+        for (int frame = 0; frame < PhaseFrameCount; frame++)
+        {
+            if (phase == 1)
+            {
+                g_DashboardTicks++;
+            }
+            else if (phase == 2)
+            {
+                // Waits for the viewer's answer to the previous frame, as a viewer in the same room would have sent it.
+                int received = isConnected ? connection.Receive(message, true) : -1;
+                isConnected = (received >= 0);
+                if ((received > 0) && DearImGuiExt::ApplyRemoteInput(message.Data, (size_t)message.Size, io))
+                {
+                    inputMessages++;
+                }
+            }
+
+            ImDrawData* pDrawData = BuildFrame(layout);
+            Clock::time_point start = Clock::now();
+            encoder.EncodeFrame(pDrawData, message);
+            encodeMs += ElapsedMs(start);
+            isConnected = isConnected && connection.Send(message);
+
+            const DearImGuiExt::DrawDataStreamStats& stats = encoder.GetStats();
+            rawBytes += stats.rawBytes;
+            encodedBytes += stats.encodedBytes;
+            listsKept += stats.listsKept;
+            listsSent += stats.listsSent;
+            isSame = isSame && localDecoder.Decode(message.Data, (size_t)message.Size) &&
+                     IsSameDrawing(pDrawData, localDecoder.GetDrawData());
+        }
+        printf("  %-6s %-13s %7.0f bytes/frame of %8.0f raw (%5.2f%%), %4.1f lists kept / %4.1f sent, encode %.3f ms/frame\n",
+               label,
+               PhaseNames[phase],
+               (double)encodedBytes / PhaseFrameCount,
+               (double)rawBytes / PhaseFrameCount,
+               100. * (double)encodedBytes / (double)ImMax(rawBytes, (size_t)1),
+               (double)listsKept / PhaseFrameCount,
+               (double)listsSent / PhaseFrameCount,
+               encodeMs / PhaseFrameCount);
+    }
+
+    // Closing the connection ends the viewer once it has read everything.
+    connection.Close();
+    viewerThread.join();
+    listener.Close();
+    printf("  %-6s font atlas %zu bytes (%d raw), first frame %zu bytes, viewer decoded %d/%d frames (%d failed), decode %.3f ms/frame,\n"
+           "         %d input messages applied, %d commands drawn with the viewer's font texture, same drawing: %s\n",
+           label,
+           textureBytes,
+           width * height * 4,
+           firstFrameBytes,
+           viewer.decodedFrames,
+           (int)viewer.frameCount,
+           viewer.failedMessages,
+           viewer.decodeMs / ImMax(viewer.decodedFrames, 1),
+           inputMessages,
+           viewer.mappedCmds,
+           isSame ? "yes" : "NO");
+
+    ImGui::DestroyContext(pContext);
+}
+
+// Bytes per frame sent to a remote viewer by DrawDataEncoder, and the cost of encoding and decoding them.
+static void BenchRemoteStream()
+{
+    printf("[remote_stream] A dashboard of 8 light panels at 1920x1080 streamed to a viewer thread.\n");
+    RunRemoteStream("unix", false);
+    RunRemoteStream("tcp", true);
+}
+
+#endif
+
+// Trace file given after "input_replay" on the command line.
+static const char* g_pInputTracePath = nullptr;
+
+// A scripted session on the 01_SimpleTwoLayouts layout: hovering, dragging the root splitter both ways, scrolling and a
+// window resize in the middle.
+static void RecordInputTrace(ImVector<unsigned char>& trace)
+{
+    constexpr int StepFrames = 60;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    ImGuiIO& io = ImGui::GetIO();
+    DearImGuiExt::CustomLayout layout(BlenderStartLayout());
+    DearImGuiExt::InputTraceRecorder recorder;
+    recorder.Start(&layout);
+
+    BuildFrame(layout);
+    for (int frame = 0; frame < StepFrames; frame++)
+    {
+        HoverStep(frame, StepFrames);
+        BuildFrame(layout);
+    }
+    DragSplitter(layout, layout.m_pRoot, -300.f, StepFrames);
+
+    io.DisplaySize = ImVec2(1280.f, 720.f);
+    for (int frame = 0; frame < StepFrames; frame++)
+    {
+        HoverStep(frame, StepFrames);
+        if ((frame % 4) == 0)
+        {
+            io.AddMouseWheelEvent(0.f, (frame < StepFrames / 2) ? -1.f : 1.f);
+        }
+        BuildFrame(layout);
+    }
+    DragSplitter(layout, layout.m_pRoot, 200.f, StepFrames);
+
+    recorder.Stop();
+    trace = recorder.GetData();
+    ImGui::DestroyContext(pContext);
+}
+
+static void PrintFrameTimes(
+    const char*            label,
+    const ImVector<float>& frameMs)
+{
+    std::vector<float> sorted(frameMs.begin(), frameMs.end());
+    std::sort(sorted.begin(), sorted.end());
+    double totalMs = 0.;
+    for (float ms : sorted)
+    {
+        totalMs += ms;
+    }
+    size_t count = ImMax(sorted.size(), (size_t)1);
+    printf("  %-8s %.3f ms/frame, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           label,
+           totalMs / (double)count,
+           sorted.empty() ? 0. : sorted[sorted.size() / 2],
+           sorted.empty() ? 0. : sorted[(sorted.size() * 99) / 100],
+           sorted.empty() ? 0. : sorted.back());
+}
+
+// Replays the same trace several times on fresh contexts. Every run must end each frame with the layout state of the
+// recording, and the per-frame timings are comparable between builds.
+static void BenchInputReplay()
+{
+    constexpr int RunCount = 3;
+
+    ImVector<unsigned char> trace;
+    DearImGuiExt::InputTracePlayer player;
+    if (g_pInputTracePath)
+    {
+        if (player.LoadFile(g_pInputTracePath) == false)
+        {
+            printf("[input_replay] Can't load the input trace '%s'.\n", g_pInputTracePath);
+            return;
+        }
+        printf("[input_replay] %s: %d frames on the 01_SimpleTwoLayouts layout, %d runs.\n",
+               g_pInputTracePath,
+               player.GetFrameCount(),
+               RunCount);
+    }
+    else
+    {
+        RecordInputTrace(trace);
+        bool isLoaded = player.Load(trace.Data, (size_t)trace.Size);
+        assert((void("ERROR: The recorded trace must load."), isLoaded));
+        (void)isLoaded;
+        printf("[input_replay] A scripted session of %d frames on the 01_SimpleTwoLayouts layout, %d bytes (%.1f bytes/frame), %d runs.\n",
+               player.GetFrameCount(),
+               trace.Size,
+               (double)trace.Size / ImMax(player.GetFrameCount(), 1),
+               RunCount);
+    }
+
+    for (int run = 0; run < RunCount; run++)
+    {
+        ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+        DearImGuiExt::CustomLayout layout(BlenderStartLayout());
+        layout.LoadState(player.GetInitialLayoutState());
+        player.Start(&layout);
+        while (player.IsDone() == false)
+        {
+            BuildFrame(layout);
+        }
+        player.Stop();
+
+        char label[16];
+        snprintf(label, sizeof(label), "run %d:", run + 1);
+        PrintFrameTimes(label, player.GetFrameTimes());
+        if (player.GetMismatchCount() > 0)
+        {
+            printf("           layout differs from the recording in %d frames, first in frame %d\n",
+                   player.GetMismatchCount(),
+                   player.GetFirstMismatchFrame());
+        }
+        else
+        {
+            printf("           same layout as the recording in all %d frames\n", player.GetPlayedFrameCount());
+        }
+        ImGui::DestroyContext(pContext);
+    }
+}
+
+// Lines of a simulated service log, from producer threads writing flat out.
+static void ProduceLogLines(
+    DearImGuiExt::CustomLogConsole* pConsole,
+    int                             producer,
+    std::atomic<bool>*              pStop)
+{
+    uint32_t seed = (uint32_t)producer + 1;
+    char line[128];
+    for (uint32_t request = 0; pStop->load(std::memory_order_relaxed) == false; request++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int length = snprintf(line, sizeof(line), "worker %d: request %u for /api/items/%u took %u us",
+                              producer, request, (seed >> 8) % 100000u, (seed >> 20) % 5000u);
+        pConsole->AddLine(line, (size_t)length);
+    }
+}
+
+static DearImGuiExt::CustomLogConsole* g_pNaiveLogLines = nullptr;
+static int g_NaiveLogLineCount = 0;
+
+// What a console without clipping does: one text item per line, visible or not.
+static void NaiveLogWindow()
+{
+    ImGui::Begin("Naive Log", nullptr, TestWindowFlag);
+    for (int i = 0; i < g_NaiveLogLineCount; i++)
+    {
+        int length = 0;
+        const char* pLine = g_pNaiveLogLines->GetLine(i, &length);
+        ImGui::TextUnformatted(pLine, pLine + length);
+    }
+    ImGui::End();
+}
+
+struct LogFrameTimes
+{
+    int    frameCount;
+    double totalMs;
+    double maxMs;
+};
+
+static void TimeLogFrame(
+    DearImGuiExt::CustomLayout& layout,
+    LogFrameTimes&              times)
+{
+    Clock::time_point start = Clock::now();
+    BuildFrame(layout);
+    double frameMs = ElapsedMs(start);
+    times.frameCount++;
+    times.totalMs += frameMs;
+    times.maxMs = std::max(times.maxMs, frameMs);
+}
+
+static void PrintLogFrameTimes(
+    const char*          pLabel,
+    const LogFrameTimes& times)
+{
+    printf("  %-34s %5d frames, %.3f ms/frame, max %.3f ms\n",
+           pLabel,
+           times.frameCount,
+           times.totalMs / ImMax(times.frameCount, 1),
+           times.maxMs);
+}
+
+// Producer threads logging into a console leaf next to the Blender style panel, up to 1M retained lines. Then frames at
+// 1M lines with and without producers, a filter indexed on the job system, and unclipped text items for comparison.
+static void BenchLogConsole()
+{
+    constexpr int RetainedLines = 1 << 20;
+    constexpr int MaxFillFrames = 20000;
+    constexpr int FrameCount = 300;
+    constexpr int NaiveLineCount = 100000;
+    constexpr int NaiveFrameCount = 10;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    {
+        // The layouts wait for their Prepare jobs when they are destroyed, before the console and the job system.
+        DearImGuiExt::JobSystem jobSystem(DearImGuiExt::JobSystem::DefaultWorkerCount());
+        DearImGuiExt::CustomLogConsole console("Log Console", RetainedLines);
+        const int producerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+        printf("[log_console] %d producer threads, %d retained lines, console leaf next to the Blender style panel.\n",
+               producerCount,
+               RetainedLines);
+
+        CustomWindowFunc funcs[] = { BlenderStyleTestLeftUpWindow, BlenderStyleTestLeftUpWindow };
+        DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, 2));
+        layout.SetJobSystem((jobSystem.GetWorkerCount() > 0) ? &jobSystem : nullptr); // A single core indexes inline.
+        console.Attach(layout.m_pRoot->GetRightChild());
+
+        std::atomic<bool> stop(false);
+        std::vector<std::thread> producers;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < producerCount; i++)
+        {
+            producers.emplace_back(ProduceLogLines, &console, i, &stop);
+        }
+
+        LogFrameTimes fill = {};
+        while ((console.GetStats().retainedLines < RetainedLines) && (fill.frameCount < MaxFillFrames))
+        {
+            TimeLogFrame(layout, fill);
+        }
+        double fillSeconds = ElapsedMs(start) / 1000.0;
+        DearImGuiExt::CustomLogConsoleStats stats = console.GetStats();
+        printf("  fill: %d lines in %.2f s, %.2f M lines/s received, %llu dropped by the full ring, %.1f MB arena\n",
+               stats.retainedLines,
+               fillSeconds,
+               (double)stats.receivedLines / fillSeconds / 1e6,
+               (unsigned long long)stats.droppedLines,
+               (double)stats.arenaBytes / (1024.0 * 1024.0));
+        PrintLogFrameTimes("while filling:", fill);
+
+        LogFrameTimes live = {};
+        uint64_t receivedBefore = stats.receivedLines;
+        start = Clock::now();
+        for (int i = 0; i < FrameCount; i++)
+        {
+            TimeLogFrame(layout, live);
+        }
+        stats = console.GetStats();
+        printf("  live: %.2f M lines/s received, %d lines retained, last drain %.3f ms\n",
+               (double)(stats.receivedLines - receivedBefore) / (ElapsedMs(start) / 1000.0) / 1e6,
+               stats.retainedLines,
+               stats.lastDrainMs);
+        PrintLogFrameTimes("1M lines, producers running:", live);
+
+        stop = true;
+        for (std::thread& producer : producers)
+        {
+            producer.join();
+        }
+
+        LogFrameTimes idle = {};
+        for (int i = 0; i < FrameCount; i++)
+        {
+            TimeLogFrame(layout, idle);
+        }
+        PrintLogFrameTimes("1M lines, producers idle:", idle);
+
+        LogFrameTimes indexing = {};
+        console.SetFilter("worker 0");
+        while ((console.GetStats().indexedLines < console.GetStats().retainedLines) && (indexing.frameCount < MaxFillFrames))
+        {
+            TimeLogFrame(layout, indexing);
+        }
+        stats = console.GetStats();
+        printf("  filter \"worker 0\": %d matching lines, indexed in %d frames\n", stats.matchingLines, indexing.frameCount);
+        PrintLogFrameTimes("while indexing:", indexing);
+
+        LogFrameTimes filtered = {};
+        for (int i = 0; i < FrameCount; i++)
+        {
+            TimeLogFrame(layout, filtered);
+        }
+        PrintLogFrameTimes("1M lines, filtered:", filtered);
+
+        g_pNaiveLogLines = &console;
+        g_NaiveLogLineCount = NaiveLineCount;
+        CustomWindowFunc naiveFuncs[] = { BlenderStyleTestLeftUpWindow, NaiveLogWindow };
+        DearImGuiExt::CustomLayout naiveLayout(BalancedLayout(naiveFuncs, 2));
+        LogFrameTimes naive = {};
+        for (int i = 0; i < NaiveFrameCount; i++)
+        {
+            TimeLogFrame(naiveLayout, naive);
+        }
+        PrintLogFrameTimes("100K unclipped text items:", naive);
+    }
+
+    ImGui::DestroyContext(pContext);
+}
+
+// A sensor channel: a slow drift, an oscillation, noise and a spike every 100K samples.
+static void FillSensorSamples(std::vector<float>& samples)
+{
+    uint32_t seed = 1;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        float noise = (float)(seed >> 8) / (float)(1u << 24) - 0.5f;
+        float spike = ((i % 100000) == 99999) ? 8.f : 0.f;
+        samples[i] = sinf((float)i * 2e-6f) * 4.f + sinf((float)i * 3e-3f) + noise * 0.5f + spike;
+    }
+}
+
+// What a plot without a pyramid does: the min and max of every column from the samples.
+static double TimeSampleScan(
+    const std::vector<float>& samples,
+    int                       width)
+{
+    Clock::time_point start = Clock::now();
+    volatile float sink = 0.f;
+    for (int column = 0; column < width; column++)
+    {
+        size_t begin = samples.size() * (size_t)column / (size_t)width;
+        size_t end = samples.size() * (size_t)(column + 1) / (size_t)width;
+        float minValue = samples[begin];
+        float maxValue = samples[begin];
+        for (size_t i = begin + 1; i < end; i++)
+        {
+            minValue = std::min(minValue, samples[i]);
+            maxValue = std::max(maxValue, samples[i]);
+        }
+        sink = sink + minValue + maxValue;
+    }
+    return ElapsedMs(start);
+}
+
+// Builds the pyramid of all the samples in the first frame of a new plot.
+static double TimePyramidBuild(
+    const std::vector<float>& samples,
+    bool                      isSimdEnabled)
+{
+    CustomWindowFunc funcs[] = { BlenderStyleTestLeftUpWindow, BlenderStyleTestLeftUpWindow };
+    DearImGuiExt::CustomTimeSeriesPlot plot("Sensor Plot");
+    DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, 2));
+    plot.Attach(layout.m_pRoot->GetRightChild());
+    plot.SetSimdEnabled(isSimdEnabled);
+    plot.Append(samples.data(), samples.size());
+    BuildFrame(layout);
+    return plot.GetStats().lastAppendMs;
+}
+
+// Frames panning by one sample, so that every Prepare downsamples again. Returns the mean downsampling time.
+static double RunPlotPanning(
+    DearImGuiExt::CustomLayout&         layout,
+    DearImGuiExt::CustomTimeSeriesPlot& plot,
+    DearImGuiExt::CustomPlotDecimation  decimation,
+    bool                                isSimdEnabled,
+    uint64_t                            sampleCount,
+    int                                 frameCount,
+    double*                             pFrameMs)
+{
+    plot.SetDecimation(decimation);
+    plot.SetSimdEnabled(isSimdEnabled);
+    double downsampleMs = 0.0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < frameCount; i++)
+    {
+        plot.SetViewRange((uint64_t)i, sampleCount - (uint64_t)frameCount + (uint64_t)i);
+        BuildFrame(layout);
+        downsampleMs += plot.GetStats().lastDownsampleMs;
+    }
+    *pFrameMs = ElapsedMs(start) / frameCount;
+    return downsampleMs / frameCount;
+}
+
+// A 10M sample series in a plot leaf next to the Blender style panel, at several panel widths: min/max and LTTB with and
+// without SIMD, frames with a fixed view, and a live series getting new samples every frame.
+static void BenchPlotDownsampling()
+{
+    constexpr size_t SampleCount = 10000000;
+    constexpr int FrameCount = 100;
+    constexpr int LiveSamplesPerFrame = 1000;
+    constexpr uint64_t LiveViewSamples = 1000000;
+    const float displayWidths[] = { 640.f, 1280.f, 1920.f, 3840.f };
+
+    std::vector<float> samples(SampleCount);
+    FillSensorSamples(samples);
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(displayWidths[0], 1080.f));
+    printf("[plot_downsampling] %zu samples in a plot leaf, %s kernels, Prepare inline.\n",
+           SampleCount,
+           DearImGuiExt::CustomTimeSeriesPlot::GetSimdName());
+    printf("  pyramid of all samples: %.2f ms, scalar %.2f ms\n", TimePyramidBuild(samples, true), TimePyramidBuild(samples, false));
+
+    {
+        // Without a job system Prepare runs at the start of the frame, so the frame times include the downsampling.
+        CustomWindowFunc funcs[] = { BlenderStyleTestLeftUpWindow, BlenderStyleTestLeftUpWindow };
+        DearImGuiExt::CustomTimeSeriesPlot plot("Sensor Plot");
+        DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, 2));
+        plot.Attach(layout.m_pRoot->GetRightChild());
+        plot.Append(samples.data(), samples.size());
+
+        for (float displayWidth : displayWidths)
+        {
+            ImGui::GetIO().DisplaySize = ImVec2(displayWidth, 1080.f);
+            for (int i = 0; i < 2; i++)
+            {
+                BuildFrame(layout); // The width of the leaf reaches Prepare a frame later.
+            }
+
+            double frameMs[4];
+            double minMaxMs = RunPlotPanning(layout, plot, DearImGuiExt::CustomPlotDecimation_MinMax, true, SampleCount, FrameCount, &frameMs[0]);
+            double minMaxScalarMs = RunPlotPanning(layout, plot, DearImGuiExt::CustomPlotDecimation_MinMax, false, SampleCount, FrameCount, &frameMs[1]);
+            int minMaxPoints = plot.GetStats().pointCount;
+            double lttbMs = RunPlotPanning(layout, plot, DearImGuiExt::CustomPlotDecimation_Lttb, true, SampleCount, FrameCount, &frameMs[2]);
+            double lttbScalarMs = RunPlotPanning(layout, plot, DearImGuiExt::CustomPlotDecimation_Lttb, false, SampleCount, FrameCount, &frameMs[3]);
+            int width = plot.GetStats().width;
+
+            // A fixed view only reuses the polyline.
+            plot.SetDecimation(DearImGuiExt::CustomPlotDecimation_MinMax);
+            plot.SetSimdEnabled(true);
+            uint64_t recomputeCount = plot.GetStats().recomputeCount;
+            Clock::time_point start = Clock::now();
+            for (int i = 0; i < FrameCount; i++)
+            {
+                BuildFrame(layout);
+            }
+            double fixedFrameMs = ElapsedMs(start) / FrameCount;
+
+            printf("  %4d px: min/max %.3f ms (scalar %.3f ms, %d points), LTTB %.3f ms (scalar %.3f ms), sample scan %.2f ms\n",
+                   width,
+                   minMaxMs,
+                   minMaxScalarMs,
+                   minMaxPoints,
+                   lttbMs,
+                   lttbScalarMs,
+                   TimeSampleScan(samples, width));
+            printf("           frames: panning %.3f ms (min/max), %.3f ms (LTTB), fixed view %.3f ms with %llu downsamplings\n",
+                   frameMs[0],
+                   frameMs[2],
+                   fixedFrameMs,
+                   (unsigned long long)(plot.GetStats().recomputeCount - recomputeCount));
+        }
+
+        // New samples every frame, the view follows the last 1M.
+        plot.SetViewLast(LiveViewSamples);
+        double appendMs = 0.0;
+        double downsampleMs = 0.0;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < FrameCount; i++)
+        {
+            size_t first = ((size_t)i * LiveSamplesPerFrame) % (SampleCount - LiveSamplesPerFrame);
+            plot.Append(samples.data() + first, LiveSamplesPerFrame);
+            BuildFrame(layout);
+            appendMs += plot.GetStats().lastAppendMs;
+            downsampleMs += plot.GetStats().lastDownsampleMs;
+        }
+        const DearImGuiExt::CustomPlotStats& stats = plot.GetStats();
+        printf("  live, %d samples per frame, last %llu shown: %.3f ms/frame, pyramid update %.3f ms, downsampling %.3f ms, %.1f MB\n",
+               LiveSamplesPerFrame,
+               (unsigned long long)LiveViewSamples,
+               ElapsedMs(start) / FrameCount,
+               appendMs / FrameCount,
+               downsampleMs / FrameCount,
+               (double)stats.pyramidBytes / (1024.0 * 1024.0));
+    }
+
+    ImGui::DestroyContext(pContext);
+}
+
+#ifdef CUSTOM_LAYOUT_COROUTINES
+// A panel that indexes a large dataset once, e.g. the parent links of a tree view. Its window function shows the progress.
+struct IndexedPanel
+{
+    ImVector<int> parents;
+    int           indexed;
+};
+
+static IndexedPanel g_IndexedPanel;
+
+static void IndexItem(IndexedPanel& panel, int item)
+{
+    uint32_t hash = (uint32_t)item * 2654435761u;
+    panel.parents[item] = (item == 0) ? -1 : (int)(hash % (uint32_t)item);
+    panel.indexed = item + 1;
+}
+
+static void IndexedPanelWindow()
+{
+    ImGui::Begin("Indexed Panel", nullptr, TestWindowFlag);
+    ImGui::ProgressBar((float)g_IndexedPanel.indexed / (float)g_IndexedPanel.parents.Size);
+    ImGui::Text("%d / %d items indexed", g_IndexedPanel.indexed, g_IndexedPanel.parents.Size);
+    ImGui::End();
+}
+
+static DearImGuiExt::CustomLeafTask IndexItemsCoroutine(IndexedPanel& panel)
+{
+    for (int item = 0; item < panel.parents.Size; item++)
+    {
+        IndexItem(panel, item);
+        if ((item % 1024) == 1023)
+        {
+            co_await DearImGuiExt::CustomBudgetCheck();
+        }
+    }
+}
+
+// Indexing 4M items in the first frame vs. a coroutine leaf spreading the work over frames with a 2 ms budget.
+static void BenchCoroutineLeaves()
+{
+    constexpr int ItemCount = 4 * 1024 * 1024;
+    constexpr int FrameCount = 300;
+
+    ImGuiContext* pContext = CreateHeadlessContext(ImVec2(1920.f, 1080.f));
+    printf("[coroutine_leaves] Indexing %d items next to the Blender style layout, %d frames.\n", ItemCount, FrameCount);
+
+    CustomWindowFunc funcs[] = { BlenderStyleTestLeftUpWindow, IndexedPanelWindow };
+    for (int useCoroutine = 0; useCoroutine < 2; useCoroutine++)
+    {
+        g_IndexedPanel.parents.resize(ItemCount);
+        g_IndexedPanel.indexed = 0;
+
+        DearImGuiExt::CustomLayout layout(BalancedLayout(funcs, 2));
+        if (useCoroutine)
+        {
+            layout.StartCoroutine(layout.m_pRoot->GetRightChild(), IndexItemsCoroutine(g_IndexedPanel));
+        }
+
+        double maxFrameMs = 0.0;
+        int doneFrame = -1;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < FrameCount; i++)
+        {
+            Clock::time_point frameStart = Clock::now();
+            if ((useCoroutine == 0) && (i == 0))
+            {
+                for (int item = 0; item < ItemCount; item++)
+                {
+                    IndexItem(g_IndexedPanel, item);
+                }
+            }
+            BuildFrame(layout);
+            maxFrameMs = std::max(maxFrameMs, ElapsedMs(frameStart));
+            if ((doneFrame < 0) && (g_IndexedPanel.indexed == ItemCount))
+            {
+                doneFrame = i;
+            }
+        }
+        double totalMs = ElapsedMs(start);
+
+        const DearImGuiExt::CustomLayoutStats& stats = layout.GetStats();
+        printf("  %s max frame %.3f ms, %.3f ms/frame, done in frame %d, %llu budget overruns (max %.3f ms)\n",
+               useCoroutine ? "coroutine:" : "one call: ",
+               maxFrameMs,
+               totalMs / FrameCount,
+               doneFrame,
+               (unsigned long long)stats.budgetOverruns,
+               stats.maxOverrunMs);
+    }
+
+    g_IndexedPanel.parents.clear();
+    ImGui::DestroyContext(pContext);
+}
+#endif
+
+struct Benchmark
+{
+    const char* pName;
+    void      (*pfnRun)();
+};
+
+static const Benchmark Benchmarks[] =
+{
+    { "render_thread", BenchRenderThread },
+    { "snapshot_pool", BenchSnapshotPool },
+    { "parallel_leaves", BenchParallelLeaves },
+    { "parallel_leaves_input", BenchParallelLeavesInput },
+    { "parallel_contexts", BenchParallelContexts },
+    { "two_phase", BenchTwoPhase },
+    { "mutation_queue", BenchMutationQueue },
+    { "split_merge", BenchSplitMerge },
+    { "history", BenchHistory },
+    { "workspaces", BenchWorkspaces },
+    { "warm_up", BenchWarmUp },
+    { "capacity_hwm", BenchCapacityHighWaterMark },
+    { "batched_updates", BenchBatchedUpdates },
+    { "constraints", BenchConstraints },
+    { "pixel_snap", BenchPixelSnap },
+    { "tabbed_leaves", BenchTabbedLeaves },
+    { "sub_layouts", BenchSubLayouts },
+    { "damage", BenchDamage },
+    { "draw_batching", BenchDrawBatching },
+#ifndef _WIN32
+    { "remote_stream", BenchRemoteStream },
+#endif
+    { "software_render", BenchSoftwareRender },
+    { "input_replay", BenchInputReplay },
+    { "log_console", BenchLogConsole },
+    { "plot_downsampling", BenchPlotDownsampling },
+#ifdef CUSTOM_LAYOUT_COROUTINES
+    { "coroutine_leaves", BenchCoroutineLeaves },
+#endif
+};
+
+int main(int argc, char** argv)
+{
+    const char* pSelected = (argc > 1) ? argv[1] : nullptr;
+    g_pInputTracePath = (argc > 2) ? argv[2] : nullptr;
+    ImGui::SetAllocatorFunctions(CountingAlloc, CountingFree);
+    bool found = false;
+
+    for (const Benchmark& benchmark : Benchmarks)
+    {
+        if ((pSelected == nullptr) || (strcmp(pSelected, benchmark.pName) == 0))
+        {
+            benchmark.pfnRun();
+            found = true;
+        }
+    }
+
+    if (found == false)
+    {
+        printf("Unknown benchmark '%s'. Available:\n", pSelected);
+        for (const Benchmark& benchmark : Benchmarks)
+        {
+            printf("  %s\n", benchmark.pName);
+        }
+        return 1;
+    }
+
+    return 0;
+}